@@ -0,0 +1,340 @@
+// ProcessGuard 管道协议压测工具，与 ProcessGuardClient.cpp 一起编译：
+//
+//   ProcessGuardBench.exe [heartbeat|status|add|all] [--clients N] [--rate HZ]
+//                         [--duration SEC] [--items N]
+//
+// heartbeat  N 个客户端（各自一条连接）按句柄经管道发送心跳，--rate 为每个客户端每秒的请求数，0 表示不限速
+// status     服务端分别有 10/100/1000 个监控项时连续调用 GetServiceStatus
+// add        连续添加 --items 个监控项
+//
+// 压测添加的监控项 ID 以 pgbench- 开头，结束时全部删除。status 与 add 的监控项处于停用状态，
+// 指向不存在的程序；heartbeat 的监控项处于启用状态，由服务以 idle 模式启动本程序的副本。
+// 每个场景输出吞吐量与 p50/p99/p999 延迟，可在修改前后各运行一次比较。
+
+#include "ProcessGuardClient.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const char *BENCH_ID_PREFIX = "pgbench-";
+    const int STATUS_ITEM_COUNTS[] = {10, 100, 1000};
+    // heartbeat 场景的每个监控项对应一个正在运行的进程，数量不随 --items 变化
+    const int HEARTBEAT_ITEM_COUNT = 16;
+
+    struct Options
+    {
+        std::string scenario = "all";
+        int clients = 8;
+        int rate = 0;
+        int durationSec = 10;
+        int items = 100;
+    };
+
+    // 每个线程各自记录，结束后合并，记录过程不加锁
+    struct LatencyRecorder
+    {
+        std::vector<double> samplesUs;
+        size_t failures = 0;
+
+        void Record(Clock::duration elapsed, bool ok)
+        {
+            samplesUs.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+            if (!ok)
+                failures++;
+        }
+
+        void Merge(const LatencyRecorder &other)
+        {
+            samplesUs.insert(samplesUs.end(), other.samplesUs.begin(), other.samplesUs.end());
+            failures += other.failures;
+        }
+    };
+
+    double Percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    void Report(const std::string &name, LatencyRecorder &recorder, Clock::duration wall)
+    {
+        std::vector<double> &samples = recorder.samplesUs;
+        std::sort(samples.begin(), samples.end());
+        double seconds = std::chrono::duration<double>(wall).count();
+        double throughput = seconds > 0 ? samples.size() / seconds : 0.0;
+
+        printf("%-24s %10zu req %10.0f req/s  p50 %8.1f us  p99 %8.1f us  p999 %8.1f us  max %8.1f us  failed %zu\n",
+               name.c_str(), samples.size(), throughput,
+               Percentile(samples, 0.50), Percentile(samples, 0.99), Percentile(samples, 0.999),
+               samples.empty() ? 0.0 : samples.back(), recorder.failures);
+    }
+
+    ProcessGuard::MonitorItem BenchItem(int index)
+    {
+        std::string id = BENCH_ID_PREFIX + std::to_string(index);
+        ProcessGuard::MonitorItem item(id, "C:\\ProcessGuardBench\\" + id + ".exe", id);
+        item.enabled = false;
+        item.heartbeatTimeoutMs = 86400000;
+        return item;
+    }
+
+    // 本程序的副本所在目录；服务不允许两个监控项使用同一路径，每个监控项一个副本
+    std::filesystem::path HeartbeatCopyDir()
+    {
+        char self[MAX_PATH] = {};
+        GetModuleFileNameA(nullptr, self, MAX_PATH);
+        return std::filesystem::path(self).parent_path() / "pgbench-items";
+    }
+
+    std::filesystem::path HeartbeatCopyPath(int index)
+    {
+        return HeartbeatCopyDir() / ("pgbench-hb-" + std::to_string(index) + ".exe");
+    }
+
+    ProcessGuard::MonitorItem HeartbeatItem(int index)
+    {
+        std::string id = BENCH_ID_PREFIX + std::string("hb-") + std::to_string(index);
+        ProcessGuard::MonitorItem item(id, HeartbeatCopyPath(index).string(), id);
+        item.args = "idle";
+        item.noWindow = true;
+        item.heartbeatTimeoutMs = 86400000;
+        return item;
+    }
+
+    bool ConnectClient(ProcessGuard::Client &client)
+    {
+        if (client.Connect())
+            return true;
+        fprintf(stderr, "连接服务失败: %s\n", client.GetLastError().c_str());
+        return false;
+    }
+
+    // 补齐 count 个压测监控项并返回它们的句柄
+    std::vector<uint32_t> EnsureBenchItems(ProcessGuard::Client &client, int count)
+    {
+        std::map<std::string, uint32_t> existing;
+        for (const auto &item : client.GetAllMonitorItems())
+        {
+            if (item.id.rfind(BENCH_ID_PREFIX, 0) == 0)
+                existing[item.id] = item.handle;
+        }
+
+        std::vector<uint32_t> handles;
+        for (int i = 0; i < count; i++)
+        {
+            ProcessGuard::MonitorItem item = BenchItem(i);
+            auto found = existing.find(item.id);
+            uint32_t handle = 0;
+            if (found != existing.end())
+                handle = found->second;
+            else if (!client.AddMonitorItem(item, handle))
+                fprintf(stderr, "添加监控项 %s 失败: %s\n", item.id.c_str(), client.GetLastError().c_str());
+            if (handle != 0)
+                handles.push_back(handle);
+        }
+        return handles;
+    }
+
+    // 复制本程序并添加启用的监控项，返回它们的句柄
+    std::vector<uint32_t> EnsureHeartbeatItems(ProcessGuard::Client &client)
+    {
+        char self[MAX_PATH] = {};
+        GetModuleFileNameA(nullptr, self, MAX_PATH);
+        std::error_code ec;
+        std::filesystem::create_directories(HeartbeatCopyDir(), ec);
+
+        std::vector<ProcessGuard::MonitorItem> items;
+        for (int i = 0; i < HEARTBEAT_ITEM_COUNT; i++)
+        {
+            // 上次压测留下的副本可能仍在运行，已存在时直接使用
+            std::filesystem::copy_file(self, HeartbeatCopyPath(i), std::filesystem::copy_options::skip_existing, ec);
+            if (ec)
+                fprintf(stderr, "复制 %s 失败: %s\n", HeartbeatCopyPath(i).string().c_str(), ec.message().c_str());
+            items.push_back(HeartbeatItem(i));
+        }
+
+        std::vector<uint32_t> handles;
+        if (!client.ApplyMonitorItems(items, {}, handles))
+            fprintf(stderr, "添加心跳监控项失败: %s\n", client.GetLastError().c_str());
+        return handles;
+    }
+
+    // 监控项删除后服务结束对应的进程，副本在进程退出后才能删除
+    void RemoveHeartbeatCopies()
+    {
+        for (int i = 0; i < HEARTBEAT_ITEM_COUNT; i++)
+        {
+            std::error_code ec;
+            for (int attempt = 0; attempt < 50 && !std::filesystem::remove(HeartbeatCopyPath(i), ec) && ec; attempt++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        std::error_code ec;
+        std::filesystem::remove(HeartbeatCopyDir(), ec);
+    }
+
+    void RemoveBenchItems(ProcessGuard::Client &client)
+    {
+        std::vector<std::string> ids;
+        for (const auto &item : client.GetAllMonitorItems())
+        {
+            if (item.id.rfind(BENCH_ID_PREFIX, 0) == 0)
+                ids.push_back(item.id);
+        }
+        if (!ids.empty() && !client.ApplyMonitorItems({}, ids))
+            fprintf(stderr, "删除压测监控项失败: %s\n", client.GetLastError().c_str());
+    }
+
+    void RunHeartbeat(const Options &options)
+    {
+        ProcessGuard::Client setup;
+        if (!ConnectClient(setup))
+            return;
+        std::vector<uint32_t> handles = EnsureHeartbeatItems(setup);
+        if (handles.empty())
+            return;
+
+        std::vector<LatencyRecorder> recorders(options.clients);
+        std::vector<std::thread> threads;
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadline = start + std::chrono::seconds(options.durationSec);
+        Clock::duration interval = options.rate > 0
+                                       ? std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / options.rate
+                                       : Clock::duration::zero();
+
+        for (int c = 0; c < options.clients; c++)
+        {
+            threads.emplace_back([&, c]()
+                                 {
+                ProcessGuard::Client client;
+                if (!ConnectClient(client))
+                    return;
+                // 客户端只接受自己取得过的句柄，先列出一次；测量的是管道往返，不写共享内存
+                client.GetAllMonitorItems();
+                client.SetSharedHeartbeatEnabled(false);
+                LatencyRecorder &recorder = recorders[c];
+                size_t next = static_cast<size_t>(c);
+                Clock::time_point due = Clock::now();
+                while (Clock::now() < deadline)
+                {
+                    if (interval != Clock::duration::zero())
+                    {
+                        std::this_thread::sleep_until(due);
+                        due += interval;
+                    }
+                    uint32_t handle = handles[next++ % handles.size()];
+                    Clock::time_point sent = Clock::now();
+                    bool ok = client.SendHeartbeat(handle);
+                    recorder.Record(Clock::now() - sent, ok);
+                } });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        LatencyRecorder total;
+        for (const auto &recorder : recorders)
+            total.Merge(recorder);
+        Report("heartbeat pipe x" + std::to_string(options.clients), total, Clock::now() - start);
+    }
+
+    void RunStatus(const Options &options)
+    {
+        ProcessGuard::Client client;
+        if (!ConnectClient(client))
+            return;
+
+        for (int count : STATUS_ITEM_COUNTS)
+        {
+            EnsureBenchItems(client, count);
+            LatencyRecorder recorder;
+            Clock::time_point start = Clock::now();
+            Clock::time_point deadline = start + std::chrono::seconds(options.durationSec);
+            while (Clock::now() < deadline)
+            {
+                Clock::time_point sent = Clock::now();
+                ProcessGuard::ServiceStatus status = client.GetServiceStatus();
+                recorder.Record(Clock::now() - sent, status.serviceRunning);
+            }
+            Report("status " + std::to_string(count) + " items", recorder, Clock::now() - start);
+        }
+    }
+
+    void RunAdd(const Options &options)
+    {
+        ProcessGuard::Client client;
+        if (!ConnectClient(client))
+            return;
+
+        RemoveBenchItems(client);
+        LatencyRecorder recorder;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < options.items; i++)
+        {
+            ProcessGuard::MonitorItem item = BenchItem(i);
+            Clock::time_point sent = Clock::now();
+            bool ok = client.AddMonitorItem(item);
+            recorder.Record(Clock::now() - sent, ok);
+        }
+        Report("add burst " + std::to_string(options.items), recorder, Clock::now() - start);
+    }
+
+    bool ParseArgs(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--clients" && hasValue)
+                options.clients = std::max(1, atoi(argv[++i]));
+            else if (arg == "--rate" && hasValue)
+                options.rate = std::max(0, atoi(argv[++i]));
+            else if (arg == "--duration" && hasValue)
+                options.durationSec = std::max(1, atoi(argv[++i]));
+            else if (arg == "--items" && hasValue)
+                options.items = std::max(1, atoi(argv[++i]));
+            else if (arg == "heartbeat" || arg == "status" || arg == "add" || arg == "all")
+                options.scenario = arg;
+            else
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // heartbeat 场景中由服务启动的副本，保持运行直到监控项被删除
+    if (argc == 2 && strcmp(argv[1], "idle") == 0)
+    {
+        for (;;)
+            std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+
+    Options options;
+    if (!ParseArgs(argc, argv, options))
+    {
+        fprintf(stderr, "用法: %s [heartbeat|status|add|all] [--clients N] [--rate HZ] [--duration SEC] [--items N]\n", argv[0]);
+        return 2;
+    }
+
+    bool all = options.scenario == "all";
+    if (all || options.scenario == "add")
+        RunAdd(options);
+    if (all || options.scenario == "heartbeat")
+        RunHeartbeat(options);
+    if (all || options.scenario == "status")
+        RunStatus(options);
+
+    ProcessGuard::Client cleanup;
+    if (cleanup.Connect())
+        RemoveBenchItems(cleanup);
+    RemoveHeartbeatCopies();
+    return 0;
+}
@@ -3,6 +3,9 @@
 #include <sstream>
 #include <filesystem>
 #include <condition_variable>
+#include <deque>
+#include <random>
+#include <cstring>
 
 #ifdef _WIN32
 #include <winsvc.h>
@@ -20,18 +23,375 @@ namespace ProcessGuard
     static const size_t PIPE_BUFFER_SIZE = 65536;
     static const DWORD PIPE_REQUEST_TIMEOUT_MS = 3000;
 
-    class PipeClient
+    static const DWORD PIPE_MAX_FRAME_SIZE = 16 * 1024 * 1024;
+    static const DWORD PIPE_SESSION_RECONNECT_TIMEOUT_MS = 1000;
+
+    // 异步请求一次流水线写出的上限。服务端处理完一批并写完应答后才继续读取，
+    // 请求总量保持在管道缓冲区一半以内，避免双方同时阻塞在写入上
+    static const size_t ASYNC_PIPELINE_DEPTH = 32;
+    static const size_t ASYNC_PIPELINE_MAX_BYTES = PIPE_BUFFER_SIZE / 2;
+
+    // 与服务端 shared_heartbeat.rs 中的段名和布局一致
+    static const char *SHARED_HEARTBEAT_NAME = "Global\\ProcessGuardHeartbeats";
+    static const uint32_t SHARED_HEARTBEAT_MAGIC = 0x42484750;
+    static const uint32_t SHARED_HEARTBEAT_VERSION = 2;
+
+    // 心跳间隔为 0 时按 heartbeatTimeoutMs / 3 选择，限制在以下范围内；超时未知时使用默认值
+    static const int HEARTBEAT_DEFAULT_INTERVAL_MS = 500;
+    static const int HEARTBEAT_MIN_INTERVAL_MS = 100;
+    static const int HEARTBEAT_MAX_INTERVAL_MS = 60000;
+    // 每次心跳的间隔随机浮动上下十分之一，避免多个客户端重新对齐
+    static const int HEARTBEAT_JITTER_DIVISOR = 10;
+    // 服务不可达时全部心跳暂停，等待时间从下限起加倍到上限，连接恢复后清零
+    static const int HEARTBEAT_OUTAGE_BACKOFF_MIN_MS = 500;
+    static const int HEARTBEAT_OUTAGE_BACKOFF_MAX_MS = 30000;
+
+    // 备用实例重复发送 ready 查询是否已被提升的间隔
+    static const DWORD READY_POLL_INTERVAL_MS = 100;
+
+    // 与服务端 SUBSCRIBE_MAX_WAIT_MS 一致
+    static const int STATUS_SUBSCRIBE_MAX_WAIT_MS = 30000;
+    static const DWORD STATUS_SUBSCRIBE_RETRY_MS = 1000;
+
+    // 只取出响应顶层 success 与 message 的 SAX 处理器，其余字段直接跳过
+    class ReplyStatusSax : public nlohmann::json_sax<nlohmann::json>
     {
     public:
-        PipeClient() : pipeHandle_(INVALID_HANDLE_VALUE), connected_(false) {}
+        bool success = false;
+        std::string message;
 
-        ~PipeClient() { Disconnect(); }
+        bool null() override { return true; }
+        bool boolean(bool value) override
+        {
+            if (depth_ == 1 && key_ == Key::Success)
+                success = value;
+            return true;
+        }
+        bool number_integer(number_integer_t) override { return true; }
+        bool number_unsigned(number_unsigned_t) override { return true; }
+        bool number_float(number_float_t, const string_t &) override { return true; }
+        bool string(string_t &value) override
+        {
+            if (depth_ == 1 && key_ == Key::Message)
+                message = std::move(value);
+            return true;
+        }
+        bool binary(binary_t &) override { return true; }
+        bool start_object(std::size_t) override
+        {
+            ++depth_;
+            return true;
+        }
+        bool key(string_t &name) override
+        {
+            if (depth_ == 1)
+                key_ = name == "success" ? Key::Success : (name == "message" ? Key::Message : Key::Other);
+            return true;
+        }
+        bool end_object() override
+        {
+            --depth_;
+            return true;
+        }
+        bool start_array(std::size_t) override
+        {
+            ++depth_;
+            return true;
+        }
+        bool end_array() override
+        {
+            --depth_;
+            return true;
+        }
+        bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &e) override
+        {
+            success = false;
+            message = std::string("Parse error: ") + e.what();
+            return false;
+        }
+
+    private:
+        enum class Key
+        {
+            Other,
+            Success,
+            Message
+        };
+
+        int depth_ = 0;
+        Key key_ = Key::Other;
+    };
+
+    class PipeClient
+    {
+    public:
+        PipeClient() : pipeHandle_(INVALID_HANDLE_VALUE), connected_(false), sessionMode_(false),
+                       binaryMode_(false), serverEpoch_(0), sessionSupport_(SessionSupport::Unknown),
+                       ioTimeoutMs_(PIPE_REQUEST_TIMEOUT_MS),
+                       cancelEvent_(CreateEventA(nullptr, TRUE, FALSE, nullptr)),
+                       readEvent_(CreateEventA(nullptr, TRUE, FALSE, nullptr)),
+                       writeEvent_(CreateEventA(nullptr, TRUE, FALSE, nullptr)),
+                       recvLength_(0) {}
+
+        ~PipeClient()
+        {
+            Disconnect();
+            for (HANDLE event : {cancelEvent_, readEvent_, writeEvent_})
+            {
+                if (event)
+                    CloseHandle(event);
+            }
+        }
 
         bool Connect(int timeoutMs)
         {
             std::lock_guard<std::mutex> lock(mutex_);
+            return ConnectInternal(timeoutMs);
+        }
+
+        void Disconnect()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            DisconnectInternal();
+        }
+
+        bool IsConnected() const { return connected_; }
+        bool IsBinaryMode() const { return binaryMode_; }
+        // 最近一次握手时服务端的 epoch，服务重启后改变；旧服务端为 0
+        uint64_t ServerEpoch() const { return serverEpoch_; }
+
+        // 单次读写的等待上限，长轮询连接需要比服务端的等待时间更长
+        void SetIoTimeout(DWORD timeoutMs) { ioTimeoutMs_ = timeoutMs; }
+
+        // 让正在等待的读写立即失败并阻止后续请求，可从其他线程调用；Reset 后恢复
+        void Cancel()
+        {
+            if (cancelEvent_)
+                SetEvent(cancelEvent_);
+        }
+
+        void ResetCancel()
+        {
+            if (cancelEvent_)
+                ResetEvent(cancelEvent_);
+        }
+
+        nlohmann::json SendRequest(const nlohmann::json &request)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            const char *error = Transact(request.dump());
+            if (error)
+                return {{"success", false}, {"message", error}};
+            return ParseReply(recvBuffer_.data(), recvLength_);
+        }
+
+        // 在会话连接上一次写出多个请求帧，再按顺序读回响应（服务端按帧顺序处理并应答）。
+        // 返回成功读到的响应数，replies 与 requests 的前若干项一一对应；
+        // 一次性模式的旧服务端不支持流水线，逐个请求并在每次之后重连
+        size_t SendPipelined(const std::vector<std::string> &requests, std::vector<nlohmann::json> &replies)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            replies.clear();
+
+            if (!connected_ || requests.empty())
+                return 0;
+
+            if (!sessionMode_)
+            {
+                for (const auto &request : requests)
+                {
+                    if (!connected_ && !ConnectInternal(PIPE_SESSION_RECONNECT_TIMEOUT_MS))
+                        break;
+                    if (Transact(request))
+                        break;
+                    replies.push_back(ParseReply(recvBuffer_.data(), recvLength_));
+                }
+                return replies.size();
+            }
+
+            sendBuffer_.clear();
+            for (const auto &request : requests)
+                AppendFrame(request, sendBuffer_);
+
+            // 与 Transact 相同，写入失败时请求尚未送达，重连后重试一次
+            if (!WriteAll(sendBuffer_.data(), static_cast<DWORD>(sendBuffer_.size())))
+            {
+                if (!ConnectInternal(PIPE_SESSION_RECONNECT_TIMEOUT_MS) || !sessionMode_ ||
+                    !WriteAll(sendBuffer_.data(), static_cast<DWORD>(sendBuffer_.size())))
+                {
+                    DisconnectInternal();
+                    return 0;
+                }
+            }
+
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                if (!ReadFrame())
+                {
+                    DisconnectInternal();
+                    break;
+                }
+                replies.push_back(ParseReply(recvBuffer_.data(), recvLength_));
+            }
+            return replies.size();
+        }
+
+        // 只需要判断成功与否的请求（心跳、增删改）用 SAX 只取出顶层的 success 与 message，不构造 JSON DOM
+        bool SendRequestStatus(const nlohmann::json &request, std::string &message)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            const char *error = Transact(request.dump());
+            if (error)
+            {
+                message = error;
+                return false;
+            }
+
+            ReplyStatusSax sax;
+            nlohmann::json::sax_parse(recvBuffer_.data(), recvBuffer_.data() + recvLength_, &sax);
+            message = std::move(sax.message);
+            return sax.success;
+        }
+
+        // 在协商了二进制报文的会话上发送一个二进制报文，成功时 reply 为响应报文
+        // 重连后的服务端不支持二进制报文时返回 false 但保持连接，由调用方改用 JSON
+        bool SendBinary(const std::string &payload, std::string &reply)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (!connected_ || !binaryMode_)
+                return false;
+
+            sendBuffer_.clear();
+            AppendFrame(payload, sendBuffer_);
+
+            if (!WriteAll(sendBuffer_.data(), static_cast<DWORD>(sendBuffer_.size())))
+            {
+                if (!ConnectInternal(PIPE_SESSION_RECONNECT_TIMEOUT_MS) || !binaryMode_)
+                    return false;
+                if (!WriteAll(sendBuffer_.data(), static_cast<DWORD>(sendBuffer_.size())))
+                {
+                    DisconnectInternal();
+                    return false;
+                }
+            }
+
+            if (!ReadFrame())
+            {
+                DisconnectInternal();
+                return false;
+            }
+            reply.assign(recvBuffer_.data(), recvLength_);
+            return true;
+        }
+
+    private:
+        enum class SessionSupport
+        {
+            Unknown,
+            Supported,
+            Unsupported
+        };
+
+        HANDLE pipeHandle_;
+        bool connected_;
+        bool sessionMode_;
+        bool binaryMode_;
+        uint64_t serverEpoch_;
+        SessionSupport sessionSupport_;
+        DWORD ioTimeoutMs_;
+        HANDLE cancelEvent_;
+        // 每次读写复用的 OVERLAPPED 事件，ReadFile/WriteFile 开始时会自动复位
+        HANDLE readEvent_;
+        HANDLE writeEvent_;
+        // 复用的发送帧与接收缓冲区，只增长不收缩；recvBuffer_ 的前 recvLength_ 字节为最近一次响应
+        std::string sendBuffer_;
+        std::vector<char> recvBuffer_;
+        size_t recvLength_;
+        std::mutex mutex_;
+
+        enum class ReadResult
+        {
+            Data,
+            Closed,
+            Failed
+        };
+
+        // 发送请求并把响应读入 recvBuffer_，失败时返回错误消息
+        const char *Transact(const std::string &requestStr)
+        {
+            if (!connected_)
+                return "Not connected";
+
+            if (sessionMode_)
+            {
+                sendBuffer_.clear();
+                AppendFrame(requestStr, sendBuffer_);
+
+                // 复用的会话连接可能已被服务端关闭（例如服务重启），写入失败时请求尚未送达，可安全重连重试一次
+                bool written = WriteAll(sendBuffer_.data(), static_cast<DWORD>(sendBuffer_.size()));
+                if (!written && !ConnectInternal(PIPE_SESSION_RECONNECT_TIMEOUT_MS))
+                    return "Write failed or timed out";
+
+                if (sessionMode_)
+                {
+                    if (!written && !WriteAll(sendBuffer_.data(), static_cast<DWORD>(sendBuffer_.size())))
+                    {
+                        DisconnectInternal();
+                        return "Write failed or timed out";
+                    }
+                    if (!ReadFrame())
+                    {
+                        DisconnectInternal();
+                        return "Read failed or timed out";
+                    }
+                    return nullptr;
+                }
+            }
+
+            if (!WriteAll(requestStr.c_str(), static_cast<DWORD>(requestStr.length())))
+            {
+                DisconnectInternal();
+                return "Write failed or timed out";
+            }
+
+            // 一次性模式: 兼容不支持会话的旧服务端，每个请求后断开
+            bool readOk = ReadUntilComplete();
+            DisconnectInternal();
+            return readOk ? nullptr : "Read failed or timed out";
+        }
+
+        bool ConnectInternal(int timeoutMs)
+        {
             DisconnectInternal();
 
+            if (!OpenPipe(timeoutMs))
+                return false;
+
+            if (sessionSupport_ == SessionSupport::Unsupported)
+                return true;
+
+            SessionSupport support = NegotiateSession();
+            if (support == SessionSupport::Supported)
+            {
+                sessionSupport_ = SessionSupport::Supported;
+                sessionMode_ = true;
+                return true;
+            }
+
+            DisconnectInternal();
+            if (support == SessionSupport::Unknown)
+                return false;
+
+            // 旧服务端处理完握手请求就会断开，需要重新打开管道并走一次性模式
+            sessionSupport_ = SessionSupport::Unsupported;
+            return OpenPipe(timeoutMs);
+        }
+
+        bool OpenPipe(int timeoutMs)
+        {
             DWORD startTime = GetTickCount();
 
             while (true)
@@ -70,139 +430,636 @@ namespace ProcessGuard
             return false;
         }
 
-        void Disconnect()
+        SessionSupport NegotiateSession()
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            DisconnectInternal();
-        }
+            nlohmann::json handshake;
+            handshake["type"] = "session";
+            handshake["binary"] = true;
+            std::string handshakeStr = handshake.dump();
 
-        bool IsConnected() const { return connected_; }
+            if (!WriteAll(handshakeStr.c_str(), static_cast<DWORD>(handshakeStr.length())) ||
+                !ReadHandshakeReply())
+            {
+                return SessionSupport::Unknown;
+            }
 
-        nlohmann::json SendRequest(const nlohmann::json &request)
+            nlohmann::json response = ParseReply(recvBuffer_.data(), recvLength_);
+            if (!response.is_object() || !response.value("success", false))
+                return SessionSupport::Unsupported;
+
+            // 只支持会话帧的服务端不返回 binary 字段
+            binaryMode_ = response.contains("data") && response["data"].is_object() &&
+                          response["data"].value("binary", false);
+            serverEpoch_ = response.contains("data") && response["data"].is_object()
+                               ? response["data"].value("epoch", uint64_t(0))
+                               : 0;
+            return SessionSupport::Supported;
+        }
+
+        static void AppendFrame(const std::string &payload, std::string &frame)
         {
-            std::lock_guard<std::mutex> lock(mutex_);
+            const uint32_t length = static_cast<uint32_t>(payload.size());
+            frame.reserve(frame.size() + sizeof(length) + payload.size());
+            for (int i = 0; i < 4; i++)
+            {
+                frame.push_back(static_cast<char>((length >> (8 * i)) & 0xFF));
+            }
+            frame.append(payload);
+        }
 
-            if (!connected_)
+        static nlohmann::json ParseReply(const char *data, size_t size)
+        {
+            try
+            {
+                return nlohmann::json::parse(data, data + size);
+            }
+            catch (const std::exception &e)
             {
-                return {{"success", false}, {"message", "Not connected"}};
+                return {{"success", false}, {"message", std::string("Parse error: ") + e.what()}};
             }
+            catch (...)
+            {
+                return {{"success", false}, {"message", "Unknown parse error"}};
+            }
+        }
+
+        bool WriteAll(const char *data, DWORD size)
+        {
+            if (!writeEvent_)
+                return false;
 
-            std::string requestStr = request.dump();
             DWORD bytesWritten = 0;
             OVERLAPPED writeOverlapped = {};
-            writeOverlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
-            if (!writeOverlapped.hEvent)
-            {
-                DisconnectInternal();
-                return {{"success", false}, {"message", "Write event creation failed"}};
-            }
+            writeOverlapped.hEvent = writeEvent_;
 
-            BOOL writeIssued = WriteFile(
-                pipeHandle_,
-                requestStr.c_str(),
-                static_cast<DWORD>(requestStr.length()),
-                &bytesWritten,
-                &writeOverlapped);
-            if (!writeIssued)
+            if (!WriteFile(pipeHandle_, data, size, &bytesWritten, &writeOverlapped))
             {
                 DWORD error = GetLastError();
                 if (error != ERROR_IO_PENDING ||
-                    !WaitForOverlappedIo(writeOverlapped, PIPE_REQUEST_TIMEOUT_MS, bytesWritten))
+                    WaitForOverlappedIo(writeOverlapped, ioTimeoutMs_, bytesWritten) != ERROR_SUCCESS)
                 {
-                    CloseHandle(writeOverlapped.hEvent);
-                    DisconnectInternal();
-                    return {{"success", false}, {"message", "Write failed or timed out"}};
+                    return false;
                 }
             }
-            CloseHandle(writeOverlapped.hEvent);
 
-            if (bytesWritten != requestStr.length())
+            return bytesWritten == size;
+        }
+
+        ReadResult ReadChunk(char *data, DWORD size, DWORD &bytesRead)
+        {
+            bytesRead = 0;
+            if (!readEvent_)
+                return ReadResult::Failed;
+
+            OVERLAPPED readOverlapped = {};
+            readOverlapped.hEvent = readEvent_;
+
+            DWORD error = ERROR_SUCCESS;
+            if (!ReadFile(pipeHandle_, data, size, &bytesRead, &readOverlapped))
+            {
+                error = GetLastError();
+                if (error == ERROR_IO_PENDING)
+                    error = WaitForOverlappedIo(readOverlapped, ioTimeoutMs_, bytesRead);
+            }
+
+            // 消息模式管道中一条消息超过缓冲区时返回 ERROR_MORE_DATA，已读出的部分有效，继续读取剩余部分
+            if (error == ERROR_SUCCESS || error == ERROR_MORE_DATA)
+                return bytesRead > 0 ? ReadResult::Data : ReadResult::Closed;
+            if (error == ERROR_BROKEN_PIPE || error == ERROR_PIPE_NOT_CONNECTED)
+                return ReadResult::Closed;
+            return ReadResult::Failed;
+        }
+
+        bool ReadExact(char *data, DWORD size)
+        {
+            DWORD total = 0;
+            while (total < size)
             {
-                DisconnectInternal();
-                return {{"success", false}, {"message", "Write incomplete"}};
+                DWORD bytesRead = 0;
+                if (ReadChunk(data + total, size - total, bytesRead) != ReadResult::Data)
+                    return false;
+                total += bytesRead;
             }
+            return true;
+        }
+
+        // 保证 recvBuffer_ 在 recvLength_ 之后至少还有 space 字节；只在首次或遇到更大的响应时扩容
+        void ReserveReceive(size_t space)
+        {
+            if (recvBuffer_.size() < recvLength_ + space)
+                recvBuffer_.resize(recvLength_ + space);
+        }
 
-            char buffer[PIPE_BUFFER_SIZE] = {0};
+        // 握手响应不带帧头且连接保持打开，响应很短，服务端一次写出
+        bool ReadHandshakeReply()
+        {
+            recvLength_ = 0;
+            ReserveReceive(PIPE_BUFFER_SIZE);
             DWORD bytesRead = 0;
-            OVERLAPPED readOverlapped = {};
-            readOverlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
-            if (!readOverlapped.hEvent)
+            if (ReadChunk(recvBuffer_.data(), static_cast<DWORD>(PIPE_BUFFER_SIZE), bytesRead) != ReadResult::Data)
+                return false;
+            recvLength_ = bytesRead;
+            return true;
+        }
+
+        // 一次性模式的响应没有帧头，读到完整的 JSON 或服务端关闭连接为止，超过 64KB 的响应也能完整读出
+        bool ReadUntilComplete()
+        {
+            recvLength_ = 0;
+            while (recvLength_ < PIPE_MAX_FRAME_SIZE)
             {
-                DisconnectInternal();
-                return {{"success", false}, {"message", "Read event creation failed"}};
+                ReserveReceive(PIPE_BUFFER_SIZE);
+                DWORD bytesRead = 0;
+                ReadResult result = ReadChunk(recvBuffer_.data() + recvLength_, static_cast<DWORD>(PIPE_BUFFER_SIZE), bytesRead);
+                if (result == ReadResult::Failed)
+                    return false;
+                if (result == ReadResult::Closed)
+                    return recvLength_ > 0;
+
+                recvLength_ += bytesRead;
+                if (nlohmann::json::accept(recvBuffer_.data(), recvBuffer_.data() + recvLength_))
+                    return true;
             }
+            return false;
+        }
 
-            BOOL readIssued = ReadFile(
-                pipeHandle_,
-                buffer,
-                PIPE_BUFFER_SIZE - 1,
-                &bytesRead,
-                &readOverlapped);
-            if (!readIssued)
+        bool ReadFrame()
+        {
+            recvLength_ = 0;
+            unsigned char header[4] = {0};
+            if (!ReadExact(reinterpret_cast<char *>(header), sizeof(header)))
+                return false;
+
+            const uint32_t length = static_cast<uint32_t>(header[0]) |
+                                    (static_cast<uint32_t>(header[1]) << 8) |
+                                    (static_cast<uint32_t>(header[2]) << 16) |
+                                    (static_cast<uint32_t>(header[3]) << 24);
+            if (length > PIPE_MAX_FRAME_SIZE)
+                return false;
+
+            ReserveReceive(length);
+            if (length > 0 && !ReadExact(recvBuffer_.data(), length))
+                return false;
+            recvLength_ = length;
+            return true;
+        }
+
+        // 返回 I/O 的结果码：ERROR_SUCCESS、ERROR_MORE_DATA 等，超时返回 WAIT_TIMEOUT，取消返回 ERROR_OPERATION_ABORTED
+        DWORD WaitForOverlappedIo(OVERLAPPED &overlapped, DWORD timeoutMs, DWORD &transferred)
+        {
+            HANDLE events[2] = {overlapped.hEvent, cancelEvent_};
+            DWORD eventCount = cancelEvent_ ? 2 : 1;
+            DWORD waitResult = WaitForMultipleObjects(eventCount, events, FALSE, timeoutMs);
+            if (waitResult == WAIT_OBJECT_0)
             {
-                DWORD error = GetLastError();
-                if (error != ERROR_IO_PENDING ||
-                    !WaitForOverlappedIo(readOverlapped, PIPE_REQUEST_TIMEOUT_MS, bytesRead) ||
-                    bytesRead == 0)
-                {
-                    CloseHandle(readOverlapped.hEvent);
-                    DisconnectInternal();
-                    return {{"success", false}, {"message", "Read failed or timed out"}};
-                }
+                return GetOverlappedResult(pipeHandle_, &overlapped, &transferred, FALSE) ? ERROR_SUCCESS : GetLastError();
             }
-            CloseHandle(readOverlapped.hEvent);
 
-            if (bytesRead == 0)
+            // 取消后必须等到 I/O 真正结束，否则 overlapped 所在的栈空间会被内核继续写入
+            CancelIoEx(pipeHandle_, &overlapped);
+            GetOverlappedResult(pipeHandle_, &overlapped, &transferred, TRUE);
+            return waitResult == WAIT_TIMEOUT ? static_cast<DWORD>(WAIT_TIMEOUT) : static_cast<DWORD>(ERROR_OPERATION_ABORTED);
+        }
+
+        void DisconnectInternal()
+        {
+            if (pipeHandle_ != INVALID_HANDLE_VALUE)
             {
-                DisconnectInternal();
-                return {{"success", false}, {"message", "Read failed"}};
+                CloseHandle(pipeHandle_);
+                pipeHandle_ = INVALID_HANDLE_VALUE;
             }
+            connected_ = false;
+            sessionMode_ = false;
+            binaryMode_ = false;
+        }
+    };
 
-            buffer[bytesRead] = '\0';
+    // 二进制报文，与服务端 wire.rs 对应:
+    // [magic u8][opcode u8][flags u16][item_index u32][timestamp i64]，小端，后接负载
+    static const uint8_t WIRE_MAGIC = 0xB7;
+    static const size_t WIRE_HEADER_SIZE = 16;
+    static const uint8_t WIRE_OP_HEARTBEAT = 0x01;
+    static const uint8_t WIRE_OP_HEARTBEAT_BATCH = 0x02;
+    static const uint8_t WIRE_OP_STATUS = 0x03;
+    static const uint8_t WIRE_OP_REPLY = 0x80;
+    static const uint16_t WIRE_FLAG_OK = 0x0001;
+    static const uint16_t WIRE_FLAG_HANDLES = 0x0002;
+    // 按句柄的心跳负载以 u64 epoch 开头，服务端拒绝上一次运行分配的句柄
+    static const uint16_t WIRE_FLAG_EPOCH = 0x0004;
+    // status 请求该标志时每个监控项追加作业、就绪、备用实例与指标字段，支持的服务端在响应中回显
+    static const uint16_t WIRE_FLAG_EXTENDED = 0x0008;
+
+    static const uint8_t WIRE_STATUS_ENABLED = 0x01;
+    static const uint8_t WIRE_STATUS_ALIVE = 0x02;
+    static const uint8_t WIRE_STATUS_HEARTBEAT_OK = 0x04;
+    static const uint8_t WIRE_STATUS_RESTART_PENDING = 0x08;
+
+    static const uint8_t WIRE_STATUS_HAS_JOB = 0x01;
+    static const uint8_t WIRE_STATUS_READY = 0x02;
+    static const uint8_t WIRE_STATUS_HAS_STANDBY = 0x04;
+    static const uint8_t WIRE_STATUS_STANDBY_READY = 0x08;
+
+    template <typename T>
+    static void AppendWireValue(std::string &out, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+        }
+    }
 
-            DisconnectInternal();
+    // 超过 u16 的部分在 UTF-8 字符边界处截断，与服务端 put_str 一致
+    static void AppendWireString(std::string &out, const std::string &value)
+    {
+        size_t length = (std::min)(value.size(), static_cast<size_t>(0xFFFF));
+        while (length < value.size() && length > 0 && (static_cast<unsigned char>(value[length]) & 0xC0) == 0x80)
+            length--;
+        AppendWireValue(out, static_cast<uint16_t>(length));
+        out.append(value, 0, length);
+    }
 
-            try
+    class WireReader
+    {
+    public:
+        explicit WireReader(const std::string &data) : data_(data), pos_(0) {}
+
+        bool AtEnd() const { return pos_ >= data_.size(); }
+
+        template <typename T>
+        bool Read(T &value)
+        {
+            if (data_.size() - pos_ < sizeof(T))
+                return false;
+
+            uint64_t result = 0;
+            for (size_t i = 0; i < sizeof(T); i++)
             {
-                return nlohmann::json::parse(buffer);
+                result |= static_cast<uint64_t>(static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
             }
-            catch (const std::exception &e)
+            value = static_cast<T>(result);
+            pos_ += sizeof(T);
+            return true;
+        }
+
+        bool ReadDouble(double &value)
+        {
+            uint64_t bits = 0;
+            if (!Read(bits))
+                return false;
+            std::memcpy(&value, &bits, sizeof(value));
+            return true;
+        }
+
+        bool ReadString(std::string &value)
+        {
+            uint16_t length = 0;
+            if (!Read(length) || data_.size() - pos_ < length)
+                return false;
+
+            value.assign(data_, pos_, length);
+            pos_ += length;
+            return true;
+        }
+
+    private:
+        const std::string &data_;
+        size_t pos_;
+    };
+
+    enum class WireResult
+    {
+        Ok,          // 服务端处理成功，reply 为响应负载
+        Rejected,    // 服务端返回错误，reply 为错误消息
+        Unavailable, // 连接未协商二进制报文，调用方改用 JSON
+        Failed       // 传输失败或响应无效
+    };
+
+    static int64_t UnixTimeMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // replyIndex、replyFlagsOut 非空时返回响应报文头中的 item_index 与标志位
+    static WireResult SendWireRequest(PipeClient &pipe, uint8_t opcode, uint16_t flags, uint32_t itemIndex,
+                                      int64_t timestamp, const std::string &body, std::string &reply,
+                                      uint32_t *replyIndex = nullptr, uint16_t *replyFlagsOut = nullptr)
+    {
+        if (!pipe.IsBinaryMode())
+            return WireResult::Unavailable;
+
+        std::string request;
+        request.reserve(WIRE_HEADER_SIZE + body.size());
+        AppendWireValue(request, WIRE_MAGIC);
+        AppendWireValue(request, opcode);
+        AppendWireValue(request, flags);
+        AppendWireValue(request, itemIndex);
+        AppendWireValue(request, timestamp);
+        request.append(body);
+
+        std::string message;
+        if (!pipe.SendBinary(request, message))
+        {
+            reply = "Binary request failed";
+            return (pipe.IsConnected() && !pipe.IsBinaryMode()) ? WireResult::Unavailable : WireResult::Failed;
+        }
+
+        WireReader reader(message);
+        uint8_t magic = 0;
+        uint8_t replyOpcode = 0;
+        uint16_t replyFlags = 0;
+        uint32_t replyItemIndex = 0;
+        int64_t replyTimestamp = 0;
+        if (!reader.Read(magic) || !reader.Read(replyOpcode) || !reader.Read(replyFlags) ||
+            !reader.Read(replyItemIndex) || !reader.Read(replyTimestamp) ||
+            magic != WIRE_MAGIC || replyOpcode != (opcode | WIRE_OP_REPLY))
+        {
+            reply = "Invalid binary reply";
+            return WireResult::Failed;
+        }
+
+        if (replyIndex)
+            *replyIndex = replyItemIndex;
+        if (replyFlagsOut)
+            *replyFlagsOut = replyFlags;
+        if (replyFlags & WIRE_FLAG_OK)
+        {
+            reply = message.substr(WIRE_HEADER_SIZE);
+            return WireResult::Ok;
+        }
+
+        if (!reader.ReadString(reply))
+            reply = "Unknown error";
+        return WireResult::Rejected;
+    }
+
+    // 扩展字段见服务端 wire.rs 的 encode_status
+    static bool ParseWireStatusExtension(WireReader &reader, ProcessStatus &ps)
+    {
+        uint8_t state = 0;
+        uint32_t standbyProcessId = 0;
+        uint32_t jobActive = 0;
+        uint32_t jobTotal = 0;
+        uint8_t gaugeCount = 0;
+        if (!reader.Read(state) || !reader.Read(standbyProcessId) || !reader.Read(jobActive) ||
+            !reader.Read(jobTotal) || !reader.Read(ps.jobCpuTimeMs) || !reader.Read(ps.jobPeakMemoryBytes) ||
+            !reader.Read(gaugeCount))
+        {
+            return false;
+        }
+
+        ps.hasJob = (state & WIRE_STATUS_HAS_JOB) != 0;
+        ps.jobActiveProcesses = static_cast<int>(jobActive);
+        ps.jobTotalProcesses = static_cast<int>(jobTotal);
+        ps.isReady = (state & WIRE_STATUS_READY) != 0;
+        if (state & WIRE_STATUS_HAS_STANDBY)
+        {
+            ps.standbyProcessId = static_cast<int>(standbyProcessId);
+            ps.standbyReady = (state & WIRE_STATUS_STANDBY_READY) != 0;
+        }
+
+        for (uint8_t i = 0; i < gaugeCount; i++)
+        {
+            std::string name;
+            GaugeStats stats;
+            uint32_t samples = 0;
+            if (!reader.ReadString(name) || !reader.ReadDouble(stats.last) || !reader.ReadDouble(stats.min) ||
+                !reader.ReadDouble(stats.max) || !reader.ReadDouble(stats.mean) || !reader.Read(samples) ||
+                !reader.Read(stats.ageMs))
             {
-                return {{"success", false}, {"message", std::string("Parse error: ") + e.what()}};
+                return false;
             }
-            catch (...)
+            stats.samples = static_cast<int>(samples);
+            ps.gauges[name] = stats;
+        }
+        return true;
+    }
+
+    // extended 为响应是否带 WIRE_FLAG_EXTENDED，旧服务端的响应只有基本字段
+    static bool ParseWireStatus(const std::string &body, bool extended, ServiceStatus &status)
+    {
+        WireReader reader(body);
+        uint32_t count = 0;
+        if (!reader.Read(count))
+            return false;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            ProcessStatus ps;
+            uint32_t processId = 0;
+            uint32_t restartCount = 0;
+            uint64_t lastHeartbeatMs = 0;
+            uint64_t heartbeatTimeoutMs = 0;
+            uint8_t state = 0;
+            if (!reader.Read(processId) || !reader.Read(restartCount) ||
+                !reader.Read(lastHeartbeatMs) || !reader.Read(heartbeatTimeoutMs) ||
+                !reader.Read(state) || !reader.ReadString(ps.id) || !reader.ReadString(ps.name) ||
+                !reader.ReadString(ps.exePath) || !reader.ReadString(ps.lastRestartReason))
             {
-                return {{"success", false}, {"message", "Unknown parse error"}};
+                return false;
             }
+
+            ps.processId = static_cast<int>(processId);
+            ps.restartCount = static_cast<int>(restartCount);
+            ps.lastHeartbeatMs = static_cast<int64_t>(lastHeartbeatMs);
+            ps.heartbeatTimeoutMs = static_cast<int>(heartbeatTimeoutMs);
+            ps.enabled = (state & WIRE_STATUS_ENABLED) != 0;
+            ps.isAlive = (state & WIRE_STATUS_ALIVE) != 0;
+            ps.isHeartbeatOk = (state & WIRE_STATUS_HEARTBEAT_OK) != 0;
+            ps.restartPending = (state & WIRE_STATUS_RESTART_PENDING) != 0;
+            if (extended && !ParseWireStatusExtension(reader, ps))
+                return false;
+            status.items.push_back(ps);
         }
 
-    private:
-        HANDLE pipeHandle_;
-        bool connected_;
-        std::mutex mutex_;
+        status.serviceRunning = true;
+        status.totalItems = static_cast<int>(count);
+        return true;
+    }
+
+    // status 与 subscribe 响应中单个监控项的 JSON
+    static void ParseGaugeStats(const nlohmann::json &data, std::map<std::string, GaugeStats> &out)
+    {
+        if (!data.is_object())
+            return;
+        for (auto it = data.begin(); it != data.end(); ++it)
+        {
+            const auto &value = it.value();
+            GaugeStats stats;
+            stats.last = value.value("last", 0.0);
+            stats.min = value.value("min", 0.0);
+            stats.max = value.value("max", 0.0);
+            stats.mean = value.value("mean", 0.0);
+            stats.samples = value.value("samples", 0);
+            stats.ageMs = value.value("age_ms", uint64_t(0));
+            out[it.key()] = stats;
+        }
+    }
+
+    static ProcessStatus ParseProcessStatus(const nlohmann::json &item)
+    {
+        ProcessStatus ps;
+        ps.id = item.value("id", "");
+        ps.name = item.value("name", "");
+        ps.exePath = item.value("exe_path", "");
+        ps.enabled = item.value("enabled", false);
+        if (item.contains("process_id") && !item["process_id"].is_null())
+        {
+            ps.processId = item.value("process_id", 0);
+        }
+        else
+        {
+            ps.processId = 0;
+        }
+        ps.lastHeartbeatMs = item.value("last_heartbeat_ms", 0);
+        ps.heartbeatTimeoutMs = item.value("heartbeat_timeout_ms", 1000);
+        ps.restartCount = item.value("restart_count", 0);
+        ps.restartPending = item.value("restart_pending", false);
+        if (item.contains("last_restart_reason") && item["last_restart_reason"].is_string())
+        {
+            ps.lastRestartReason = item["last_restart_reason"].get<std::string>();
+        }
+        ps.isAlive = item.value("is_alive", false);
+        ps.isHeartbeatOk = item.value("is_heartbeat_ok", false);
+        if (item.contains("job") && item["job"].is_object())
+        {
+            const auto &job = item["job"];
+            ps.hasJob = true;
+            ps.jobActiveProcesses = job.value("active_processes", 0);
+            ps.jobTotalProcesses = job.value("total_processes", 0);
+            ps.jobCpuTimeMs = job.value("cpu_time_ms", uint64_t(0));
+            ps.jobPeakMemoryBytes = job.value("peak_memory_bytes", uint64_t(0));
+        }
+        if (item.contains("gauges"))
+            ParseGaugeStats(item["gauges"], ps.gauges);
+        ps.isReady = item.value("is_ready", false);
+        if (item.contains("standby") && item["standby"].is_object())
+        {
+            ps.standbyProcessId = item["standby"].value("process_id", 0);
+            ps.standbyReady = item["standby"].value("is_ready", false);
+        }
+        return ps;
+    }
+
+    // status 响应的 data；单个监控项解析失败时跳过并通过 error 返回原因
+    static void ParseServiceStatus(const nlohmann::json &data, ServiceStatus &status, std::string &error)
+    {
+        try
+        {
+            status.serviceRunning = data.value("service_running", false);
+            status.totalItems = data.value("total_items", 0);
+
+            if (data.contains("items") && data["items"].is_array())
+            {
+                for (const auto &item : data["items"])
+                {
+                    try
+                    {
+                        status.items.push_back(ParseProcessStatus(item));
+                    }
+                    catch (const std::exception &e)
+                    {
+                        error = std::string("Parse process status error: ") + e.what();
+                        continue;
+                    }
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            error = std::string("Parse status error: ") + e.what();
+        }
+    }
+
+    static StatusEventType ParseStatusEventType(const std::string &name)
+    {
+        if (name == "started")
+            return StatusEventType::Started;
+        if (name == "died")
+            return StatusEventType::Died;
+        if (name == "restarted")
+            return StatusEventType::Restarted;
+        if (name == "heartbeat_late")
+            return StatusEventType::HeartbeatLate;
+        if (name == "config_changed")
+            return StatusEventType::ConfigChanged;
+        if (name == "removed")
+            return StatusEventType::Removed;
+        return StatusEventType::Unknown;
+    }
 
-        bool WaitForOverlappedIo(OVERLAPPED &overlapped, DWORD timeoutMs, DWORD &transferred)
+    static nlohmann::json MonitorItemToJson(const MonitorItem &item)
+    {
+        nlohmann::json config;
+        config["id"] = item.id;
+        config["exe_path"] = item.exePath;
+        config["name"] = item.name;
+        config["minimize"] = item.minimize;
+        config["no_window"] = item.noWindow;
+        config["enabled"] = item.enabled;
+        config["heartbeat_timeout_ms"] = static_cast<int64_t>(item.heartbeatTimeoutMs);
+        if (!item.args.empty())
         {
-            DWORD waitResult = WaitForSingleObject(overlapped.hEvent, timeoutMs);
-            if (waitResult == WAIT_OBJECT_0)
-            {
-                return GetOverlappedResult(pipeHandle_, &overlapped, &transferred, FALSE) != FALSE;
-            }
-
-            CancelIoEx(pipeHandle_, &overlapped);
-            return false;
+            config["args"] = item.args;
         }
-
-        void DisconnectInternal()
+        if (item.limits.Any())
         {
-            if (pipeHandle_ != INVALID_HANDLE_VALUE)
-            {
-                CloseHandle(pipeHandle_);
-                pipeHandle_ = INVALID_HANDLE_VALUE;
-            }
-            connected_ = false;
+            nlohmann::json limits;
+            if (item.limits.maxWorkingSetMb)
+                limits["max_working_set_mb"] = item.limits.maxWorkingSetMb;
+            if (item.limits.maxPrivateMb)
+                limits["max_private_mb"] = item.limits.maxPrivateMb;
+            if (item.limits.maxHandles)
+                limits["max_handles"] = item.limits.maxHandles;
+            if (item.limits.maxCpuPercent > 0)
+                limits["max_cpu_percent"] = item.limits.maxCpuPercent;
+            limits["cpu_sustain_ms"] = (std::max)(0, item.limits.cpuSustainMs);
+            config["limits"] = limits;
         }
-    };
+        if (item.readyTimeoutMs > 0)
+            config["ready_timeout_ms"] = static_cast<int64_t>(item.readyTimeoutMs);
+        if (item.standby)
+            config["standby"] = true;
+        return config;
+    }
+
+    static bool ValidateMonitorItem(const MonitorItem &item, std::string &error)
+    {
+        if (item.id.empty())
+            error = "Item ID cannot be empty";
+        else if (item.exePath.empty())
+            error = "Executable path cannot be empty";
+        else if (item.name.empty())
+            error = "Item name cannot be empty";
+        else
+            return true;
+        return false;
+    }
+
+    static HistogramSummary ParseHistogramSummary(const nlohmann::json &item)
+    {
+        HistogramSummary summary;
+        summary.unit = item.value("unit", "");
+        summary.count = item.value("count", uint64_t(0));
+        summary.sum = item.value("sum", uint64_t(0));
+        summary.max = item.value("max", uint64_t(0));
+        summary.mean = item.value("mean", uint64_t(0));
+        summary.p50 = item.value("p50", uint64_t(0));
+        summary.p90 = item.value("p90", uint64_t(0));
+        summary.p99 = item.value("p99", uint64_t(0));
+        summary.p999 = item.value("p999", uint64_t(0));
+        return summary;
+    }
+
+    static void ParseHistogramMap(const nlohmann::json &data, const char *key,
+                                  std::map<std::string, HistogramSummary> &out)
+    {
+        if (!data.contains(key) || !data[key].is_object())
+            return;
+        for (auto it = data[key].begin(); it != data[key].end(); ++it)
+            out[it.key()] = ParseHistogramSummary(it.value());
+    }
 
     class ServiceManager
     {
@@ -371,55 +1228,687 @@ namespace ProcessGuard
             SERVICE_STATUS status;
             BOOL result = ControlService(svc, SERVICE_CONTROL_STOP, &status);
 
-            if (result)
+            if (result)
+            {
+                for (int i = 0; i < 60; i++)
+                {
+                    if (QueryServiceStatus(svc, &status) &&
+                        status.dwCurrentState == SERVICE_STOPPED)
+                    {
+                        break;
+                    }
+                    Sleep(500);
+                }
+            }
+
+            CloseServiceHandle(svc);
+            CloseServiceHandle(scm);
+            return true;
+        }
+    };
+
+    // 异步请求的 I/O 线程，使用独立的会话连接，不与同步调用争用管道锁。
+    // 排队的请求按批流水线写出：一次写入多个帧，再按顺序读回各自的响应
+    class AsyncPipe
+    {
+    public:
+        using Completion = std::function<void(const nlohmann::json &)>;
+
+        AsyncPipe() : pipe_(std::make_unique<PipeClient>()) {}
+
+        ~AsyncPipe() { Stop(); }
+
+        // 停止后提交的请求立即以失败完成
+        void Submit(const nlohmann::json &request, Completion done)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!stopping_)
+                {
+                    queue_.push_back({request.dump(), std::move(done)});
+                    if (!thread_.joinable())
+                        thread_ = std::thread([this]()
+                                              { Run(); });
+                    cv_.notify_all();
+                    return;
+                }
+            }
+            Complete(done, Failure("Client is shutting down"));
+        }
+
+        // 中断进行中的请求并让所有未完成的请求以失败完成
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+            pipe_->Cancel();
+            if (thread_.joinable())
+                thread_.join();
+            pipe_->Disconnect();
+
+            std::deque<Pending> remaining;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                remaining.swap(queue_);
+            }
+            for (auto &pending : remaining)
+                Complete(pending.done, Failure("Client is shutting down"));
+        }
+
+    private:
+        struct Pending
+        {
+            std::string request;
+            Completion done;
+        };
+
+        std::unique_ptr<PipeClient> pipe_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Pending> queue_;
+        std::thread thread_;
+        bool stopping_ = false;
+
+        static nlohmann::json Failure(const std::string &message)
+        {
+            return {{"success", false}, {"message", message}};
+        }
+
+        // 回调运行在 I/O 线程上，异常不能让线程退出
+        static void Complete(const Completion &done, const nlohmann::json &reply)
+        {
+            if (!done)
+                return;
+            try
+            {
+                done(reply);
+            }
+            catch (...)
+            {
+            }
+        }
+
+        void Run()
+        {
+            std::vector<Pending> batch;
+            std::vector<std::string> requests;
+            std::vector<nlohmann::json> replies;
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopping_)
+            {
+                if (queue_.empty())
+                {
+                    cv_.wait(lock);
+                    continue;
+                }
+
+                // 至少取一个请求，超大的单个请求也能单独发出
+                size_t bytes = 0;
+                batch.clear();
+                while (!queue_.empty() && batch.size() < ASYNC_PIPELINE_DEPTH &&
+                       (batch.empty() || bytes + queue_.front().request.size() <= ASYNC_PIPELINE_MAX_BYTES))
+                {
+                    bytes += queue_.front().request.size();
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+                lock.unlock();
+
+                requests.clear();
+                for (const auto &pending : batch)
+                    requests.push_back(pending.request);
+
+                size_t answered = 0;
+                replies.clear();
+                if (pipe_->IsConnected() || pipe_->Connect(PIPE_SESSION_RECONNECT_TIMEOUT_MS))
+                    answered = pipe_->SendPipelined(requests, replies);
+
+                for (size_t i = 0; i < batch.size(); ++i)
+                    Complete(batch[i].done, i < answered ? replies[i] : Failure("Failed to communicate with service"));
+
+                lock.lock();
+            }
+        }
+    };
+
+    // 服务端开启 shared_heartbeat 时创建的心跳共享内存。按句柄的心跳只把
+    // GetTickCount64 写入句柄对应的槽位，服务端检查心跳前读取，不发送管道请求
+    class SharedHeartbeatView
+    {
+    public:
+        ~SharedHeartbeatView()
+        {
+            if (view_)
+                UnmapViewOfFile(view_);
+            if (mapping_)
+                CloseHandle(mapping_);
+        }
+
+        // 服务端未开启共享内存或布局版本不一致时返回 false
+        bool Open()
+        {
+            mapping_ = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, SHARED_HEARTBEAT_NAME);
+            if (!mapping_)
+                return false;
+
+            view_ = MapViewOfFile(mapping_, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+            if (!view_)
+                return false;
+
+            const auto *header = static_cast<const std::atomic<uint32_t> *>(view_);
+            if (header[0].load(std::memory_order_acquire) != SHARED_HEARTBEAT_MAGIC ||
+                header[1].load(std::memory_order_relaxed) != SHARED_HEARTBEAT_VERSION)
+                return false;
+
+            slotCount_ = header[2].load(std::memory_order_relaxed);
+            epoch_ = reinterpret_cast<const std::atomic<uint64_t> *>(static_cast<char *>(view_) + 16);
+            slots_ = reinterpret_cast<std::atomic<uint64_t> *>(
+                static_cast<char *>(view_) + header[3].load(std::memory_order_relaxed));
+            return true;
+        }
+
+        // 句柄超出槽位范围，或段头的 epoch 不是取得句柄时的 epoch（服务已重启）时返回 false，
+        // 由调用方改用管道发送
+        bool Write(uint32_t handle, uint64_t epoch)
+        {
+            if (handle == 0 || handle >= slotCount_ || epoch == 0 ||
+                epoch_->load(std::memory_order_acquire) != epoch)
+                return false;
+            slots_[handle].store(GetTickCount64(), std::memory_order_release);
+            return true;
+        }
+
+    private:
+        static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "shared slot layout");
+
+        HANDLE mapping_ = nullptr;
+        void *view_ = nullptr;
+        const std::atomic<uint64_t> *epoch_ = nullptr;
+        std::atomic<uint64_t> *slots_ = nullptr;
+        uint32_t slotCount_ = 0;
+    };
+
+    class Client::HeartbeatScheduler
+    {
+    public:
+        // 监控项 ID 或句柄，按句柄调度时 ID 为空
+        using Target = std::pair<std::string, uint32_t>;
+        // 返回发送后服务是否可达，不可达时所有监控项一起退避
+        using SendBatchFn = std::function<bool(const std::vector<Target> &)>;
+
+        explicit HeartbeatScheduler(SendBatchFn sendBatch)
+            : sendBatch_(std::move(sendBatch)), random_(std::random_device{}()) {}
+
+        ~HeartbeatScheduler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+                entries_.clear();
+            }
+            cv_.notify_all();
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+        void Add(const Target &target, int intervalMs)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_ || entries_.find(target) != entries_.end())
+                    return;
+
+                // 首次心跳在一个间隔内随机错开，同时启动的多个客户端不会同时请求
+                intervalMs = (std::max)(1, intervalMs);
+                auto phase = std::uniform_int_distribution<int>(0, intervalMs - 1)(random_);
+                entries_[target] = {intervalMs, Clock::now() + std::chrono::milliseconds(phase)};
+                if (!thread_.joinable())
+                    thread_ = std::thread([this]()
+                                          { Run(); });
+            }
+            cv_.notify_all();
+        }
+
+        // 返回后不会再为该监控项发送心跳（等待进行中的批量请求完成）
+        void Remove(const Target &target)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            entries_.erase(target);
+            WaitForSendLocked(lock);
+        }
+
+        void Clear()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            entries_.clear();
+            WaitForSendLocked(lock);
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            int intervalMs;
+            Clock::time_point nextDue;
+        };
+
+        SendBatchFn sendBatch_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::map<Target, Entry> entries_;
+        std::thread thread_;
+        bool stopping_ = false;
+        bool sending_ = false;
+        std::mt19937 random_;
+        int outageBackoffMs_ = 0;
+
+        Clock::duration JitteredInterval(int intervalMs)
+        {
+            int jitter = intervalMs / HEARTBEAT_JITTER_DIVISOR;
+            int offset = jitter > 0 ? std::uniform_int_distribution<int>(-jitter, jitter)(random_) : 0;
+            return std::chrono::milliseconds(intervalMs + offset);
+        }
+
+        // 服务不可达时推迟全部监控项，不再按各自的间隔反复尝试连接
+        void BackOffLocked(Clock::time_point now)
+        {
+            outageBackoffMs_ = outageBackoffMs_ == 0
+                                   ? HEARTBEAT_OUTAGE_BACKOFF_MIN_MS
+                                   : (std::min)(outageBackoffMs_ * 2, HEARTBEAT_OUTAGE_BACKOFF_MAX_MS);
+            auto retryAt = now + std::chrono::milliseconds(outageBackoffMs_);
+            for (auto &pair : entries_)
+                pair.second.nextDue = (std::max)(pair.second.nextDue, retryAt);
+        }
+
+        void WaitForSendLocked(std::unique_lock<std::mutex> &lock)
+        {
+            // 心跳失败回调中调用 Stop* 时运行在调度线程上，不能等待自己
+            if (std::this_thread::get_id() == thread_.get_id())
+                return;
+            cv_.wait(lock, [this]()
+                     { return !sending_; });
+        }
+
+        void Run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopping_)
+            {
+                if (entries_.empty())
+                {
+                    cv_.wait(lock);
+                    continue;
+                }
+
+                auto now = Clock::now();
+                auto nextDue = Clock::time_point::max();
+                for (const auto &pair : entries_)
+                    nextDue = (std::min)(nextDue, pair.second.nextDue);
+
+                if (nextDue > now)
+                {
+                    cv_.wait_until(lock, nextDue);
+                    continue;
+                }
+
+                // 将即将到期（四分之一间隔内）的监控项一并发送，减少请求次数
+                std::vector<Target> batch;
+                for (auto &pair : entries_)
+                {
+                    auto slack = std::chrono::milliseconds(pair.second.intervalMs / 4);
+                    if (pair.second.nextDue <= now + slack)
+                    {
+                        batch.push_back(pair.first);
+                        pair.second.nextDue = now + JitteredInterval(pair.second.intervalMs);
+                    }
+                }
+
+                sending_ = true;
+                lock.unlock();
+                bool reachable = sendBatch_(batch);
+                lock.lock();
+                sending_ = false;
+                if (reachable)
+                    outageBackoffMs_ = 0;
+                else
+                    BackOffLocked(Clock::now());
+                cv_.notify_all();
+            }
+        }
+    };
+
+    struct Client::Impl
+    {
+        std::unique_ptr<PipeClient> pipeClient;
+        std::unique_ptr<ServiceManager> serviceManager;
+
+        std::unique_ptr<HeartbeatScheduler> heartbeatScheduler;
+        std::atomic<bool> heartbeatBatchSupported{true};
+
+        std::function<void(const std::string &)> heartbeatFailedCallback;
+        std::function<void(bool)> connectedChangedCallback;
+        std::function<Gauges(const std::string &)> heartbeatGaugeProvider;
+
+        std::atomic<bool> connected{false};
+        mutable std::string lastError;
+        std::string selfMonitorId;
+
+        // 每次连接成功后尝试打开，打开后一直使用到客户端析构
+        std::mutex sharedMutex;
+        std::unique_ptr<SharedHeartbeatView> sharedHeartbeats;
+
+        void OpenSharedHeartbeats()
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            if (sharedHeartbeats)
+                return;
+            auto view = std::make_unique<SharedHeartbeatView>();
+            if (view->Open())
+                sharedHeartbeats = std::move(view);
+        }
+
+        std::atomic<bool> sharedHeartbeatEnabled{true};
+
+        bool WriteSharedHeartbeat(uint32_t handle, uint64_t epoch)
+        {
+            if (!sharedHeartbeatEnabled)
+                return false;
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            return sharedHeartbeats && sharedHeartbeats->Write(handle, epoch);
+        }
+
+        // 监控项有当前运行的句柄时写入共享内存
+        bool WriteSharedHeartbeat(const std::string &itemId)
+        {
+            uint64_t epoch = 0;
+            uint32_t handle = HandleForItem(itemId, epoch);
+            return handle != 0 && WriteSharedHeartbeat(handle, epoch);
+        }
+
+        // 句柄与监控项 ID 的双向映射，只保存 handleEpoch 对应的那次服务运行分配的句柄，
+        // 用于校验按句柄发送的心跳、失败时回调 ID 以及按 ID 发送时改用句柄；
+        // ID 到心跳超时，用于自动选择心跳间隔
+        std::mutex handleMutex;
+        uint64_t handleEpoch = 0;
+        std::map<uint32_t, std::string> handleIds;
+        std::map<std::string, uint32_t> itemHandles;
+        std::map<std::string, int> heartbeatTimeouts;
+
+        // 服务重启后 epoch 改变，同一数字可能已分给其他监控项，丢弃上次运行的全部句柄，
+        // 之后从 add/batch/list 的响应中重新取得。旧服务端的 epoch 为 0，句柄一直保留
+        void ObserveEpochLocked(uint64_t epoch)
+        {
+            if (epoch == 0 || epoch == handleEpoch)
+                return;
+            handleEpoch = epoch;
+            handleIds.clear();
+            itemHandles.clear();
+        }
+
+        // epoch 为 0 时取连接握手时的 epoch
+        void RememberItem(uint32_t handle, const MonitorItem &item, uint64_t epoch = 0)
+        {
+            std::lock_guard<std::mutex> lock(handleMutex);
+            RememberHandleLocked(handle, item.id, epoch);
+            heartbeatTimeouts[item.id] = item.heartbeatTimeoutMs;
+        }
+
+        void RememberHandle(uint32_t handle, const std::string &itemId)
+        {
+            std::lock_guard<std::mutex> lock(handleMutex);
+            RememberHandleLocked(handle, itemId, 0);
+        }
+
+        void RememberHandleLocked(uint32_t handle, const std::string &itemId, uint64_t epoch)
+        {
+            ObserveEpochLocked(epoch != 0 ? epoch : pipeClient->ServerEpoch());
+            if (handle != 0)
+            {
+                handleIds[handle] = itemId;
+                itemHandles[itemId] = handle;
+            }
+        }
+
+        int HeartbeatIntervalFor(const HeartbeatScheduler::Target &target, int intervalMs)
+        {
+            if (intervalMs > 0)
+                return intervalMs;
+
+            std::lock_guard<std::mutex> lock(handleMutex);
+            std::string itemId = target.first;
+            if (target.second != 0)
+            {
+                auto handle = handleIds.find(target.second);
+                if (handle != handleIds.end())
+                    itemId = handle->second;
+            }
+            auto timeout = heartbeatTimeouts.find(itemId);
+            if (timeout == heartbeatTimeouts.end())
+                return HEARTBEAT_DEFAULT_INTERVAL_MS;
+            return (std::min)((std::max)(timeout->second / 3, HEARTBEAT_MIN_INTERVAL_MS), HEARTBEAT_MAX_INTERVAL_MS);
+        }
+
+        // 先按连接最近一次握手的 epoch 丢弃失效的句柄；epoch 为发送时附带的值，由服务端再校验一次
+        bool IsKnownHandle(uint32_t handle, uint64_t &epoch)
+        {
+            std::lock_guard<std::mutex> lock(handleMutex);
+            ObserveEpochLocked(pipeClient->ServerEpoch());
+            epoch = handleEpoch;
+            return handleIds.count(handle) != 0;
+        }
+
+        // 监控项在当前运行中的句柄，未知时返回 0
+        uint32_t HandleForItem(const std::string &itemId, uint64_t &epoch)
+        {
+            std::lock_guard<std::mutex> lock(handleMutex);
+            ObserveEpochLocked(pipeClient->ServerEpoch());
+            epoch = handleEpoch;
+            auto it = itemHandles.find(itemId);
+            return it != itemHandles.end() ? it->second : 0;
+        }
+
+        // 不是本客户端从 add/batch/list 响应中取得的句柄，不写共享内存也不发送
+        bool RejectUnknownHandle(uint32_t handle)
+        {
+            lastError = "Heartbeat failed: unknown handle: " + std::to_string(handle);
+            if (heartbeatFailedCallback)
+                heartbeatFailedCallback(std::to_string(handle));
+            return false;
+        }
+
+        std::string ItemIdForHandle(uint32_t handle)
+        {
+            std::lock_guard<std::mutex> lock(handleMutex);
+            auto it = handleIds.find(handle);
+            return it != handleIds.end() ? it->second : std::to_string(handle);
+        }
+
+        // 带指标的心跳只走 JSON 请求；request 中已填好 item_id 或 handle
+        bool SendGaugeHeartbeat(nlohmann::json request, const Gauges &gauges, const std::string &itemId)
+        {
+            request["type"] = "heartbeat";
+            request["timestamp"] = UnixTimeMs();
+            request["gauges"] = gauges;
+
+            std::string message;
+            bool success = pipeClient->SendRequestStatus(request, message);
+            connected = pipeClient->IsConnected();
+            if (!success)
+            {
+                lastError = "Heartbeat failed: " + (message.empty() ? std::string("Unknown error") : message);
+                if (heartbeatFailedCallback)
+                    heartbeatFailedCallback(itemId);
+            }
+            return success;
+        }
+
+        // 状态订阅使用独立连接，长轮询期间不阻塞其他请求
+        std::unique_ptr<PipeClient> statusPipe;
+        std::thread statusThread;
+        std::mutex statusMutex;
+        std::condition_variable statusCv;
+        bool statusStopping = false;
+
+        // 等待一段时间，订阅被取消时提前返回 false
+        bool WaitStatusRetry(DWORD delayMs)
+        {
+            std::unique_lock<std::mutex> lock(statusMutex);
+            return !statusCv.wait_for(lock, std::chrono::milliseconds(delayMs),
+                                      [this]
+                                      { return statusStopping; });
+        }
+
+        bool IsStatusStopping()
+        {
+            std::lock_guard<std::mutex> lock(statusMutex);
+            return statusStopping;
+        }
+
+        void RunStatusSubscription(const std::function<void(const StatusUpdate &)> &callback, int waitMs)
+        {
+            uint64_t version = 0;
+            uint64_t epoch = 0;
+
+            while (!IsStatusStopping())
             {
-                for (int i = 0; i < 60; i++)
+                if (!statusPipe->IsConnected() && !statusPipe->Connect(PIPE_SESSION_RECONNECT_TIMEOUT_MS))
                 {
-                    if (QueryServiceStatus(svc, &status) &&
-                        status.dwCurrentState == SERVICE_STOPPED)
-                    {
+                    if (!WaitStatusRetry(STATUS_SUBSCRIBE_RETRY_MS))
+                        break;
+                    continue;
+                }
+
+                nlohmann::json request;
+                request["type"] = "subscribe";
+                request["wait_ms"] = waitMs;
+                if (version != 0)
+                {
+                    request["since_version"] = version;
+                    request["epoch"] = epoch;
+                }
+
+                auto response = statusPipe->SendRequest(request);
+                if (!response.is_object() || !response.value("success", false) ||
+                    !response.contains("data") || !response["data"].is_object())
+                {
+                    if (!WaitStatusRetry(STATUS_SUBSCRIBE_RETRY_MS))
                         break;
+                    continue;
+                }
+
+                StatusUpdate update;
+                try
+                {
+                    const auto &data = response["data"];
+                    epoch = data.value("epoch", static_cast<uint64_t>(0));
+                    version = data.value("version", static_cast<uint64_t>(0));
+                    update.version = version;
+                    update.snapshot = data.value("snapshot", false);
+
+                    if (update.snapshot && data.contains("items") && data["items"].is_array())
+                    {
+                        for (const auto &item : data["items"])
+                            update.items.push_back(ParseProcessStatus(item));
                     }
-                    Sleep(500);
+
+                    if (data.contains("events") && data["events"].is_array())
+                    {
+                        for (const auto &item : data["events"])
+                        {
+                            StatusEvent event;
+                            event.type = ParseStatusEventType(item.value("event", ""));
+                            event.version = item.value("version", static_cast<uint64_t>(0));
+                            event.itemId = item.value("item_id", "");
+                            if (item.contains("status") && item["status"].is_object())
+                            {
+                                event.hasStatus = true;
+                                event.status = ParseProcessStatus(item["status"]);
+                            }
+                            update.events.push_back(event);
+                        }
+                    }
+                }
+                catch (const std::exception &)
+                {
+                    // 无法解析时丢弃版本号，下一次请求重新获取快照
+                    version = 0;
+                    continue;
                 }
+
+                if ((update.snapshot || !update.events.empty()) && !IsStatusStopping())
+                    callback(update);
             }
 
-            CloseServiceHandle(svc);
-            CloseServiceHandle(scm);
-            return true;
+            statusPipe->Disconnect();
         }
-    };
-
-    struct Client::HeartbeatThreadEntry
-    {
-        std::shared_ptr<std::atomic<bool>> running;
-        std::unique_ptr<std::thread> thread;
-    };
 
-    struct Client::Impl
-    {
-        std::unique_ptr<PipeClient> pipeClient;
-        std::unique_ptr<ServiceManager> serviceManager;
+        // 异步请求的连接和 I/O 线程在第一次异步调用时创建
+        std::mutex asyncMutex;
+        std::unique_ptr<AsyncPipe> asyncPipe;
 
-        std::mutex heartbeatMutex;
-        std::map<std::string, HeartbeatThreadEntry> heartbeatThreads;
-
-        std::function<void(const std::string &)> heartbeatFailedCallback;
-        std::function<void(bool)> connectedChangedCallback;
+        AsyncPipe &Async()
+        {
+            std::lock_guard<std::mutex> lock(asyncMutex);
+            if (!asyncPipe)
+                asyncPipe = std::make_unique<AsyncPipe>();
+            return *asyncPipe;
+        }
 
-        std::atomic<bool> connected{false};
-        mutable std::string lastError;
-        std::string selfMonitorId;
+        void StopAsync()
+        {
+            std::lock_guard<std::mutex> lock(asyncMutex);
+            if (asyncPipe)
+                asyncPipe->Stop();
+        }
 
         Impl() : pipeClient(std::make_unique<PipeClient>()),
-                 serviceManager(std::make_unique<ServiceManager>()) {}
+                 serviceManager(std::make_unique<ServiceManager>()),
+                 statusPipe(std::make_unique<PipeClient>()) {}
     };
 
-    Client::Client() : impl_(std::make_unique<Impl>()) {}
+    Client::Client() : impl_(std::make_unique<Impl>())
+    {
+        impl_->heartbeatScheduler = std::make_unique<HeartbeatScheduler>(
+            [this](const std::vector<HeartbeatScheduler::Target> &targets)
+            {
+                std::vector<std::string> itemIds;
+                std::vector<uint32_t> handles;
+                for (const auto &target : targets)
+                {
+                    if (impl_->heartbeatGaugeProvider)
+                    {
+                        std::string itemId = target.second != 0 ? impl_->ItemIdForHandle(target.second) : target.first;
+                        Gauges gauges = impl_->heartbeatGaugeProvider(itemId);
+                        if (!gauges.empty())
+                        {
+                            if (target.second != 0)
+                                SendHeartbeat(target.second, gauges);
+                            else
+                                SendHeartbeat(target.first, gauges);
+                            continue;
+                        }
+                    }
+                    if (target.second != 0)
+                        handles.push_back(target.second);
+                    else
+                        itemIds.push_back(target.first);
+                }
+                SendHeartbeatBatch(itemIds);
+                SendHeartbeatBatch(handles);
+                return impl_->connected.load();
+            });
+    }
 
     Client::~Client()
     {
-        StopAllHeartbeatThreads();
+        impl_->StopAsync();
+        UnsubscribeStatus();
+        impl_->heartbeatScheduler.reset();
         Disconnect();
     }
 
@@ -505,7 +1994,12 @@ namespace ProcessGuard
     {
         bool result = impl_->pipeClient->Connect(timeoutMs);
         impl_->connected = result;
-        if (!result)
+        if (result)
+        {
+            impl_->heartbeatBatchSupported = true; // 服务端可能已升级，重新探测
+            impl_->OpenSharedHeartbeats();
+        }
+        else
             impl_->lastError = "Failed to connect to service pipe";
         if (impl_->connectedChangedCallback)
             impl_->connectedChangedCallback(result);
@@ -525,523 +2019,1052 @@ namespace ProcessGuard
         return impl_->connected;
     }
 
-    bool Client::AddMonitorItem(const MonitorItem &item)
+    bool Client::AddMonitorItem(const MonitorItem &item)
+    {
+        uint32_t handle = 0;
+        return AddMonitorItem(item, handle);
+    }
+
+    bool Client::AddMonitorItem(const MonitorItem &item, uint32_t &handle)
+    {
+        handle = 0;
+        if (!impl_->connected && !Connect())
+            return false;
+
+        if (!ValidateMonitorItem(item, impl_->lastError))
+            return false;
+
+        try
+        {
+            // ID 与路径是否重复由服务端校验（路径不区分大小写），不需要先拉取完整列表
+            nlohmann::json request;
+            request["type"] = "add";
+            request["config"] = MonitorItemToJson(item);
+
+            auto response = impl_->pipeClient->SendRequest(request);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!response.is_object() || !response.value("success", false))
+            {
+                impl_->lastError = response.value("message", "Unknown error");
+                return false;
+            }
+
+            // 旧服务端不返回句柄，此时 handle 保持为 0
+            if (response.contains("data") && response["data"].is_object())
+            {
+                handle = response["data"].value("handle", 0u);
+                impl_->RememberItem(handle, item, response["data"].value("epoch", uint64_t(0)));
+            }
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("AddMonitorItem error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "AddMonitorItem unknown error";
+            return false;
+        }
+    }
+
+    bool Client::UpdateMonitorItem(const MonitorItem &item)
+    {
+        if (!impl_->connected && !Connect())
+            return false;
+
+        try
+        {
+            nlohmann::json request;
+            request["type"] = "update";
+            request["config"] = MonitorItemToJson(item);
+
+            std::string message;
+            bool success = impl_->pipeClient->SendRequestStatus(request, message);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!success)
+            {
+                impl_->lastError = message.empty() ? "Unknown error" : message;
+                return false;
+            }
+            impl_->RememberItem(0, item);
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("UpdateMonitorItem error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "UpdateMonitorItem unknown error";
+            return false;
+        }
+    }
+
+    bool Client::ApplyMonitorItems(const std::vector<MonitorItem> &items, const std::vector<std::string> &removeIds)
+    {
+        std::vector<uint32_t> handles;
+        return ApplyMonitorItems(items, removeIds, handles);
+    }
+
+    bool Client::ApplyMonitorItems(const std::vector<MonitorItem> &items, const std::vector<std::string> &removeIds,
+                                   std::vector<uint32_t> &handles)
+    {
+        handles.clear();
+        if (items.empty() && removeIds.empty())
+            return true;
+        if (!impl_->connected && !Connect())
+            return false;
+
+        for (const auto &item : items)
+        {
+            if (!ValidateMonitorItem(item, impl_->lastError))
+                return false;
+        }
+
+        try
+        {
+            nlohmann::json request;
+            request["type"] = "batch";
+            nlohmann::json configs = nlohmann::json::array();
+            for (const auto &item : items)
+                configs.push_back(MonitorItemToJson(item));
+            request["items"] = std::move(configs);
+            request["remove_ids"] = removeIds;
+
+            auto response = impl_->pipeClient->SendRequest(request);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!response.is_object() || !response.value("success", false))
+            {
+                impl_->lastError = response.is_object() ? response.value("message", "Unknown error") : "Unknown error";
+                return false;
+            }
+
+            if (response.contains("data") && response["data"].is_object())
+            {
+                const auto &data = response["data"];
+                if (data.contains("handles") && data["handles"].is_array() && data["handles"].size() == items.size())
+                {
+                    for (size_t i = 0; i < items.size(); ++i)
+                    {
+                        uint32_t handle = data["handles"][i].get<uint32_t>();
+                        impl_->RememberItem(handle, items[i], data.value("epoch", uint64_t(0)));
+                        handles.push_back(handle);
+                    }
+                }
+            }
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("ApplyMonitorItems error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "ApplyMonitorItems unknown error";
+            return false;
+        }
+    }
+
+    bool Client::RemoveMonitorItem(const std::string &id)
+    {
+        if (!impl_->connected && !Connect())
+            return false;
+
+        try
+        {
+            nlohmann::json request;
+            request["type"] = "remove";
+            request["id"] = id;
+
+            std::string message;
+            bool success = impl_->pipeClient->SendRequestStatus(request, message);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!success)
+            {
+                impl_->lastError = message.empty() ? "Unknown error" : message;
+                return false;
+            }
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("RemoveMonitorItem error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "RemoveMonitorItem unknown error";
+            return false;
+        }
+    }
+
+    bool Client::StopMonitorItem(const std::string &id)
+    {
+        if (!impl_->connected && !Connect())
+            return false;
+
+        try
+        {
+            nlohmann::json request;
+            request["type"] = "stop";
+            request["id"] = id;
+
+            std::string message;
+            bool success = impl_->pipeClient->SendRequestStatus(request, message);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!success)
+            {
+                impl_->lastError = message.empty() ? "Unknown error" : message;
+                return false;
+            }
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("StopMonitorItem error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "StopMonitorItem unknown error";
+            return false;
+        }
+    }
+
+    bool Client::StartMonitorItem(const std::string &id)
+    {
+        if (!impl_->connected && !Connect())
+            return false;
+
+        try
+        {
+            nlohmann::json request;
+            request["type"] = "start";
+            request["id"] = id;
+
+            std::string message;
+            bool success = impl_->pipeClient->SendRequestStatus(request, message);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!success)
+            {
+                impl_->lastError = message.empty() ? "Unknown error" : message;
+                return false;
+            }
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("StartMonitorItem error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "StartMonitorItem unknown error";
+            return false;
+        }
+    }
+
+    bool Client::PauseMonitorItem(const std::string &id)
     {
         if (!impl_->connected && !Connect())
             return false;
 
-        if (item.id.empty())
+        try
         {
-            impl_->lastError = "Item ID cannot be empty";
-            return false;
+            nlohmann::json request;
+            request["type"] = "pause";
+            request["id"] = id;
+
+            std::string message;
+            bool success = impl_->pipeClient->SendRequestStatus(request, message);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!success)
+            {
+                impl_->lastError = message.empty() ? "Unknown error" : message;
+                return false;
+            }
+            return true;
         }
-        if (item.exePath.empty())
+        catch (const std::exception &e)
         {
-            impl_->lastError = "Executable path cannot be empty";
+            impl_->connected = false;
+            impl_->lastError = std::string("PauseMonitorItem error: ") + e.what();
             return false;
         }
-        if (item.name.empty())
+        catch (...)
         {
-            impl_->lastError = "Item name cannot be empty";
+            impl_->connected = false;
+            impl_->lastError = "PauseMonitorItem unknown error";
             return false;
         }
+    }
+
+    std::vector<MonitorItem> Client::GetAllMonitorItems()
+    {
+        if (!impl_->connected && !Connect())
+            return {};
 
         try
         {
-            nlohmann::json listRequest;
-            listRequest["type"] = "list";
-            auto listResponse = impl_->pipeClient->SendRequest(listRequest);
+            nlohmann::json request;
+            request["type"] = "list";
+
+            auto response = impl_->pipeClient->SendRequest(request);
             impl_->connected = impl_->pipeClient->IsConnected();
+            std::vector<MonitorItem> items;
 
-            if (listResponse.is_object() && listResponse.contains("data") && listResponse["data"].is_array())
+            if (response.is_object() && response.value("success", false) &&
+                response.contains("data") && response["data"].is_array())
             {
-                for (const auto &existingItem : listResponse["data"])
+                for (const auto &item : response["data"])
                 {
-                    std::string existingPath = existingItem.value("exe_path", "");
-                    if (!existingPath.empty() && existingPath == item.exePath)
+                    try
+                    {
+                        MonitorItem mi;
+                        mi.id = item.value("id", "");
+                        mi.exePath = item.value("exe_path", "");
+                        if (item.contains("args") && !item["args"].is_null())
+                        {
+                            mi.args = item.value("args", "");
+                        }
+                        else
+                        {
+                            mi.args = "";
+                        }
+                        mi.name = item.value("name", "");
+                        mi.minimize = item.value("minimize", false);
+                        mi.noWindow = item.value("no_window", false);
+                        mi.enabled = item.value("enabled", false);
+                        mi.heartbeatTimeoutMs = item.value("heartbeat_timeout_ms", 1000);
+                        mi.readyTimeoutMs = item.value("ready_timeout_ms", 0);
+                        mi.standby = item.value("standby", false);
+                        mi.handle = item.value("handle", 0u);
+                        if (item.contains("limits") && item["limits"].is_object())
+                        {
+                            const auto &limits = item["limits"];
+                            mi.limits.maxWorkingSetMb = limits.value("max_working_set_mb", uint64_t(0));
+                            mi.limits.maxPrivateMb = limits.value("max_private_mb", uint64_t(0));
+                            mi.limits.maxHandles = limits.value("max_handles", 0u);
+                            mi.limits.maxCpuPercent = limits.value("max_cpu_percent", 0);
+                            mi.limits.cpuSustainMs = limits.value("cpu_sustain_ms", 60000);
+                        }
+                        impl_->RememberItem(mi.handle, mi, item.value("epoch", uint64_t(0)));
+                        items.push_back(mi);
+                    }
+                    catch (const std::exception &e)
                     {
-                        impl_->lastError = "Executable path already monitored";
-                        return false;
+                        impl_->lastError = std::string("Parse item error: ") + e.what();
+                        continue;
                     }
                 }
             }
 
-            if (!impl_->connected && !Connect())
-            {
-                impl_->lastError = "Failed to reconnect to service";
-                return false;
-            }
+            return items;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("GetAllMonitorItems error: ") + e.what();
+            return {};
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "GetAllMonitorItems unknown error";
+            return {};
+        }
+    }
 
-            nlohmann::json request;
-            request["type"] = "add";
+    ServiceStatus Client::GetServiceStatus()
+    {
+        if (!impl_->connected && !Connect())
+            return {};
 
-            nlohmann::json config;
-            config["id"] = item.id;
-            config["exe_path"] = item.exePath;
-            config["name"] = item.name;
-            config["minimize"] = item.minimize;
-            config["no_window"] = item.noWindow;
-            config["enabled"] = item.enabled;
-            config["heartbeat_timeout_ms"] = static_cast<int64_t>(item.heartbeatTimeoutMs);
-            if (!item.args.empty())
+        try
+        {
+            std::string wireReply;
+            uint16_t replyFlags = 0;
+            WireResult wireResult = SendWireRequest(*impl_->pipeClient, WIRE_OP_STATUS, WIRE_FLAG_EXTENDED, 0, 0, "", wireReply,
+                                                    nullptr, &replyFlags);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (wireResult != WireResult::Unavailable)
             {
-                config["args"] = item.args;
+                ServiceStatus status;
+                if (wireResult != WireResult::Ok)
+                    impl_->lastError = "GetServiceStatus error: " + wireReply;
+                else if (!ParseWireStatus(wireReply, (replyFlags & WIRE_FLAG_EXTENDED) != 0, status))
+                    impl_->lastError = "Parse status error: invalid binary status";
+                return status;
             }
-            request["config"] = config;
+
+            nlohmann::json request;
+            request["type"] = "status";
 
             auto response = impl_->pipeClient->SendRequest(request);
             impl_->connected = impl_->pipeClient->IsConnected();
-            if (!response.is_object() || !response.value("success", false))
+            ServiceStatus status;
+
+            if (response.is_object() && response.value("success", false) && response.contains("data"))
             {
-                impl_->lastError = response.value("message", "Unknown error");
-                return false;
+                std::string error;
+                ParseServiceStatus(response["data"], status, error);
+                if (!error.empty())
+                    impl_->lastError = error;
             }
-            return true;
+
+            return status;
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("AddMonitorItem error: ") + e.what();
-            return false;
+            impl_->lastError = std::string("GetServiceStatus error: ") + e.what();
+            return {};
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "AddMonitorItem unknown error";
-            return false;
+            impl_->lastError = "GetServiceStatus unknown error";
+            return {};
         }
     }
 
-    bool Client::UpdateMonitorItem(const MonitorItem &item)
+    ServiceMetrics Client::GetMetrics()
     {
         if (!impl_->connected && !Connect())
-            return false;
+            return {};
 
         try
         {
             nlohmann::json request;
-            request["type"] = "update";
-
-            nlohmann::json config;
-            config["id"] = item.id;
-            config["exe_path"] = item.exePath;
-            config["name"] = item.name;
-            config["minimize"] = item.minimize;
-            config["no_window"] = item.noWindow;
-            config["enabled"] = item.enabled;
-            config["heartbeat_timeout_ms"] = item.heartbeatTimeoutMs;
-            if (!item.args.empty())
-            {
-                config["args"] = item.args;
-            }
-            request["config"] = config;
+            request["type"] = "metrics";
 
             auto response = impl_->pipeClient->SendRequest(request);
             impl_->connected = impl_->pipeClient->IsConnected();
-            if (!response.is_object() || !response.value("success", false))
+            ServiceMetrics metrics;
+
+            if (response.is_object() && response.value("success", false) && response.contains("data"))
             {
-                impl_->lastError = response.value("message", "Unknown error");
-                return false;
+                try
+                {
+                    const auto &data = response["data"];
+                    metrics.uptimeMs = data.value("uptime_ms", uint64_t(0));
+
+                    if (data.contains("counters") && data["counters"].is_object())
+                    {
+                        for (auto it = data["counters"].begin(); it != data["counters"].end(); ++it)
+                            metrics.counters[it.key()] = it.value().get<uint64_t>();
+                    }
+                    ParseHistogramMap(data, "histograms", metrics.histograms);
+                    ParseHistogramMap(data, "requests", metrics.requests);
+                    if (data.contains("gauges") && data["gauges"].is_object())
+                    {
+                        for (auto it = data["gauges"].begin(); it != data["gauges"].end(); ++it)
+                            ParseGaugeStats(it.value(), metrics.gauges[it.key()]);
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    impl_->lastError = std::string("Parse metrics error: ") + e.what();
+                }
             }
-            return true;
+            else if (response.is_object())
+            {
+                impl_->lastError = "GetMetrics error: " + response.value("message", std::string());
+            }
+
+            return metrics;
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("UpdateMonitorItem error: ") + e.what();
-            return false;
+            impl_->lastError = std::string("GetMetrics error: ") + e.what();
+            return {};
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "UpdateMonitorItem unknown error";
+            impl_->lastError = "GetMetrics unknown error";
+            return {};
+        }
+    }
+
+    void Client::SendHeartbeatAsync(const std::string &itemId, std::function<void(bool)> callback)
+    {
+        nlohmann::json request;
+        request["type"] = "heartbeat";
+        request["item_id"] = itemId;
+        request["timestamp"] = UnixTimeMs();
+
+        impl_->Async().Submit(request, [this, itemId, callback](const nlohmann::json &reply)
+                              {
+                                  bool success = reply.is_object() && reply.value("success", false);
+                                  if (!success && impl_->heartbeatFailedCallback)
+                                      impl_->heartbeatFailedCallback(itemId);
+                                  if (callback)
+                                      callback(success); });
+    }
+
+    std::future<bool> Client::SendHeartbeatAsync(const std::string &itemId)
+    {
+        auto promise = std::make_shared<std::promise<bool>>();
+        auto future = promise->get_future();
+        SendHeartbeatAsync(itemId, [promise](bool success)
+                           { promise->set_value(success); });
+        return future;
+    }
+
+    void Client::GetServiceStatusAsync(std::function<void(const ServiceStatus &)> callback)
+    {
+        nlohmann::json request;
+        request["type"] = "status";
+
+        impl_->Async().Submit(request, [callback](const nlohmann::json &reply)
+                              {
+                                  ServiceStatus status;
+                                  if (reply.is_object() && reply.value("success", false) && reply.contains("data"))
+                                  {
+                                      std::string error;
+                                      ParseServiceStatus(reply["data"], status, error);
+                                  }
+                                  if (callback)
+                                      callback(status); });
+    }
+
+    std::future<ServiceStatus> Client::GetServiceStatusAsync()
+    {
+        auto promise = std::make_shared<std::promise<ServiceStatus>>();
+        auto future = promise->get_future();
+        GetServiceStatusAsync([promise](const ServiceStatus &status)
+                              { promise->set_value(status); });
+        return future;
+    }
+
+    bool Client::SubscribeStatus(std::function<void(const StatusUpdate &)> callback, int waitMs)
+    {
+        // 订阅线程无法替换自身
+        if (std::this_thread::get_id() == impl_->statusThread.get_id())
+        {
+            impl_->lastError = "SubscribeStatus cannot be called from the status callback";
+            return false;
+        }
+        UnsubscribeStatus();
+        if (!callback)
+            return false;
+
+        waitMs = (std::max)(0, (std::min)(waitMs, STATUS_SUBSCRIBE_MAX_WAIT_MS));
+        impl_->statusPipe->ResetCancel();
+        impl_->statusPipe->SetIoTimeout(static_cast<DWORD>(waitMs) + PIPE_REQUEST_TIMEOUT_MS);
+        if (!impl_->statusPipe->Connect(5000))
+        {
+            impl_->lastError = "Failed to connect to service pipe";
             return false;
         }
+
+        {
+            std::lock_guard<std::mutex> lock(impl_->statusMutex);
+            impl_->statusStopping = false;
+        }
+        impl_->statusThread = std::thread([this, callback, waitMs]()
+                                          { impl_->RunStatusSubscription(callback, waitMs); });
+        return true;
     }
 
-    bool Client::RemoveMonitorItem(const std::string &id)
+    void Client::UnsubscribeStatus()
+    {
+        {
+            std::lock_guard<std::mutex> lock(impl_->statusMutex);
+            impl_->statusStopping = true;
+        }
+        impl_->statusCv.notify_all();
+        // 中断正在等待的长轮询读取
+        impl_->statusPipe->Cancel();
+
+        // 在订阅回调中调用时不能等待自身；回调返回后线程看到 statusStopping 自行退出，
+        // 由之后再次订阅、取消订阅或析构时回收
+        if (std::this_thread::get_id() == impl_->statusThread.get_id())
+        {
+            impl_->statusPipe->Disconnect();
+            return;
+        }
+
+        if (impl_->statusThread.joinable())
+            impl_->statusThread.join();
+        impl_->statusPipe->Disconnect();
+    }
+
+    bool Client::SendHeartbeat(const std::string &itemId)
     {
+        if (impl_->WriteSharedHeartbeat(itemId))
+            return true;
+
         if (!impl_->connected && !Connect())
             return false;
 
         try
         {
+            // 已知当前句柄时按句柄发送，服务端不查找字符串 ID；否则负载为 ID，
+            // 成功响应的 item_index 为该监控项的句柄，之后的心跳改用句柄
+            uint64_t epoch = 0;
+            uint32_t handle = impl_->HandleForItem(itemId, epoch);
+            std::string wireBody;
+            uint16_t wireFlags = 0;
+            if (handle == 0)
+            {
+                wireBody = itemId;
+            }
+            else if (epoch != 0)
+            {
+                wireFlags |= WIRE_FLAG_EPOCH;
+                AppendWireValue(wireBody, epoch);
+            }
+
+            std::string wireReply;
+            uint32_t replyHandle = 0;
+            WireResult wireResult = SendWireRequest(*impl_->pipeClient, WIRE_OP_HEARTBEAT, wireFlags, handle, UnixTimeMs(), wireBody, wireReply, &replyHandle);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (wireResult == WireResult::Ok && handle == 0)
+                impl_->RememberHandle(replyHandle, itemId);
+            // 句柄因服务重启被拒绝时已从缓存中丢弃，改按 ID 重发一次
+            if (wireResult == WireResult::Rejected && handle != 0 && impl_->HandleForItem(itemId, epoch) == 0)
+                return SendHeartbeat(itemId);
+            if (wireResult != WireResult::Unavailable)
+            {
+                bool success = wireResult == WireResult::Ok;
+                if (!success)
+                {
+                    impl_->lastError = "Heartbeat failed: " + wireReply;
+                    if (impl_->heartbeatFailedCallback)
+                        impl_->heartbeatFailedCallback(itemId);
+                }
+                return success;
+            }
+
             nlohmann::json request;
-            request["type"] = "remove";
-            request["id"] = id;
+            request["type"] = "heartbeat";
+            request["item_id"] = itemId;
+            request["timestamp"] = UnixTimeMs();
 
-            auto response = impl_->pipeClient->SendRequest(request);
+            std::string message;
+            bool success = impl_->pipeClient->SendRequestStatus(request, message);
             impl_->connected = impl_->pipeClient->IsConnected();
-            if (!response.is_object() || !response.value("success", false))
+
+            if (!success)
             {
-                impl_->lastError = response.value("message", "Unknown error");
-                return false;
+                impl_->lastError = "Heartbeat failed: " + (message.empty() ? std::string("Unknown error") : message);
+                if (impl_->heartbeatFailedCallback)
+                    impl_->heartbeatFailedCallback(itemId);
             }
-            return true;
+
+            return success;
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("RemoveMonitorItem error: ") + e.what();
+            impl_->lastError = std::string("SendHeartbeat error: ") + e.what();
             return false;
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "RemoveMonitorItem unknown error";
+            impl_->lastError = "SendHeartbeat unknown error";
             return false;
         }
     }
 
-    bool Client::StopMonitorItem(const std::string &id)
+    bool Client::SendHeartbeatBatch(const std::vector<std::string> &itemIds)
     {
+        // 已知当前句柄的监控项直接写入共享内存，其余经管道发送
+        std::vector<std::string> pending;
+        for (const auto &itemId : itemIds)
+        {
+            if (!impl_->WriteSharedHeartbeat(itemId))
+                pending.push_back(itemId);
+        }
+        if (pending.empty())
+            return true;
+
+        if (!impl_->heartbeatBatchSupported)
+        {
+            bool allOk = true;
+            for (const auto &itemId : pending)
+                allOk = SendHeartbeat(itemId) && allOk;
+            return allOk;
+        }
+
         if (!impl_->connected && !Connect())
             return false;
 
         try
         {
+            std::string wireBody;
+            for (const auto &itemId : pending)
+                AppendWireString(wireBody, itemId);
+
+            std::string wireReply;
+            WireResult wireResult = SendWireRequest(*impl_->pipeClient, WIRE_OP_HEARTBEAT_BATCH, 0, 0, UnixTimeMs(), wireBody, wireReply);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (wireResult == WireResult::Ok)
+            {
+                // 响应负载为未找到的监控项 ID 列表
+                bool allOk = true;
+                WireReader reader(wireReply);
+                std::string unknown;
+                while (!reader.AtEnd() && reader.ReadString(unknown))
+                {
+                    allOk = false;
+                    impl_->lastError = "Heartbeat failed: item not found: " + unknown;
+                    if (impl_->heartbeatFailedCallback)
+                        impl_->heartbeatFailedCallback(unknown);
+                }
+                return allOk;
+            }
+            if (wireResult != WireResult::Unavailable)
+            {
+                impl_->lastError = "Heartbeat batch failed: " + wireReply;
+                if (impl_->heartbeatFailedCallback)
+                {
+                    for (const auto &itemId : pending)
+                        impl_->heartbeatFailedCallback(itemId);
+                }
+                return false;
+            }
+
             nlohmann::json request;
-            request["type"] = "stop";
-            request["id"] = id;
+            request["type"] = "heartbeat_batch";
+            request["item_ids"] = pending;
+            request["timestamp"] = UnixTimeMs();
 
             auto response = impl_->pipeClient->SendRequest(request);
             impl_->connected = impl_->pipeClient->IsConnected();
-            if (!response.is_object() || !response.value("success", false))
+            bool success = response.is_object() && response.value("success", false);
+
+            if (!success)
             {
-                impl_->lastError = response.value("message", "Unknown error");
+                std::string message = response.is_object() ? response.value("message", "Unknown error") : "Unknown error";
+
+                // 旧服务端返回 "未知的请求类型: heartbeat_batch"，退回到逐个发送
+                if (message.find("heartbeat_batch") != std::string::npos)
+                {
+                    impl_->heartbeatBatchSupported = false;
+                    return SendHeartbeatBatch(pending);
+                }
+
+                impl_->lastError = "Heartbeat batch failed: " + message;
+                if (impl_->heartbeatFailedCallback)
+                {
+                    for (const auto &itemId : pending)
+                        impl_->heartbeatFailedCallback(itemId);
+                }
                 return false;
             }
-            return true;
+
+            bool allOk = true;
+            if (response.contains("data") && response["data"].is_object() &&
+                response["data"].contains("unknown") && response["data"]["unknown"].is_array())
+            {
+                for (const auto &unknown : response["data"]["unknown"])
+                {
+                    if (!unknown.is_string())
+                        continue;
+                    allOk = false;
+                    impl_->lastError = "Heartbeat failed: item not found: " + unknown.get<std::string>();
+                    if (impl_->heartbeatFailedCallback)
+                        impl_->heartbeatFailedCallback(unknown.get<std::string>());
+                }
+            }
+
+            return allOk;
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("StopMonitorItem error: ") + e.what();
+            impl_->lastError = std::string("SendHeartbeatBatch error: ") + e.what();
             return false;
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "StopMonitorItem unknown error";
+            impl_->lastError = "SendHeartbeatBatch unknown error";
             return false;
         }
     }
 
-    bool Client::StartMonitorItem(const std::string &id)
+    bool Client::SendHeartbeat(uint32_t handle)
     {
+        uint64_t epoch = 0;
+        if (!impl_->IsKnownHandle(handle, epoch))
+            return impl_->RejectUnknownHandle(handle);
+        if (impl_->WriteSharedHeartbeat(handle, epoch))
+            return true;
+
         if (!impl_->connected && !Connect())
             return false;
 
         try
         {
-            nlohmann::json request;
-            request["type"] = "start";
-            request["id"] = id;
+            // 发送时附带取得句柄时的 epoch，管道重连到重启后的服务时旧句柄会被拒绝
+            std::string wireBody;
+            uint16_t wireFlags = 0;
+            if (epoch != 0)
+            {
+                wireFlags |= WIRE_FLAG_EPOCH;
+                AppendWireValue(wireBody, epoch);
+            }
 
-            auto response = impl_->pipeClient->SendRequest(request);
+            std::string wireReply;
+            WireResult wireResult = SendWireRequest(*impl_->pipeClient, WIRE_OP_HEARTBEAT, wireFlags, handle, UnixTimeMs(), wireBody, wireReply);
             impl_->connected = impl_->pipeClient->IsConnected();
-            if (!response.is_object() || !response.value("success", false))
+
+            bool success = wireResult == WireResult::Ok;
+            std::string message = wireReply;
+            if (wireResult == WireResult::Unavailable)
             {
-                impl_->lastError = response.value("message", "Unknown error");
-                return false;
+                nlohmann::json request;
+                request["type"] = "heartbeat";
+                request["handle"] = handle;
+                request["timestamp"] = UnixTimeMs();
+                if (epoch != 0)
+                    request["epoch"] = epoch;
+
+                success = impl_->pipeClient->SendRequestStatus(request, message);
+                impl_->connected = impl_->pipeClient->IsConnected();
+                if (message.empty())
+                    message = "Unknown error";
             }
-            return true;
+
+            if (!success)
+            {
+                impl_->lastError = "Heartbeat failed: " + message;
+                if (impl_->heartbeatFailedCallback)
+                    impl_->heartbeatFailedCallback(impl_->ItemIdForHandle(handle));
+            }
+
+            return success;
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("StartMonitorItem error: ") + e.what();
+            impl_->lastError = std::string("SendHeartbeat error: ") + e.what();
             return false;
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "StartMonitorItem unknown error";
+            impl_->lastError = "SendHeartbeat unknown error";
             return false;
         }
     }
 
-    bool Client::PauseMonitorItem(const std::string &id)
+    bool Client::SendHeartbeat(const std::string &itemId, const Gauges &gauges)
     {
+        if (gauges.empty())
+            return SendHeartbeat(itemId);
         if (!impl_->connected && !Connect())
             return false;
 
         try
         {
             nlohmann::json request;
-            request["type"] = "pause";
-            request["id"] = id;
-
-            auto response = impl_->pipeClient->SendRequest(request);
-            impl_->connected = impl_->pipeClient->IsConnected();
-            if (!response.is_object() || !response.value("success", false))
-            {
-                impl_->lastError = response.value("message", "Unknown error");
-                return false;
-            }
-            return true;
+            request["item_id"] = itemId;
+            return impl_->SendGaugeHeartbeat(std::move(request), gauges, itemId);
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("PauseMonitorItem error: ") + e.what();
+            impl_->lastError = std::string("SendHeartbeat error: ") + e.what();
             return false;
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "PauseMonitorItem unknown error";
+            impl_->lastError = "SendHeartbeat unknown error";
             return false;
         }
     }
 
-    std::vector<MonitorItem> Client::GetAllMonitorItems()
+    bool Client::SendHeartbeat(uint32_t handle, const Gauges &gauges)
     {
+        if (gauges.empty())
+            return SendHeartbeat(handle);
+        uint64_t epoch = 0;
+        if (!impl_->IsKnownHandle(handle, epoch))
+            return impl_->RejectUnknownHandle(handle);
         if (!impl_->connected && !Connect())
-            return {};
+            return false;
 
         try
         {
             nlohmann::json request;
-            request["type"] = "list";
-
-            auto response = impl_->pipeClient->SendRequest(request);
-            impl_->connected = impl_->pipeClient->IsConnected();
-            std::vector<MonitorItem> items;
-
-            if (response.is_object() && response.value("success", false) &&
-                response.contains("data") && response["data"].is_array())
-            {
-                for (const auto &item : response["data"])
-                {
-                    try
-                    {
-                        MonitorItem mi;
-                        mi.id = item.value("id", "");
-                        mi.exePath = item.value("exe_path", "");
-                        if (item.contains("args") && !item["args"].is_null())
-                        {
-                            mi.args = item.value("args", "");
-                        }
-                        else
-                        {
-                            mi.args = "";
-                        }
-                        mi.name = item.value("name", "");
-                        mi.minimize = item.value("minimize", false);
-                        mi.noWindow = item.value("no_window", false);
-                        mi.enabled = item.value("enabled", false);
-                        mi.heartbeatTimeoutMs = item.value("heartbeat_timeout_ms", 1000);
-                        items.push_back(mi);
-                    }
-                    catch (const std::exception &e)
-                    {
-                        impl_->lastError = std::string("Parse item error: ") + e.what();
-                        continue;
-                    }
-                }
-            }
-
-            return items;
+            request["handle"] = handle;
+            if (epoch != 0)
+                request["epoch"] = epoch;
+            return impl_->SendGaugeHeartbeat(std::move(request), gauges, impl_->ItemIdForHandle(handle));
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("GetAllMonitorItems error: ") + e.what();
-            return {};
+            impl_->lastError = std::string("SendHeartbeat error: ") + e.what();
+            return false;
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "GetAllMonitorItems unknown error";
-            return {};
+            impl_->lastError = "SendHeartbeat unknown error";
+            return false;
         }
     }
 
-    ServiceStatus Client::GetServiceStatus()
+    bool Client::SendHeartbeatBatch(const std::vector<uint32_t> &requested)
     {
+        // 能写入共享内存的句柄不再经过管道
+        bool allKnown = true;
+        uint64_t epoch = 0;
+        std::vector<uint32_t> handles;
+        for (uint32_t handle : requested)
+        {
+            if (!impl_->IsKnownHandle(handle, epoch))
+                allKnown = impl_->RejectUnknownHandle(handle);
+            else if (!impl_->WriteSharedHeartbeat(handle, epoch))
+                handles.push_back(handle);
+        }
+        if (handles.empty())
+            return allKnown;
+
         if (!impl_->connected && !Connect())
-            return {};
+            return false;
 
         try
         {
-            nlohmann::json request;
-            request["type"] = "status";
+            std::vector<uint32_t> unknown;
+            std::string message;
+            bool success = false;
 
-            auto response = impl_->pipeClient->SendRequest(request);
-            impl_->connected = impl_->pipeClient->IsConnected();
-            ServiceStatus status;
+            std::string wireBody;
+            uint16_t wireFlags = WIRE_FLAG_HANDLES;
+            if (epoch != 0)
+            {
+                wireFlags |= WIRE_FLAG_EPOCH;
+                AppendWireValue(wireBody, epoch);
+            }
+            for (uint32_t handle : handles)
+                AppendWireValue(wireBody, handle);
 
-            if (response.is_object() && response.value("success", false) && response.contains("data"))
+            std::string wireReply;
+            WireResult wireResult = SendWireRequest(*impl_->pipeClient, WIRE_OP_HEARTBEAT_BATCH, wireFlags, 0, UnixTimeMs(), wireBody, wireReply);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (wireResult == WireResult::Unavailable)
             {
-                try
+                nlohmann::json request;
+                request["type"] = "heartbeat_batch";
+                request["handles"] = handles;
+                request["timestamp"] = UnixTimeMs();
+                if (epoch != 0)
+                    request["epoch"] = epoch;
+
+                auto response = impl_->pipeClient->SendRequest(request);
+                impl_->connected = impl_->pipeClient->IsConnected();
+                success = response.is_object() && response.value("success", false);
+                message = response.is_object() ? response.value("message", "Unknown error") : "Unknown error";
+                if (success && response.contains("data") && response["data"].is_object() &&
+                    response["data"].contains("unknown_handles") && response["data"]["unknown_handles"].is_array())
                 {
-                    const auto &data = response["data"];
-                    status.serviceRunning = data.value("service_running", false);
-                    status.totalItems = data.value("total_items", 0);
-
-                    if (data.contains("items") && data["items"].is_array())
+                    for (const auto &handle : response["data"]["unknown_handles"])
                     {
-                        for (const auto &item : data["items"])
-                        {
-                            try
-                            {
-                                ProcessStatus ps;
-                                ps.id = item.value("id", "");
-                                ps.name = item.value("name", "");
-                                ps.exePath = item.value("exe_path", "");
-                                ps.enabled = item.value("enabled", false);
-                                if (item.contains("process_id") && !item["process_id"].is_null())
-                                {
-                                    ps.processId = item.value("process_id", 0);
-                                }
-                                else
-                                {
-                                    ps.processId = 0;
-                                }
-                                ps.lastHeartbeatMs = item.value("last_heartbeat_ms", 0);
-                                ps.heartbeatTimeoutMs = item.value("heartbeat_timeout_ms", 1000);
-                                ps.restartCount = item.value("restart_count", 0);
-                                ps.isAlive = item.value("is_alive", false);
-                                ps.isHeartbeatOk = item.value("is_heartbeat_ok", false);
-                                status.items.push_back(ps);
-                            }
-                            catch (const std::exception &e)
-                            {
-                                impl_->lastError = std::string("Parse process status error: ") + e.what();
-                                continue;
-                            }
-                        }
+                        if (handle.is_number_unsigned())
+                            unknown.push_back(handle.get<uint32_t>());
                     }
                 }
-                catch (const std::exception &e)
+            }
+            else
+            {
+                success = wireResult == WireResult::Ok;
+                message = wireReply;
+                if (success)
                 {
-                    impl_->lastError = std::string("Parse status error: ") + e.what();
+                    // 响应负载为未找到的句柄列表
+                    WireReader reader(wireReply);
+                    uint32_t handle = 0;
+                    while (!reader.AtEnd() && reader.Read(handle))
+                        unknown.push_back(handle);
                 }
             }
 
-            return status;
-        }
-        catch (const std::exception &e)
-        {
-            impl_->connected = false;
-            impl_->lastError = std::string("GetServiceStatus error: ") + e.what();
-            return {};
-        }
-        catch (...)
-        {
-            impl_->connected = false;
-            impl_->lastError = "GetServiceStatus unknown error";
-            return {};
-        }
-    }
-
-    bool Client::SendHeartbeat(const std::string &itemId)
-    {
-        if (!impl_->connected && !Connect())
-            return false;
-
-        try
-        {
-            nlohmann::json request;
-            request["type"] = "heartbeat";
-            request["item_id"] = itemId;
-            request["timestamp"] = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                       std::chrono::system_clock::now().time_since_epoch())
-                                       .count();
-
-            auto response = impl_->pipeClient->SendRequest(request);
-            impl_->connected = impl_->pipeClient->IsConnected();
-            bool success = response.is_object() && response.value("success", false);
-
             if (!success)
             {
-                impl_->lastError = "Heartbeat failed: " + response.value("message", "Unknown error");
+                impl_->lastError = "Heartbeat batch failed: " + message;
+                if (impl_->heartbeatFailedCallback)
+                {
+                    for (uint32_t handle : handles)
+                        impl_->heartbeatFailedCallback(impl_->ItemIdForHandle(handle));
+                }
+                return false;
+            }
+
+            for (uint32_t handle : unknown)
+            {
+                std::string itemId = impl_->ItemIdForHandle(handle);
+                impl_->lastError = "Heartbeat failed: item not found: " + itemId;
                 if (impl_->heartbeatFailedCallback)
                     impl_->heartbeatFailedCallback(itemId);
             }
 
-            return success;
+            return allKnown && unknown.empty();
         }
         catch (const std::exception &e)
         {
             impl_->connected = false;
-            impl_->lastError = std::string("SendHeartbeat error: ") + e.what();
+            impl_->lastError = std::string("SendHeartbeatBatch error: ") + e.what();
             return false;
         }
         catch (...)
         {
             impl_->connected = false;
-            impl_->lastError = "SendHeartbeat unknown error";
+            impl_->lastError = "SendHeartbeatBatch unknown error";
             return false;
         }
     }
 
     void Client::StartHeartbeatThread(const std::string &itemId, int intervalMs)
     {
-        std::lock_guard<std::mutex> lock(impl_->heartbeatMutex);
-
-        if (impl_->heartbeatThreads.find(itemId) != impl_->heartbeatThreads.end())
-            return;
-
-        auto running = std::make_shared<std::atomic<bool>>(true);
-        auto worker = std::make_unique<std::thread>([this, itemId, intervalMs, running]()
-                                                    {
-        while (running->load()) {
-            SendHeartbeat(itemId);
+        HeartbeatScheduler::Target target{itemId, 0};
+        impl_->heartbeatScheduler->Add(target, impl_->HeartbeatIntervalFor(target, intervalMs));
+    }
 
-            int sleptMs = 0;
-            while (running->load() && sleptMs < intervalMs) {
-                const int sliceMs = (std::min)(50, intervalMs - sleptMs);
-                std::this_thread::sleep_for(std::chrono::milliseconds(sliceMs));
-                sleptMs += sliceMs;
-            }
-        } });
-        impl_->heartbeatThreads[itemId] = {running, std::move(worker)};
+    void Client::StartHeartbeatThread(uint32_t handle, int intervalMs)
+    {
+        HeartbeatScheduler::Target target{std::string(), handle};
+        impl_->heartbeatScheduler->Add(target, impl_->HeartbeatIntervalFor(target, intervalMs));
     }
 
     void Client::StopHeartbeatThread(const std::string &itemId)
     {
-        std::unique_ptr<std::thread> thread;
-        {
-            std::lock_guard<std::mutex> lock(impl_->heartbeatMutex);
-
-            auto it = impl_->heartbeatThreads.find(itemId);
-            if (it == impl_->heartbeatThreads.end())
-                return;
-
-            it->second.running->store(false);
-            thread = std::move(it->second.thread);
-            impl_->heartbeatThreads.erase(it);
-        }
+        impl_->heartbeatScheduler->Remove({itemId, 0});
+    }
 
-        if (thread && thread->joinable())
-        {
-            thread->join();
-        }
+    void Client::StopHeartbeatThread(uint32_t handle)
+    {
+        impl_->heartbeatScheduler->Remove({std::string(), handle});
     }
 
     void Client::StopAllHeartbeatThreads()
     {
-        std::vector<std::unique_ptr<std::thread>> threads;
-        {
-            std::lock_guard<std::mutex> lock(impl_->heartbeatMutex);
-
-            for (auto &pair : impl_->heartbeatThreads)
-            {
-                pair.second.running->store(false);
-                if (pair.second.thread)
-                    threads.push_back(std::move(pair.second.thread));
-            }
-
-            impl_->heartbeatThreads.clear();
-        }
-
-        for (auto &thread : threads)
-        {
-            if (thread && thread->joinable())
-                thread->join();
-        }
+        impl_->heartbeatScheduler->Clear();
     }
 
     bool Client::EnsureServiceInstalled(const std::string &servicePath)
@@ -1064,6 +3087,16 @@ namespace ProcessGuard
         impl_->connectedChangedCallback = std::move(callback);
     }
 
+    void Client::SetHeartbeatGaugeProvider(std::function<Gauges(const std::string &)> provider)
+    {
+        impl_->heartbeatGaugeProvider = std::move(provider);
+    }
+
+    void Client::SetSharedHeartbeatEnabled(bool enabled)
+    {
+        impl_->sharedHeartbeatEnabled = enabled;
+    }
+
     bool Client::AddSelfMonitor(const std::string &id, int heartbeatTimeoutMs)
     {
         // 确保已连接到服务
@@ -1168,6 +3201,7 @@ namespace ProcessGuard
         {
             return false;
         }
+        // 按 ID 调度，发送时已知当前句柄则写入共享内存；服务重启后句柄失效，改回按 ID 发送
         StartHeartbeatThread(impl_->selfMonitorId, intervalMs);
         return true;
     }
@@ -1190,4 +3224,67 @@ namespace ProcessGuard
         }
     }
 
+    bool Client::SignalReady(const std::string &itemId, bool *isStandby)
+    {
+        if (!impl_->connected && !Connect())
+            return false;
+
+        try
+        {
+            nlohmann::json request;
+            request["type"] = "ready";
+            request["item_id"] = itemId;
+            request["process_id"] = static_cast<uint32_t>(GetCurrentProcessId());
+
+            auto response = impl_->pipeClient->SendRequest(request);
+            impl_->connected = impl_->pipeClient->IsConnected();
+            if (!response.is_object() || !response.value("success", false))
+            {
+                std::string message = response.is_object() ? response.value("message", std::string()) : std::string();
+                impl_->lastError = "SignalReady failed: " + (message.empty() ? std::string("Unknown error") : message);
+                return false;
+            }
+
+            if (isStandby)
+            {
+                *isStandby = response.contains("data") && response["data"].is_object() &&
+                             response["data"].value("role", std::string()) == "standby";
+            }
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            impl_->connected = false;
+            impl_->lastError = std::string("SignalReady error: ") + e.what();
+            return false;
+        }
+        catch (...)
+        {
+            impl_->connected = false;
+            impl_->lastError = "SignalReady unknown error";
+            return false;
+        }
+    }
+
+    bool Client::WaitForPromotion(const std::string &itemId, int timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds((std::max)(0, timeoutMs));
+        while (true)
+        {
+            // ready 可以重复发送，服务端提升备用实例后同一请求返回 active
+            bool isStandby = false;
+            if (!SignalReady(itemId, &isStandby))
+                return false;
+            if (!isStandby)
+                return true;
+
+            if (timeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline)
+            {
+                impl_->lastError = "WaitForPromotion timed out";
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(READY_POLL_INTERVAL_MS));
+        }
+    }
+
 }
@@ -9,6 +9,7 @@
 #include <memory>
 #include <chrono>
 #include <map>
+#include <future>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -17,6 +18,19 @@
 namespace ProcessGuard
 {
 
+    // 资源上限，0 表示不限制；超过任一上限时服务端主动重启，原因记录在 ProcessStatus::lastRestartReason
+    struct ResourceLimits
+    {
+        uint64_t maxWorkingSetMb = 0;
+        uint64_t maxPrivateMb = 0;
+        uint32_t maxHandles = 0;
+        // 占全部逻辑处理器的百分比，持续 cpuSustainMs 毫秒超过上限才重启
+        int maxCpuPercent = 0;
+        int cpuSustainMs = 60000;
+
+        bool Any() const { return maxWorkingSetMb || maxPrivateMb || maxHandles || maxCpuPercent; }
+    };
+
     struct MonitorItem
     {
         std::string id;
@@ -27,6 +41,15 @@ namespace ProcessGuard
         bool noWindow = false;
         bool enabled = true;
         int heartbeatTimeoutMs = 1000;
+        ResourceLimits limits;
+        // 大于 0 时进程启动后需调用 SignalReady，启动宽限期在此时结束，超过该时间仍未就绪则重启；
+        // 为 0 时宽限期固定为 5 秒，期间调用 SignalReady 同样提前结束
+        int readyTimeoutMs = 0;
+        // 预先启动一个备用实例，当前实例失败时直接由备用实例接替（未设置 readyTimeoutMs 时就绪超时为 60 秒）
+        bool standby = false;
+        // 服务端分配的数字句柄（0 表示未知），由 AddMonitorItem/GetAllMonitorItems 返回，仅在服务本次运行期间有效；
+        // 客户端发现服务重启后丢弃旧句柄，之后按旧句柄的心跳返回 false，需重新调用 GetAllMonitorItems 取得
+        uint32_t handle = 0;
 
         MonitorItem() = default;
 
@@ -54,6 +77,20 @@ namespace ProcessGuard
         }
     };
 
+    // 随心跳上报的指标（队列长度、请求速率、延迟等），每个监控项最多 8 个，名称不超过 64 字节
+    using Gauges = std::map<std::string, double>;
+
+    // 单个指标在服务端最近 32 次采样内的统计；ageMs 为最近一次上报距今的毫秒数
+    struct GaugeStats
+    {
+        double last = 0;
+        double min = 0;
+        double max = 0;
+        double mean = 0;
+        int samples = 0;
+        uint64_t ageMs = 0;
+    };
+
     struct ProcessStatus
     {
         std::string id;
@@ -64,8 +101,22 @@ namespace ProcessGuard
         int64_t lastHeartbeatMs = 0;
         int heartbeatTimeoutMs = 1000;
         int restartCount = 0;
+        bool restartPending = false;
+        std::string lastRestartReason;
         bool isAlive = false;
         bool isHeartbeatOk = false;
+        // 进程树（作业对象）的累计统计；连接到不支持扩展二进制状态的旧服务端时 hasJob 为 false
+        bool hasJob = false;
+        int jobActiveProcesses = 0;
+        int jobTotalProcesses = 0;
+        uint64_t jobCpuTimeMs = 0;
+        uint64_t jobPeakMemoryBytes = 0;
+        // 从未上报指标时为空；旧服务端的二进制状态同样为空
+        std::map<std::string, GaugeStats> gauges;
+        // 当前实例已调用 SignalReady（或是服务复用的已运行进程）；备用实例 PID 为 0 表示没有备用实例
+        bool isReady = false;
+        int standbyProcessId = 0;
+        bool standbyReady = false;
     };
 
     struct ServiceStatus
@@ -75,6 +126,62 @@ namespace ProcessGuard
         std::vector<ProcessStatus> items;
     };
 
+    enum class StatusEventType
+    {
+        Started,
+        Died,
+        Restarted,
+        HeartbeatLate,
+        ConfigChanged,
+        Removed,
+        Unknown
+    };
+
+    struct StatusEvent
+    {
+        StatusEventType type = StatusEventType::Unknown;
+        uint64_t version = 0;
+        std::string itemId;
+        // 事件发生后该监控项的状态，Removed 事件没有状态
+        bool hasStatus = false;
+        ProcessStatus status;
+    };
+
+    // 订阅回调的参数: snapshot 为 true 时 items 是全部监控项的当前状态，
+    // 否则 events 是自上次回调以来按版本号排序的状态变化
+    struct StatusUpdate
+    {
+        uint64_t version = 0;
+        bool snapshot = false;
+        std::vector<ProcessStatus> items;
+        std::vector<StatusEvent> events;
+    };
+
+    // 直方图摘要，数值单位见 unit: us 为微秒、ms 为毫秒、permille 为占心跳超时的千分比
+    struct HistogramSummary
+    {
+        std::string unit;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t mean = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t p999 = 0;
+    };
+
+    // 服务自启动以来的运行指标; requests 按请求类型统计处理耗时，只包含收到过的类型
+    struct ServiceMetrics
+    {
+        uint64_t uptimeMs = 0;
+        std::map<std::string, uint64_t> counters;
+        std::map<std::string, HistogramSummary> histograms;
+        std::map<std::string, HistogramSummary> requests;
+        // 监控项 ID 到其上报的指标统计
+        std::map<std::string, std::map<std::string, GaugeStats>> gauges;
+    };
+
     class Client
     {
     public:
@@ -103,7 +210,15 @@ namespace ProcessGuard
         bool IsConnected() const;
 
         bool AddMonitorItem(const MonitorItem &item);
+        // 添加成功时通过 handle 返回服务端分配的句柄，可用于下面按句柄发送心跳的重载
+        bool AddMonitorItem(const MonitorItem &item, uint32_t &handle);
         bool UpdateMonitorItem(const MonitorItem &item);
+        // 一次请求批量添加或更新（按 ID）并移除监控项，服务端在一次加锁内校验整批并只保存一次配置；
+        // 任何一项校验失败（ID 重复、路径已被监控、移除的项不存在）时整批不生效。
+        // handles 与 items 一一对应
+        bool ApplyMonitorItems(const std::vector<MonitorItem> &items, const std::vector<std::string> &removeIds = {});
+        bool ApplyMonitorItems(const std::vector<MonitorItem> &items, const std::vector<std::string> &removeIds,
+                               std::vector<uint32_t> &handles);
         bool RemoveMonitorItem(const std::string &id);
         bool StopMonitorItem(const std::string &id);
         bool StartMonitorItem(const std::string &id);
@@ -112,11 +227,48 @@ namespace ProcessGuard
 
         std::vector<MonitorItem> GetAllMonitorItems();
         ServiceStatus GetServiceStatus();
+        ServiceMetrics GetMetrics();
 
+        // 在独立连接和线程上长轮询状态变化，先回调一次快照，之后只回调增量事件；
+        // 服务重启或落后太多时会再次收到快照。再次调用会替换之前的订阅。
+        // 回调中可以调用 UnsubscribeStatus（回调返回后订阅线程退出），但不能调用 SubscribeStatus 或析构 Client
+        bool SubscribeStatus(std::function<void(const StatusUpdate &)> callback, int waitMs = 10000);
+        void UnsubscribeStatus();
+
+        // 已知监控项当前的句柄（添加、列出过或之前的心跳响应中返回过）时按句柄发送，
+        // 服务端开启 shared_heartbeat 时同样只写入共享内存槽位
         bool SendHeartbeat(const std::string &itemId);
-        void StartHeartbeatThread(const std::string &itemId, int intervalMs = 500);
+        // 按句柄发送心跳，服务端直接定位监控项而不查找字符串 ID；心跳失败回调的参数为句柄对应的 ID。
+        // 只接受本客户端的 AddMonitorItem/ApplyMonitorItems/GetAllMonitorItems 在服务本次运行中返回过的句柄，其他句柄直接返回 false。
+        // 服务端开启 shared_heartbeat 时只写入共享内存槽位，不发送请求，也不会检测到已删除的监控项
+        bool SendHeartbeat(uint32_t handle);
+        // 心跳同时携带指标；指标只能通过 JSON 请求上报，不使用二进制报文和共享内存。gauges 为空时同上
+        bool SendHeartbeat(const std::string &itemId, const Gauges &gauges);
+        bool SendHeartbeat(uint32_t handle, const Gauges &gauges);
+        // 一次请求更新多个监控项的心跳；服务端不支持时自动逐个发送
+        bool SendHeartbeatBatch(const std::vector<std::string> &itemIds);
+        bool SendHeartbeatBatch(const std::vector<uint32_t> &handles);
+        // 所有监控项共用一个心跳调度线程，同一时刻到期的监控项合并为一个批量请求。
+        // intervalMs 为 0 时按监控项的 heartbeatTimeoutMs / 3 选择（本客户端添加或列出过的监控项，否则 500ms）；
+        // 首次心跳在一个间隔内随机错开，服务不可达时全部心跳按 0.5s 起加倍（上限 30s）退避
+        void StartHeartbeatThread(const std::string &itemId, int intervalMs = 0);
+        void StartHeartbeatThread(uint32_t handle, int intervalMs = 0);
         void StopHeartbeatThread(const std::string &itemId);
+        void StopHeartbeatThread(uint32_t handle);
         void StopAllHeartbeatThreads();
+        // 心跳线程发送前按监控项 ID 取指标，返回非空时该监控项单独发送带指标的心跳，不参与批量合并；
+        // 应在 StartHeartbeatThread 之前设置
+        void SetHeartbeatGaugeProvider(std::function<Gauges(const std::string &)> provider);
+        // 默认开启；关闭后心跳不再写入共享内存，总是经管道发送（例如测量管道往返）
+        void SetSharedHeartbeatEnabled(bool enabled);
+
+        // 异步请求在独立连接和 I/O 线程上排队，连续提交的请求合并为一次流水线写入；
+        // 回调在 I/O 线程上执行，不应阻塞。异步调用不更新 GetLastError，
+        // 心跳失败时仍会调用心跳失败回调。客户端析构时未完成的请求以失败完成
+        std::future<bool> SendHeartbeatAsync(const std::string &itemId);
+        void SendHeartbeatAsync(const std::string &itemId, std::function<void(bool)> callback);
+        std::future<ServiceStatus> GetServiceStatusAsync();
+        void GetServiceStatusAsync(std::function<void(const ServiceStatus &)> callback);
 
         bool EnsureServiceInstalled(const std::string &servicePath);
         bool EnsureServiceRunning();
@@ -130,11 +282,17 @@ namespace ProcessGuard
         bool ResumeSelfMonitor();
         void SetSelfMonitorId(const std::string &id);
         std::string GetSelfMonitorId() const;
-        bool StartSelfHeartbeat(int intervalMs = 500);
+        bool StartSelfHeartbeat(int intervalMs = 0);
         void StopSelfHeartbeat();
 
+        // 通知服务当前进程已完成启动。isStandby 为 true 表示当前进程是开启 standby 的监控项的备用实例，
+        // 此时不应发送心跳或对外提供服务，应先调用 WaitForPromotion
+        bool SignalReady(const std::string &itemId, bool *isStandby = nullptr);
+        // 备用实例等待被提升为当前实例，提升后返回 true；timeoutMs 小于 0 时一直等待
+        bool WaitForPromotion(const std::string &itemId, int timeoutMs = -1);
+
     private:
-        struct HeartbeatThreadEntry;
+        class HeartbeatScheduler;
         struct Impl;
         std::unique_ptr<Impl> impl_;
     };
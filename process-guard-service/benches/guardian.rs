@@ -0,0 +1,127 @@
+//! 守护线程热点路径的基准测试：`cargo bench --bench guardian`
+//!
+//! 不连接管道、不启动进程：监控项直接标记为“已启动”，PID 指向基准测试进程自身，
+//! 因此 check_processes 走完整的快照与存活判断，但不会调用会话 0 启动或触发重启。
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use process_guard_service::guardian::Guardian;
+use process_guard_service::models::{Config, MonitorItem};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+
+const ITEM_COUNTS: [usize; 3] = [10, 100, 1000];
+const CLIENT_COUNTS: [usize; 3] = [1, 4, 16];
+
+fn guardian_with_items(count: usize) -> Arc<Guardian> {
+    let mut config = Config::default();
+    config.items = (0..count)
+        .map(|i| {
+            MonitorItem::new(
+                format!("C:\\ProcessGuardBench\\item-{}.exe", i),
+                format!("bench-{}", i),
+            )
+        })
+        .collect();
+
+    let guardian = Arc::new(Guardian::with_config(
+        config,
+        Arc::new(Mutex::new(true)),
+        None,
+    ));
+
+    // 跳过启动宽限期，让检查覆盖全部监控项
+    let started_long_ago = Instant::now() - Duration::from_secs(3600);
+    guardian.for_each_process_mut(|process| {
+        process.process_id = Some(std::process::id());
+        process.startup_time = started_long_ago;
+        process.heartbeat.reset();
+    });
+    guardian
+}
+
+fn item_handles(guardian: &Guardian) -> Vec<u32> {
+    let ids: Vec<String> = guardian
+        .get_config()
+        .lock()
+        .unwrap()
+        .items
+        .iter()
+        .map(|item| item.id.clone())
+        .collect();
+    ids.iter().map(|id| guardian.item_handle(id)).collect()
+}
+
+fn bench_status(c: &mut Criterion) {
+    let mut group = c.benchmark_group("status");
+    for count in ITEM_COUNTS {
+        let guardian = guardian_with_items(count);
+        group.throughput(Throughput::Elements(count as u64));
+        group.bench_with_input(
+            BenchmarkId::new("status_snapshot", count),
+            &guardian,
+            |b, g| b.iter(|| black_box(g.status_snapshot())),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("get_status_json", count),
+            &guardian,
+            |b, g| b.iter(|| black_box(g.get_status().to_string())),
+        );
+    }
+    group.finish();
+}
+
+fn bench_check_processes(c: &mut Criterion) {
+    let mut group = c.benchmark_group("check_processes");
+    for count in ITEM_COUNTS {
+        let guardian = guardian_with_items(count);
+        group.throughput(Throughput::Elements(count as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(count), &guardian, |b, g| {
+            b.iter(|| g.check_processes())
+        });
+    }
+    group.finish();
+}
+
+/// `clients` 个线程同时按句柄上报心跳，每个线程各自轮流写入全部监控项
+fn bench_heartbeats(c: &mut Criterion) {
+    let guardian = guardian_with_items(100);
+    let handles = item_handles(&guardian);
+
+    let mut group = c.benchmark_group("heartbeat_by_handle");
+    for clients in CLIENT_COUNTS {
+        group.throughput(Throughput::Elements((clients * handles.len()) as u64));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(clients),
+            &clients,
+            |b, &clients| {
+                b.iter_custom(|iters| {
+                    let started = Instant::now();
+                    std::thread::scope(|scope| {
+                        for _ in 0..clients {
+                            scope.spawn(|| {
+                                for _ in 0..iters {
+                                    for &handle in &handles {
+                                        black_box(
+                                            guardian
+                                                .update_heartbeat_by_handle(handle, Duration::ZERO),
+                                        );
+                                    }
+                                }
+                            });
+                        }
+                    });
+                    started.elapsed()
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_status,
+    bench_check_processes,
+    bench_heartbeats
+);
+criterion_main!(benches);
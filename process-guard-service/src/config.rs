@@ -1,10 +1,30 @@
-use crate::models::{Config, MonitorItem, CONFIG_BACKUP_FILE_NAME, CONFIG_FILE_NAME};
+use crate::journal::Journal;
+use crate::metrics::metrics;
+use crate::models::{
+    ChangeType, Config, ConfigChange, MonitorItem, CONFIG_BACKUP_FILE_NAME, CONFIG_FILE_NAME,
+    JOURNAL_FILE_NAME,
+};
 use log::{debug, error, info, warn};
-use std::collections::HashMap;
+use std::collections::{hash_map::Entry, HashMap, HashSet};
 use std::env;
 use std::fs;
-use std::io;
+use std::io::{self, Write};
+use std::os::windows::ffi::OsStrExt;
 use std::path::{Path, PathBuf};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant, UNIX_EPOCH};
+use windows::core::PCWSTR;
+use windows::Win32::Storage::FileSystem::{
+    MoveFileExW, MOVEFILE_REPLACE_EXISTING, MOVEFILE_WRITE_THROUGH,
+};
+
+/// 第一次变更后等待合并后续变更的时长
+const CONFIG_SAVE_COALESCE_MS: u64 = 200;
+/// 保存失败后重试的间隔
+const CONFIG_SAVE_RETRY_MS: u64 = 5000;
+/// 写入临时文件后再替换正式文件，避免中途失败留下半个文件
+const CONFIG_TEMP_SUFFIX: &str = ".tmp";
 
 pub fn get_config_dir() -> PathBuf {
     let exe_path = env::current_exe().unwrap_or_else(|_| PathBuf::from("."));
@@ -20,6 +40,19 @@ pub fn get_config_backup_file_path() -> PathBuf {
     get_config_dir().join(CONFIG_BACKUP_FILE_NAME)
 }
 
+pub fn get_journal_file_path() -> PathBuf {
+    get_config_dir().join(JOURNAL_FILE_NAME)
+}
+
+/// 配置文件的修改时间（Unix 毫秒），文件不存在时返回 None
+pub fn config_modified_ms(path: &Path) -> Option<i64> {
+    let modified = fs::metadata(path).and_then(|m| m.modified()).ok()?;
+    modified
+        .duration_since(UNIX_EPOCH)
+        .ok()
+        .map(|d| d.as_millis() as i64)
+}
+
 #[cfg(test)]
 fn get_config_backup_file_path_for_tests(base_dir: &Path) -> PathBuf {
     base_dir.join(CONFIG_BACKUP_FILE_NAME)
@@ -183,92 +216,389 @@ fn deduplicate_exe_paths_with_target(mut config: Config, save_path: Option<&Path
     config
 }
 
+/// 立即保存配置：写入正式文件成功后再刷新备份文件
 pub fn save_config(config: &Config) -> io::Result<()> {
-    ensure_config_dir()?;
+    let content = serialize_config(config)?;
+    commit_config(
+        &get_config_file_path(),
+        Some(&get_config_backup_file_path()),
+        &content,
+        config.items.len(),
+    )
+}
 
-    let config_path = get_config_file_path();
+fn serialize_config(config: &Config) -> io::Result<String> {
+    serde_json::to_string_pretty(config).map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))
+}
+
+fn commit_config(
+    config_path: &Path,
+    backup_path: Option<&Path>,
+    content: &str,
+    item_count: usize,
+) -> io::Result<()> {
+    let started = Instant::now();
+    let result = commit_config_inner(config_path, backup_path, content, item_count);
+
+    let metrics = metrics();
+    metrics
+        .config_save_duration
+        .record_duration(started.elapsed());
+    metrics.config_saves.increment();
+    if result.is_err() {
+        metrics.config_save_failures.increment();
+    }
+    result
+}
 
-    info!("Saving config to: {:?}", config_path);
+fn commit_config_inner(
+    config_path: &Path,
+    backup_path: Option<&Path>,
+    content: &str,
+    item_count: usize,
+) -> io::Result<()> {
+    debug!("Saving config to: {:?}", config_path);
 
-    save_config_to_path(&config_path, config)?;
+    write_file_atomic(config_path, content)?;
 
-    info!("Config saved successfully ({} items)", config.items.len());
+    // 备份只在正式文件成功提交后刷新，始终是最近一次完整写入的配置
+    if let Some(backup_path) = backup_path {
+        if let Err(e) = write_file_atomic(backup_path, content) {
+            warn!("Failed to refresh config backup {:?}: {}", backup_path, e);
+        }
+    }
 
-    debug!("Saved config: {:?}", config);
+    info!("Config saved successfully ({} items)", item_count);
     Ok(())
 }
 
 fn save_config_to_path(path: &Path, config: &Config) -> io::Result<()> {
+    write_file_atomic(path, &serialize_config(config)?)
+}
+
+fn write_file_atomic(path: &Path, content: &str) -> io::Result<()> {
+    write_bytes_atomic(path, content.as_bytes())
+}
+
+/// 先写入同目录下的临时文件并落盘，再用 MoveFileExW 替换目标文件；
+/// 任何一步失败时目标文件保持原样
+pub(crate) fn write_bytes_atomic(path: &Path, content: &[u8]) -> io::Result<()> {
     if let Some(parent) = path.parent() {
         fs::create_dir_all(parent)?;
     }
 
-    let content = serde_json::to_string_pretty(config)
-        .map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?;
+    let mut temp_name = path.as_os_str().to_os_string();
+    temp_name.push(CONFIG_TEMP_SUFFIX);
+    let temp_path = PathBuf::from(temp_name);
+
+    let written = fs::File::create(&temp_path).and_then(|mut file| {
+        file.write_all(content)?;
+        file.sync_all()
+    });
+    if let Err(e) = written {
+        let _ = fs::remove_file(&temp_path);
+        return Err(e);
+    }
+
+    let to_wide = |p: &Path| -> Vec<u16> {
+        p.as_os_str()
+            .encode_wide()
+            .chain(std::iter::once(0))
+            .collect()
+    };
+    let temp_wide = to_wide(&temp_path);
+    let target_wide = to_wide(path);
+
+    let moved = unsafe {
+        MoveFileExW(
+            PCWSTR(temp_wide.as_ptr()),
+            PCWSTR(target_wide.as_ptr()),
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH,
+        )
+    };
+    moved.map_err(|e| {
+        let _ = fs::remove_file(&temp_path);
+        io::Error::new(
+            io::ErrorKind::Other,
+            format!("MoveFileExW to {:?} failed: {}", path, e),
+        )
+    })
+}
+
+#[derive(Default)]
+struct PersistState {
+    dirty: bool,
+    /// 到达该时间后写入；第一次变更时设置，之后的变更不会推迟写入
+    due_at: Option<Instant>,
+    shutdown: bool,
+}
 
-    fs::write(path, content)
+struct PersistShared {
+    config: Arc<Mutex<Config>>,
+    config_path: PathBuf,
+    backup_path: PathBuf,
+    /// 有状态日志时由日志代替备份文件：变更先追加到日志，config.json 只作为导出
+    journal: Option<Arc<Journal>>,
+    state: Mutex<PersistState>,
+    condvar: Condvar,
 }
 
-pub fn add_item(config: &mut Config, item: MonitorItem) -> io::Result<()> {
-    info!("Adding new monitor item: {} ({})", item.name, item.id);
+/// 后台配置保存线程。
+/// 请求处理只把配置标记为已修改，短时间内的多次修改合并为一次写入；
+/// 写入时只在序列化期间持有配置锁，文件 I/O 不阻塞管道请求。
+/// 锁顺序为配置锁在前：调用方可以在持有配置锁时调用 mark_dirty。
+pub struct ConfigPersister {
+    shared: Arc<PersistShared>,
+    worker: Mutex<Option<JoinHandle<()>>>,
+}
 
-    if config.items.iter().any(|i| i.id == item.id) {
-        error!("Item with id {} already exists", item.id);
-        return Err(io::Error::new(
-            io::ErrorKind::AlreadyExists,
-            format!("Item with id {} already exists", item.id),
-        ));
+impl ConfigPersister {
+    pub fn new(config: Arc<Mutex<Config>>, journal: Option<Arc<Journal>>) -> Self {
+        Self::with_paths(
+            config,
+            get_config_file_path(),
+            get_config_backup_file_path(),
+            journal,
+        )
     }
 
-    config.items.push(item);
-    save_config(config)?;
+    fn with_paths(
+        config: Arc<Mutex<Config>>,
+        config_path: PathBuf,
+        backup_path: PathBuf,
+        journal: Option<Arc<Journal>>,
+    ) -> Self {
+        let shared = Arc::new(PersistShared {
+            config,
+            config_path,
+            backup_path,
+            journal,
+            state: Mutex::new(PersistState::default()),
+            condvar: Condvar::new(),
+        });
 
-    info!("Item added successfully");
-    Ok(())
-}
+        let shared_for_worker = shared.clone();
+        let worker = std::thread::Builder::new()
+            .name("config-persister".to_string())
+            .spawn(move || persist_loop(&shared_for_worker));
+        let worker = match worker {
+            Ok(handle) => Some(handle),
+            Err(e) => {
+                error!("Failed to spawn config persister: {}", e);
+                None
+            }
+        };
 
-pub fn update_item(config: &mut Config, item: MonitorItem) -> io::Result<()> {
-    info!("Updating monitor item: {} ({})", item.name, item.id);
-
-    if let Some(existing) = config.items.iter_mut().find(|i| i.id == item.id) {
-        *existing = item;
-        save_config(config)?;
-        info!("Item updated successfully");
-        Ok(())
-    } else {
-        error!("Item with id {} not found", item.id);
-        Err(io::Error::new(
-            io::ErrorKind::NotFound,
-            format!("Item with id {} not found", item.id),
-        ))
+        Self {
+            shared,
+            worker: Mutex::new(worker),
+        }
     }
-}
 
-pub fn remove_item(config: &mut Config, id: &str) -> io::Result<()> {
-    info!("Removing monitor item: {}", id);
+    /// 标记配置已修改，CONFIG_SAVE_COALESCE_MS 内的后续修改合并到同一次写入
+    pub fn mark_dirty(&self) {
+        let mut state = self.shared.state.lock().unwrap();
+        if state.shutdown {
+            warn!("Config persister already stopped, change will not be saved");
+            return;
+        }
+        if !state.dirty {
+            state.dirty = true;
+            state.due_at = Some(Instant::now() + Duration::from_millis(CONFIG_SAVE_COALESCE_MS));
+            self.shared.condvar.notify_one();
+        }
+    }
 
-    let initial_len = config.items.len();
-    config.items.retain(|i| i.id != id);
+    /// 立即写出尚未保存的修改后停止后台线程
+    pub fn shutdown(&self) {
+        {
+            let mut state = self.shared.state.lock().unwrap();
+            state.shutdown = true;
+            self.shared.condvar.notify_one();
+        }
 
-    if config.items.len() == initial_len {
-        error!("Item with id {} not found", id);
-        return Err(io::Error::new(
-            io::ErrorKind::NotFound,
-            format!("Item with id {} not found", id),
-        ));
+        if let Some(worker) = self.worker.lock().unwrap().take() {
+            let _ = worker.join();
+        }
     }
+}
 
-    save_config(config)?;
-    info!("Item removed successfully");
-    Ok(())
+impl Drop for ConfigPersister {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
 }
 
-pub fn get_item<'a>(config: &'a Config, id: &str) -> Option<&'a MonitorItem> {
-    config.items.iter().find(|i| i.id == id)
+fn persist_loop(shared: &PersistShared) {
+    loop {
+        let shutdown = {
+            let mut state = shared.state.lock().unwrap();
+            loop {
+                if state.dirty {
+                    let now = Instant::now();
+                    let due_at = state.due_at.unwrap_or(now);
+                    if state.shutdown || now >= due_at {
+                        break;
+                    }
+                    state = shared.condvar.wait_timeout(state, due_at - now).unwrap().0;
+                } else if state.shutdown {
+                    return;
+                } else {
+                    state = shared.condvar.wait(state).unwrap();
+                }
+            }
+            state.dirty = false;
+            state.due_at = None;
+            state.shutdown
+        };
+
+        let serialized = {
+            let config = shared.config.lock().unwrap();
+            if let Some(journal) = &shared.journal {
+                journal.record_config(&config);
+            }
+            serialize_config(&config).map(|content| (content, config.items.len()))
+        };
+
+        let backup_path = match shared.journal {
+            Some(_) => None,
+            None => Some(shared.backup_path.as_path()),
+        };
+        let result = serialized.and_then(|(content, item_count)| {
+            commit_config(&shared.config_path, backup_path, &content, item_count)
+        });
+        if let (Ok(()), Some(journal)) = (&result, &shared.journal) {
+            if let Some(modified_ms) = config_modified_ms(&shared.config_path) {
+                journal.record_exported(modified_ms);
+            }
+        }
+        if let Err(e) = result {
+            if shutdown {
+                error!("Failed to save config on shutdown: {}", e);
+                return;
+            }
+            error!(
+                "Failed to save config, retrying in {} ms: {}",
+                CONFIG_SAVE_RETRY_MS, e
+            );
+            let mut state = shared.state.lock().unwrap();
+            if !state.dirty {
+                state.dirty = true;
+                state.due_at = Some(Instant::now() + Duration::from_millis(CONFIG_SAVE_RETRY_MS));
+            }
+        }
+    }
 }
 
-pub fn get_item_mut<'a>(config: &'a mut Config, id: &str) -> Option<&'a mut MonitorItem> {
-    config.items.iter_mut().find(|i| i.id == id)
+/// batch 请求应用到配置后需要交给守护线程的运行时变更
+#[derive(Debug)]
+pub struct BatchOutcome {
+    pub added: usize,
+    pub updated: usize,
+    pub removed: usize,
+    pub changes: Vec<ConfigChange>,
+}
+
+/// 在一次加锁内校验并应用一批修改：`items` 按 ID 添加或更新，`remove_ids` 中的监控项被移除。
+/// 先用路径索引校验整批（ID 重复、路径冲突、移除不存在的项），有任何错误时不修改配置并返回全部错误
+pub fn apply_batch(
+    config: &mut Config,
+    items: &[MonitorItem],
+    remove_ids: &[String],
+) -> Result<BatchOutcome, Vec<String>> {
+    let mut errors = Vec::new();
+    let existing_ids: HashSet<&str> = config.items.iter().map(|i| i.id.as_str()).collect();
+
+    let removing: HashSet<&str> = remove_ids.iter().map(|id| id.as_str()).collect();
+    for id in &removing {
+        if !existing_ids.contains(id) {
+            errors.push(format!("未找到要移除的监控项: {}", id));
+        }
+    }
+
+    let mut batch_ids = HashSet::new();
+    for item in items {
+        if item.id.is_empty() || item.exe_path.is_empty() {
+            errors.push(format!("监控项缺少 id 或 exe_path: {}", item.name));
+        } else if !batch_ids.insert(item.id.as_str()) {
+            errors.push(format!("批量请求中监控项 ID 重复: {}", item.id));
+        } else if removing.contains(item.id.as_str()) {
+            errors.push(format!("监控项不能同时更新和移除: {}", item.id));
+        }
+    }
+
+    // 被移除或被本批次覆盖的旧项不占用路径
+    let mut paths: HashMap<String, &str> = config
+        .items
+        .iter()
+        .filter(|i| !removing.contains(i.id.as_str()) && !batch_ids.contains(i.id.as_str()))
+        .map(|i| (i.exe_path.to_lowercase(), i.id.as_str()))
+        .collect();
+    for item in items {
+        match paths.entry(item.exe_path.to_lowercase()) {
+            Entry::Occupied(owner) if *owner.get() != item.id => errors.push(format!(
+                "可执行文件路径已被监控: {} ({})",
+                item.exe_path,
+                owner.get()
+            )),
+            Entry::Occupied(_) => {}
+            Entry::Vacant(slot) => {
+                slot.insert(item.id.as_str());
+            }
+        }
+    }
+
+    if !errors.is_empty() {
+        return Err(errors);
+    }
+
+    let mut outcome = BatchOutcome {
+        added: 0,
+        updated: 0,
+        removed: 0,
+        changes: Vec::with_capacity(items.len() + remove_ids.len()),
+    };
+
+    if !removing.is_empty() {
+        config.items.retain(|item| {
+            if !removing.contains(item.id.as_str()) {
+                return true;
+            }
+            outcome.changes.push(ConfigChange {
+                item: item.clone(),
+                change_type: ChangeType::Stop | ChangeType::Remove,
+            });
+            false
+        });
+        outcome.removed = outcome.changes.len();
+    }
+
+    let positions: HashMap<String, usize> = config
+        .items
+        .iter()
+        .enumerate()
+        .map(|(index, item)| (item.id.clone(), index))
+        .collect();
+    for item in items {
+        let change_type = match positions.get(&item.id) {
+            Some(&index) => {
+                config.items[index] = item.clone();
+                outcome.updated += 1;
+                ChangeType::Stop | ChangeType::Start
+            }
+            None => {
+                config.items.push(item.clone());
+                outcome.added += 1;
+                ChangeType::Start
+            }
+        };
+        outcome.changes.push(ConfigChange {
+            item: item.clone(),
+            change_type,
+        });
+    }
+
+    Ok(outcome)
 }
 
 #[cfg(test)]
@@ -443,6 +773,111 @@ mod tests {
         assert_eq!(backup_after, backup);
     }
 
+    #[test]
+    fn persister_coalesces_changes_and_refreshes_backup_on_commit() {
+        let harness = ConfigTestHarness::new();
+        let config = Arc::new(Mutex::new(Config::new()));
+        let persister = ConfigPersister::with_paths(
+            config.clone(),
+            harness.main_path().to_path_buf(),
+            harness.backup_path().to_path_buf(),
+            None,
+        );
+
+        for index in 0..50 {
+            let mut cfg = config.lock().unwrap();
+            cfg.items.push(MonitorItem {
+                id: index.to_string(),
+                exe_path: format!("C:\\App{}.exe", index),
+                args: None,
+                name: format!("App{}", index),
+                minimize: false,
+                no_window: false,
+                enabled: true,
+                heartbeat_timeout_ms: 10000,
+                limits: None,
+                ready_timeout_ms: 0,
+                standby: false,
+            });
+            persister.mark_dirty();
+        }
+        // 仍在合并窗口内，尚未写入
+        assert!(!harness.main_path().exists());
+
+        persister.shutdown();
+
+        let main_after = fs::read_to_string(harness.main_path()).unwrap();
+        let saved: Config = serde_json::from_str(&main_after).unwrap();
+        assert_eq!(saved.items.len(), 50);
+        assert_eq!(
+            fs::read_to_string(harness.backup_path()).unwrap(),
+            main_after
+        );
+
+        let mut temp_name = harness.main_path().as_os_str().to_os_string();
+        temp_name.push(CONFIG_TEMP_SUFFIX);
+        assert!(!PathBuf::from(temp_name).exists());
+    }
+
+    fn batch_item(id: &str, exe_path: &str) -> MonitorItem {
+        MonitorItem {
+            id: id.to_string(),
+            exe_path: exe_path.to_string(),
+            args: None,
+            name: id.to_string(),
+            minimize: false,
+            no_window: false,
+            enabled: true,
+            heartbeat_timeout_ms: 10000,
+            limits: None,
+            ready_timeout_ms: 0,
+            standby: false,
+        }
+    }
+
+    #[test]
+    fn batch_applies_adds_updates_and_removals_together() {
+        let mut config = Config::new();
+        config.items.push(batch_item("a", "C:\\A.exe"));
+        config.items.push(batch_item("b", "C:\\B.exe"));
+
+        // b 被移除后其路径可以由新项 c 使用，a 更新为新路径
+        let outcome = apply_batch(
+            &mut config,
+            &[batch_item("a", "C:\\A2.exe"), batch_item("c", "c:\\b.EXE")],
+            &["b".to_string()],
+        )
+        .unwrap();
+
+        assert_eq!((outcome.added, outcome.updated, outcome.removed), (1, 1, 1));
+        assert_eq!(outcome.changes.len(), 3);
+        assert!(outcome.changes[0].change_type.has_flag(ChangeType::Remove));
+        let ids: Vec<&str> = config.items.iter().map(|i| i.id.as_str()).collect();
+        assert_eq!(ids, vec!["a", "c"]);
+        assert_eq!(config.items[0].exe_path, "C:\\A2.exe");
+    }
+
+    #[test]
+    fn batch_with_any_error_leaves_config_unchanged() {
+        let mut config = Config::new();
+        config.items.push(batch_item("a", "C:\\A.exe"));
+
+        let errors = apply_batch(
+            &mut config,
+            &[
+                batch_item("b", "c:\\a.exe"),
+                batch_item("c", "C:\\C.exe"),
+                batch_item("c", "C:\\D.exe"),
+            ],
+            &["missing".to_string()],
+        )
+        .unwrap_err();
+
+        assert_eq!(errors.len(), 3);
+        assert_eq!(config.items.len(), 1);
+        assert_eq!(config.items[0].id, "a");
+    }
+
     fn valid_single_item_json() -> &'static str {
         r#"{"items":[{"id":"1","exe_path":"C:\\App.exe","args":null,"name":"App","minimize":false,"no_window":false,"enabled":true,"heartbeat_timeout_ms":10000}]}"#
     }
@@ -0,0 +1,103 @@
+use std::cmp::Reverse;
+use std::collections::{BinaryHeap, HashMap};
+use std::time::Instant;
+
+/// 按截止时间排序的监控项调度器（最小堆）。
+/// 每个监控项只有一个有效截止时间，重新调度时旧的堆项不删除，出堆时与 `current` 比对后丢弃。
+/// 心跳不需要修改堆：截止时间到达后由调用方根据最新心跳重新计算，未超时则再次调度。
+#[derive(Debug, Default)]
+pub struct DeadlineScheduler {
+    heap: BinaryHeap<Reverse<(Instant, String)>>,
+    current: HashMap<String, Instant>,
+}
+
+impl DeadlineScheduler {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn schedule(&mut self, item_id: &str, deadline: Instant) {
+        if self.current.get(item_id) == Some(&deadline) {
+            return;
+        }
+        self.current.insert(item_id.to_string(), deadline);
+        self.heap.push(Reverse((deadline, item_id.to_string())));
+    }
+
+    pub fn cancel(&mut self, item_id: &str) {
+        self.current.remove(item_id);
+    }
+
+    /// 最早的有效截止时间，顺带丢弃堆顶的过期项
+    pub fn next_deadline(&mut self) -> Option<Instant> {
+        while let Some(Reverse((deadline, item_id))) = self.heap.peek() {
+            if self.current.get(item_id) == Some(deadline) {
+                return Some(*deadline);
+            }
+            self.heap.pop();
+        }
+        None
+    }
+
+    /// 取出所有截止时间不晚于 `now` 的监控项，按截止时间先后排列
+    pub fn pop_due(&mut self, now: Instant) -> Vec<String> {
+        let mut due = Vec::new();
+        while let Some(deadline) = self.next_deadline() {
+            if deadline > now {
+                break;
+            }
+            if let Some(Reverse((_, item_id))) = self.heap.pop() {
+                self.current.remove(&item_id);
+                due.push(item_id);
+            }
+        }
+        due
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::DeadlineScheduler;
+    use std::time::{Duration, Instant};
+
+    #[test]
+    fn pops_due_items_in_deadline_order() {
+        let base = Instant::now();
+        let mut scheduler = DeadlineScheduler::new();
+        scheduler.schedule("late", base + Duration::from_millis(300));
+        scheduler.schedule("early", base + Duration::from_millis(100));
+        scheduler.schedule("middle", base + Duration::from_millis(200));
+
+        assert_eq!(
+            scheduler.next_deadline(),
+            Some(base + Duration::from_millis(100))
+        );
+        assert_eq!(
+            scheduler.pop_due(base + Duration::from_millis(250)),
+            vec!["early".to_string(), "middle".to_string()]
+        );
+        assert_eq!(
+            scheduler.next_deadline(),
+            Some(base + Duration::from_millis(300))
+        );
+    }
+
+    #[test]
+    fn rescheduling_and_cancel_discard_stale_entries() {
+        let base = Instant::now();
+        let mut scheduler = DeadlineScheduler::new();
+        scheduler.schedule("EnergyMonitor", base + Duration::from_millis(100));
+        scheduler.schedule("EnergyMonitor", base + Duration::from_millis(500));
+        scheduler.schedule("Collector", base + Duration::from_millis(200));
+        scheduler.cancel("Collector");
+
+        assert!(scheduler
+            .pop_due(base + Duration::from_millis(400))
+            .is_empty());
+        assert_eq!(
+            scheduler.pop_due(base + Duration::from_millis(500)),
+            vec!["EnergyMonitor".to_string()]
+        );
+        assert_eq!(scheduler.next_deadline(), None);
+    }
+}
@@ -0,0 +1,122 @@
+pub const FRAME_HEADER_SIZE: usize = 4;
+pub const MAX_FRAME_SIZE: usize = 16 * 1024 * 1024;
+
+#[derive(Debug, PartialEq, Eq)]
+pub enum FrameError {
+    TooLarge(usize),
+}
+
+impl std::fmt::Display for FrameError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            FrameError::TooLarge(len) => write!(f, "frame too large: {} bytes", len),
+        }
+    }
+}
+
+/// 会话模式下的长度前缀帧: `[u32 小端长度][负载]`，编码后追加到 `out`
+pub fn encode_frame(payload: &[u8], out: &mut Vec<u8>) {
+    out.reserve(FRAME_HEADER_SIZE + payload.len());
+    out.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+    out.extend_from_slice(payload);
+}
+
+/// 增量帧解码器，允许一次读取包含多个帧或半个帧
+#[derive(Debug, Default)]
+pub struct FrameDecoder {
+    buffer: Vec<u8>,
+    consumed: usize,
+}
+
+impl FrameDecoder {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn push(&mut self, data: &[u8]) {
+        if self.consumed > 0 && self.consumed == self.buffer.len() {
+            self.buffer.clear();
+            self.consumed = 0;
+        }
+        self.buffer.extend_from_slice(data);
+    }
+
+    /// 取出下一个完整帧的负载；数据不足时返回 `Ok(None)`
+    pub fn next_frame(&mut self) -> Result<Option<Vec<u8>>, FrameError> {
+        let pending = &self.buffer[self.consumed..];
+        if pending.len() < FRAME_HEADER_SIZE {
+            self.compact();
+            return Ok(None);
+        }
+
+        let len = u32::from_le_bytes([pending[0], pending[1], pending[2], pending[3]]) as usize;
+        if len > MAX_FRAME_SIZE {
+            return Err(FrameError::TooLarge(len));
+        }
+
+        if pending.len() < FRAME_HEADER_SIZE + len {
+            self.compact();
+            return Ok(None);
+        }
+
+        let start = self.consumed + FRAME_HEADER_SIZE;
+        let payload = self.buffer[start..start + len].to_vec();
+        self.consumed = start + len;
+        Ok(Some(payload))
+    }
+
+    fn compact(&mut self) {
+        if self.consumed > 0 {
+            self.buffer.drain(..self.consumed);
+            self.consumed = 0;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{encode_frame, FrameDecoder, FrameError, MAX_FRAME_SIZE};
+
+    #[test]
+    fn decodes_frame_split_across_reads() {
+        let mut encoded = Vec::new();
+        encode_frame(br#"{"type":"heartbeat"}"#, &mut encoded);
+
+        let mut decoder = FrameDecoder::new();
+        decoder.push(&encoded[..3]);
+        assert_eq!(decoder.next_frame(), Ok(None));
+        decoder.push(&encoded[3..10]);
+        assert_eq!(decoder.next_frame(), Ok(None));
+        decoder.push(&encoded[10..]);
+        assert_eq!(
+            decoder.next_frame(),
+            Ok(Some(br#"{"type":"heartbeat"}"#.to_vec()))
+        );
+        assert_eq!(decoder.next_frame(), Ok(None));
+    }
+
+    #[test]
+    fn decodes_multiple_frames_from_single_read() {
+        let mut encoded = Vec::new();
+        encode_frame(b"first", &mut encoded);
+        encode_frame(b"", &mut encoded);
+        encode_frame(b"third", &mut encoded);
+
+        let mut decoder = FrameDecoder::new();
+        decoder.push(&encoded);
+        assert_eq!(decoder.next_frame(), Ok(Some(b"first".to_vec())));
+        assert_eq!(decoder.next_frame(), Ok(Some(Vec::new())));
+        assert_eq!(decoder.next_frame(), Ok(Some(b"third".to_vec())));
+        assert_eq!(decoder.next_frame(), Ok(None));
+    }
+
+    #[test]
+    fn rejects_oversized_frame_header() {
+        let mut decoder = FrameDecoder::new();
+        decoder.push(&((MAX_FRAME_SIZE as u32) + 1).to_le_bytes());
+        assert_eq!(
+            decoder.next_frame(),
+            Err(FrameError::TooLarge(MAX_FRAME_SIZE + 1))
+        );
+    }
+}
@@ -0,0 +1,159 @@
+use serde::Serialize;
+use std::collections::BTreeMap;
+
+/// 每个监控项最多记录的指标数，超出的指标名被丢弃
+pub const MAX_GAUGES: usize = 8;
+/// 每个监控项保留的最近采样数
+pub const GAUGE_HISTORY: usize = 32;
+pub const MAX_GAUGE_NAME_LEN: usize = 64;
+
+/// 一次心跳携带的全部指标，未上报的指标为 NaN
+#[derive(Debug, Clone, Copy)]
+struct GaugeSample {
+    at_ms: u64,
+    values: [f64; MAX_GAUGES],
+}
+
+const EMPTY_SAMPLE: GaugeSample = GaugeSample {
+    at_ms: 0,
+    values: [f64::NAN; MAX_GAUGES],
+};
+
+/// 单个指标在环形缓冲区内的统计
+#[derive(Debug, Clone, PartialEq, Serialize)]
+pub struct GaugeStats {
+    pub last: f64,
+    pub min: f64,
+    pub max: f64,
+    pub mean: f64,
+    pub samples: usize,
+    /// 最近一次上报距现在的毫秒数
+    pub age_ms: u64,
+}
+
+/// 进程随心跳上报的数值指标（队列长度、请求速率、延迟等）。
+/// 缓冲区大小固定，指标名在首次出现时登记一次，之后每次采样只覆盖最旧的槽位，不再分配内存
+#[derive(Debug)]
+pub struct GaugeRing {
+    names: Vec<String>,
+    samples: [GaugeSample; GAUGE_HISTORY],
+    next: usize,
+    len: usize,
+}
+
+impl GaugeRing {
+    pub fn new() -> Self {
+        Self {
+            names: Vec::with_capacity(MAX_GAUGES),
+            samples: [EMPTY_SAMPLE; GAUGE_HISTORY],
+            next: 0,
+            len: 0,
+        }
+    }
+
+    /// 记录一次采样，返回被丢弃的指标数（名称过长、超出 MAX_GAUGES 或不是有限值）
+    pub fn record<'a, I>(&mut self, at_ms: u64, gauges: I) -> usize
+    where
+        I: IntoIterator<Item = (&'a str, f64)>,
+    {
+        let mut sample = GaugeSample {
+            at_ms,
+            values: [f64::NAN; MAX_GAUGES],
+        };
+        let mut dropped = 0;
+        for (name, value) in gauges {
+            match self.slot_for(name) {
+                Some(slot) if value.is_finite() => sample.values[slot] = value,
+                _ => dropped += 1,
+            }
+        }
+
+        self.samples[self.next] = sample;
+        self.next = (self.next + 1) % GAUGE_HISTORY;
+        self.len = (self.len + 1).min(GAUGE_HISTORY);
+        dropped
+    }
+
+    fn slot_for(&mut self, name: &str) -> Option<usize> {
+        if let Some(slot) = self.names.iter().position(|n| n == name) {
+            return Some(slot);
+        }
+        if self.names.len() >= MAX_GAUGES || name.is_empty() || name.len() > MAX_GAUGE_NAME_LEN {
+            return None;
+        }
+        self.names.push(name.to_string());
+        Some(self.names.len() - 1)
+    }
+
+    /// 按指标名汇总缓冲区内的采样，没有有效采样的指标省略
+    pub fn stats(&self, now_ms: u64) -> BTreeMap<String, GaugeStats> {
+        let mut stats = BTreeMap::new();
+        for (slot, name) in self.names.iter().enumerate() {
+            // 从最新的采样往前遍历，第一个有效值即为 last
+            let mut summary: Option<GaugeStats> = None;
+            let mut sum = 0.0;
+            for age in 0..self.len {
+                let sample = &self.samples[(self.next + GAUGE_HISTORY - 1 - age) % GAUGE_HISTORY];
+                let value = sample.values[slot];
+                if value.is_nan() {
+                    continue;
+                }
+                sum += value;
+                let entry = summary.get_or_insert(GaugeStats {
+                    last: value,
+                    min: value,
+                    max: value,
+                    mean: 0.0,
+                    samples: 0,
+                    age_ms: now_ms.saturating_sub(sample.at_ms),
+                });
+                entry.min = entry.min.min(value);
+                entry.max = entry.max.max(value);
+                entry.samples += 1;
+            }
+            if let Some(mut entry) = summary {
+                entry.mean = sum / entry.samples as f64;
+                stats.insert(name.clone(), entry);
+            }
+        }
+        stats
+    }
+}
+
+impl Default for GaugeRing {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{GaugeRing, GAUGE_HISTORY, MAX_GAUGES};
+
+    #[test]
+    fn keeps_recent_samples_and_drops_excess_gauges() {
+        let mut ring = GaugeRing::new();
+        for i in 0..(GAUGE_HISTORY as u64 + 8) {
+            let dropped = ring.record(i * 10, [("queue_depth", i as f64), ("latency_ms", 2.0)]);
+            assert_eq!(dropped, 0);
+        }
+        // 只有最近一次带 rate
+        assert_eq!(ring.record(1_000, [("rate", f64::NAN), ("rate", 5.0)]), 1);
+
+        let stats = ring.stats(1_050);
+        let depth = &stats["queue_depth"];
+        assert_eq!(depth.samples, GAUGE_HISTORY - 1);
+        assert_eq!(depth.last, (GAUGE_HISTORY as f64) + 7.0);
+        assert_eq!(depth.min, 9.0);
+        assert_eq!(depth.age_ms, 1_050 - (GAUGE_HISTORY as u64 + 7) * 10);
+        assert_eq!(stats["latency_ms"].mean, 2.0);
+        assert_eq!(stats["rate"].samples, 1);
+        assert_eq!(stats["rate"].age_ms, 50);
+
+        let names: Vec<String> = (0..MAX_GAUGES).map(|i| format!("g{}", i)).collect();
+        let dropped = ring.record(1_100, names.iter().map(|n| (n.as_str(), 1.0)));
+        // 已有 3 个指标，只能再登记 MAX_GAUGES - 3 个
+        assert_eq!(dropped, 3);
+        assert_eq!(ring.stats(1_100).len(), MAX_GAUGES);
+    }
+}
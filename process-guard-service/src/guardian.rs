@@ -1,11 +1,32 @@
-use crate::config::load_config;
-use crate::models::{ChangeType, Config, ConfigChange, MonitoredProcess, CHECK_INTERVAL_MS};
+use crate::config::{
+    config_modified_ms, ensure_config_dir, get_config_file_path, get_journal_file_path,
+    load_config, ConfigPersister,
+};
+use crate::deadline::DeadlineScheduler;
+use crate::health_log::{HealthLog, HealthSample};
+use crate::heartbeat::{age_from_timestamp, HeartbeatIndex};
+use crate::journal::{unix_ms_ago, Journal, JournalState, RuntimeState};
+use crate::metrics::metrics;
+use crate::models::{
+    ChangeType, Config, ConfigChange, InstanceRole, ItemStatus, MonitorItem, MonitoredProcess,
+    StandbyInstance, StandbyStatus, CHECK_INTERVAL_MS, MAX_GUARDIAN_SHARDS,
+    MAX_RESTART_CONCURRENCY, RESTART_BACKOFF_INITIAL_MS, RESTART_BACKOFF_MAX_MS,
+    RESTART_BACKOFF_RESET_MS,
+};
+use crate::process_index::ProcessPathIndex;
+use crate::process_watcher::{ProcessExit, ProcessWatch, ProcessWatcher};
+use crate::resource_watch::{processor_count, ResourceWatch};
+use crate::restart_executor::RestartExecutor;
 use crate::session0::{
-    check_process_alive, find_process_by_path, kill_process, start_process_in_session0,
+    check_process_alive, kill_process, start_process_in_session0, ProcessHandle,
 };
+use crate::shared_heartbeat::SharedHeartbeats;
+use crate::status_events::{StatusEventKind, StatusEvents, STATUS_EVENT_CAPACITY};
+use crate::system_snapshot::{SnapshotBuffer, SystemSnapshot};
 use log::{debug, error, info, warn};
 use std::collections::HashMap;
-use std::sync::{Arc, Mutex};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, RwLock};
 use std::time::{Duration, Instant};
 
 fn should_kill_process_for_change(change_type: ChangeType) -> bool {
@@ -16,6 +37,186 @@ fn normalize_startup_config(config: Config) -> (Config, bool) {
     (config, false)
 }
 
+/// 日志中有完整配置，且 config.json 自上次导出后没有被修改过（或已删除）时以日志为准；
+/// 修改时间不同说明服务停止期间手工编辑过 config.json
+fn journal_is_current(state: &JournalState, config_modified_ms: Option<i64>) -> bool {
+    if state.config.is_none() {
+        return false;
+    }
+    match (config_modified_ms, state.exported_ms) {
+        (Some(modified), Some(exported)) => modified == exported,
+        _ => true,
+    }
+}
+
+fn runtime_state(process: &MonitoredProcess) -> RuntimeState {
+    RuntimeState {
+        id: process.item.id.clone(),
+        process_id: process.process_id,
+        create_time: process.process_create_time,
+        restart_count: process.restart_count,
+        started_at_ms: process
+            .process_id
+            .map(|_| unix_ms_ago(process.startup_time.elapsed())),
+    }
+}
+
+/// 按状态日志恢复监控项：重启次数直接恢复；记录了 PID 时启动时间沿用记录的值，进程在启动时被重新接管后
+/// 运行时长与 started_at 不从服务启动时重新计算
+fn restore_runtime(process: &mut MonitoredProcess, state: &RuntimeState) {
+    process.restart_count = state.restart_count;
+    process.process_id = state.process_id;
+    process.process_create_time = state.create_time;
+    if state.process_id.is_none() {
+        return;
+    }
+    if let Some(started_at) = state
+        .started_at_ms
+        .and_then(|ms| Instant::now().checked_sub(age_from_timestamp(Some(ms))))
+    {
+        process.startup_time = started_at;
+    }
+}
+
+fn item_status(p: &MonitoredProcess, snapshot: Option<&SystemSnapshot>) -> ItemStatus {
+    ItemStatus {
+        id: p.item.id.clone(),
+        name: p.item.name.clone(),
+        exe_path: p.item.exe_path.clone(),
+        enabled: p.item.enabled,
+        process_id: p.process_id,
+        last_heartbeat_ms: p.heartbeat.elapsed().as_millis() as u64,
+        heartbeat_timeout_ms: p.item.heartbeat_timeout_ms,
+        restart_count: p.restart_count,
+        restart_pending: p.restart_pending,
+        last_restart_reason: p.last_restart_reason.clone(),
+        is_alive: is_process_alive(p, snapshot),
+        is_heartbeat_ok: !p.is_heartbeat_timeout(),
+        job: p.watch.as_ref().and_then(|watch| watch.accounting()),
+        gauges: p.heartbeat.gauge_stats(),
+        is_ready: p.ready_at.is_some(),
+        standby: p.standby.as_ref().map(|standby| StandbyStatus {
+            process_id: standby.process_id,
+            is_ready: standby.ready_at.is_some(),
+        }),
+    }
+}
+
+/// 优先使用保存的进程句柄判断存活；没有句柄时在系统快照中按 PID 与创建时间查找，
+/// 避免 PID 被复用后误判为存活，没有快照时才退回到按 PID 打开进程
+fn is_alive(
+    watch: Option<&ProcessWatch>,
+    process_id: Option<u32>,
+    create_time: Option<u64>,
+    snapshot: Option<&SystemSnapshot>,
+) -> bool {
+    match (watch, process_id, snapshot) {
+        (Some(watch), _, _) => watch.is_alive(),
+        (None, Some(pid), Some(snapshot)) => snapshot.is_alive(pid, create_time),
+        (None, pid, None) => pid.map_or(false, check_process_alive),
+        (None, None, Some(_)) => false,
+    }
+}
+
+fn terminate(watch: Option<&ProcessWatch>, process_id: Option<u32>) {
+    match watch {
+        Some(watch) => {
+            watch.terminate();
+        }
+        None => {
+            if let Some(pid) = process_id {
+                kill_process(pid);
+            }
+        }
+    }
+}
+
+/// 采样并与监控项的资源上限比较，超限时返回重启原因。
+/// 内存与句柄数取自本周期的系统快照，进程在作业中时 CPU 时间取整棵进程树的统计；
+/// 快照中没有该进程时退回到用保存的句柄采样
+fn resource_limit_exceeded(
+    process: &mut MonitoredProcess,
+    now: Instant,
+    snapshot: Option<&SystemSnapshot>,
+) -> Option<String> {
+    let limits = process.item.limits.as_ref()?;
+    let watch = process.watch.as_ref()?;
+    let from_snapshot = snapshot
+        .and_then(|snapshot| snapshot.find(watch.process_id(), process.process_create_time))
+        .map(|entry| {
+            let mut sample = entry.sample();
+            if let Some(accounting) = watch.accounting() {
+                sample.cpu_time_ms = accounting.cpu_time_ms;
+            }
+            sample
+        });
+    let sample = from_snapshot.or_else(|| watch.sample())?;
+    process
+        .resource_watch
+        .check(limits, &sample, now, processor_count())
+}
+
+fn is_process_alive(process: &MonitoredProcess, snapshot: Option<&SystemSnapshot>) -> bool {
+    is_alive(
+        process.watch.as_deref(),
+        process.process_id,
+        process.process_create_time,
+        snapshot,
+    )
+}
+
+fn terminate_process(process: &MonitoredProcess) {
+    terminate(process.watch.as_deref(), process.process_id)
+}
+
+/// 终止备用实例，并让正在启动的备用实例在启动完成后被丢弃
+fn discard_standby(process: &mut MonitoredProcess) {
+    process.standby_pending = None;
+    if let Some(standby) = process.standby.take() {
+        info!(
+            "Stopping standby instance of {} (PID: {})",
+            process.item.name, standby.process_id
+        );
+        terminate(standby.watch.as_deref(), Some(standby.process_id));
+    }
+}
+
+/// 计算下一次重启前的退避时间：首次或稳定运行一段时间后立即重启，
+/// 短时间内反复重启时从 RESTART_BACKOFF_INITIAL_MS 起按倍数增长，上限 RESTART_BACKOFF_MAX_MS
+fn next_restart_delay_ms(previous_delay_ms: u64, since_last_restart: Option<Duration>) -> u64 {
+    match since_last_restart {
+        Some(elapsed) if elapsed < Duration::from_millis(RESTART_BACKOFF_RESET_MS) => {
+            previous_delay_ms
+                .saturating_mul(2)
+                .clamp(RESTART_BACKOFF_INITIAL_MS, RESTART_BACKOFF_MAX_MS)
+        }
+        _ => 0,
+    }
+}
+
+/// 执行器中完成的启动结果，由守护线程写回 MonitoredProcess
+struct LaunchedProcess {
+    process_id: u32,
+    create_time: Option<u64>,
+    watch: Option<Arc<ProcessWatch>>,
+    /// 复用的已运行进程与提升的备用实例不会再发送 ready，沿用已知的就绪时间
+    ready_at: Option<Instant>,
+}
+
+/// 更新监控项时被替换的旧实例，由执行器在启动新实例之前终止
+struct ReplacedInstance {
+    watch: Option<Arc<ProcessWatch>>,
+    process_id: Option<u32>,
+    create_time: Option<u64>,
+}
+
+/// 已登记、尚未提交到执行器的配置变更启动
+struct PendingStart {
+    item: MonitorItem,
+    generation: u64,
+    replaced: Option<ReplacedInstance>,
+}
+
 fn apply_pause_state(
     processes: &mut HashMap<String, MonitoredProcess>,
     config: &mut Config,
@@ -41,21 +242,98 @@ fn apply_pause_state(
     found
 }
 
+/// 监控项按句柄分配到的分片，同一 ID 在服务运行期间句柄不变，因此始终属于同一分片
+fn shard_index(handle: u32, shard_count: usize) -> usize {
+    handle as usize % shard_count.max(1)
+}
+
+/// 一部分监控项的守护状态，由各自的守护线程检查；分片之间不共享锁
+struct Shard {
+    /// 分片下标，句柄满足 `shard_index(handle, 分片数) == index` 的监控项属于本分片
+    index: usize,
+    processes: Mutex<HashMap<String, MonitoredProcess>>,
+    deadlines: Mutex<DeadlineScheduler>,
+    /// 处于退避等待中的重启，到期后提交到 restart_executor
+    pending_restarts: Mutex<DeadlineScheduler>,
+    /// 本分片进程的退出通知，只唤醒本分片的守护线程
+    watcher: Arc<ProcessWatcher>,
+    /// 本分片每个检查周期生成系统快照时复用的缓冲区
+    snapshot_buffer: Mutex<SnapshotBuffer>,
+    /// 属于本分片的监控项的配置变更，由本分片的守护线程按提交顺序处理
+    pending_changes: Mutex<Vec<ConfigChange>>,
+}
+
+impl Shard {
+    fn new(index: usize) -> Self {
+        Self {
+            index,
+            processes: Mutex::new(HashMap::new()),
+            deadlines: Mutex::new(DeadlineScheduler::new()),
+            pending_restarts: Mutex::new(DeadlineScheduler::new()),
+            watcher: Arc::new(ProcessWatcher::new()),
+            snapshot_buffer: Mutex::new(SnapshotBuffer::new()),
+            pending_changes: Mutex::new(Vec::new()),
+        }
+    }
+}
+
 pub struct Guardian {
-    processes: Arc<Mutex<HashMap<String, MonitoredProcess>>>,
+    /// settings.guardian_shards 个分片，每个分片一个守护线程
+    shards: Vec<Shard>,
     config: Arc<Mutex<Config>>,
-    pending_changes: Arc<Mutex<Vec<ConfigChange>>>,
     running: Arc<Mutex<bool>>,
     startup_gate: Option<Arc<crate::service::StartupGate>>,
+    /// 监控项 ID / 句柄到心跳槽的索引，只在增删监控项时写入，心跳路径只取读锁
+    heartbeats: RwLock<HeartbeatIndex>,
+    restart_executor: RestartExecutor,
+    /// 服务启动时并行启动进程的线程数，与重启并发数相同
+    launch_concurrency: usize,
+    next_restart_generation: AtomicU64,
+    /// 供 subscribe 请求读取的状态变化事件
+    status_events: StatusEvents,
+    /// 查找可复用的已运行进程，启动与重启线程共用
+    process_index: Mutex<ProcessPathIndex>,
+    health_log: Mutex<HealthLog>,
+    /// 配置修改后在后台合并写入，请求路径上不做文件 I/O
+    config_persister: ConfigPersister,
+    /// 配置变更与运行状态的追加日志，服务重启时用于快速恢复
+    journal: Option<Arc<Journal>>,
+    /// settings.shared_heartbeat 开启时的心跳共享内存
+    shared_heartbeats: Option<SharedHeartbeats>,
 }
 
 #[cfg(test)]
 mod tests {
     use super::{
-        apply_pause_state, normalize_startup_config, should_kill_process_for_change,
+        apply_pause_state, journal_is_current, next_restart_delay_ms, normalize_startup_config,
+        restore_runtime, shard_index, should_kill_process_for_change, Guardian,
+    };
+    use crate::journal::{unix_ms_ago, JournalState, RuntimeState};
+    use crate::models::{
+        ChangeType, Config, ConfigChange, MonitorItem, MonitoredProcess, DEFAULT_READY_TIMEOUT_MS,
+        RESTART_BACKOFF_INITIAL_MS, RESTART_BACKOFF_MAX_MS, RESTART_BACKOFF_RESET_MS,
+        STARTUP_GRACE_PERIOD_MS,
     };
-    use crate::models::{ChangeType, Config, MonitorItem, MonitoredProcess};
     use std::collections::HashMap;
+    use std::sync::{Arc, Mutex};
+    use std::time::{Duration, Instant};
+
+    #[test]
+    fn restart_backoff_grows_while_crash_looping_and_resets_after_stable_run() {
+        assert_eq!(next_restart_delay_ms(0, None), 0);
+
+        let recent = Some(Duration::from_secs(1));
+        let first = next_restart_delay_ms(0, recent);
+        assert_eq!(first, RESTART_BACKOFF_INITIAL_MS);
+        assert_eq!(next_restart_delay_ms(first, recent), first * 2);
+        assert_eq!(
+            next_restart_delay_ms(RESTART_BACKOFF_MAX_MS, recent),
+            RESTART_BACKOFF_MAX_MS
+        );
+
+        let stable = Some(Duration::from_millis(RESTART_BACKOFF_RESET_MS));
+        assert_eq!(next_restart_delay_ms(RESTART_BACKOFF_MAX_MS, stable), 0);
+    }
 
     #[test]
     fn pause_change_does_not_require_terminating_process() {
@@ -78,6 +356,9 @@ mod tests {
             no_window: false,
             enabled: true,
             heartbeat_timeout_ms: 15_000,
+            limits: None,
+            ready_timeout_ms: 0,
+            standby: false,
         };
         let mut processes = HashMap::new();
         let mut process = MonitoredProcess::from_item(item.clone());
@@ -86,6 +367,7 @@ mod tests {
 
         let mut config = Config {
             items: vec![item.clone()],
+            ..Config::new()
         };
 
         assert!(apply_pause_state(&mut processes, &mut config, &item.id));
@@ -106,13 +388,223 @@ mod tests {
                 no_window: false,
                 enabled: false,
                 heartbeat_timeout_ms: 15_000,
+                limits: None,
+                ready_timeout_ms: 0,
+                standby: false,
             }],
+            ..Config::new()
         };
 
         let (normalized, modified) = normalize_startup_config(config);
         assert!(!modified);
         assert!(!normalized.items[0].enabled);
     }
+
+    #[test]
+    fn journal_is_used_unless_config_json_was_edited_since_export() {
+        let mut state = JournalState::default();
+        assert!(!journal_is_current(&state, None));
+
+        state.config = Some(Config::new());
+        state.exported_ms = Some(1_000);
+        assert!(journal_is_current(&state, Some(1_000)));
+        assert!(journal_is_current(&state, None));
+        assert!(!journal_is_current(&state, Some(2_000)));
+    }
+
+    #[test]
+    fn recorded_process_keeps_its_start_time() {
+        let item = MonitorItem::new(
+            "C:\\Apps\\EnergyMonitor.exe".to_string(),
+            "EnergyMonitor".to_string(),
+        );
+        let mut state = RuntimeState {
+            id: item.id.clone(),
+            process_id: Some(1234),
+            create_time: Some(99),
+            restart_count: 3,
+            started_at_ms: Some(unix_ms_ago(Duration::from_secs(600))),
+        };
+
+        let mut process = MonitoredProcess::from_item(item.clone());
+        restore_runtime(&mut process, &state);
+        assert_eq!(process.restart_count, 3);
+        assert_eq!(process.process_create_time, Some(99));
+        assert!(process.startup_time.elapsed() >= Duration::from_secs(600));
+        assert!(process.startup_time.elapsed() < Duration::from_secs(605));
+
+        // 没有记录 PID 时进程会重新启动，时间不恢复
+        state.process_id = None;
+        let mut process = MonitoredProcess::from_item(item);
+        restore_runtime(&mut process, &state);
+        assert_eq!(process.restart_count, 3);
+        assert!(process.startup_time.elapsed() < Duration::from_secs(5));
+    }
+
+    #[test]
+    fn items_spread_evenly_across_shards_by_handle() {
+        assert_eq!(shard_index(7, 1), 0);
+        assert_eq!(shard_index(7, 0), 0);
+
+        let mut counts = [0usize; 4];
+        for handle in 1..=400u32 {
+            counts[shard_index(handle, counts.len())] += 1;
+        }
+        assert_eq!(counts, [100; 4]);
+    }
+
+    #[test]
+    fn config_changes_queue_on_the_owning_shard() {
+        let mut config = Config::new();
+        config.settings.guardian_shards = 4;
+        config.items = (0..8)
+            .map(|i| MonitorItem::new(format!(r"C:\App{}.exe", i), format!("App{}", i)))
+            .collect();
+        let items = config.items.clone();
+        let guardian = Guardian::with_config(config, Arc::new(Mutex::new(true)), None);
+
+        let added = MonitorItem::new(r"C:\Added.exe".to_string(), "Added".to_string());
+        let mut changes: Vec<ConfigChange> = items
+            .iter()
+            .map(|item| ConfigChange {
+                item: item.clone(),
+                change_type: ChangeType::Pause,
+            })
+            .collect();
+        changes.push(ConfigChange {
+            item: added.clone(),
+            change_type: ChangeType::Start,
+        });
+        // 没有句柄的监控项只能由启动添加，其余变更被丢弃
+        changes.push(ConfigChange {
+            item: MonitorItem::new(r"C:\Unknown.exe".to_string(), "Unknown".to_string()),
+            change_type: ChangeType::Stop,
+        });
+        guardian.add_changes(changes);
+
+        let mut queued = 0;
+        for shard in &guardian.shards {
+            for change in shard.pending_changes.lock().unwrap().iter() {
+                let handle = guardian.item_handle(&change.item.id);
+                assert_eq!(shard_index(handle, guardian.shards.len()), shard.index);
+                queued += 1;
+            }
+        }
+        assert_eq!(queued, items.len() + 1);
+        assert!(guardian
+            .shard(&added.id)
+            .unwrap()
+            .pending_changes
+            .lock()
+            .unwrap()
+            .iter()
+            .any(|change| change.item.id == added.id));
+    }
+
+    #[test]
+    fn config_start_runs_on_executor_and_failure_disables_item() {
+        let guardian = Arc::new(Guardian::with_config(
+            Config::new(),
+            Arc::new(Mutex::new(true)),
+            None,
+        ));
+        let item = MonitorItem::new(r"C:\Missing\App.exe".to_string(), "Missing".to_string());
+        guardian.add_change(ConfigChange {
+            item: item.clone(),
+            change_type: ChangeType::Start,
+        });
+        let shard = guardian.shard(&item.id).unwrap();
+        guardian.process_pending_changes(shard);
+
+        // 守护线程只登记启动，监控项立即出现在进程表中
+        assert!(shard.processes.lock().unwrap().contains_key(&item.id));
+        let deadline = Instant::now() + Duration::from_secs(5);
+        while shard.processes.lock().unwrap()[&item.id].restart_pending {
+            assert!(Instant::now() < deadline, "start was not finished");
+            std::thread::sleep(Duration::from_millis(10));
+        }
+
+        let processes = shard.processes.lock().unwrap();
+        let process = &processes[&item.id];
+        assert!(!process.item.enabled);
+        assert_eq!(process.process_id, None);
+        assert!(guardian.config.lock().unwrap().items.is_empty());
+    }
+
+    #[test]
+    fn batch_start_stopped_later_in_the_same_batch_is_not_launched() {
+        let guardian = Arc::new(Guardian::with_config(
+            Config::new(),
+            Arc::new(Mutex::new(true)),
+            None,
+        ));
+        let kept = MonitorItem::new(r"C:\Missing\Kept.exe".to_string(), "Kept".to_string());
+        let stopped =
+            MonitorItem::new(r"C:\Missing\Stopped.exe".to_string(), "Stopped".to_string());
+        guardian.add_changes(vec![
+            ConfigChange {
+                item: kept.clone(),
+                change_type: ChangeType::Start,
+            },
+            ConfigChange {
+                item: stopped.clone(),
+                change_type: ChangeType::Start,
+            },
+            ConfigChange {
+                item: stopped.clone(),
+                change_type: ChangeType::Stop,
+            },
+        ]);
+        let shard = &guardian.shards[0];
+        guardian.process_pending_changes(shard);
+
+        {
+            let processes = shard.processes.lock().unwrap();
+            let process = &processes[&stopped.id];
+            assert!(!process.restart_pending);
+            assert!(!process.item.enabled);
+        }
+        let deadline = Instant::now() + Duration::from_secs(5);
+        while shard.processes.lock().unwrap()[&kept.id].restart_pending {
+            assert!(Instant::now() < deadline, "start was not finished");
+            std::thread::sleep(Duration::from_millis(10));
+        }
+    }
+
+    #[test]
+    fn ready_signal_ends_grace_period_and_gates_ready_timeout() {
+        let started = Instant::now() - Duration::from_secs(30);
+        let mut item = MonitorItem::new(
+            r"C:\EnergyMonitor.exe".to_string(),
+            "EnergyMonitor".to_string(),
+        );
+        let mut process = MonitoredProcess::from_item(item.clone());
+        process.startup_time = started;
+
+        // 不需要 ready：固定宽限期，收到 ready 时提前结束，永远不会因未就绪而重启
+        assert_eq!(
+            process.grace_end(),
+            started + Duration::from_millis(STARTUP_GRACE_PERIOD_MS)
+        );
+        assert!(!process.ready_overdue(Instant::now()));
+        process.ready_at = Some(started + Duration::from_secs(1));
+        assert_eq!(process.grace_end(), started + Duration::from_secs(1));
+
+        // 备用实例要求 ready，未设置超时时使用默认值
+        item.standby = true;
+        assert_eq!(
+            item.ready_timeout(),
+            Some(Duration::from_millis(DEFAULT_READY_TIMEOUT_MS))
+        );
+        item.ready_timeout_ms = 20_000;
+        let mut process = MonitoredProcess::from_item(item);
+        process.startup_time = started;
+        assert_eq!(process.grace_end(), started + Duration::from_secs(20));
+        assert!(process.ready_overdue(Instant::now()));
+        assert!(!process.ready_overdue(started + Duration::from_secs(10)));
+        process.ready_at = Some(Instant::now());
+        assert!(!process.ready_overdue(Instant::now()));
+    }
 }
 
 impl Guardian {
@@ -122,12 +614,44 @@ impl Guardian {
     ) -> Self {
         info!("Initializing guardian");
 
-        let loaded_config = load_config();
+        ensure_config_dir().ok();
+        let started = Instant::now();
+        let (journal, recovered) = match Journal::open(&get_journal_file_path()) {
+            Some((journal, state)) => (Some(Arc::new(journal)), Some(state)),
+            None => (None, None),
+        };
+
+        let config_path = get_config_file_path();
+        let (loaded_config, runtime) = match recovered {
+            Some(state) if journal_is_current(&state, config_modified_ms(&config_path)) => {
+                let config = state.config.unwrap_or_default();
+                info!(
+                    "Recovered {} monitor items and {} runtime states from state journal in {} ms",
+                    config.items.len(),
+                    state.runtime.len(),
+                    started.elapsed().as_millis()
+                );
+                (config, state.runtime)
+            }
+            recovered => {
+                let config = load_config();
+                let runtime: HashMap<String, RuntimeState> = recovered
+                    .map(|state| state.runtime)
+                    .unwrap_or_default()
+                    .into_iter()
+                    .filter(|(id, _)| config.items.iter().any(|item| &item.id == id))
+                    .collect();
+                if let Some(journal) = &journal {
+                    journal.reset(&config, runtime.clone(), config_modified_ms(&config_path));
+                }
+                (config, runtime)
+            }
+        };
         let (config, config_modified) = normalize_startup_config(loaded_config);
-        let mut processes = HashMap::new();
 
         info!("Loaded {} monitor items from config", config.items.len());
 
+        // 管道服务尚未启动，直接同步写入
         if config_modified {
             if let Err(e) = crate::config::save_config(&config) {
                 error!("Failed to persist normalized startup config: {}", e);
@@ -136,55 +660,306 @@ impl Guardian {
             }
         }
 
+        Self::build(config, runtime, journal, running, startup_gate)
+    }
+
+    /// 使用给定配置创建，不读写配置文件，也不启动任何进程；基准测试直接调用
+    pub fn with_config(
+        config: Config,
+        running: Arc<Mutex<bool>>,
+        startup_gate: Option<Arc<crate::service::StartupGate>>,
+    ) -> Self {
+        Self::build(config, HashMap::new(), None, running, startup_gate)
+    }
+
+    /// `runtime` 为从状态日志恢复的运行状态：重启次数直接恢复，记录的 PID 在启动时优先接管，
+    /// 见 `restore_runtime`
+    fn build(
+        config: Config,
+        runtime: HashMap<String, RuntimeState>,
+        journal: Option<Arc<Journal>>,
+        running: Arc<Mutex<bool>>,
+        startup_gate: Option<Arc<crate::service::StartupGate>>,
+    ) -> Self {
+        let mut heartbeats = HeartbeatIndex::new();
+
+        let restart_concurrency = config
+            .settings
+            .restart_concurrency
+            .clamp(1, MAX_RESTART_CONCURRENCY);
+
+        let shard_count = config
+            .settings
+            .guardian_shards
+            .clamp(1, MAX_GUARDIAN_SHARDS);
+        let mut shards: Vec<Shard> = (0..shard_count).map(Shard::new).collect();
+
+        let health_log = HealthLog::new(
+            config.settings.health_log,
+            config.settings.health_summary_interval_ms,
+        );
+
         for item in &config.items {
-            let monitored = MonitoredProcess::from_item(item.clone());
-            processes.insert(item.id.clone(), monitored);
+            let mut monitored = MonitoredProcess::from_item(item.clone());
+            if let Some(state) = runtime.get(&item.id) {
+                restore_runtime(&mut monitored, state);
+            }
+            let handle = heartbeats.insert(&item.id, monitored.heartbeat.clone());
+            shards[shard_index(handle, shard_count)]
+                .processes
+                .get_mut()
+                .unwrap()
+                .insert(item.id.clone(), monitored);
             info!("Registered monitor item: {} ({})", item.name, item.exe_path);
         }
 
+        let status_events = StatusEvents::new(STATUS_EVENT_CAPACITY);
+        let shared_heartbeats = if config.settings.shared_heartbeat {
+            SharedHeartbeats::create(status_events.epoch())
+        } else {
+            None
+        };
+
+        let config = Arc::new(Mutex::new(config));
+        let config_persister = ConfigPersister::new(config.clone(), journal.clone());
+
         Self {
-            processes: Arc::new(Mutex::new(processes)),
-            config: Arc::new(Mutex::new(config)),
-            pending_changes: Arc::new(Mutex::new(Vec::new())),
+            shards,
+            config,
             running,
             startup_gate,
+            heartbeats: RwLock::new(heartbeats),
+            restart_executor: RestartExecutor::new(restart_concurrency),
+            launch_concurrency: restart_concurrency,
+            next_restart_generation: AtomicU64::new(1),
+            status_events,
+            process_index: Mutex::new(ProcessPathIndex::new()),
+            health_log: Mutex::new(health_log),
+            config_persister,
+            journal,
+            shared_heartbeats,
+        }
+    }
+
+    pub fn status_events(&self) -> &StatusEvents {
+        &self.status_events
+    }
+
+    fn publish_event(&self, event: StatusEventKind, process: &MonitoredProcess) {
+        self.status_events
+            .publish(event, &process.item.id, Some(item_status(process, None)));
+        if let (Some(journal), StatusEventKind::Started | StatusEventKind::Restarted) =
+            (&self.journal, event)
+        {
+            journal.record_runtime(runtime_state(process));
+        }
+    }
+
+    /// 依次锁定各分片并修改其中的全部监控项
+    pub fn for_each_process_mut<F>(&self, mut f: F)
+    where
+        F: FnMut(&mut MonitoredProcess),
+    {
+        for shard in &self.shards {
+            shard
+                .processes
+                .lock()
+                .unwrap()
+                .values_mut()
+                .for_each(&mut f);
         }
     }
 
-    pub fn get_processes(&self) -> Arc<Mutex<HashMap<String, MonitoredProcess>>> {
-        self.processes.clone()
+    /// 监控项所在的分片，只取索引读锁；ID 从未分配过句柄时返回 None
+    fn shard(&self, item_id: &str) -> Option<&Shard> {
+        let handle = self.heartbeats.read().unwrap().handle(item_id)?;
+        Some(self.shard_for_handle(handle))
+    }
+
+    fn shard_for_handle(&self, handle: u32) -> &Shard {
+        &self.shards[shard_index(handle, self.shards.len())]
     }
 
     pub fn get_config(&self) -> Arc<Mutex<Config>> {
         self.config.clone()
     }
 
-    pub fn get_pending_changes(&self) -> Arc<Mutex<Vec<ConfigChange>>> {
-        self.pending_changes.clone()
+    /// 配置已在内存中修改，由后台线程稍后写入文件
+    pub fn persist_config(&self) {
+        self.config_persister.mark_dirty();
+    }
+
+    /// 变更所属的分片。只有启动会添加监控项，需要时在这里分配句柄；
+    /// 其余变更针对的 ID 必须已有句柄
+    fn change_shard(&self, change: &ConfigChange) -> Option<&Shard> {
+        if change.change_type.has_flag(ChangeType::Start) {
+            return Some(self.shard_for_handle(self.item_handle(&change.item.id)));
+        }
+        let shard = self.shard(&change.item.id);
+        if shard.is_none() {
+            warn!(
+                "Ignoring config change for unknown monitor item: {}",
+                change.item.id
+            );
+        }
+        shard
     }
 
+    /// 排入监控项所属分片的队列，由该分片的守护线程处理
     pub fn add_change(&self, change: ConfigChange) {
-        let item_id = change.item.id.clone();
-        let mut pending = self.pending_changes.lock().unwrap();
-        pending.push(change);
-        debug!("Queued config change for {}", item_id);
+        if let Some(shard) = self.change_shard(&change) {
+            debug!(
+                "Queued config change for {} on shard {}",
+                change.item.id, shard.index
+            );
+            shard.pending_changes.lock().unwrap().push(change);
+        }
+    }
+
+    /// 按分片分组后每个分片只加一次锁；同一监控项总在同一分片，各自的变更顺序不变
+    pub fn add_changes(&self, changes: Vec<ConfigChange>) {
+        let count = changes.len();
+        let mut grouped: Vec<Vec<ConfigChange>> = self.shards.iter().map(|_| Vec::new()).collect();
+        for change in changes {
+            if let Some(shard) = self.change_shard(&change) {
+                grouped[shard.index].push(change);
+            }
+        }
+        for (shard, changes) in self.shards.iter().zip(grouped) {
+            if !changes.is_empty() {
+                shard.pending_changes.lock().unwrap().extend(changes);
+            }
+        }
+        debug!("Queued {} config changes", count);
     }
 
     pub fn update_heartbeat(&self, item_id: &str) -> bool {
-        let mut processes = self.processes.lock().unwrap();
-        if let Some(process) = processes.get_mut(item_id) {
-            process.update_heartbeat();
-            debug!("Heartbeat updated for {} ({})", process.item.name, item_id);
+        let heartbeats = self.heartbeats.read().unwrap();
+        if let Some(slot) = heartbeats.get(item_id) {
+            slot.record();
+            debug!("Heartbeat updated for {}", item_id);
+            true
+        } else {
+            warn!("Heartbeat update failed, item not found: {}", item_id);
+            metrics().heartbeats_unknown.increment();
+            false
+        }
+    }
+
+    /// 更新单个监控项的心跳，`age` 为心跳实际发生距现在的时长
+    pub fn update_heartbeat_aged(&self, item_id: &str, age: Duration) -> bool {
+        let heartbeats = self.heartbeats.read().unwrap();
+        if let Some(slot) = heartbeats.get(item_id) {
+            slot.record_aged(age);
+            debug!("Heartbeat updated for {}", item_id);
             true
         } else {
             warn!("Heartbeat update failed, item not found: {}", item_id);
+            metrics().heartbeats_unknown.increment();
             false
         }
     }
 
-    pub fn run(&self) {
+    /// 按句柄更新心跳；句柄未分配或监控项已移除时返回 false
+    pub fn update_heartbeat_by_handle(&self, handle: u32, age: Duration) -> bool {
+        let heartbeats = self.heartbeats.read().unwrap();
+        if let Some(slot) = heartbeats.get_by_handle(handle) {
+            slot.record_aged(age);
+            debug!("Heartbeat updated for handle {}", handle);
+            true
+        } else {
+            warn!("Heartbeat update failed, unknown handle: {}", handle);
+            metrics().heartbeats_unknown.increment();
+            false
+        }
+    }
+
+    /// 记录心跳携带的指标；监控项不存在时返回 None，否则返回被丢弃的指标数
+    pub fn record_gauges(&self, item_id: &str, gauges: &HashMap<String, f64>) -> Option<usize> {
+        let heartbeats = self.heartbeats.read().unwrap();
+        let slot = heartbeats.get(item_id)?;
+        Some(slot.record_gauges(gauges.iter().map(|(name, value)| (name.as_str(), *value))))
+    }
+
+    pub fn record_gauges_by_handle(
+        &self,
+        handle: u32,
+        gauges: &HashMap<String, f64>,
+    ) -> Option<usize> {
+        let heartbeats = self.heartbeats.read().unwrap();
+        let slot = heartbeats.get_by_handle(handle)?;
+        Some(slot.record_gauges(gauges.iter().map(|(name, value)| (name.as_str(), *value))))
+    }
+
+    /// 所有上报过指标的监控项，按 ID 分组；只读取心跳槽，不获取 processes 锁
+    pub fn gauge_stats(&self) -> serde_json::Value {
+        let heartbeats = self.heartbeats.read().unwrap();
+        let items: serde_json::Map<String, serde_json::Value> = heartbeats
+            .iter()
+            .filter_map(|(id, slot)| Some((id.to_string(), serde_json::json!(slot.gauge_stats()?))))
+            .collect();
+        serde_json::Value::Object(items)
+    }
+
+    /// 监控项的数字句柄，尚未分配时分配；同一 ID 在服务运行期间始终得到同一句柄
+    pub fn item_handle(&self, item_id: &str) -> u32 {
+        if let Some(handle) = self.heartbeats.read().unwrap().handle(item_id) {
+            return handle;
+        }
+        self.heartbeats.write().unwrap().handle_for(item_id)
+    }
+
+    /// 批量更新心跳，整批只取一次索引读锁；返回未找到的监控项 ID
+    pub fn update_heartbeat_batch<'a, I>(&self, heartbeats: I) -> Vec<String>
+    where
+        I: IntoIterator<Item = (&'a str, Duration)>,
+    {
+        let index = self.heartbeats.read().unwrap();
+        let mut unknown = Vec::new();
+
+        for (item_id, age) in heartbeats {
+            match index.get(item_id) {
+                Some(slot) => slot.record_aged(age),
+                None => unknown.push(item_id.to_string()),
+            }
+        }
+
+        if !unknown.is_empty() {
+            warn!("Heartbeat batch contained unknown items: {:?}", unknown);
+            metrics().heartbeats_unknown.add(unknown.len() as u64);
+        }
+        unknown
+    }
+
+    /// 按句柄批量更新心跳；返回未找到的句柄
+    pub fn update_heartbeat_batch_by_handle<I>(&self, heartbeats: I) -> Vec<u32>
+    where
+        I: IntoIterator<Item = (u32, Duration)>,
+    {
+        let index = self.heartbeats.read().unwrap();
+        let mut unknown = Vec::new();
+
+        for (handle, age) in heartbeats {
+            match index.get_by_handle(handle) {
+                Some(slot) => slot.record_aged(age),
+                None => unknown.push(handle),
+            }
+        }
+
+        if !unknown.is_empty() {
+            warn!("Heartbeat batch contained unknown handles: {:?}", unknown);
+            metrics().heartbeats_unknown.add(unknown.len() as u64);
+        }
+        unknown
+    }
+
+    pub fn run(self: &Arc<Self>) {
         info!("Guardian started");
-        info!("Check interval: {} ms", CHECK_INTERVAL_MS);
+        info!(
+            "Check interval: {} ms, {} shard(s)",
+            CHECK_INTERVAL_MS,
+            self.shards.len()
+        );
 
         if let Some(startup_gate) = &self.startup_gate {
             info!("Waiting for pipe server readiness before starting monitored processes");
@@ -193,185 +968,919 @@ impl Guardian {
 
         self.start_all_processes();
 
+        // 分片 0 在当前线程运行，并负责健康汇总；其余分片各一个线程
+        let workers: Vec<_> = (1..self.shards.len())
+            .filter_map(|index| {
+                let guardian = self.clone();
+                std::thread::Builder::new()
+                    .name(format!("guardian-shard-{}", index))
+                    .spawn(move || {
+                        guardian.run_shard(index);
+                    })
+                    .map_err(|e| error!("Failed to start guardian shard {}: {}", index, e))
+                    .ok()
+            })
+            .collect();
+
+        let check_count = self.run_shard(0);
+        for worker in workers {
+            let _ = worker.join();
+        }
+
+        self.restart_executor.shutdown();
+        // 备用实例由服务启动，服务重启后无法区分，随服务一起退出
+        self.for_each_process_mut(discard_standby);
+        self.config_persister.shutdown();
+        if let Some(journal) = &self.journal {
+            self.for_each_process_mut(|process| journal.record_runtime(runtime_state(process)));
+        }
+        info!("Guardian stopped after {} checks", check_count);
+    }
+
+    /// 一个分片的守护循环，返回完成的检查周期数
+    fn run_shard(self: &Arc<Self>, index: usize) -> u64 {
+        let shard = &self.shards[index];
+        let is_primary = index == 0;
         let mut check_count: u64 = 0;
+        let check_interval = Duration::from_millis(CHECK_INTERVAL_MS);
+        let mut next_check = Instant::now() + check_interval;
 
         loop {
             let running = *self.running.lock().unwrap();
             if !running {
-                info!("Guardian stopping");
+                info!("Guardian shard {} stopping", index);
                 break;
             }
 
-            std::thread::sleep(Duration::from_millis(CHECK_INTERVAL_MS));
+            // 进程退出由线程池回调即时通知，心跳超时由截止时间堆精确唤醒，
+            // 周期检查只负责待处理的配置变更和没有进程句柄时的存活检查
+            let now = Instant::now();
+            let next_deadline = shard.deadlines.lock().unwrap().next_deadline();
+            let next_restart = shard.pending_restarts.lock().unwrap().next_deadline();
+            let wake_at = [next_deadline, next_restart]
+                .into_iter()
+                .flatten()
+                .fold(next_check, Instant::min);
+
+            if now < wake_at {
+                let exits = shard.watcher.wait_for_exits(wake_at - now);
+                if !exits.is_empty() {
+                    self.handle_process_exits(shard, exits);
+                }
+                continue;
+            }
+
+            self.check_heartbeat_deadlines(shard, now);
+            self.submit_due_restarts(shard, now);
+            if now < next_check {
+                continue;
+            }
+
+            next_check = now + check_interval;
             check_count += 1;
 
-            info!("--- Check cycle #{} ---", check_count);
-            self.process_pending_changes();
-            self.check_processes();
+            if is_primary && self.health_log.lock().unwrap().is_verbose() {
+                info!("--- Check cycle #{} ---", check_count);
+            }
+            self.process_pending_changes(shard);
+            self.check_shard(shard);
+            if is_primary {
+                self.health_log.lock().unwrap().maybe_summarize(now);
+            }
         }
-
-        info!("Guardian stopped after {} checks", check_count);
+        check_count
     }
 
+    /// 服务启动阶段：在同一份进程快照中为每个监控项查找已运行的进程并复用，
+    /// 其余进程在最多 `launch_concurrency` 个线程上并行启动，全部完成后才进入守护循环
     fn start_all_processes(&self) {
         info!("Starting all monitored processes");
+        let started = Instant::now();
+
+        let mut items: Vec<MonitorItem> = Vec::new();
+        let mut recorded: Vec<Option<(u32, Option<u64>)>> = Vec::new();
+        for shard in &self.shards {
+            for process in shard.processes.lock().unwrap().values() {
+                if process.item.enabled {
+                    items.push(process.item.clone());
+                    let create_time = process.process_create_time;
+                    recorded.push(process.process_id.map(|pid| (pid, create_time)));
+                }
+            }
+        }
+
+        // 状态日志中记录的进程仍在运行（PID 与创建时间都一致）时直接接管，不再按路径查找
+        let snapshot = self.capture_snapshot(&self.shards[0]);
+        let reattach: Vec<Option<u32>> = recorded
+            .into_iter()
+            .map(|recorded| match (recorded, &snapshot) {
+                (Some((pid, Some(create_time))), Some(snapshot))
+                    if snapshot.is_alive(pid, Some(create_time)) =>
+                {
+                    Some(pid)
+                }
+                _ => None,
+            })
+            .collect();
 
-        let processes = self.processes.lock().unwrap().clone();
+        let exe_paths: Vec<&str> = items
+            .iter()
+            .zip(&reattach)
+            .filter(|(_, pid)| pid.is_none())
+            .map(|(item, _)| item.exe_path.as_str())
+            .collect();
+        let mut found = {
+            let mut index = self.process_index.lock().unwrap();
+            match &snapshot {
+                Some(snapshot) => index.refresh_from(snapshot),
+                None => {
+                    index.refresh();
+                }
+            }
+            index.find_many(&exe_paths)
+        }
+        .into_iter();
+        let claimed: Vec<u32> = reattach.iter().flatten().copied().collect();
+        let existing: Vec<Option<u32>> = reattach
+            .iter()
+            .map(|pid| match pid {
+                Some(pid) => Some(*pid),
+                // 已被状态日志中的监控项接管的进程不能再分给其他监控项
+                None => found.next().flatten().filter(|pid| !claimed.contains(pid)),
+            })
+            .collect();
 
-        for (id, mut process) in processes {
-            if process.item.enabled {
-                info!(
-                    "Starting monitored process {} ({})",
-                    process.item.name, process.item.exe_path
-                );
-                if let Err(e) = self.start_process_internal(&mut process) {
-                    error!("Failed to start monitored process {}: {}", process.item.name, e);
-                } else {
-                    let mut procs = self.processes.lock().unwrap();
-                    procs.insert(id, process);
+        // 复用只需打开句柄，直接在当前线程完成
+        let mut results = Vec::with_capacity(items.len());
+        let mut to_launch = Vec::new();
+        for (item, existing_pid) in items.into_iter().zip(existing) {
+            match existing_pid {
+                Some(pid) => {
+                    let result = self.launch_process(&item, Some(pid));
+                    results.push((item, result));
+                }
+                None => to_launch.push(item),
+            }
+        }
+        let reattached = claimed.len();
+        let reused = results.len();
+        let adopted = reused - reattached;
+        let launched = to_launch.len();
+        results.extend(self.launch_parallel(to_launch));
+
+        let mut failed = 0;
+        for (n, (item, result)) in results.into_iter().enumerate() {
+            let mut processes = self
+                .shard(&item.id)
+                .map(|shard| shard.processes.lock().unwrap());
+            match (result, processes.as_mut().and_then(|p| p.get_mut(&item.id))) {
+                (Ok(launch), Some(process)) => {
+                    // 前 `reused` 个结果是接管的已运行进程，心跳不重新计时；
+                    // 按路径接管的不是状态日志记录的进程，记录中恢复的启动时间不适用
+                    if n < reused {
+                        if !claimed.contains(&launch.process_id) {
+                            process.startup_time = Instant::now();
+                        }
+                        self.attach_instance(process, launch);
+                    } else {
+                        self.apply_launch(process, launch);
+                    }
+                    self.publish_event(StatusEventKind::Started, process);
+                }
+                (Ok(_), None) => {}
+                (Err(e), _) => {
+                    failed += 1;
+                    error!("Failed to start monitored process {}: {}", item.name, e);
                 }
             }
         }
 
-        info!("Finished starting monitored processes");
+        info!(
+            "Finished starting monitored processes: {} reattached, {} adopted, {} launched, {} failed in {} ms",
+            reattached,
+            adopted,
+            launched,
+            failed,
+            started.elapsed().as_millis()
+        );
     }
 
-    fn check_processes(&self) {
-        let mut processes = self.processes.lock().unwrap();
+    /// 在最多 `launch_concurrency` 个线程上启动进程，结果顺序不固定
+    fn launch_parallel(
+        &self,
+        items: Vec<MonitorItem>,
+    ) -> Vec<(MonitorItem, Result<LaunchedProcess, String>)> {
+        let workers = self.launch_concurrency.min(items.len());
+        if workers <= 1 {
+            return items
+                .into_iter()
+                .map(|item| {
+                    let result = self.launch_process(&item, None);
+                    (item, result)
+                })
+                .collect();
+        }
 
-        for process in processes.values_mut() {
-            if !process.item.enabled {
-                debug!("Process {} is disabled, skipping check", process.item.name);
-                continue;
+        let queue = Mutex::new(items.into_iter());
+        let results = Mutex::new(Vec::new());
+        std::thread::scope(|scope| {
+            for _ in 0..workers {
+                scope.spawn(|| loop {
+                    let item = match queue.lock().unwrap().next() {
+                        Some(item) => item,
+                        None => break,
+                    };
+                    let result = self.launch_process(&item, None);
+                    results.lock().unwrap().push((item, result));
+                });
             }
+        });
+        results.into_inner().unwrap()
+    }
 
-            let startup_elapsed = process.startup_time.elapsed();
-            let in_grace_period = startup_elapsed < Duration::from_secs(5);
+    fn handle_process_exits(self: &Arc<Self>, shard: &Shard, exits: Vec<ProcessExit>) {
+        let mut processes = shard.processes.lock().unwrap();
 
-            if in_grace_period {
-                debug!(
-                    "Process {} is in startup grace period ({:.1}s), skipping checks",
-                    process.item.name,
-                    startup_elapsed.as_secs_f64()
+        for exit in exits {
+            let process = match processes.get_mut(&exit.item_id) {
+                Some(process) => process,
+                None => continue,
+            };
+
+            if process.standby.as_ref().map(|standby| standby.process_id) == Some(exit.process_id) {
+                warn!(
+                    "Standby instance of {} (PID: {}) exited",
+                    process.item.name, exit.process_id
                 );
+                process.standby = None;
                 continue;
             }
 
-            let process_alive = process
-                .process_id
-                .map_or(false, check_process_alive);
-            let heartbeat_ok = !process.is_heartbeat_timeout();
+            let watched_pid = process.watch.as_ref().map(|watch| watch.process_id());
+            if watched_pid != Some(exit.process_id) {
+                debug!(
+                    "Ignoring stale exit notification for {} (PID: {})",
+                    exit.item_id, exit.process_id
+                );
+                continue;
+            }
+
+            process.watch = None;
+            self.publish_event(StatusEventKind::Died, process);
+            self.health_log.lock().unwrap().mark(
+                &process.item.id,
+                false,
+                !process.is_heartbeat_timeout(),
+            );
+
+            if !process.item.enabled {
+                info!(
+                    "Process {} (PID: {}) exited while monitoring is disabled",
+                    process.item.name, exit.process_id
+                );
+                continue;
+            }
+
+            warn!(
+                "Process {} (PID: {}) exited",
+                process.item.name, exit.process_id
+            );
+            self.request_restart(shard, process, "process exited");
+        }
+    }
+
+    /// 标记需要重启并按退避时间排队；实际的终止与启动在 restart_executor 中执行
+    fn request_restart(
+        self: &Arc<Self>,
+        shard: &Shard,
+        process: &mut MonitoredProcess,
+        reason: &str,
+    ) {
+        if process.restart_pending {
+            debug!(
+                "Restart already pending for {}, ignoring: {}",
+                process.item.name, reason
+            );
+            return;
+        }
+
+        warn!(
+            "Process {} needs restart because {} (restart_count={})",
+            process.item.name, reason, process.restart_count
+        );
+
+        if let Some(standby) = process.standby.take() {
+            self.promote_standby(process, standby, reason);
+            return;
+        }
 
+        let delay_ms = next_restart_delay_ms(
+            process.restart_backoff_ms,
+            process.last_restart_at.map(|at| at.elapsed()),
+        );
+        process.restart_pending = true;
+        process.restart_requested_at = Some(Instant::now());
+        process.restart_backoff_ms = delay_ms;
+        process.last_restart_reason = Some(reason.to_string());
+        shard.deadlines.lock().unwrap().cancel(&process.item.id);
+
+        if delay_ms == 0 {
+            self.submit_restart(process);
+        } else {
             info!(
-                "Check [{}]: PID={:?}, alive={}, heartbeat_ok={} (last_heartbeat={:.1}s ago, timeout={}ms, startup={:.1}s ago)",
-                process.item.name,
-                process.process_id,
-                process_alive,
-                heartbeat_ok,
-                process.last_heartbeat.elapsed().as_secs_f64(),
-                process.item.heartbeat_timeout_ms,
-                startup_elapsed.as_secs_f64()
+                "Delaying restart of {} by {} ms (backoff)",
+                process.item.name, delay_ms
+            );
+            shard.pending_restarts.lock().unwrap().schedule(
+                &process.item.id,
+                Instant::now() + Duration::from_millis(delay_ms),
             );
+        }
+    }
 
-            if !process_alive || !heartbeat_ok {
-                let reason = if !process_alive {
-                    "process not alive"
-                } else {
-                    "heartbeat timeout"
-                };
-
-                if !heartbeat_ok && process_alive {
-                    let elapsed_ms = process.last_heartbeat.elapsed().as_millis();
-                    let timeout_ms = process.item.heartbeat_timeout_ms;
-                    debug!(
-                        "Heartbeat timeout detail: name={}, elapsed={}ms, timeout={}ms, delta={}ms",
-                        process.item.name,
-                        elapsed_ms,
-                        timeout_ms,
-                        elapsed_ms as i64 - timeout_ms as i64
-                    );
-                }
+    /// 用备用实例代替失败的当前实例，不经过退避等待；备用实例尚未就绪时从它的启动时间起继续等待 ready。
+    /// 旧实例在执行器中终止之后才启动新的备用实例
+    fn promote_standby(
+        self: &Arc<Self>,
+        process: &mut MonitoredProcess,
+        standby: StandbyInstance,
+        reason: &str,
+    ) {
+        let old_watch = process.watch.take();
+        let old_process_id = process.process_id;
+        let old_create_time = process.process_create_time;
+
+        self.apply_launch(
+            process,
+            LaunchedProcess {
+                process_id: standby.process_id,
+                create_time: standby.process_create_time,
+                watch: standby.watch,
+                ready_at: standby.ready_at,
+            },
+        );
+        if process.ready_at.is_none() {
+            process.startup_time = standby.launched_at;
+            self.schedule_heartbeat_deadline(process);
+        }
+        process.restart_count += 1;
+        process.last_restart_at = Some(Instant::now());
+        process.last_restart_reason = Some(reason.to_string());
+        metrics().restarts.increment();
+        metrics().standby_promotions.increment();
+        info!(
+            "Promoted standby instance of {} (PID: {}, ready={}) replacing PID {:?}",
+            process.item.name,
+            standby.process_id,
+            standby.ready_at.is_some(),
+            old_process_id
+        );
+        self.publish_event(StatusEventKind::Restarted, process);
+
+        let generation = self.next_restart_generation.fetch_add(1, Ordering::SeqCst);
+        process.standby_pending = Some(generation);
+        let item = process.item.clone();
+        let guardian = self.clone();
+        let submitted = self.restart_executor.submit(Box::new(move || {
+            guardian.stop_instance(&item, old_watch, old_process_id, old_create_time);
+            guardian.launch_standby(item, generation);
+        }));
+        if !submitted {
+            process.standby_pending = None;
+        }
+    }
 
-                warn!(
-                    "Process unhealthy or intentionally controlled: name={}, reason={}, pid={:?}",
-                    process.item.name, reason, process.process_id
+    /// 监控项开启 standby、当前实例在运行且没有备用实例时，在执行器中启动一个备用实例
+    fn ensure_standby(self: &Arc<Self>, process: &mut MonitoredProcess) {
+        if !process.item.standby
+            || process.standby.is_some()
+            || process.standby_pending.is_some()
+            || process.process_id.is_none()
+        {
+            return;
+        }
+
+        let generation = self.next_restart_generation.fetch_add(1, Ordering::SeqCst);
+        process.standby_pending = Some(generation);
+        let item = process.item.clone();
+        let guardian = self.clone();
+        let submitted = self.restart_executor.submit(Box::new(move || {
+            guardian.launch_standby(item, generation);
+        }));
+        if !submitted {
+            process.standby_pending = None;
+        }
+    }
+
+    /// 在执行器线程中运行；备用实例总是新启动，不复用已运行的进程
+    fn launch_standby(&self, item: MonitorItem, generation: u64) {
+        info!("Starting standby instance of {}", item.name);
+        let result = self.launch_process(&item, None);
+        let mut processes = self
+            .shard(&item.id)
+            .map(|shard| shard.processes.lock().unwrap());
+        let process = processes
+            .as_mut()
+            .and_then(|processes| processes.get_mut(&item.id))
+            .filter(|process| process.standby_pending == Some(generation));
+
+        match (result, process) {
+            // 重启时按路径查找复用了刚启动的进程，它已经是当前实例
+            (Ok(launched), Some(process)) if process.process_id == Some(launched.process_id) => {
+                process.standby_pending = None;
+            }
+            (Ok(launched), Some(process)) => {
+                process.standby_pending = None;
+                process.standby = Some(StandbyInstance {
+                    process_id: launched.process_id,
+                    process_create_time: launched.create_time,
+                    watch: launched.watch,
+                    launched_at: Instant::now(),
+                    ready_at: None,
+                });
+            }
+            (Ok(launched), None) => {
+                info!(
+                    "Discarding superseded standby instance of {}, stopping PID {}",
+                    item.name, launched.process_id
                 );
+                terminate(launched.watch.as_deref(), Some(launched.process_id));
+            }
+            (Err(e), process) => {
+                if let Some(process) = process {
+                    process.standby_pending = None;
+                }
+                error!("Failed to start standby instance of {}: {}", item.name, e);
+            }
+        }
+    }
+
+    /// 备用实例退出或超过就绪超时仍未就绪时丢弃，然后补充启动
+    fn check_standby(
+        self: &Arc<Self>,
+        process: &mut MonitoredProcess,
+        snapshot: Option<&SystemSnapshot>,
+    ) {
+        if let Some(standby) = &process.standby {
+            let alive = is_alive(
+                standby.watch.as_deref(),
+                Some(standby.process_id),
+                standby.process_create_time,
+                snapshot,
+            );
+            let overdue = standby.ready_at.is_none()
+                && process
+                    .item
+                    .ready_timeout()
+                    .map_or(false, |timeout| standby.launched_at.elapsed() >= timeout);
+            if alive && !overdue {
+                return;
+            }
+            if overdue {
                 warn!(
-                    "Process {} needs restart because {} (restart_count={})",
-                    process.item.name, reason, process.restart_count
+                    "Standby instance of {} (PID: {}) is not ready within ready timeout",
+                    process.item.name, standby.process_id
                 );
+                metrics().ready_timeouts.increment();
+            }
+            discard_standby(process);
+        }
+        self.ensure_standby(process);
+    }
 
-                if let Some(pid) = process.process_id {
-                    if check_process_alive(pid) {
-                        info!(
-                            "Stopping monitored process: {}, PID: {}, reason: restart required",
-                            process.item.name, pid
-                        );
-                        kill_process(pid);
-                    }
+    /// 处理进程发送的 ready；`process_id` 为备用实例的 PID 时只标记备用实例就绪。
+    /// 监控项不存在或 PID 不属于该监控项时返回 None
+    pub fn mark_ready(&self, item_id: &str, process_id: Option<u32>) -> Option<InstanceRole> {
+        let shard = self.shard(item_id)?;
+        let mut processes = shard.processes.lock().unwrap();
+        let process = processes.get_mut(item_id)?;
+
+        if let Some(standby) = process.standby.as_mut() {
+            if process_id == Some(standby.process_id) {
+                if standby.ready_at.is_none() {
+                    standby.ready_at = Some(Instant::now());
+                    info!(
+                        "Standby instance of {} (PID: {}) is ready after {} ms",
+                        process.item.name,
+                        standby.process_id,
+                        standby.launched_at.elapsed().as_millis()
+                    );
+                }
+                return Some(InstanceRole::Standby);
+            }
+        }
+
+        if process_id.is_some() && process_id != process.process_id {
+            warn!(
+                "Ignoring ready from PID {:?}, not an instance of {}",
+                process_id, process.item.name
+            );
+            return None;
+        }
+
+        if process.ready_at.is_none() {
+            process.ready_at = Some(Instant::now());
+            info!(
+                "Process {} is ready after {} ms",
+                process.item.name,
+                process.startup_time.elapsed().as_millis()
+            );
+            // 宽限期提前结束，按新的截止时间检查心跳
+            self.schedule_heartbeat_deadline(process);
+        }
+        Some(InstanceRole::Active)
+    }
+
+    fn submit_due_restarts(self: &Arc<Self>, shard: &Shard, now: Instant) {
+        let due = shard.pending_restarts.lock().unwrap().pop_due(now);
+        if due.is_empty() {
+            return;
+        }
+
+        let mut processes = shard.processes.lock().unwrap();
+
+        for item_id in due {
+            if let Some(process) = processes.get_mut(&item_id) {
+                if !process.restart_pending {
+                    continue;
+                }
+                if !process.item.enabled {
+                    process.restart_pending = false;
+                    continue;
                 }
+                self.submit_restart(process);
+            }
+        }
+    }
+
+    fn submit_restart(self: &Arc<Self>, process: &mut MonitoredProcess) {
+        let generation = self.next_restart_generation.fetch_add(1, Ordering::SeqCst);
+        process.restart_generation = generation;
+        process.last_restart_at = Some(Instant::now());
+
+        let item = process.item.clone();
+        let old_watch = process.watch.take();
+        let old_process_id = process.process_id;
+        let old_create_time = process.process_create_time;
+        let guardian = self.clone();
+
+        let submitted = self.restart_executor.submit(Box::new(move || {
+            guardian.run_restart(item, generation, old_watch, old_process_id, old_create_time);
+        }));
+
+        if !submitted {
+            debug!(
+                "Restart executor stopped, dropping restart of {}",
+                process.item.name
+            );
+            process.restart_pending = false;
+        }
+    }
+
+    /// 在执行器线程中运行，不持有 processes 锁
+    fn run_restart(
+        &self,
+        item: MonitorItem,
+        generation: u64,
+        old_watch: Option<Arc<ProcessWatch>>,
+        old_process_id: Option<u32>,
+        old_create_time: Option<u64>,
+    ) {
+        let started = Instant::now();
+        self.stop_instance(&item, old_watch, old_process_id, old_create_time);
+
+        let existing_pid = self.find_running_process(&item.exe_path);
+        let result = self.launch_process(&item, existing_pid);
+        metrics()
+            .restart_execution
+            .record_duration(started.elapsed());
+        self.finish_restart(&item, generation, result);
+    }
+
+    /// 终止仍在运行的旧实例，在执行器线程中调用
+    fn stop_instance(
+        &self,
+        item: &MonitorItem,
+        old_watch: Option<Arc<ProcessWatch>>,
+        old_process_id: Option<u32>,
+        old_create_time: Option<u64>,
+    ) {
+        let snapshot = match old_watch {
+            Some(_) => None,
+            None => self
+                .shard(&item.id)
+                .and_then(|shard| self.capture_snapshot(shard)),
+        };
+        if is_alive(
+            old_watch.as_deref(),
+            old_process_id,
+            old_create_time,
+            snapshot.as_ref(),
+        ) {
+            info!(
+                "Stopping monitored process: {}, PID: {:?}, reason: restart required",
+                item.name, old_process_id
+            );
+            terminate(old_watch.as_deref(), old_process_id);
+        }
+    }
 
-                if let Err(e) = self.start_process_internal(process) {
-                    error!("Failed to restart process {}: {}", process.item.name, e);
-                } else {
-                    process.restart_count += 1;
+    fn finish_restart(
+        &self,
+        item: &MonitorItem,
+        generation: u64,
+        result: Result<LaunchedProcess, String>,
+    ) {
+        let mut processes = self
+            .shard(&item.id)
+            .map(|shard| shard.processes.lock().unwrap());
+
+        let process = match processes.as_mut().and_then(|p| p.get_mut(&item.id)) {
+            Some(process) => process,
+            None => {
+                info!("Monitor item {} was removed during restart", item.id);
+                return;
+            }
+        };
+
+        if !process.restart_pending || process.restart_generation != generation {
+            // 重启期间监控项被停止或重新添加，丢弃本次结果
+            if let Ok(launched) = &result {
+                if process.process_id != Some(launched.process_id) {
                     info!(
-                        "Process {} restarted successfully (restart_count={})",
-                        process.item.name, process.restart_count
+                        "Discarding superseded restart of {}, stopping PID {}",
+                        item.name, launched.process_id
                     );
+                    terminate(launched.watch.as_deref(), Some(launched.process_id));
                 }
             }
+            return;
+        }
 
-            process.last_check = Instant::now();
+        process.restart_pending = false;
+        let metrics = metrics();
+        let requested_at = process.restart_requested_at.take();
+
+        match result {
+            Ok(launched) => {
+                metrics.restarts.increment();
+                if let Some(requested_at) = requested_at {
+                    metrics
+                        .restart_latency
+                        .record_duration(requested_at.elapsed());
+                }
+                // 按路径查找复用了刚启动的备用实例，它直接成为当前实例
+                if process.standby.as_ref().map(|standby| standby.process_id)
+                    == Some(launched.process_id)
+                {
+                    process.standby = None;
+                }
+                self.apply_launch(process, launched);
+                process.restart_count += 1;
+                info!(
+                    "Process {} restarted successfully (restart_count={})",
+                    process.item.name, process.restart_count
+                );
+                self.publish_event(StatusEventKind::Restarted, process);
+            }
+            Err(e) => {
+                metrics.restart_failures.increment();
+                error!("Failed to restart process {}: {}", process.item.name, e);
+            }
         }
     }
 
-    fn process_pending_changes(&self) {
-        let mut pending = self.pending_changes.lock().unwrap();
-        if pending.is_empty() {
+    fn check_heartbeat_deadlines(self: &Arc<Self>, shard: &Shard, now: Instant) {
+        let due = shard.deadlines.lock().unwrap().pop_due(now);
+        if due.is_empty() {
             return;
         }
 
-        let changes: Vec<ConfigChange> = pending.drain(..).collect();
-        drop(pending);
+        self.sync_shard_heartbeats(shard);
+
+        let mut processes = shard.processes.lock().unwrap();
+
+        for item_id in due {
+            let process = match processes.get_mut(&item_id) {
+                Some(process) => process,
+                None => continue,
+            };
+
+            if !process.item.enabled || process.restart_pending {
+                continue;
+            }
+
+            if process.ready_overdue(now) {
+                self.restart_not_ready(shard, process);
+                continue;
+            }
+
+            // 截止时间到达后按最新心跳重新计算，期间收到过心跳则顺延
+            let deadline = process.heartbeat_deadline();
+            if deadline > now {
+                shard.deadlines.lock().unwrap().schedule(&item_id, deadline);
+                continue;
+            }
+
+            let elapsed_ms = process.heartbeat.elapsed().as_millis();
+            let timeout_ms = process.item.heartbeat_timeout_ms;
+            debug!(
+                "Heartbeat timeout detail: name={}, elapsed={}ms, timeout={}ms, delta={}ms",
+                process.item.name,
+                elapsed_ms,
+                timeout_ms,
+                elapsed_ms as i64 - timeout_ms as i64
+            );
+            warn!(
+                "Process unhealthy or intentionally controlled: name={}, reason={}, pid={:?}",
+                process.item.name, "heartbeat timeout", process.process_id
+            );
+            self.request_restart(shard, process, "heartbeat timeout");
+            self.publish_event(StatusEventKind::HeartbeatLate, process);
+            self.health_log.lock().unwrap().mark(
+                &process.item.id,
+                is_process_alive(process, None),
+                false,
+            );
+        }
+    }
+
+    fn restart_not_ready(self: &Arc<Self>, shard: &Shard, process: &mut MonitoredProcess) {
+        warn!(
+            "Process unhealthy or intentionally controlled: name={}, reason={}, pid={:?}",
+            process.item.name, "ready timeout", process.process_id
+        );
+        metrics().ready_timeouts.increment();
+        self.request_restart(shard, process, "ready timeout");
+    }
+
+    /// 依次对全部分片做一次完整的存活与资源检查
+    pub fn check_processes(self: &Arc<Self>) {
+        for shard in &self.shards {
+            self.check_shard(shard);
+        }
+    }
 
-        info!("Processing {} pending changes", changes.len());
+    /// 一个分片的存活与资源检查，分片的守护循环每个周期调用一次
+    fn check_shard(self: &Arc<Self>, shard: &Shard) {
+        self.sync_shard_heartbeats(shard);
+        // 本周期所有存活判断与资源采样共用一份快照，在持有 processes 锁之前生成
+        let snapshot = self.capture_snapshot(shard);
+        let snapshot = snapshot.as_ref();
+        let verbose = self.health_log.lock().unwrap().is_verbose();
+        let mut processes = shard.processes.lock().unwrap();
 
+        for process in processes.values_mut() {
+            if !process.item.enabled {
+                debug!("Process {} is disabled, skipping check", process.item.name);
+                continue;
+            }
+
+            if process.restart_pending {
+                debug!(
+                    "Process {} has a pending restart, skipping check",
+                    process.item.name
+                );
+                continue;
+            }
+
+            let startup_elapsed = process.startup_time.elapsed();
+            let now = Instant::now();
+            if now < process.grace_end() {
+                debug!(
+                    "Process {} is in startup grace period ({:.1}s), skipping checks",
+                    process.item.name,
+                    startup_elapsed.as_secs_f64()
+                );
+                continue;
+            }
+
+            if process.ready_overdue(now) {
+                self.restart_not_ready(shard, process);
+                continue;
+            }
+
+            let process_alive = is_process_alive(process, snapshot);
+            let heartbeat_ok = !process.is_heartbeat_timeout();
+            let heartbeat_lag = process.heartbeat.elapsed();
+
+            if verbose {
+                info!(
+                    "Check [{}]: PID={:?}, alive={}, heartbeat_ok={} (last_heartbeat={:.1}s ago, timeout={}ms, startup={:.1}s ago)",
+                    process.item.name,
+                    process.process_id,
+                    process_alive,
+                    heartbeat_ok,
+                    heartbeat_lag.as_secs_f64(),
+                    process.item.heartbeat_timeout_ms,
+                    startup_elapsed.as_secs_f64()
+                );
+            }
+            // 健康日志由所有分片共用，每条记录单独加锁，不在整个周期内持有
+            self.health_log.lock().unwrap().record(&HealthSample {
+                item_id: &process.item.id,
+                name: &process.item.name,
+                process_id: process.process_id,
+                alive: process_alive,
+                heartbeat_ok,
+                heartbeat_lag_ms: heartbeat_lag.as_millis() as u64,
+            });
+
+            // 心跳超时由 check_heartbeat_deadlines 处理，这里只兜底没有收到退出通知的进程
+            if !process_alive {
+                let reason = "process not alive";
+                warn!(
+                    "Process unhealthy or intentionally controlled: name={}, reason={}, pid={:?}",
+                    process.item.name, reason, process.process_id
+                );
+                self.request_restart(shard, process, reason);
+                self.publish_event(StatusEventKind::Died, process);
+            } else if let Some(exceeded) =
+                resource_limit_exceeded(process, Instant::now(), snapshot)
+            {
+                let reason = format!("resource limit: {}", exceeded);
+                warn!(
+                    "Process unhealthy or intentionally controlled: name={}, reason={}, pid={:?}",
+                    process.item.name, reason, process.process_id
+                );
+                metrics().resource_restarts.increment();
+                self.request_restart(shard, process, &reason);
+            }
+
+            if !process.restart_pending {
+                self.check_standby(process, snapshot);
+            }
+            process.last_check = Instant::now();
+        }
+    }
+
+    /// 处理排入本分片的配置变更；全局配置只在修改 `config.items` 时短暂加锁，
+    /// 进程的终止与启动提交到 restart_executor，不在守护线程上执行
+    fn process_pending_changes(self: &Arc<Self>, shard: &Shard) {
+        let changes: Vec<ConfigChange> =
+            std::mem::take(&mut *shard.pending_changes.lock().unwrap());
+        if changes.is_empty() {
+            return;
+        }
+
+        info!(
+            "Processing {} pending changes on shard {}",
+            changes.len(),
+            shard.index
+        );
+
+        let mut starts = Vec::new();
         for change in changes {
-            self.apply_change(change);
+            starts.extend(self.apply_change(shard, change));
         }
+        self.submit_starts(shard, starts);
     }
 
-    fn apply_change(&self, change: ConfigChange) {
-        let mut processes = self.processes.lock().unwrap();
-        let mut config = self.config.lock().unwrap();
+    /// 应用一个变更；启动只在这里登记，整批变更处理完后由 submit_starts 统一提交
+    fn apply_change(self: &Arc<Self>, shard: &Shard, change: ConfigChange) -> Option<PendingStart> {
+        let mut processes = shard.processes.lock().unwrap();
 
         info!(
             "Applying config change: {} ({:?})",
             change.item.id, change.change_type
         );
 
+        // 更新（Stop | Start）的旧实例交给执行器终止，随后在同一任务中启动新实例
+        let replace = change.change_type.has_flag(ChangeType::Stop)
+            && change.change_type.has_flag(ChangeType::Start);
+        let mut replaced = None;
+
         if change.change_type.has_flag(ChangeType::Stop)
             || change.change_type.has_flag(ChangeType::Pause)
         {
             let should_kill = should_kill_process_for_change(change.change_type);
+            if let Some(process) = processes.get_mut(&change.item.id) {
+                discard_standby(process);
+            }
 
             if let Some(process) = processes.get(&change.item.id) {
                 if should_kill {
-                    if let Some(pid) = process.process_id {
-                        if check_process_alive(pid) {
-                            warn!(
-                                "Process {} will be terminated because monitoring was stopped by user, pid={}",
-                                process.item.name, pid
-                            );
-                            info!(
-                                "Stopping monitored process: {}, PID: {}, reason: user stop",
-                                process.item.name, pid
-                            );
-                            kill_process(pid);
-                        }
+                    if replace {
+                        info!(
+                            "Process {} will be replaced because its config was updated, pid={:?}",
+                            process.item.name, process.process_id
+                        );
+                    } else if is_process_alive(process, None) {
+                        warn!(
+                            "Process {} will be terminated because monitoring was stopped by user, pid={:?}",
+                            process.item.name, process.process_id
+                        );
+                        info!(
+                            "Stopping monitored process: {}, PID: {:?}, reason: user stop",
+                            process.item.name, process.process_id
+                        );
+                        terminate_process(process);
                     }
-                } else if apply_pause_state(&mut processes, &mut config, &change.item.id) {
+                } else if apply_pause_state(
+                    &mut processes,
+                    &mut self.config.lock().unwrap(),
+                    &change.item.id,
+                ) {
                     info!(
                         "Pausing monitor item while keeping process alive: {} ({})",
                         change.item.name, change.item.id
@@ -381,76 +1890,259 @@ impl Guardian {
 
             if should_kill {
                 if let Some(process) = processes.get_mut(&change.item.id) {
+                    let watch = process.watch.take();
+                    if replace {
+                        replaced = Some(ReplacedInstance {
+                            watch,
+                            process_id: process.process_id,
+                            create_time: process.process_create_time,
+                        });
+                    }
                     process.process_id = None;
                     process.item.enabled = false;
+                    process.restart_pending = false;
+                    shard.deadlines.lock().unwrap().cancel(&change.item.id);
+                    shard
+                        .pending_restarts
+                        .lock()
+                        .unwrap()
+                        .cancel(&change.item.id);
                     info!(
                         "Disabled monitor item at runtime: {} ({})",
                         process.item.name, change.item.id
                     );
                 }
 
+                let mut config = self.config.lock().unwrap();
                 if let Some(item) = config.items.iter_mut().find(|i| i.id == change.item.id) {
                     item.enabled = false;
                 }
             }
 
-            if let Err(e) = crate::config::save_config(&config) {
-                error!("Failed to persist disabled config: {}", e);
-            } else {
-                info!("Saved disabled monitor item config: {}", change.item.id);
+            self.config_persister.mark_dirty();
+
+            if let Some(process) = processes.get(&change.item.id) {
+                self.publish_event(StatusEventKind::ConfigChanged, process);
             }
         }
 
         if change.change_type.has_flag(ChangeType::Remove) {
-            if let Some(process) = processes.remove(&change.item.id) {
+            shard.deadlines.lock().unwrap().cancel(&change.item.id);
+            shard
+                .pending_restarts
+                .lock()
+                .unwrap()
+                .cancel(&change.item.id);
+            self.heartbeats.write().unwrap().remove(&change.item.id);
+            if let Some(mut process) = processes.remove(&change.item.id) {
+                discard_standby(&mut process);
                 info!(
                     "Removed monitor item from runtime: {} ({})",
                     process.item.name, change.item.id
                 );
             }
-            config.items.retain(|i| i.id != change.item.id);
-            if let Err(e) = crate::config::save_config(&config) {
-                error!("Failed to persist removal: {}", e);
-            }
+            self.config
+                .lock()
+                .unwrap()
+                .items
+                .retain(|i| i.id != change.item.id);
+            self.config_persister.mark_dirty();
             info!("Removed monitor item from config: {}", change.item.id);
+            self.health_log.lock().unwrap().forget(&change.item.id);
+            self.status_events
+                .publish(StatusEventKind::Removed, &change.item.id, None);
         }
 
         if change.change_type.has_flag(ChangeType::Start) {
-            let mut monitored = MonitoredProcess::from_item(change.item.clone());
+            // 备用实例先退出，避免按路径查找时被当作已运行的进程复用
+            if let Some(previous) = processes.get_mut(&change.item.id) {
+                discard_standby(previous);
+            }
+            return Some(self.register_start(shard, &mut processes, change.item, replaced));
+        }
+        None
+    }
 
-            if let Err(e) = self.start_process_internal(&mut monitored) {
-                error!("Failed to start process {}: {}", change.item.name, e);
-            } else {
-                processes.insert(change.item.id.clone(), monitored);
+    /// 新的监控状态立即替换旧状态并标记为等待重启，检查与心跳截止时间都跳过它；
+    /// 同一批中之后的停止、删除或再次变更照常作用于它
+    fn register_start(
+        &self,
+        shard: &Shard,
+        processes: &mut HashMap<String, MonitoredProcess>,
+        item: MonitorItem,
+        replaced: Option<ReplacedInstance>,
+    ) -> PendingStart {
+        // 旧状态的退避重启与心跳截止时间随之作废
+        shard.deadlines.lock().unwrap().cancel(&item.id);
+        shard.pending_restarts.lock().unwrap().cancel(&item.id);
+        let generation = self.next_restart_generation.fetch_add(1, Ordering::SeqCst);
+        let mut monitored = MonitoredProcess::from_item(item.clone());
+        monitored.restart_pending = true;
+        monitored.restart_generation = generation;
+        self.heartbeats
+            .write()
+            .unwrap()
+            .insert(&item.id, monitored.heartbeat.clone());
+        processes.insert(item.id.clone(), monitored);
+        PendingStart {
+            item,
+            generation,
+            replaced,
+        }
+    }
 
-                if let Some(item) = config.items.iter_mut().find(|i| i.id == change.item.id) {
-                    item.enabled = true;
-                    if let Err(e) = crate::config::save_config(&config) {
-                        error!("Failed to persist enabled config: {}", e);
-                    } else {
-                        info!("Saved enabled monitor item config: {}", change.item.id);
-                    }
-                } else {
-                    config.items.push(change.item.clone());
-                    if let Err(e) = crate::config::save_config(&config) {
-                        error!("Failed to persist added config: {}", e);
-                    }
+    /// 整批启动共用一次进程路径索引刷新来查找可复用的已运行进程，再逐个提交到 restart_executor，
+    /// 由执行器按 restart_concurrency 并行启动；终止、启动与配置更新都不在守护线程上等待
+    fn submit_starts(self: &Arc<Self>, shard: &Shard, starts: Vec<PendingStart>) {
+        if starts.is_empty() {
+            return;
+        }
+
+        // 被替换的旧实例终止之前仍在运行，这类启动在执行器中终止旧实例后再查找
+        let exe_paths: Vec<&str> = starts
+            .iter()
+            .filter(|start| start.replaced.is_none())
+            .map(|start| start.item.exe_path.as_str())
+            .collect();
+        let mut found = if exe_paths.is_empty() {
+            Vec::new()
+        } else {
+            let mut index = self.process_index.lock().unwrap();
+            index.refresh();
+            index.find_many(&exe_paths)
+        }
+        .into_iter();
+
+        let mut processes = shard.processes.lock().unwrap();
+        let count = starts.len();
+        for start in starts {
+            let existing_pid = match start.replaced {
+                Some(_) => None,
+                None => found.next().flatten(),
+            };
+            let superseded = processes.get(&start.item.id).map_or(true, |process| {
+                !process.restart_pending || process.restart_generation != start.generation
+            });
+            if superseded {
+                debug!("Skipping superseded start of {}", start.item.name);
+                continue;
+            }
+
+            let guardian = self.clone();
+            let item_id = start.item.id.clone();
+            let submitted = self.restart_executor.submit(Box::new(move || {
+                guardian.run_start(start, existing_pid);
+            }));
+            if !submitted {
+                debug!("Restart executor stopped, dropping start of {}", item_id);
+                if let Some(process) = processes.get_mut(&item_id) {
+                    process.restart_pending = false;
                 }
+            }
+        }
+        debug!("Submitted {} config starts on shard {}", count, shard.index);
+    }
 
-                info!(
-                    "Started monitoring {} ({})",
-                    change.item.name, change.item.id
+    /// 在执行器线程中运行，不持有 processes 锁；`existing_pid` 为提交时找到的已运行进程
+    fn run_start(&self, start: PendingStart, existing_pid: Option<u32>) {
+        let existing_pid = match start.replaced {
+            Some(replaced) => {
+                self.stop_instance(
+                    &start.item,
+                    replaced.watch,
+                    replaced.process_id,
+                    replaced.create_time,
                 );
+                self.find_running_process(&start.item.exe_path)
+            }
+            None => existing_pid,
+        };
+        let result = self.launch_process(&start.item, existing_pid);
+        self.finish_start(&start.item, start.generation, result);
+    }
+
+    /// 写回配置变更触发的启动结果；期间监控项被停止、移除或再次变更时丢弃结果
+    fn finish_start(
+        &self,
+        item: &MonitorItem,
+        generation: u64,
+        result: Result<LaunchedProcess, String>,
+    ) {
+        let mut processes = self
+            .shard(&item.id)
+            .map(|shard| shard.processes.lock().unwrap());
+        let current = processes
+            .as_mut()
+            .and_then(|processes| processes.get_mut(&item.id));
+        let current_pid = current.as_ref().and_then(|process| process.process_id);
+        let process = current
+            .filter(|process| process.restart_pending && process.restart_generation == generation);
+
+        match (result, process) {
+            (Ok(launched), Some(process)) => {
+                process.restart_pending = false;
+                self.apply_launch(process, launched);
+                self.publish_event(StatusEventKind::Started, process);
+                // 启动期间被暂停的监控项保持暂停
+                if process.item.enabled {
+                    self.enable_in_config(item);
+                }
+                info!("Started monitoring {} ({})", item.name, item.id);
+            }
+            (Ok(launched), None) => {
+                if current_pid != Some(launched.process_id) {
+                    info!(
+                        "Discarding superseded start of {}, stopping PID {}",
+                        item.name, launched.process_id
+                    );
+                    terminate(launched.watch.as_deref(), Some(launched.process_id));
+                }
+            }
+            (Err(e), process) => {
+                if let Some(process) = process {
+                    process.restart_pending = false;
+                    process.item.enabled = false;
+                }
+                error!("Failed to start process {}: {}", item.name, e);
             }
         }
     }
 
+    /// 启动成功后在配置中启用监控项，新添加的监控项追加到末尾；配置锁只在这里短暂持有
+    fn enable_in_config(&self, item: &MonitorItem) {
+        let mut config = self.config.lock().unwrap();
+        match config.items.iter_mut().find(|i| i.id == item.id) {
+            Some(existing) => existing.enabled = true,
+            None => config.items.push(item.clone()),
+        }
+        drop(config);
+        self.config_persister.mark_dirty();
+    }
+
     fn start_process(&self, process: &mut MonitoredProcess) -> Result<(), String> {
-        self.start_process_internal(process)
+        let existing_pid = self.find_running_process(&process.item.exe_path);
+        process.watch = None;
+        let launched = self.launch_process(&process.item, existing_pid)?;
+        self.apply_launch(process, launched);
+        self.publish_event(StatusEventKind::Started, process);
+        Ok(())
     }
 
-    fn start_process_internal(&self, process: &mut MonitoredProcess) -> Result<(), String> {
-        let exe_path = &process.item.exe_path;
+    /// 刷新进程路径索引并查找映像路径相同的已运行进程
+    fn find_running_process(&self, exe_path: &str) -> Option<u32> {
+        let mut index = self.process_index.lock().unwrap();
+        index.refresh();
+        index.find(exe_path)
+    }
+
+    /// 启动进程，或复用 `existing_pid` 指定的已运行进程，并注册退出等待；
+    /// 不修改监控状态，可在执行器线程中调用
+    fn launch_process(
+        &self,
+        item: &MonitorItem,
+        existing_pid: Option<u32>,
+    ) -> Result<LaunchedProcess, String> {
+        let exe_path = &item.exe_path;
 
         info!("Starting process: {}", exe_path);
 
@@ -459,15 +2151,24 @@ impl Guardian {
             return Err(format!("Executable not found: {}", exe_path));
         }
 
-        if let Some(existing_pid) = find_process_by_path(exe_path) {
+        if let Some(existing_pid) = existing_pid {
             info!(
                 "Found running process {} (PID: {}), reusing it",
-                process.item.name, existing_pid
+                item.name, existing_pid
             );
-            process.process_id = Some(existing_pid);
-            process.last_heartbeat = Instant::now();
-            process.startup_time = Instant::now();
-            return Ok(());
+            let watch = ProcessHandle::open(existing_pid)
+                .and_then(|handle| self.shard(&item.id)?.watcher.watch(&item.id, handle))
+                .map(Arc::new);
+            let create_time = watch
+                .as_ref()
+                .and_then(|watch| watch.create_time())
+                .or_else(|| self.process_index.lock().unwrap().create_time(existing_pid));
+            return Ok(LaunchedProcess {
+                process_id: existing_pid,
+                create_time,
+                watch,
+                ready_at: Some(Instant::now()),
+            });
         }
 
         let working_dir = std::path::Path::new(exe_path)
@@ -475,47 +2176,121 @@ impl Guardian {
             .and_then(|p| p.to_str())
             .map(|s| s.to_string());
 
-        let args = process.item.args.as_deref();
+        let args = item.args.as_deref();
 
-        let proc_info = start_process_in_session0(
+        let launch_started = Instant::now();
+        let mut proc_info = start_process_in_session0(
             exe_path,
             working_dir.as_deref(),
             args,
-            process.item.minimize,
-            process.item.no_window,
+            item.minimize,
+            item.no_window,
         )?;
+        metrics()
+            .process_launch
+            .record_duration(launch_started.elapsed());
 
-        process.process_id = Some(proc_info.process_id);
-        process.last_heartbeat = Instant::now();
-        process.startup_time = Instant::now();
+        let watch = proc_info
+            .take_process_handle()
+            .and_then(|handle| self.shard(&item.id)?.watcher.watch(&item.id, handle))
+            .map(Arc::new);
 
         info!(
             "Started monitored process {} with PID {}",
-            process.item.name, proc_info.process_id
+            item.name, proc_info.process_id
         );
 
-        Ok(())
+        Ok(LaunchedProcess {
+            process_id: proc_info.process_id,
+            create_time: watch.as_ref().and_then(|watch| watch.create_time()),
+            watch,
+            ready_at: None,
+        })
+    }
+
+    fn apply_launch(&self, process: &mut MonitoredProcess, launched: LaunchedProcess) {
+        process.heartbeat.reset();
+        process.startup_time = Instant::now();
+        self.attach_instance(process, launched);
+    }
+
+    /// 服务启动时接管已在运行的进程：心跳与启动时间沿用已有的值（注册时的初始值或状态日志中恢复的值），
+    /// 不重新开始计时
+    fn attach_instance(&self, process: &mut MonitoredProcess, launched: LaunchedProcess) {
+        process.process_id = Some(launched.process_id);
+        process.process_create_time = launched.create_time;
+        process.watch = launched.watch;
+        process.resource_watch = ResourceWatch::default();
+        process.ready_at = launched.ready_at;
+        self.schedule_heartbeat_deadline(process);
+    }
+
+    fn schedule_heartbeat_deadline(&self, process: &MonitoredProcess) {
+        if let Some(shard) = self.shard(&process.item.id) {
+            shard
+                .deadlines
+                .lock()
+                .unwrap()
+                .schedule(&process.item.id, process.heartbeat_deadline());
+        }
+    }
+
+    /// 共享内存中的心跳只在读取心跳时间前合并，客户端写入时不通知服务
+    fn sync_shared_heartbeats(&self) {
+        if let Some(shared) = &self.shared_heartbeats {
+            shared.sync(&self.heartbeats.read().unwrap());
+        }
+    }
+
+    /// 只合并本分片句柄的槽位，各分片的守护线程不重复扫描其他分片的槽位
+    fn sync_shard_heartbeats(&self, shard: &Shard) {
+        if let Some(shared) = &self.shared_heartbeats {
+            shared.sync_shard(
+                &self.heartbeats.read().unwrap(),
+                shard.index,
+                self.shards.len(),
+            );
+        }
+    }
+
+    /// 生成系统进程快照，失败时返回 None，调用方退回到逐个进程查询
+    fn capture_snapshot(&self, shard: &Shard) -> Option<SystemSnapshot> {
+        SystemSnapshot::capture(&mut shard.snapshot_buffer.lock().unwrap())
+    }
+
+    pub fn status_snapshot(&self) -> Vec<ItemStatus> {
+        self.sync_shared_heartbeats();
+        // 所有进程都持有句柄时不需要快照
+        let needs_snapshot = self.shards.iter().any(|shard| {
+            shard
+                .processes
+                .lock()
+                .unwrap()
+                .values()
+                .any(|p| p.watch.is_none() && p.process_id.is_some())
+        });
+        let snapshot = if needs_snapshot {
+            self.capture_snapshot(&self.shards[0])
+        } else {
+            None
+        };
+
+        let mut items = Vec::new();
+        for shard in &self.shards {
+            items.extend(
+                shard
+                    .processes
+                    .lock()
+                    .unwrap()
+                    .values()
+                    .map(|p| item_status(p, snapshot.as_ref())),
+            );
+        }
+        items
     }
 
     pub fn get_status(&self) -> serde_json::Value {
-        let processes = self.processes.lock().unwrap();
-        let items: Vec<serde_json::Value> = processes
-            .iter()
-            .map(|(id, p)| {
-                serde_json::json!({
-                    "id": id,
-                    "name": p.item.name,
-                    "exe_path": p.item.exe_path,
-                    "enabled": p.item.enabled,
-                    "process_id": p.process_id,
-                    "last_heartbeat_ms": p.last_heartbeat.elapsed().as_millis(),
-                    "heartbeat_timeout_ms": p.item.heartbeat_timeout_ms,
-                    "restart_count": p.restart_count,
-                    "is_alive": p.process_id.map_or(false, check_process_alive),
-                    "is_heartbeat_ok": !p.is_heartbeat_timeout(),
-                })
-            })
-            .collect();
+        let items = self.status_snapshot();
 
         serde_json::json!({
             "service_running": true,
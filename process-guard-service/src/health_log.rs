@@ -0,0 +1,243 @@
+use log::{debug, info, warn};
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::time::{Duration, Instant};
+
+/// 汇总周期内最多保留的心跳延迟样本数，超出后丢弃新样本
+const MAX_LAG_SAMPLES: usize = 65536;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize, Default)]
+#[serde(rename_all = "snake_case")]
+pub enum HealthLogMode {
+    /// 每个检查周期为每个监控项输出一行状态
+    Verbose,
+    /// 只记录状态变化，并定期输出一行汇总
+    #[default]
+    Transitions,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct ItemHealth {
+    alive: bool,
+    heartbeat_ok: bool,
+}
+
+/// 一个检查周期中对单个监控项的观察结果
+pub struct HealthSample<'a> {
+    pub item_id: &'a str,
+    pub name: &'a str,
+    pub process_id: Option<u32>,
+    pub alive: bool,
+    pub heartbeat_ok: bool,
+    pub heartbeat_lag_ms: u64,
+}
+
+#[derive(Default)]
+struct HealthCounts {
+    checks: u64,
+    dead: u64,
+    late: u64,
+    transitions: u64,
+}
+
+/// 监控项健康状态日志：按模式输出逐项明细，或只输出状态变化与周期汇总
+pub struct HealthLog {
+    mode: HealthLogMode,
+    summary_interval: Option<Duration>,
+    states: HashMap<String, ItemHealth>,
+    lag_samples: Vec<u64>,
+    counts: HealthCounts,
+    last_summary: Instant,
+}
+
+impl HealthLog {
+    /// `summary_interval_ms` 为 0 时不输出汇总
+    pub fn new(mode: HealthLogMode, summary_interval_ms: u64) -> Self {
+        Self {
+            mode,
+            summary_interval: (summary_interval_ms > 0)
+                .then(|| Duration::from_millis(summary_interval_ms)),
+            states: HashMap::new(),
+            lag_samples: Vec::new(),
+            counts: HealthCounts::default(),
+            last_summary: Instant::now(),
+        }
+    }
+
+    pub fn is_verbose(&self) -> bool {
+        self.mode == HealthLogMode::Verbose
+    }
+
+    /// 记录一次检查结果；与上次观察相比状态变化时输出一行日志
+    pub fn record(&mut self, sample: &HealthSample) {
+        let current = ItemHealth {
+            alive: sample.alive,
+            heartbeat_ok: sample.heartbeat_ok,
+        };
+        // 首次观察视为从健康状态开始，只有异常才需要记录
+        let previous = self
+            .states
+            .insert(sample.item_id.to_string(), current)
+            .unwrap_or(ItemHealth {
+                alive: true,
+                heartbeat_ok: true,
+            });
+
+        self.counts.checks += 1;
+        if !current.alive {
+            self.counts.dead += 1;
+        }
+        if !current.heartbeat_ok {
+            self.counts.late += 1;
+        }
+        if self.lag_samples.len() < MAX_LAG_SAMPLES {
+            self.lag_samples.push(sample.heartbeat_lag_ms);
+        }
+
+        if previous == current {
+            return;
+        }
+        self.counts.transitions += 1;
+
+        let describe = |health: ItemHealth| {
+            format!(
+                "alive={}, heartbeat_ok={}",
+                health.alive, health.heartbeat_ok
+            )
+        };
+        if (previous.alive && !current.alive) || (previous.heartbeat_ok && !current.heartbeat_ok) {
+            warn!(
+                "Health [{}]: {} -> {} (PID={:?}, last_heartbeat={}ms ago)",
+                sample.name,
+                describe(previous),
+                describe(current),
+                sample.process_id,
+                sample.heartbeat_lag_ms
+            );
+        } else {
+            info!(
+                "Health [{}]: {} -> {} (PID={:?})",
+                sample.name,
+                describe(previous),
+                describe(current),
+                sample.process_id
+            );
+        }
+    }
+
+    /// 记录调用方已经输出过日志的状态变化（退出通知、心跳超时），之后恢复正常时仍会输出一行日志
+    pub fn mark(&mut self, item_id: &str, alive: bool, heartbeat_ok: bool) {
+        let current = ItemHealth {
+            alive,
+            heartbeat_ok,
+        };
+        if self.states.insert(item_id.to_string(), current) != Some(current) {
+            self.counts.transitions += 1;
+        }
+    }
+
+    /// 监控项被移除后丢弃其状态，重新添加时从健康状态开始
+    pub fn forget(&mut self, item_id: &str) {
+        self.states.remove(item_id);
+    }
+
+    /// 到达汇总周期时输出一行汇总并开始新的周期
+    pub fn maybe_summarize(&mut self, now: Instant) {
+        let interval = match self.summary_interval {
+            Some(interval) => interval,
+            None => return,
+        };
+        if now.duration_since(self.last_summary) < interval {
+            return;
+        }
+
+        let summary = self.take_summary();
+        self.last_summary = now;
+        if self.is_verbose() {
+            debug!("{}", summary);
+        } else {
+            info!("{}", summary);
+        }
+    }
+
+    fn take_summary(&mut self) -> String {
+        self.lag_samples.sort_unstable();
+        let summary = format!(
+            "Health summary: items={}, checks={}, dead={}, heartbeat_late={}, transitions={}, heartbeat lag p50={}ms p99={}ms max={}ms",
+            self.states.len(),
+            self.counts.checks,
+            self.counts.dead,
+            self.counts.late,
+            self.counts.transitions,
+            percentile(&self.lag_samples, 50),
+            percentile(&self.lag_samples, 99),
+            self.lag_samples.last().copied().unwrap_or(0)
+        );
+        self.lag_samples.clear();
+        self.counts = HealthCounts::default();
+        summary
+    }
+}
+
+/// 已排序样本的最近秩百分位数，没有样本时为 0
+fn percentile(sorted: &[u64], percent: usize) -> u64 {
+    if sorted.is_empty() {
+        return 0;
+    }
+    let rank = ((sorted.len() * percent + 99) / 100).max(1);
+    sorted[rank.min(sorted.len()) - 1]
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{percentile, HealthLog, HealthLogMode, HealthSample};
+
+    fn sample(alive: bool, heartbeat_ok: bool, lag: u64) -> HealthSample<'static> {
+        HealthSample {
+            item_id: "EnergyMonitor",
+            name: "EnergyMonitor",
+            process_id: Some(42),
+            alive,
+            heartbeat_ok,
+            heartbeat_lag_ms: lag,
+        }
+    }
+
+    #[test]
+    fn percentile_uses_nearest_rank() {
+        let samples: Vec<u64> = (1..=100).collect();
+        assert_eq!(percentile(&samples, 50), 50);
+        assert_eq!(percentile(&samples, 99), 99);
+        assert_eq!(percentile(&[7], 99), 7);
+        assert_eq!(percentile(&[], 50), 0);
+    }
+
+    #[test]
+    fn counts_transitions_only_and_resets_after_summary() {
+        let mut health = HealthLog::new(HealthLogMode::Transitions, 60_000);
+        health.record(&sample(true, true, 100));
+        health.record(&sample(true, true, 200));
+        health.record(&sample(true, false, 12_000));
+        health.record(&sample(false, false, 15_000));
+        health.record(&sample(true, true, 50));
+        assert_eq!(health.counts.transitions, 3);
+        assert_eq!(health.counts.dead, 1);
+        assert_eq!(health.counts.late, 2);
+
+        let summary = health.take_summary();
+        assert!(summary.contains("items=1, checks=5"));
+        assert!(summary.contains("p50=200ms p99=15000ms max=15000ms"));
+        assert_eq!(health.counts.checks, 0);
+        assert!(health.lag_samples.is_empty());
+
+        // 首次观察到的异常状态也算一次变化
+        health.forget("EnergyMonitor");
+        health.record(&sample(false, true, 0));
+        assert_eq!(health.counts.transitions, 1);
+
+        health.mark("EnergyMonitor", false, true);
+        assert_eq!(health.counts.transitions, 1);
+        health.mark("EnergyMonitor", true, false);
+        assert_eq!(health.counts.transitions, 2);
+    }
+}
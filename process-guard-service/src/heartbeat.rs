@@ -0,0 +1,268 @@
+use crate::gauges::{GaugeRing, GaugeStats};
+use crate::metrics::metrics;
+use std::collections::{BTreeMap, HashMap};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+/// 单调时钟起点，心跳时间以相对它的毫秒数保存，便于放入原子变量
+fn clock_epoch() -> Instant {
+    static EPOCH: OnceLock<Instant> = OnceLock::new();
+    *EPOCH.get_or_init(Instant::now)
+}
+
+pub fn monotonic_ms() -> u64 {
+    clock_epoch().elapsed().as_millis() as u64
+}
+
+/// 客户端上报的 Unix 毫秒时间戳距现在的时长；缺省、晚于当前时间或无法解析时视为刚刚发生
+pub fn age_from_timestamp(timestamp_ms: Option<i64>) -> Duration {
+    let now_ms = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_millis() as i64)
+        .unwrap_or(0);
+    age_between(timestamp_ms, now_ms)
+}
+
+fn age_between(timestamp_ms: Option<i64>, now_ms: i64) -> Duration {
+    match timestamp_ms {
+        Some(ts) if ts > 0 && ts < now_ms => Duration::from_millis((now_ms - ts) as u64),
+        _ => Duration::ZERO,
+    }
+}
+
+/// 一个监控项的最近心跳时间。
+/// 管道线程只做原子写入，不需要获取守护线程持有的 processes 锁。
+#[derive(Debug)]
+pub struct HeartbeatSlot {
+    last_heartbeat_ms: AtomicU64,
+    /// 监控项的心跳超时，仅用于统计心跳延迟；0 表示未知
+    timeout_ms: u64,
+    /// 随心跳上报的指标，首次上报时分配，之后不再分配
+    gauges: Mutex<Option<Box<GaugeRing>>>,
+}
+
+impl HeartbeatSlot {
+    pub fn new() -> Self {
+        Self::with_timeout(0)
+    }
+
+    pub fn with_timeout(timeout_ms: u64) -> Self {
+        Self {
+            last_heartbeat_ms: AtomicU64::new(monotonic_ms()),
+            timeout_ms,
+            gauges: Mutex::new(None),
+        }
+    }
+
+    pub fn record(&self) {
+        self.record_at(monotonic_ms());
+    }
+
+    /// 记录发生在 `age` 之前的心跳（批量心跳携带各自的时间戳），不会让心跳时间倒退
+    pub fn record_aged(&self, age: Duration) {
+        self.record_at(monotonic_ms().saturating_sub(age.as_millis() as u64));
+    }
+
+    fn record_at(&self, at: u64) {
+        let previous = self.last_heartbeat_ms.fetch_max(at, Ordering::Relaxed);
+        // 乱序到达、早于当前记录的心跳不计入间隔
+        let interval = (at > previous).then(|| at - previous);
+        metrics().record_heartbeat(interval, self.timeout_ms);
+    }
+
+    /// 进程启动或重启时重置为当前时间
+    pub fn reset(&self) {
+        self.last_heartbeat_ms.store(monotonic_ms(), Ordering::Relaxed);
+    }
+
+    pub fn last_heartbeat(&self) -> Instant {
+        clock_epoch() + Duration::from_millis(self.last_heartbeat_ms.load(Ordering::Relaxed))
+    }
+
+    pub fn elapsed(&self) -> Duration {
+        let last = self.last_heartbeat_ms.load(Ordering::Relaxed);
+        Duration::from_millis(monotonic_ms().saturating_sub(last))
+    }
+
+    /// 记录一次心跳携带的指标，返回被丢弃的指标数
+    pub fn record_gauges<'a, I>(&self, gauges: I) -> usize
+    where
+        I: IntoIterator<Item = (&'a str, f64)>,
+    {
+        let mut ring = self.gauges.lock().unwrap();
+        let dropped = ring
+            .get_or_insert_with(Box::default)
+            .record(monotonic_ms(), gauges);
+        metrics().gauge_samples.increment();
+        metrics().gauges_dropped.add(dropped as u64);
+        dropped
+    }
+
+    /// 指标统计，从未上报过指标时返回 None
+    pub fn gauge_stats(&self) -> Option<BTreeMap<String, GaugeStats>> {
+        let ring = self.gauges.lock().unwrap();
+        let stats = ring.as_ref()?.stats(monotonic_ms());
+        (!stats.is_empty()).then_some(stats)
+    }
+}
+
+impl Default for HeartbeatSlot {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// 监控项 ID 到心跳槽的索引。
+/// 每个 ID 首次出现时分配一个数字句柄，服务运行期间保持不变且不会复用（移除后再添加同一 ID 得到原句柄），
+/// 按句柄上报的心跳直接下标访问槽位，不需要对字符串 ID 做哈希。句柄 0 保留表示未指定。
+#[derive(Debug)]
+pub struct HeartbeatIndex {
+    handles: HashMap<String, u32>,
+    slots: Vec<Option<Arc<HeartbeatSlot>>>,
+}
+
+impl HeartbeatIndex {
+    pub fn new() -> Self {
+        Self {
+            handles: HashMap::new(),
+            slots: vec![None],
+        }
+    }
+
+    pub fn handle(&self, item_id: &str) -> Option<u32> {
+        self.handles.get(item_id).copied()
+    }
+
+    /// 返回 ID 对应的句柄，尚未分配时分配新句柄
+    pub fn handle_for(&mut self, item_id: &str) -> u32 {
+        if let Some(handle) = self.handles.get(item_id) {
+            return *handle;
+        }
+
+        let handle = self.slots.len() as u32;
+        self.slots.push(None);
+        self.handles.insert(item_id.to_string(), handle);
+        handle
+    }
+
+    pub fn insert(&mut self, item_id: &str, slot: Arc<HeartbeatSlot>) -> u32 {
+        let handle = self.handle_for(item_id);
+        self.slots[handle as usize] = Some(slot);
+        handle
+    }
+
+    /// 移除心跳槽，句柄保留给同一 ID 再次添加时使用
+    pub fn remove(&mut self, item_id: &str) {
+        if let Some(handle) = self.handles.get(item_id) {
+            self.slots[*handle as usize] = None;
+        }
+    }
+
+    pub fn get(&self, item_id: &str) -> Option<&Arc<HeartbeatSlot>> {
+        self.handles
+            .get(item_id)
+            .and_then(|handle| self.get_by_handle(*handle))
+    }
+
+    pub fn get_by_handle(&self, handle: u32) -> Option<&Arc<HeartbeatSlot>> {
+        self.slots.get(handle as usize).and_then(Option::as_ref)
+    }
+
+    /// 遍历当前存在心跳槽的监控项
+    pub fn iter(&self) -> impl Iterator<Item = (&str, &Arc<HeartbeatSlot>)> {
+        self.handles
+            .iter()
+            .filter_map(|(id, handle)| Some((id.as_str(), self.get_by_handle(*handle)?)))
+    }
+}
+
+impl Default for HeartbeatIndex {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{age_between, monotonic_ms, HeartbeatIndex, HeartbeatSlot};
+    use std::sync::atomic::Ordering;
+    use std::sync::Arc;
+    use std::time::Duration;
+
+    #[test]
+    fn record_moves_heartbeat_forward_only() {
+        let slot = HeartbeatSlot::new();
+        let future = monotonic_ms() + 60_000;
+        slot.last_heartbeat_ms.store(future, Ordering::Relaxed);
+
+        slot.record();
+        assert_eq!(slot.last_heartbeat_ms.load(Ordering::Relaxed), future);
+        assert_eq!(slot.elapsed(), Duration::ZERO);
+
+        slot.reset();
+        assert!(slot.last_heartbeat_ms.load(Ordering::Relaxed) < future);
+    }
+
+    #[test]
+    fn aged_record_never_moves_heartbeat_backwards() {
+        let slot = HeartbeatSlot::new();
+        slot.last_heartbeat_ms.store(0, Ordering::Relaxed);
+        std::thread::sleep(Duration::from_millis(5));
+
+        slot.record_aged(Duration::from_millis(2));
+        let aged = slot.last_heartbeat_ms.load(Ordering::Relaxed);
+        assert!(aged > 0);
+
+        slot.record_aged(Duration::from_secs(3600));
+        assert_eq!(slot.last_heartbeat_ms.load(Ordering::Relaxed), aged);
+    }
+
+    #[test]
+    fn timestamp_age_ignores_missing_and_future_values() {
+        assert_eq!(age_between(None, 10_000), Duration::ZERO);
+        assert_eq!(age_between(Some(12_000), 10_000), Duration::ZERO);
+        assert_eq!(age_between(Some(-5), 10_000), Duration::ZERO);
+        assert_eq!(age_between(Some(9_250), 10_000), Duration::from_millis(750));
+    }
+
+    #[test]
+    fn handles_are_dense_stable_and_never_reused() {
+        let mut index = HeartbeatIndex::new();
+        let first = index.insert("EnergyMonitor", Arc::new(HeartbeatSlot::new()));
+        let second = index.insert("Collector", Arc::new(HeartbeatSlot::new()));
+        assert_eq!((first, second), (1, 2));
+        assert!(index.get_by_handle(0).is_none());
+        assert!(index.get_by_handle(second).is_some());
+
+        index.remove("EnergyMonitor");
+        assert!(index.get("EnergyMonitor").is_none());
+        assert!(index.get_by_handle(first).is_none());
+        assert_eq!(index.handle_for("Uploader"), 3);
+
+        assert_eq!(
+            index.insert("EnergyMonitor", Arc::new(HeartbeatSlot::new())),
+            first
+        );
+        assert!(index.get_by_handle(first).is_some());
+    }
+
+    #[test]
+    fn concurrent_records_are_visible_through_shared_slot() {
+        let slot = Arc::new(HeartbeatSlot::new());
+        slot.last_heartbeat_ms.store(0, Ordering::Relaxed);
+        std::thread::sleep(Duration::from_millis(2));
+
+        let handles: Vec<_> = (0..4)
+            .map(|_| {
+                let slot = slot.clone();
+                std::thread::spawn(move || slot.record())
+            })
+            .collect();
+        for handle in handles {
+            handle.join().unwrap();
+        }
+
+        assert!(slot.last_heartbeat_ms.load(Ordering::Relaxed) > 0);
+    }
+}
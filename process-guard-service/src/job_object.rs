@@ -0,0 +1,127 @@
+use log::{debug, info, warn};
+use serde::Serialize;
+use windows::core::PCWSTR;
+use windows::Win32::Foundation::{CloseHandle, HANDLE};
+use windows::Win32::System::JobObjects::{
+    AssignProcessToJobObject, CreateJobObjectW, JobObjectBasicAccountingInformation,
+    JobObjectExtendedLimitInformation, QueryInformationJobObject, TerminateJobObject,
+    JOBOBJECT_BASIC_ACCOUNTING_INFORMATION, JOBOBJECT_EXTENDED_LIMIT_INFORMATION,
+};
+
+/// 作业对象中的 CPU 时间以 100 纳秒为单位
+const TICKS_PER_MS: i64 = 10_000;
+
+/// 作业内所有进程（包括已退出的进程）的累计资源使用
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct JobAccounting {
+    pub active_processes: u32,
+    pub total_processes: u32,
+    /// 用户态与内核态 CPU 时间之和
+    pub cpu_time_ms: u64,
+    /// 作业提交内存的峰值
+    pub peak_memory_bytes: u64,
+}
+
+/// 每个监控项一个匿名作业对象，被监控进程启动的子进程自动加入同一作业，
+/// 终止时整棵进程树一起结束，不会留下占用端口或内存的子进程。
+/// 不设置 KILL_ON_JOB_CLOSE：服务停止时关闭作业句柄不影响被监控的进程。
+#[derive(Debug)]
+pub struct ProcessJob {
+    handle: HANDLE,
+}
+
+// 作业句柄可以在任意线程上查询或终止
+unsafe impl Send for ProcessJob {}
+unsafe impl Sync for ProcessJob {}
+
+impl ProcessJob {
+    /// 创建作业并加入进程，失败时返回 None，调用方只终止顶层进程
+    pub fn assign(process_id: u32, process: HANDLE) -> Option<Self> {
+        let handle = match unsafe { CreateJobObjectW(None, PCWSTR::null()) } {
+            Ok(handle) => handle,
+            Err(e) => {
+                warn!("创建作业对象失败 (PID: {}): {:?}", process_id, e);
+                return None;
+            }
+        };
+        let job = Self { handle };
+
+        // 进程已属于不允许嵌套的作业（例如由其他工具启动）时会失败
+        if let Err(e) = unsafe { AssignProcessToJobObject(job.handle, process) } {
+            debug!("无法将进程 {} 加入作业对象: {:?}", process_id, e);
+            return None;
+        }
+        Some(job)
+    }
+
+    /// 终止作业内的全部进程
+    pub fn terminate(&self, process_id: u32) -> bool {
+        info!("正在终止进程树, PID: {}", process_id);
+        match unsafe { TerminateJobObject(self.handle, 0) } {
+            Ok(()) => {
+                info!("进程树 {} 终止成功", process_id);
+                true
+            }
+            Err(e) => {
+                warn!("终止作业对象失败 (PID: {}): {:?}", process_id, e);
+                false
+            }
+        }
+    }
+
+    pub fn accounting(&self) -> Option<JobAccounting> {
+        let mut basic = JOBOBJECT_BASIC_ACCOUNTING_INFORMATION::default();
+        let mut extended = JOBOBJECT_EXTENDED_LIMIT_INFORMATION::default();
+        unsafe {
+            QueryInformationJobObject(
+                self.handle,
+                JobObjectBasicAccountingInformation,
+                &mut basic as *mut _ as *mut std::ffi::c_void,
+                std::mem::size_of::<JOBOBJECT_BASIC_ACCOUNTING_INFORMATION>() as u32,
+                None,
+            )
+            .ok()?;
+            QueryInformationJobObject(
+                self.handle,
+                JobObjectExtendedLimitInformation,
+                &mut extended as *mut _ as *mut std::ffi::c_void,
+                std::mem::size_of::<JOBOBJECT_EXTENDED_LIMIT_INFORMATION>() as u32,
+                None,
+            )
+            .ok()?;
+        }
+
+        Some(JobAccounting {
+            active_processes: basic.ActiveProcesses,
+            total_processes: basic.TotalProcesses,
+            cpu_time_ms: cpu_ticks_to_ms(basic.TotalUserTime, basic.TotalKernelTime),
+            peak_memory_bytes: extended.PeakJobMemoryUsed as u64,
+        })
+    }
+}
+
+impl Drop for ProcessJob {
+    fn drop(&mut self) {
+        unsafe {
+            if !self.handle.is_invalid() {
+                let _ = CloseHandle(self.handle);
+            }
+        }
+    }
+}
+
+fn cpu_ticks_to_ms(user: i64, kernel: i64) -> u64 {
+    (user.max(0) + kernel.max(0)) as u64 / TICKS_PER_MS as u64
+}
+
+#[cfg(test)]
+mod tests {
+    use super::cpu_ticks_to_ms;
+
+    #[test]
+    fn cpu_time_sums_user_and_kernel_in_milliseconds() {
+        assert_eq!(cpu_ticks_to_ms(25_000, 5_000), 3);
+        assert_eq!(cpu_ticks_to_ms(9_999, 0), 0);
+        assert_eq!(cpu_ticks_to_ms(-1, 20_000), 2);
+    }
+}
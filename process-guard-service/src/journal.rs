@@ -0,0 +1,737 @@
+use crate::config::write_bytes_atomic;
+use crate::metrics::metrics;
+use crate::models::{Config, MonitorItem, ServiceSettings};
+use log::{debug, error, info, warn};
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::fs::{File, OpenOptions};
+use std::io;
+use std::os::windows::io::AsRawHandle;
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+use windows::core::PCWSTR;
+use windows::Win32::Foundation::{CloseHandle, HANDLE};
+use windows::Win32::System::Memory::{
+    CreateFileMappingW, FlushViewOfFile, MapViewOfFile, UnmapViewOfFile, FILE_MAP_ALL_ACCESS,
+    MEMORY_MAPPED_VIEW_ADDRESS, PAGE_READWRITE,
+};
+
+/// 文件头中的标识 "PGJL"
+const JOURNAL_MAGIC: u32 = 0x4C4A_4750;
+const JOURNAL_VERSION: u32 = 1;
+const HEADER_SIZE: usize = 16;
+/// 每条记录前的长度与 CRC32，各 4 字节
+const RECORD_HEADER_SIZE: usize = 8;
+/// 文件按此粒度预分配，写满后压缩
+const JOURNAL_MIN_CAPACITY: usize = 1024 * 1024;
+const JOURNAL_CAPACITY_ALIGN: usize = 64 * 1024;
+/// 启动时回放的记录数超过该值则立即压缩
+const JOURNAL_COMPACT_RECORDS: usize = 4096;
+
+/// 一个监控项的运行状态，服务重启后用于恢复重启次数并直接接管仍在运行的进程
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+pub struct RuntimeState {
+    pub id: String,
+    pub process_id: Option<u32>,
+    /// 进程创建时间（FILETIME），与 PID 一起确认进程没有被替换
+    pub create_time: Option<u64>,
+    pub restart_count: u32,
+    /// 进程启动时间（Unix 毫秒）。最近心跳不记录：服务停止期间客户端无法上报，
+    /// 恢复后停机时长会被算作心跳超时
+    pub started_at_ms: Option<i64>,
+}
+
+/// 日志中的一条记录。压缩后的日志以一条 Snapshot 开始，之后只追加增量
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(tag = "type", rename_all = "snake_case")]
+enum JournalRecord {
+    Snapshot {
+        config: Config,
+        runtime: Vec<RuntimeState>,
+        #[serde(default, skip_serializing_if = "Option::is_none")]
+        exported_ms: Option<i64>,
+    },
+    Settings {
+        settings: ServiceSettings,
+    },
+    Upsert {
+        item: MonitorItem,
+    },
+    Remove {
+        id: String,
+    },
+    Runtime {
+        state: RuntimeState,
+    },
+    /// config.json 写出后的修改时间，启动时据此判断 config.json 是否被手工修改过
+    Exported {
+        modified_ms: i64,
+    },
+}
+
+/// 回放日志得到的状态；`config` 为 None 表示日志为空或没有完整的快照
+#[derive(Debug, Clone, Default)]
+pub struct JournalState {
+    pub config: Option<Config>,
+    pub runtime: HashMap<String, RuntimeState>,
+    pub exported_ms: Option<i64>,
+    records: usize,
+}
+
+impl JournalState {
+    fn apply(&mut self, record: JournalRecord) {
+        self.records += 1;
+        match record {
+            JournalRecord::Snapshot {
+                config,
+                runtime,
+                exported_ms,
+            } => {
+                self.config = Some(config);
+                self.runtime = runtime
+                    .into_iter()
+                    .map(|state| (state.id.clone(), state))
+                    .collect();
+                self.exported_ms = exported_ms;
+            }
+            JournalRecord::Settings { settings } => {
+                if let Some(config) = &mut self.config {
+                    config.settings = settings;
+                }
+            }
+            JournalRecord::Upsert { item } => {
+                if let Some(config) = &mut self.config {
+                    match config.items.iter_mut().find(|i| i.id == item.id) {
+                        Some(existing) => *existing = item,
+                        None => config.items.push(item),
+                    }
+                }
+            }
+            JournalRecord::Remove { id } => {
+                if let Some(config) = &mut self.config {
+                    config.items.retain(|i| i.id != id);
+                }
+                self.runtime.remove(&id);
+            }
+            JournalRecord::Runtime { state } => {
+                self.runtime.insert(state.id.clone(), state);
+            }
+            JournalRecord::Exported { modified_ms } => self.exported_ms = Some(modified_ms),
+        }
+    }
+
+    fn snapshot(&self) -> JournalRecord {
+        let mut runtime: Vec<RuntimeState> = self.runtime.values().cloned().collect();
+        runtime.sort_by(|a, b| a.id.cmp(&b.id));
+        JournalRecord::Snapshot {
+            config: self.config.clone().unwrap_or_default(),
+            runtime,
+            exported_ms: self.exported_ms,
+        }
+    }
+}
+
+/// 当前配置相对上次记录的变化；只比较序列化结果，监控项顺序变化不产生记录
+fn config_changes(previous: &Config, config: &Config) -> Vec<JournalRecord> {
+    let to_json = |item: &MonitorItem| serde_json::to_string(item).unwrap_or_default();
+    let previous_items: HashMap<&str, String> = previous
+        .items
+        .iter()
+        .map(|item| (item.id.as_str(), to_json(item)))
+        .collect();
+
+    let mut changes = Vec::new();
+    if serde_json::to_value(&previous.settings).ok() != serde_json::to_value(&config.settings).ok()
+    {
+        changes.push(JournalRecord::Settings {
+            settings: config.settings.clone(),
+        });
+    }
+    for item in &config.items {
+        if previous_items.get(item.id.as_str()) != Some(&to_json(item)) {
+            changes.push(JournalRecord::Upsert { item: item.clone() });
+        }
+    }
+    for item in &previous.items {
+        if !config.items.iter().any(|i| i.id == item.id) {
+            changes.push(JournalRecord::Remove {
+                id: item.id.clone(),
+            });
+        }
+    }
+    changes
+}
+
+/// CRC-32（IEEE 802.3，与 zlib 相同）
+fn crc32(bytes: &[u8]) -> u32 {
+    const TABLE: [u32; 256] = {
+        let mut table = [0u32; 256];
+        let mut i = 0;
+        while i < 256 {
+            let mut crc = i as u32;
+            let mut bit = 0;
+            while bit < 8 {
+                crc = if crc & 1 != 0 {
+                    0xEDB8_8320 ^ (crc >> 1)
+                } else {
+                    crc >> 1
+                };
+                bit += 1;
+            }
+            table[i] = crc;
+            i += 1;
+        }
+        table
+    };
+
+    let mut crc = !0u32;
+    for &byte in bytes {
+        crc = TABLE[((crc ^ byte as u32) & 0xFF) as usize] ^ (crc >> 8);
+    }
+    !crc
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes([
+        bytes[offset],
+        bytes[offset + 1],
+        bytes[offset + 2],
+        bytes[offset + 3],
+    ])
+}
+
+fn write_header(bytes: &mut [u8]) {
+    bytes[..HEADER_SIZE].fill(0);
+    bytes[0..4].copy_from_slice(&JOURNAL_MAGIC.to_le_bytes());
+    bytes[4..8].copy_from_slice(&JOURNAL_VERSION.to_le_bytes());
+}
+
+fn has_header(bytes: &[u8]) -> bool {
+    bytes.len() >= HEADER_SIZE
+        && read_u32(bytes, 0) == JOURNAL_MAGIC
+        && read_u32(bytes, 4) == JOURNAL_VERSION
+}
+
+/// 在 `offset` 处写入一条记录并返回新的结尾，空间不足时返回 None。
+/// 长度字段最后写入：进程在写入中途退出时，这条记录的长度仍为 0，回放到此为止
+fn encode_record(bytes: &mut [u8], offset: usize, payload: &[u8]) -> Option<usize> {
+    let end = offset
+        .checked_add(RECORD_HEADER_SIZE)?
+        .checked_add(payload.len())?;
+    // 结尾至少留出一个为 0 的长度字段作为结束标记
+    if payload.is_empty() || payload.len() > u32::MAX as usize || end + 4 > bytes.len() {
+        return None;
+    }
+    bytes[offset + RECORD_HEADER_SIZE..end].copy_from_slice(payload);
+    bytes[offset + 4..offset + 8].copy_from_slice(&crc32(payload).to_le_bytes());
+    bytes[end..end + 4].fill(0);
+    bytes[offset..offset + 4].copy_from_slice(&(payload.len() as u32).to_le_bytes());
+    Some(end)
+}
+
+/// 从文件头之后依次读取记录，遇到长度为 0、越界或 CRC 不符的记录停止；
+/// 返回有效记录的内容与有效部分的结尾
+fn scan_records(bytes: &[u8]) -> (Vec<&[u8]>, usize) {
+    let mut payloads = Vec::new();
+    let mut offset = HEADER_SIZE;
+
+    while offset + RECORD_HEADER_SIZE <= bytes.len() {
+        let len = read_u32(bytes, offset) as usize;
+        let start = offset + RECORD_HEADER_SIZE;
+        if len == 0 || len > bytes.len() - start {
+            break;
+        }
+        let payload = &bytes[start..start + len];
+        if crc32(payload) != read_u32(bytes, offset + 4) {
+            warn!("状态日志在偏移 {} 处校验失败，丢弃之后的记录", offset);
+            break;
+        }
+        payloads.push(payload);
+        offset = start + len;
+    }
+    (payloads, offset)
+}
+
+fn journal_capacity(needed: usize) -> usize {
+    let capacity = needed.saturating_mul(4).max(JOURNAL_MIN_CAPACITY);
+    (capacity + JOURNAL_CAPACITY_ALIGN - 1) / JOURNAL_CAPACITY_ALIGN * JOURNAL_CAPACITY_ALIGN
+}
+
+pub fn unix_ms_now() -> i64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_millis() as i64)
+        .unwrap_or(0)
+}
+
+/// `elapsed` 之前的 Unix 毫秒时间
+pub fn unix_ms_ago(elapsed: Duration) -> i64 {
+    unix_ms_now() - elapsed.as_millis() as i64
+}
+
+/// 整个日志文件映射为一个可写视图，文件长度即容量
+struct MappedFile {
+    _file: File,
+    mapping: HANDLE,
+    view: MEMORY_MAPPED_VIEW_ADDRESS,
+    len: usize,
+}
+
+// 视图只在持有 Journal 的互斥锁时访问
+unsafe impl Send for MappedFile {}
+
+impl MappedFile {
+    /// 映射整个文件，文件小于 `min_len` 时先扩展到该长度
+    fn open(path: &Path, min_len: usize) -> io::Result<Self> {
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(path)?;
+        let len = file.metadata()?.len() as usize;
+        let min_len = min_len.max(JOURNAL_MIN_CAPACITY);
+        if len < min_len {
+            file.set_len(min_len as u64)?;
+        }
+        let len = len.max(min_len);
+
+        unsafe {
+            let mapping = CreateFileMappingW(
+                HANDLE(file.as_raw_handle() as _),
+                None,
+                PAGE_READWRITE,
+                (len as u64 >> 32) as u32,
+                len as u32,
+                PCWSTR::null(),
+            )
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+
+            let view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, len);
+            if view.Value.is_null() {
+                let _ = CloseHandle(mapping);
+                return Err(io::Error::last_os_error());
+            }
+
+            Ok(Self {
+                _file: file,
+                mapping,
+                view,
+                len,
+            })
+        }
+    }
+
+    fn bytes(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.view.Value as *const u8, self.len) }
+    }
+
+    fn bytes_mut(&mut self) -> &mut [u8] {
+        unsafe { std::slice::from_raw_parts_mut(self.view.Value as *mut u8, self.len) }
+    }
+
+    /// 把 [start, end) 范围内修改过的页提交给系统写回磁盘
+    fn flush(&self, start: usize, end: usize) {
+        if end <= start {
+            return;
+        }
+        unsafe {
+            let base = (self.view.Value as *const u8).add(start);
+            if let Err(e) = FlushViewOfFile(base as *const std::ffi::c_void, end - start) {
+                warn!("FlushViewOfFile 失败: {}", e);
+            }
+        }
+    }
+}
+
+impl Drop for MappedFile {
+    fn drop(&mut self) {
+        unsafe {
+            let _ = UnmapViewOfFile(self.view);
+            let _ = CloseHandle(self.mapping);
+        }
+    }
+}
+
+struct JournalInner {
+    path: PathBuf,
+    /// 重新映射失败后为 None，之后的记录全部丢弃
+    file: Option<MappedFile>,
+    end: usize,
+    /// 已写入日志的最新状态，增量与压缩快照都由它生成
+    state: JournalState,
+}
+
+/// 配置目录中的只追加状态日志（内存映射），记录配置变更与各监控项的运行状态。
+/// 服务启动时回放日志即可恢复配置、重启次数与仍在运行的进程，不需要解析 config.json；
+/// 写满时把当前状态写成一条快照替换整个文件。
+pub struct Journal {
+    inner: Mutex<JournalInner>,
+}
+
+impl Journal {
+    /// 打开（不存在时创建）日志并回放，失败时返回 None，服务退回到只使用配置文件
+    pub fn open(path: &Path) -> Option<(Self, JournalState)> {
+        let started = Instant::now();
+        let mut file = match MappedFile::open(path, JOURNAL_MIN_CAPACITY) {
+            Ok(file) => file,
+            Err(e) => {
+                error!("Failed to open state journal {:?}: {}", path, e);
+                return None;
+            }
+        };
+
+        let mut state = JournalState::default();
+        let end = if has_header(file.bytes()) {
+            let (payloads, end) = scan_records(file.bytes());
+            for payload in payloads {
+                match serde_json::from_slice::<JournalRecord>(payload) {
+                    Ok(record) => state.apply(record),
+                    Err(e) => warn!("Skipping unreadable journal record: {}", e),
+                }
+            }
+            end
+        } else {
+            info!("Initializing state journal: {:?}", path);
+            write_header(file.bytes_mut());
+            file.bytes_mut()[HEADER_SIZE..HEADER_SIZE + 4].fill(0);
+            file.flush(0, HEADER_SIZE + 4);
+            HEADER_SIZE
+        };
+
+        info!(
+            "Replayed {} journal records ({} bytes) in {} ms",
+            state.records,
+            end,
+            started.elapsed().as_millis()
+        );
+
+        let journal = Self {
+            inner: Mutex::new(JournalInner {
+                path: path.to_path_buf(),
+                file: Some(file),
+                end,
+                state: state.clone(),
+            }),
+        };
+        if state.config.is_some() && state.records > JOURNAL_COMPACT_RECORDS {
+            journal.inner.lock().unwrap().compact();
+        }
+        Some((journal, state))
+    }
+
+    /// 用给定的配置与运行状态重写整个日志，例如 config.json 被手工修改后；
+    /// `exported_ms` 为该配置对应的 config.json 修改时间
+    pub fn reset(
+        &self,
+        config: &Config,
+        runtime: HashMap<String, RuntimeState>,
+        exported_ms: Option<i64>,
+    ) {
+        let mut inner = self.inner.lock().unwrap();
+        inner.state = JournalState {
+            config: Some(config.clone()),
+            runtime,
+            exported_ms,
+            records: 0,
+        };
+        inner.compact();
+    }
+
+    /// 记录与上次相比发生变化的监控项与服务设置
+    pub fn record_config(&self, config: &Config) {
+        let mut inner = self.inner.lock().unwrap();
+        let changes = match &inner.state.config {
+            Some(previous) => config_changes(previous, config),
+            None => vec![JournalRecord::Snapshot {
+                config: config.clone(),
+                runtime: Vec::new(),
+                exported_ms: None,
+            }],
+        };
+        inner.append(changes);
+    }
+
+    pub fn record_exported(&self, modified_ms: i64) {
+        let mut inner = self.inner.lock().unwrap();
+        if inner.state.exported_ms != Some(modified_ms) {
+            inner.append(vec![JournalRecord::Exported { modified_ms }]);
+        }
+    }
+
+    /// 记录一个监控项的运行状态，与上次记录相同时不写入
+    pub fn record_runtime(&self, state: RuntimeState) {
+        let mut inner = self.inner.lock().unwrap();
+        if inner.state.runtime.get(&state.id) != Some(&state) {
+            inner.append(vec![JournalRecord::Runtime { state }]);
+        }
+    }
+}
+
+impl JournalInner {
+    /// 整批记录先应用到状态，再依次追加；写不下时压缩一次，快照已包含整批记录
+    fn append(&mut self, records: Vec<JournalRecord>) {
+        if records.is_empty() || self.file.is_none() {
+            return;
+        }
+
+        let mut payloads = Vec::with_capacity(records.len());
+        for record in records {
+            match serde_json::to_vec(&record) {
+                Ok(payload) => {
+                    self.state.apply(record);
+                    payloads.push(payload);
+                }
+                Err(e) => error!("Failed to serialize journal record: {}", e),
+            }
+        }
+
+        let start = self.end;
+        for payload in &payloads {
+            let file = match self.file.as_mut() {
+                Some(file) => file,
+                None => return,
+            };
+            match encode_record(file.bytes_mut(), self.end, payload) {
+                Some(end) => {
+                    self.end = end;
+                    metrics().journal_appends.increment();
+                }
+                None => {
+                    self.compact();
+                    return;
+                }
+            }
+        }
+
+        if let Some(file) = &self.file {
+            file.flush(start, self.end + 4);
+        }
+    }
+
+    /// 把当前状态写成只含一条快照的新文件，原子替换旧文件后重新映射；
+    /// 替换失败时扩展旧文件并把快照追加在末尾，当前状态同样落盘
+    fn compact(&mut self) {
+        let started = Instant::now();
+        let payload = match serde_json::to_vec(&self.state.snapshot()) {
+            Ok(payload) => payload,
+            Err(e) => {
+                error!("Failed to serialize journal snapshot: {}", e);
+                return;
+            }
+        };
+
+        let needed = HEADER_SIZE + RECORD_HEADER_SIZE + payload.len() + 4;
+        let mut bytes = vec![0u8; journal_capacity(needed)];
+        write_header(&mut bytes);
+        let end = match encode_record(&mut bytes, HEADER_SIZE, &payload) {
+            Some(end) => end,
+            None => return,
+        };
+
+        // 映射中的文件不能被替换，先释放视图
+        self.file = None;
+        let replaced = match write_bytes_atomic(&self.path, &bytes) {
+            Ok(()) => true,
+            Err(e) => {
+                error!("Failed to compact state journal {:?}: {}", self.path, e);
+                false
+            }
+        };
+        let file = match MappedFile::open(&self.path, JOURNAL_MIN_CAPACITY) {
+            Ok(file) => file,
+            Err(e) => {
+                error!(
+                    "Failed to remap state journal {:?}, journaling disabled: {}",
+                    self.path, e
+                );
+                return;
+            }
+        };
+
+        let (payloads, scanned_end) = scan_records(file.bytes());
+        if replaced && payloads.len() == 1 && scanned_end == end {
+            self.file = Some(file);
+            self.end = end;
+            self.state.records = 1;
+            metrics().journal_compactions.increment();
+            debug!(
+                "Compacted state journal to {} bytes in {} ms",
+                end,
+                started.elapsed().as_millis()
+            );
+            return;
+        }
+
+        // 仍是旧文件：保留其中的有效记录，扩展后把快照追加在末尾
+        let grown = file.bytes().len() + journal_capacity(RECORD_HEADER_SIZE + payload.len() + 4);
+        drop(file);
+        let mut file = match MappedFile::open(&self.path, grown) {
+            Ok(file) => file,
+            Err(e) => {
+                error!(
+                    "Failed to remap state journal {:?}, journaling disabled: {}",
+                    self.path, e
+                );
+                return;
+            }
+        };
+        match encode_record(file.bytes_mut(), scanned_end, &payload) {
+            Some(end) => {
+                file.flush(scanned_end, end + 4);
+                self.end = end;
+                self.state.records += 1;
+                metrics().journal_appends.increment();
+            }
+            None => {
+                error!("State journal {:?} has no room for a snapshot", self.path);
+                self.end = scanned_end;
+            }
+        }
+        self.file = Some(file);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{
+        config_changes, crc32, encode_record, scan_records, write_header, Journal, JournalRecord,
+        JournalState, RuntimeState, HEADER_SIZE, JOURNAL_MIN_CAPACITY,
+    };
+    use crate::models::{Config, MonitorItem};
+    use std::fs;
+    use std::time::{SystemTime, UNIX_EPOCH};
+
+    fn item(id: &str, exe_path: &str) -> MonitorItem {
+        MonitorItem {
+            id: id.to_string(),
+            exe_path: exe_path.to_string(),
+            args: None,
+            name: id.to_string(),
+            minimize: false,
+            no_window: false,
+            enabled: true,
+            heartbeat_timeout_ms: 10_000,
+            limits: None,
+            ready_timeout_ms: 0,
+            standby: false,
+        }
+    }
+
+    #[test]
+    fn crc32_matches_reference_value() {
+        assert_eq!(crc32(b"123456789"), 0xCBF4_3926);
+        assert_eq!(crc32(b""), 0);
+    }
+
+    #[test]
+    fn scan_stops_at_torn_or_corrupt_record() {
+        let mut bytes = vec![0u8; 256];
+        write_header(&mut bytes);
+        let first = encode_record(&mut bytes, HEADER_SIZE, b"first").unwrap();
+        let second = encode_record(&mut bytes, first, b"second").unwrap();
+        assert_eq!(encode_record(&mut bytes, second, &[1u8; 256]), None);
+
+        let (payloads, end) = scan_records(&bytes);
+        assert_eq!(payloads, vec![&b"first"[..], &b"second"[..]]);
+        assert_eq!(end, second);
+
+        // 第二条记录内容损坏时只保留第一条
+        bytes[first + 9] ^= 0xFF;
+        let (payloads, end) = scan_records(&bytes);
+        assert_eq!(payloads, vec![&b"first"[..]]);
+        assert_eq!(end, first);
+    }
+
+    #[test]
+    fn replaying_config_changes_rebuilds_config_and_runtime() {
+        let mut before = Config::new();
+        before.items = vec![item("a", r"C:\A.exe"), item("b", r"C:\B.exe")];
+        let mut after = before.clone();
+        after.items[0].enabled = false;
+        after.items.remove(1);
+        after.items.push(item("c", r"C:\C.exe"));
+        after.settings.restart_concurrency = 8;
+
+        let changes = config_changes(&before, &after);
+        assert_eq!(changes.len(), 4);
+        assert!(config_changes(&after, &after).is_empty());
+
+        let mut state = JournalState::default();
+        state.apply(JournalRecord::Snapshot {
+            config: before,
+            runtime: Vec::new(),
+            exported_ms: Some(1),
+        });
+        let runtime = RuntimeState {
+            id: "b".to_string(),
+            process_id: Some(42),
+            create_time: Some(7),
+            restart_count: 3,
+            started_at_ms: Some(1_000),
+        };
+        state.apply(JournalRecord::Runtime { state: runtime });
+        for change in changes {
+            // 记录以 JSON 保存，回放前经过一次往返
+            let payload = serde_json::to_vec(&change).unwrap();
+            state.apply(serde_json::from_slice(&payload).unwrap());
+        }
+
+        let config = state.config.as_ref().unwrap();
+        let ids: Vec<&str> = config.items.iter().map(|i| i.id.as_str()).collect();
+        assert_eq!(ids, vec!["a", "c"]);
+        assert!(!config.items[0].enabled);
+        assert_eq!(config.settings.restart_concurrency, 8);
+        assert!(state.runtime.is_empty());
+        assert_eq!(state.exported_ms, Some(1));
+    }
+
+    #[test]
+    fn batch_crossing_capacity_survives_reopen() {
+        let root = std::env::temp_dir().join(format!(
+            "pg-journal-tests-{}-{}",
+            std::process::id(),
+            SystemTime::now()
+                .duration_since(UNIX_EPOCH)
+                .unwrap()
+                .as_nanos()
+        ));
+        fs::create_dir_all(&root).unwrap();
+        let path = root.join("state.journal");
+
+        let mut config = Config::new();
+        config.items = vec![item("first", r"C:\First.exe")];
+        {
+            let (journal, _) = Journal::open(&path).unwrap();
+            journal.record_config(&config);
+
+            // 一批增量超过剩余容量，中途触发压缩
+            let long_path = format!(r"C:\{}.exe", "x".repeat(1024));
+            let count = JOURNAL_MIN_CAPACITY / 1024 + 16;
+            for i in 0..count {
+                config.items.push(item(&format!("item-{}", i), &long_path));
+            }
+            journal.record_config(&config);
+            journal.record_runtime(RuntimeState {
+                id: "first".to_string(),
+                process_id: Some(42),
+                create_time: Some(7),
+                restart_count: 2,
+                started_at_ms: Some(1_000),
+            });
+        }
+
+        let (journal, state) = Journal::open(&path).unwrap();
+        let replayed = state.config.as_ref().unwrap();
+        let ids: Vec<&str> = replayed.items.iter().map(|i| i.id.as_str()).collect();
+        let expected: Vec<&str> = config.items.iter().map(|i| i.id.as_str()).collect();
+        assert_eq!(ids, expected);
+        assert_eq!(state.runtime["first"].restart_count, 2);
+        // 压缩后只剩一条快照和之后追加的运行状态
+        assert_eq!(state.records, 2);
+
+        drop(journal);
+        let _ = fs::remove_dir_all(&root);
+    }
+}
@@ -0,0 +1,25 @@
+//! 进程守护服务的各个模块；可执行文件使用 service，基准测试使用 guardian 与 models，其余模块不公开
+
+mod config;
+mod deadline;
+mod framing;
+mod gauges;
+pub mod guardian;
+mod health_log;
+mod heartbeat;
+mod job_object;
+mod journal;
+mod logger;
+mod metrics;
+pub mod models;
+mod pipe_server;
+mod process_index;
+mod process_watcher;
+mod resource_watch;
+mod restart_executor;
+pub mod service;
+mod session0;
+mod shared_heartbeat;
+mod status_events;
+mod system_snapshot;
+mod wire;
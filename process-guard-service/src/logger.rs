@@ -0,0 +1,471 @@
+use log::{info, Level, LevelFilter, Log, Metadata, Record};
+use std::env;
+use std::fs::{self, File, OpenOptions};
+use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::mpsc::{self, Receiver, RecvTimeoutError, SyncSender, TrySendError};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+use time::macros::offset;
+use time::{Date, OffsetDateTime};
+
+const MAX_LOG_SIZE: u64 = 300 * 1024 * 1024; // 300MB
+const LOG_DIR_NAME: &str = "logs";
+/// 写入线程来不及处理时最多积压的日志条数，超出后丢弃并计数，调用方从不阻塞
+const LOG_QUEUE_CAPACITY: usize = 8192;
+/// 单次批量写入的最大条数
+const LOG_BATCH_SIZE: usize = 512;
+/// 没有 warn 及以上级别的日志时，日志在缓冲区中最多停留的时间
+const LOG_FLUSH_INTERVAL_MS: u64 = 500;
+/// 清理旧日志需要遍历日志目录，只按周期执行
+const LOG_CLEANUP_INTERVAL_MS: u64 = 60_000;
+/// 缓冲区超过该大小时不等定时器直接写入文件
+const LOG_BUFFER_FLUSH_SIZE: usize = 64 * 1024;
+/// Log::flush 等待写入线程确认的最长时间
+const LOG_FLUSH_WAIT_MS: u64 = 2000;
+
+/// 获取日志目录路径
+pub fn get_log_dir() -> PathBuf {
+    let exe_path = env::current_exe().unwrap_or_else(|_| PathBuf::from("."));
+    let exe_dir = exe_path.parent().unwrap_or(std::path::Path::new("."));
+    exe_dir.join(LOG_DIR_NAME)
+}
+
+/// 根据日期获取日志文件路径
+fn get_log_file_path(log_dir: &Path, date: &OffsetDateTime) -> PathBuf {
+    let date_str = date
+        .format(time::macros::format_description!("[year]-[month]-[day]"))
+        .unwrap_or_else(|_| "unknown".to_string());
+    log_dir.join(format!("process-guard-service-{}.log", date_str))
+}
+
+/// 计算日志目录总大小
+fn get_total_log_size(log_dir: &Path) -> u64 {
+    if !log_dir.exists() {
+        return 0;
+    }
+
+    let mut total_size = 0u64;
+    if let Ok(entries) = fs::read_dir(log_dir) {
+        for entry in entries.flatten() {
+            if let Ok(metadata) = entry.metadata() {
+                if metadata.is_file() {
+                    total_size += metadata.len();
+                }
+            }
+        }
+    }
+    total_size
+}
+
+/// 清理旧的日志文件，直到总大小低于限制
+fn cleanup_old_logs(log_dir: &Path, max_size: u64) {
+    let mut total_size = get_total_log_size(log_dir);
+
+    if total_size <= max_size {
+        return;
+    }
+
+    // 收集所有日志文件及其修改时间
+    let mut log_files: Vec<(PathBuf, std::time::SystemTime)> = Vec::new();
+    if let Ok(entries) = fs::read_dir(log_dir) {
+        for entry in entries.flatten() {
+            let path = entry.path();
+            if let Ok(metadata) = entry.metadata() {
+                if metadata.is_file() {
+                    if let Ok(modified) = metadata.modified() {
+                        log_files.push((path, modified));
+                    }
+                }
+            }
+        }
+    }
+
+    // 按修改时间排序（最老的在前）
+    log_files.sort_by(|a, b| a.1.cmp(&b.1));
+
+    // 删除最老的文件直到低于限制
+    for (path, _) in log_files {
+        if total_size <= max_size {
+            break;
+        }
+
+        if let Ok(metadata) = fs::metadata(&path) {
+            let file_size = metadata.len();
+            if fs::remove_file(&path).is_ok() {
+                total_size -= file_size;
+                eprintln!("已删除旧日志文件: {:?}", path);
+            }
+        }
+    }
+}
+
+fn now_local() -> OffsetDateTime {
+    OffsetDateTime::now_utc().to_offset(offset!(+8))
+}
+
+/// 调用方线程只记录时间与格式化后的消息，时间格式化与文件写入在写入线程完成
+struct LogRecord {
+    time: OffsetDateTime,
+    level: Level,
+    message: String,
+}
+
+enum LogCommand {
+    Record(LogRecord),
+    /// 写完此前的日志并刷新文件后回复
+    Flush(mpsc::Sender<()>),
+}
+
+fn format_record(record: &LogRecord, out: &mut String) {
+    use std::fmt::Write as _;
+
+    let time_str = record
+        .time
+        .format(time::macros::format_description!(
+            "[year]-[month]-[day] [hour]:[minute]:[second]"
+        ))
+        .unwrap_or_else(|_| "unknown".to_string());
+    let _ = writeln!(out, "[{}] [{}] {}", time_str, record.level, record.message);
+}
+
+/// 写入线程持有的日志文件，支持按日期分割和容量控制
+struct LogWriter {
+    log_dir: PathBuf,
+    current_date: Date,
+    file: Option<File>,
+    console: bool,
+    buffer: String,
+    last_cleanup: Option<Instant>,
+}
+
+impl LogWriter {
+    fn new(log_dir: PathBuf, console: bool) -> Self {
+        // 创建日志目录
+        if let Err(e) = fs::create_dir_all(&log_dir) {
+            eprintln!("创建日志目录失败: {:?}", e);
+        }
+
+        let now = now_local();
+        let mut writer = Self {
+            log_dir,
+            current_date: now.date(),
+            file: None,
+            console,
+            buffer: String::new(),
+            last_cleanup: None,
+        };
+        writer.open_file(&now);
+        writer.cleanup_if_due();
+        writer
+    }
+
+    fn open_file(&mut self, now: &OffsetDateTime) -> bool {
+        let log_path = get_log_file_path(&self.log_dir, now);
+        match OpenOptions::new().create(true).append(true).open(&log_path) {
+            Ok(file) => {
+                self.file = Some(file);
+                self.current_date = now.date();
+                eprintln!("日志文件已打开: {:?}", log_path);
+                true
+            }
+            Err(_) => {
+                eprintln!("无法打开日志文件: {:?}", log_path);
+                false
+            }
+        }
+    }
+
+    /// 检查是否需要轮转（跨天），每批日志只检查一次
+    fn check_and_rotate(&mut self) {
+        let now = now_local();
+        if now.date() != self.current_date && self.open_file(&now) {
+            eprintln!(
+                "日志已轮转至新文件: {:?}",
+                get_log_file_path(&self.log_dir, &now)
+            );
+            self.last_cleanup = None;
+        }
+        self.cleanup_if_due();
+    }
+
+    fn cleanup_if_due(&mut self) {
+        let due = self.last_cleanup.map_or(true, |at| {
+            at.elapsed() >= Duration::from_millis(LOG_CLEANUP_INTERVAL_MS)
+        });
+        if due {
+            cleanup_old_logs(&self.log_dir, MAX_LOG_SIZE);
+            self.last_cleanup = Some(Instant::now());
+        }
+    }
+
+    /// 把一批日志追加到缓冲区；包含 warn 及以上级别或缓冲区较大时立即写入文件
+    fn append_batch(&mut self, records: &[LogRecord], dropped: u64) {
+        self.check_and_rotate();
+
+        if dropped > 0 {
+            format_record(
+                &LogRecord {
+                    time: now_local(),
+                    level: Level::Warn,
+                    message: format!("日志队列已满，丢弃了 {} 条日志", dropped),
+                },
+                &mut self.buffer,
+            );
+        }
+        for record in records {
+            format_record(record, &mut self.buffer);
+        }
+
+        let urgent = dropped > 0 || records.iter().any(|r| r.level <= Level::Warn);
+        if urgent || self.buffer.len() >= LOG_BUFFER_FLUSH_SIZE {
+            self.flush();
+        }
+    }
+
+    fn has_pending(&self) -> bool {
+        !self.buffer.is_empty()
+    }
+
+    /// 缓冲区一次写入文件
+    fn flush(&mut self) {
+        if self.buffer.is_empty() {
+            return;
+        }
+
+        if let Some(ref mut file) = self.file {
+            let _ = file.write_all(self.buffer.as_bytes());
+            let _ = file.flush();
+        }
+
+        // 同时输出到控制台（用于调试）
+        if self.console {
+            let _ = std::io::stderr().lock().write_all(self.buffer.as_bytes());
+        }
+
+        self.buffer.clear();
+    }
+}
+
+fn run_writer(mut writer: LogWriter, receiver: Receiver<LogCommand>, dropped: &AtomicU64) {
+    let flush_interval = Duration::from_millis(LOG_FLUSH_INTERVAL_MS);
+    let mut batch: Vec<LogRecord> = Vec::with_capacity(LOG_BATCH_SIZE);
+    let mut acks: Vec<mpsc::Sender<()>> = Vec::new();
+    let mut last_flush = Instant::now();
+
+    loop {
+        // 缓冲区为空时没有截止时间，只需偶尔醒来检查丢弃计数
+        let timeout = if writer.has_pending() {
+            flush_interval.saturating_sub(last_flush.elapsed())
+        } else {
+            flush_interval
+        };
+
+        let disconnected = match receiver.recv_timeout(timeout) {
+            Ok(command) => {
+                let mut next = Some(command);
+                while let Some(command) = next.take() {
+                    match command {
+                        LogCommand::Record(record) => batch.push(record),
+                        LogCommand::Flush(ack) => acks.push(ack),
+                    }
+                    if batch.len() < LOG_BATCH_SIZE {
+                        next = receiver.try_recv().ok();
+                    }
+                }
+                false
+            }
+            Err(RecvTimeoutError::Timeout) => false,
+            Err(RecvTimeoutError::Disconnected) => true,
+        };
+
+        let lost = dropped.swap(0, Ordering::Relaxed);
+        if !batch.is_empty() || lost > 0 {
+            writer.append_batch(&batch, lost);
+            batch.clear();
+        }
+
+        if !writer.has_pending() {
+            last_flush = Instant::now();
+        } else if disconnected || !acks.is_empty() || last_flush.elapsed() >= flush_interval {
+            writer.flush();
+            last_flush = Instant::now();
+        }
+        for ack in acks.drain(..) {
+            let _ = ack.send(());
+        }
+
+        if disconnected {
+            return;
+        }
+    }
+}
+
+/// 异步日志：`log` 只把记录放入有界队列，由单独的写入线程批量写文件
+struct AsyncLogger {
+    level: LevelFilter,
+    sender: SyncSender<LogCommand>,
+    dropped: Arc<AtomicU64>,
+}
+
+impl AsyncLogger {
+    fn start(level: LevelFilter, log_dir: PathBuf, console: bool) -> std::io::Result<Self> {
+        let (sender, receiver) = mpsc::sync_channel(LOG_QUEUE_CAPACITY);
+        let dropped = Arc::new(AtomicU64::new(0));
+        let dropped_for_writer = dropped.clone();
+
+        std::thread::Builder::new()
+            .name("log-writer".to_string())
+            .spawn(move || {
+                run_writer(
+                    LogWriter::new(log_dir, console),
+                    receiver,
+                    &dropped_for_writer,
+                )
+            })?;
+
+        Ok(Self {
+            level,
+            sender,
+            dropped,
+        })
+    }
+}
+
+impl Log for AsyncLogger {
+    fn enabled(&self, metadata: &Metadata) -> bool {
+        metadata.level() <= self.level
+    }
+
+    fn log(&self, record: &Record) {
+        if !self.enabled(record.metadata()) {
+            return;
+        }
+
+        let record = LogRecord {
+            time: now_local(),
+            level: record.level(),
+            message: record.args().to_string(),
+        };
+        match self.sender.try_send(LogCommand::Record(record)) {
+            Ok(()) => {}
+            Err(TrySendError::Full(_)) => {
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+            }
+            Err(TrySendError::Disconnected(_)) => {}
+        }
+    }
+
+    /// 等待写入线程写完此前的日志；服务退出前调用
+    fn flush(&self) {
+        let (ack, done) = mpsc::channel();
+        if self.sender.send(LogCommand::Flush(ack)).is_ok() {
+            let _ = done.recv_timeout(Duration::from_millis(LOG_FLUSH_WAIT_MS));
+        }
+    }
+}
+
+pub fn init_logger() {
+    let log_dir = get_log_dir();
+    let logger = match AsyncLogger::start(LevelFilter::Debug, log_dir.clone(), true) {
+        Ok(logger) => logger,
+        Err(e) => {
+            eprintln!("日志写入线程启动失败: {:?}", e);
+            return;
+        }
+    };
+
+    if log::set_boxed_logger(Box::new(logger)).is_ok() {
+        log::set_max_level(LevelFilter::Debug);
+        info!("日志初始化完成, 日志目录: {:?}", log_dir);
+    } else {
+        eprintln!("日志初始化失败");
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{AsyncLogger, LogRecord, LogWriter};
+    use log::{Level, LevelFilter, Log, Record};
+    use std::fs;
+    use time::macros::datetime;
+
+    fn temp_log_dir(name: &str) -> std::path::PathBuf {
+        let dir =
+            std::env::temp_dir().join(format!("process-guard-log-{}-{}", name, std::process::id()));
+        let _ = fs::remove_dir_all(&dir);
+        dir
+    }
+
+    fn read_logs(dir: &std::path::Path) -> String {
+        let mut contents = String::new();
+        for entry in fs::read_dir(dir).unwrap().flatten() {
+            contents.push_str(&fs::read_to_string(entry.path()).unwrap());
+        }
+        contents
+    }
+
+    #[test]
+    fn buffers_until_warn_and_reports_dropped_records() {
+        let dir = temp_log_dir("batch");
+        let mut writer = LogWriter::new(dir.clone(), false);
+
+        let records = vec![
+            LogRecord {
+                time: datetime!(2024-05-01 08:00:00 +8),
+                level: Level::Info,
+                message: "first".to_string(),
+            },
+            LogRecord {
+                time: datetime!(2024-05-01 08:00:01 +8),
+                level: Level::Debug,
+                message: "second".to_string(),
+            },
+        ];
+        writer.append_batch(&records, 0);
+        assert!(writer.has_pending());
+        assert!(read_logs(&dir).is_empty());
+
+        // 丢弃提示为 warn 级别，连同之前缓冲的日志一起立即写入
+        writer.append_batch(&[], 3);
+        assert!(!writer.has_pending());
+
+        let contents = read_logs(&dir);
+        let lines: Vec<&str> = contents.lines().collect();
+        assert_eq!(lines[0], "[2024-05-01 08:00:00] [INFO] first");
+        assert_eq!(lines[1], "[2024-05-01 08:00:01] [DEBUG] second");
+        assert!(lines[2].ends_with("[WARN] 日志队列已满，丢弃了 3 条日志"));
+
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn flush_waits_for_queued_records() {
+        let dir = temp_log_dir("flush");
+        let logger = AsyncLogger::start(LevelFilter::Info, dir.clone(), false).unwrap();
+
+        for i in 0..100 {
+            logger.log(
+                &Record::builder()
+                    .level(Level::Info)
+                    .args(format_args!("record {}", i))
+                    .build(),
+            );
+        }
+        logger.log(
+            &Record::builder()
+                .level(Level::Debug)
+                .args(format_args!("filtered"))
+                .build(),
+        );
+        logger.flush();
+
+        let contents = read_logs(&dir);
+        assert_eq!(contents.lines().count(), 100);
+        assert!(contents.ends_with("record 99\n"));
+        assert!(!contents.contains("filtered"));
+
+        let _ = fs::remove_dir_all(&dir);
+    }
+}
@@ -1,10 +1,5 @@
-mod config;
-mod guardian;
-mod models;
-mod pipe_server;
-mod service;
-mod session0;
 
+use process_guard_service::service;
 use std::env;
 
 fn print_usage() {
@@ -0,0 +1,370 @@
+use serde_json::{json, Map, Value};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::OnceLock;
+use std::time::{Duration, Instant};
+
+/// 小于该值的样本每个值一个桶
+const LINEAR_BUCKETS: usize = 16;
+/// 之后每个 2 的幂区间再分成 8 个桶，相对误差不超过 12.5%
+const SUB_BUCKET_BITS: u32 = 3;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+const BUCKET_COUNT: usize = LINEAR_BUCKETS + (64 - 4) * SUB_BUCKETS;
+
+/// 按请求类型统计处理耗时；不在列表中的类型计入 other
+const REQUEST_TYPES: &[&str] = &[
+    "heartbeat",
+    "heartbeat_batch",
+    "add",
+    "update",
+    "remove",
+    "batch",
+    "pause",
+    "stop",
+    "start",
+    "list",
+    "status",
+    "subscribe",
+    "metrics",
+    "ready",
+    "wire_heartbeat",
+    "wire_heartbeat_batch",
+    "wire_status",
+    "other",
+];
+
+fn bucket_index(value: u64) -> usize {
+    if value < LINEAR_BUCKETS as u64 {
+        return value as usize;
+    }
+    let exponent = 63 - value.leading_zeros();
+    let sub = (value >> (exponent - SUB_BUCKET_BITS)) as usize & (SUB_BUCKETS - 1);
+    LINEAR_BUCKETS + (exponent as usize - 4) * SUB_BUCKETS + sub
+}
+
+/// 桶内的最大值
+fn bucket_upper_bound(index: usize) -> u64 {
+    if index < LINEAR_BUCKETS {
+        return index as u64;
+    }
+    let exponent = ((index - LINEAR_BUCKETS) / SUB_BUCKETS + 4) as u32;
+    let sub = ((index - LINEAR_BUCKETS) % SUB_BUCKETS) as u64;
+    let width = 1u64 << (exponent - SUB_BUCKET_BITS);
+    ((SUB_BUCKETS as u64 + sub) * width).saturating_add(width - 1)
+}
+
+/// 对数分桶的直方图，记录只做几次原子加，不加锁
+pub struct Histogram {
+    buckets: Box<[AtomicU64]>,
+    count: AtomicU64,
+    sum: AtomicU64,
+    max: AtomicU64,
+}
+
+impl Histogram {
+    pub fn new() -> Self {
+        Self {
+            buckets: (0..BUCKET_COUNT).map(|_| AtomicU64::new(0)).collect(),
+            count: AtomicU64::new(0),
+            sum: AtomicU64::new(0),
+            max: AtomicU64::new(0),
+        }
+    }
+
+    pub fn record(&self, value: u64) {
+        self.buckets[bucket_index(value)].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum.fetch_add(value, Ordering::Relaxed);
+        self.max.fetch_max(value, Ordering::Relaxed);
+    }
+
+    /// 以微秒记录耗时
+    pub fn record_duration(&self, duration: Duration) {
+        self.record(duration.as_micros().min(u64::MAX as u128) as u64);
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    /// 累计分布中第 `percent` 百分位所在桶的上界（不超过最大值）
+    fn quantile(&self, counts: &[u64], total: u64, percent: f64) -> u64 {
+        if total == 0 {
+            return 0;
+        }
+        let rank = ((total as f64 * percent / 100.0).ceil() as u64).max(1);
+        let mut seen = 0u64;
+        for (index, &count) in counts.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return bucket_upper_bound(index).min(self.max.load(Ordering::Relaxed));
+            }
+        }
+        self.max.load(Ordering::Relaxed)
+    }
+
+    /// 并发记录时各字段之间可能相差几个样本，用于导出监控已足够
+    pub fn snapshot(&self, unit: &str) -> Value {
+        let counts: Vec<u64> = self
+            .buckets
+            .iter()
+            .map(|bucket| bucket.load(Ordering::Relaxed))
+            .collect();
+        let total: u64 = counts.iter().sum();
+        let sum = self.sum.load(Ordering::Relaxed);
+
+        // 只导出非空桶: [上界, 数量]
+        let buckets: Vec<Value> = counts
+            .iter()
+            .enumerate()
+            .filter(|(_, &count)| count > 0)
+            .map(|(index, &count)| json!([bucket_upper_bound(index), count]))
+            .collect();
+
+        json!({
+            "unit": unit,
+            "count": total,
+            "sum": sum,
+            "max": self.max.load(Ordering::Relaxed),
+            "mean": if total > 0 { sum / total } else { 0 },
+            "p50": self.quantile(&counts, total, 50.0),
+            "p90": self.quantile(&counts, total, 90.0),
+            "p99": self.quantile(&counts, total, 99.0),
+            "p999": self.quantile(&counts, total, 99.9),
+            "buckets": buckets,
+        })
+    }
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[derive(Default)]
+pub struct Counter(AtomicU64);
+
+impl Counter {
+    pub fn increment(&self) {
+        self.0.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn add(&self, value: u64) {
+        self.0.fetch_add(value, Ordering::Relaxed);
+    }
+
+    pub fn get(&self) -> u64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+/// 服务运行指标，守护线程、管道线程与重启执行器共用一份
+pub struct Metrics {
+    started_at: Instant,
+    /// 按 REQUEST_TYPES 下标，单位微秒
+    request_duration: Vec<Histogram>,
+    pub request_errors: Counter,
+    pub pipe_connections: Counter,
+    /// 空闲管道实例从开始监听到客户端连接的等待时间，微秒
+    pub pipe_accept_wait: Histogram,
+    pub heartbeats: Counter,
+    pub heartbeats_unknown: Counter,
+    /// 从共享内存槽位合并的心跳，不经过管道
+    pub heartbeats_shared: Counter,
+    /// 同一监控项相邻两次心跳的间隔，毫秒
+    pub heartbeat_interval: Histogram,
+    /// 心跳间隔占 heartbeat_timeout_ms 的千分比，超过 1000 表示心跳曾经超时
+    pub heartbeat_lag: Histogram,
+    /// 随心跳上报的指标采样，以及因名称无效、数量超限或数值无效被丢弃的指标
+    pub gauge_samples: Counter,
+    pub gauges_dropped: Counter,
+    pub restarts: Counter,
+    pub restart_failures: Counter,
+    /// 超过资源上限触发的重启
+    pub resource_restarts: Counter,
+    /// 提升备用实例代替重启，以及超过就绪超时仍未就绪的实例
+    pub standby_promotions: Counter,
+    pub ready_timeouts: Counter,
+    /// 从发现异常到新进程启动完成（包含退避等待），微秒
+    pub restart_latency: Histogram,
+    /// 执行器中终止旧进程并启动新进程的耗时，微秒
+    pub restart_execution: Histogram,
+    /// 查找可复用进程或 CreateProcessAsUserW 的耗时，微秒
+    pub process_launch: Histogram,
+    /// 一次系统进程快照（NtQuerySystemInformation）的耗时，微秒
+    pub system_snapshot: Histogram,
+    pub config_saves: Counter,
+    pub config_save_failures: Counter,
+    /// 追加到状态日志的记录数
+    pub journal_appends: Counter,
+    pub journal_compactions: Counter,
+    /// save_config 写入配置文件的耗时，微秒
+    pub config_save_duration: Histogram,
+}
+
+impl Metrics {
+    fn new() -> Self {
+        Self {
+            started_at: Instant::now(),
+            request_duration: REQUEST_TYPES.iter().map(|_| Histogram::new()).collect(),
+            request_errors: Counter::default(),
+            pipe_connections: Counter::default(),
+            pipe_accept_wait: Histogram::new(),
+            heartbeats: Counter::default(),
+            heartbeats_unknown: Counter::default(),
+            heartbeats_shared: Counter::default(),
+            heartbeat_interval: Histogram::new(),
+            heartbeat_lag: Histogram::new(),
+            gauge_samples: Counter::default(),
+            gauges_dropped: Counter::default(),
+            restarts: Counter::default(),
+            restart_failures: Counter::default(),
+            resource_restarts: Counter::default(),
+            standby_promotions: Counter::default(),
+            ready_timeouts: Counter::default(),
+            restart_latency: Histogram::new(),
+            restart_execution: Histogram::new(),
+            process_launch: Histogram::new(),
+            system_snapshot: Histogram::new(),
+            config_saves: Counter::default(),
+            config_save_failures: Counter::default(),
+            journal_appends: Counter::default(),
+            journal_compactions: Counter::default(),
+            config_save_duration: Histogram::new(),
+        }
+    }
+
+    pub fn record_request(&self, request_type: &str, elapsed: Duration, success: bool) {
+        let index = REQUEST_TYPES
+            .iter()
+            .position(|&name| name == request_type)
+            .unwrap_or(REQUEST_TYPES.len() - 1);
+        self.request_duration[index].record_duration(elapsed);
+        if !success {
+            self.request_errors.increment();
+        }
+    }
+
+    /// 记录一次到达的心跳。`interval_ms` 为与上一次心跳的间隔，乱序到达的旧心跳为 None；
+    /// `timeout_ms` 为 0 时不计算延迟比例
+    pub fn record_heartbeat(&self, interval_ms: Option<u64>, timeout_ms: u64) {
+        self.heartbeats.increment();
+        if let Some(interval_ms) = interval_ms {
+            self.heartbeat_interval.record(interval_ms);
+            if timeout_ms > 0 {
+                self.heartbeat_lag
+                    .record(interval_ms.saturating_mul(1000) / timeout_ms);
+            }
+        }
+    }
+
+    pub fn to_json(&self) -> Value {
+        let mut requests = Map::new();
+        for (name, histogram) in REQUEST_TYPES.iter().zip(&self.request_duration) {
+            if histogram.count() > 0 {
+                requests.insert(name.to_string(), histogram.snapshot("us"));
+            }
+        }
+
+        json!({
+            "uptime_ms": self.started_at.elapsed().as_millis() as u64,
+            "counters": {
+                "request_errors": self.request_errors.get(),
+                "pipe_connections": self.pipe_connections.get(),
+                "heartbeats": self.heartbeats.get(),
+                "heartbeats_unknown": self.heartbeats_unknown.get(),
+                "heartbeats_shared": self.heartbeats_shared.get(),
+                "gauge_samples": self.gauge_samples.get(),
+                "gauges_dropped": self.gauges_dropped.get(),
+                "restarts": self.restarts.get(),
+                "restart_failures": self.restart_failures.get(),
+                "resource_restarts": self.resource_restarts.get(),
+                "standby_promotions": self.standby_promotions.get(),
+                "ready_timeouts": self.ready_timeouts.get(),
+                "config_saves": self.config_saves.get(),
+                "config_save_failures": self.config_save_failures.get(),
+                "journal_appends": self.journal_appends.get(),
+                "journal_compactions": self.journal_compactions.get(),
+            },
+            "histograms": {
+                "pipe_accept_wait": self.pipe_accept_wait.snapshot("us"),
+                "heartbeat_interval": self.heartbeat_interval.snapshot("ms"),
+                "heartbeat_lag": self.heartbeat_lag.snapshot("permille"),
+                "restart_latency": self.restart_latency.snapshot("us"),
+                "restart_execution": self.restart_execution.snapshot("us"),
+                "process_launch": self.process_launch.snapshot("us"),
+                "system_snapshot": self.system_snapshot.snapshot("us"),
+                "config_save_duration": self.config_save_duration.snapshot("us"),
+            },
+            "requests": Value::Object(requests),
+        })
+    }
+}
+
+pub fn metrics() -> &'static Metrics {
+    static METRICS: OnceLock<Metrics> = OnceLock::new();
+    METRICS.get_or_init(Metrics::new)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{bucket_index, bucket_upper_bound, Histogram, Metrics, BUCKET_COUNT};
+    use std::time::Duration;
+
+    #[test]
+    fn buckets_cover_range_with_bounded_relative_error() {
+        assert_eq!(bucket_index(0), 0);
+        assert_eq!(bucket_index(15), 15);
+        assert_eq!(bucket_index(16), 16);
+        assert_eq!(bucket_index(u64::MAX), BUCKET_COUNT - 1);
+        assert_eq!(bucket_upper_bound(BUCKET_COUNT - 1), u64::MAX);
+
+        for value in [16u64, 17, 100, 1_000, 65_535, 1 << 40, u64::MAX / 3] {
+            let index = bucket_index(value);
+            let upper = bucket_upper_bound(index);
+            assert!(upper >= value);
+            assert!(index == 0 || bucket_upper_bound(index - 1) < value);
+            assert!((upper - value) as f64 <= value as f64 * 0.125);
+        }
+    }
+
+    #[test]
+    fn snapshot_reports_quantiles_and_non_empty_buckets() {
+        let histogram = Histogram::new();
+        for value in 1..=100u64 {
+            histogram.record(value);
+        }
+        let snapshot = histogram.snapshot("ms");
+
+        assert_eq!(snapshot["count"], 100);
+        assert_eq!(snapshot["sum"], 5050);
+        assert_eq!(snapshot["max"], 100);
+        let p50 = snapshot["p50"].as_u64().unwrap();
+        assert!((50..=55).contains(&p50));
+        assert_eq!(snapshot["p999"], 100);
+        let bucket_total: u64 = snapshot["buckets"]
+            .as_array()
+            .unwrap()
+            .iter()
+            .map(|bucket| bucket[1].as_u64().unwrap())
+            .sum();
+        assert_eq!(bucket_total, 100);
+    }
+
+    #[test]
+    fn unknown_request_types_are_counted_as_other() {
+        let metrics = Metrics::new();
+        metrics.record_request("heartbeat", Duration::from_micros(20), true);
+        metrics.record_request("bogus", Duration::from_micros(5), false);
+        metrics.record_heartbeat(Some(3000), 10_000);
+        metrics.record_heartbeat(None, 10_000);
+
+        let json = metrics.to_json();
+        assert_eq!(json["requests"]["heartbeat"]["count"], 1);
+        assert_eq!(json["requests"]["other"]["count"], 1);
+        assert!(json["requests"].get("add").is_none());
+        assert_eq!(json["counters"]["request_errors"], 1);
+        assert_eq!(json["counters"]["heartbeats"], 2);
+        assert_eq!(json["histograms"]["heartbeat_lag"]["max"], 300);
+    }
+}
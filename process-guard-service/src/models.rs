@@ -1,6 +1,14 @@
+use crate::gauges::GaugeStats;
+use crate::health_log::HealthLogMode;
+use crate::heartbeat::HeartbeatSlot;
+use crate::job_object::JobAccounting;
+use crate::process_watcher::ProcessWatch;
+use crate::resource_watch::{ResourceLimits, ResourceWatch};
 use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, HashMap};
 use std::ops::BitOr;
-use std::time::Instant;
+use std::sync::Arc;
+use std::time::{Duration, Instant};
 use uuid::Uuid;
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -14,12 +22,30 @@ pub struct MonitorItem {
     pub enabled: bool,
     #[serde(default = "default_heartbeat_timeout")]
     pub heartbeat_timeout_ms: u64,
+    /// 资源上限，超过时主动重启
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub limits: Option<ResourceLimits>,
+    /// 大于 0 时进程启动后需发送 ready：启动宽限期在收到 ready 时结束，超过该时间仍未就绪则重启。
+    /// 为 0 时宽限期为 STARTUP_GRACE_PERIOD_MS，期间收到 ready 同样提前结束
+    #[serde(default, skip_serializing_if = "is_zero")]
+    pub ready_timeout_ms: u64,
+    /// 预先启动一个备用实例，当前实例失败时直接提升备用实例，之后再启动新的备用实例
+    #[serde(default, skip_serializing_if = "is_false")]
+    pub standby: bool,
 }
 
 fn default_heartbeat_timeout() -> u64 {
     10000
 }
 
+fn is_zero(value: &u64) -> bool {
+    *value == 0
+}
+
+fn is_false(value: &bool) -> bool {
+    !*value
+}
+
 impl MonitorItem {
     pub fn new(exe_path: String, name: String) -> Self {
         Self {
@@ -31,50 +57,168 @@ impl MonitorItem {
             no_window: false,
             enabled: true,
             heartbeat_timeout_ms: 10000,
+            limits: None,
+            ready_timeout_ms: 0,
+            standby: false,
         }
     }
+
+    /// 需要发送 ready 的监控项的就绪超时；开启备用实例但未设置超时时使用 DEFAULT_READY_TIMEOUT_MS
+    pub fn ready_timeout(&self) -> Option<Duration> {
+        match (self.ready_timeout_ms, self.standby) {
+            (0, false) => None,
+            (0, true) => Some(Duration::from_millis(DEFAULT_READY_TIMEOUT_MS)),
+            (timeout_ms, _) => Some(Duration::from_millis(timeout_ms)),
+        }
+    }
+}
+
+/// 预先启动、等待提升的备用实例；不发送心跳，也不做存活以外的检查
+#[derive(Debug, Clone)]
+pub struct StandbyInstance {
+    pub process_id: u32,
+    pub process_create_time: Option<u64>,
+    pub watch: Option<Arc<ProcessWatch>>,
+    pub launched_at: Instant,
+    pub ready_at: Option<Instant>,
 }
 
 #[derive(Debug, Clone)]
 pub struct MonitoredProcess {
     pub item: MonitorItem,
     pub process_id: Option<u32>,
-    pub last_heartbeat: Instant,
+    pub process_create_time: Option<u64>, // 用于在系统快照中识别 PID 复用
+    pub heartbeat: Arc<HeartbeatSlot>, // 与心跳索引共享，心跳写入不经过 processes 锁
     pub last_check: Instant,
     pub restart_count: u32,
     pub startup_time: Instant, // 进程启动时间，用于计算启动宽限期
+    pub watch: Option<Arc<ProcessWatch>>, // 进程句柄及退出等待，注册失败时为 None
+    pub restart_pending: bool, // 已排队或正在退避等待的重启
+    pub restart_generation: u64, // 用于丢弃被停止/重新添加操作取代的重启结果
+    pub restart_backoff_ms: u64, // 上一次重启使用的退避时间
+    pub last_restart_at: Option<Instant>,
+    pub last_restart_reason: Option<String>,
+    pub restart_requested_at: Option<Instant>, // 发现需要重启的时间，用于统计重启耗时
+    pub resource_watch: ResourceWatch, // 资源上限检查的 CPU 采样状态，进程启动时重置
+    pub ready_at: Option<Instant>, // 当前实例发送 ready 的时间，复用已运行的进程时视为已就绪
+    pub standby: Option<StandbyInstance>,
+    pub standby_pending: Option<u64>, // 正在启动的备用实例的代次，用于丢弃被取代的启动结果
 }
 
 impl MonitoredProcess {
     pub fn from_item(item: MonitorItem) -> Self {
+        let heartbeat = Arc::new(HeartbeatSlot::with_timeout(item.heartbeat_timeout_ms));
         Self {
             item,
             process_id: None,
-            last_heartbeat: Instant::now(),
+            process_create_time: None,
+            heartbeat,
             last_check: Instant::now(),
             restart_count: 0,
             startup_time: Instant::now(),
+            watch: None,
+            restart_pending: false,
+            restart_generation: 0,
+            restart_backoff_ms: 0,
+            last_restart_at: None,
+            last_restart_reason: None,
+            restart_requested_at: None,
+            resource_watch: ResourceWatch::default(),
+            ready_at: None,
+            standby: None,
+            standby_pending: None,
         }
     }
 
     pub fn is_heartbeat_timeout(&self) -> bool {
-        let timeout = std::time::Duration::from_millis(self.item.heartbeat_timeout_ms);
-        self.last_heartbeat.elapsed() > timeout
+        let timeout = Duration::from_millis(self.item.heartbeat_timeout_ms);
+        self.heartbeat.elapsed() > timeout
+    }
+
+    /// 启动宽限期在收到 ready 时结束，最长为就绪超时（不需要 ready 时为 STARTUP_GRACE_PERIOD_MS）
+    pub fn grace_end(&self) -> Instant {
+        let limit = self
+            .item
+            .ready_timeout()
+            .unwrap_or(Duration::from_millis(STARTUP_GRACE_PERIOD_MS));
+        let timer_end = self.startup_time + limit;
+        self.ready_at
+            .map_or(timer_end, |ready_at| ready_at.min(timer_end))
     }
 
-    pub fn update_heartbeat(&mut self) {
-        self.last_heartbeat = Instant::now();
+    /// 需要 ready 的监控项超过就绪超时仍未就绪
+    pub fn ready_overdue(&self, now: Instant) -> bool {
+        self.ready_at.is_none()
+            && self
+                .item
+                .ready_timeout()
+                .map_or(false, |timeout| now >= self.startup_time + timeout)
+    }
+
+    /// 下一次需要检查心跳的时间：启动宽限期结束与心跳超时两者中较晚的一个
+    pub fn heartbeat_deadline(&self) -> Instant {
+        let heartbeat_expiry =
+            self.heartbeat.last_heartbeat() + Duration::from_millis(self.item.heartbeat_timeout_ms);
+        self.grace_end().max(heartbeat_expiry)
+    }
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct ServiceSettings {
+    /// 同时进行的进程重启数上限
+    #[serde(default = "default_restart_concurrency")]
+    pub restart_concurrency: usize,
+    /// 健康检查日志模式：verbose 每个周期逐项输出，transitions 只输出状态变化与周期汇总
+    #[serde(default)]
+    pub health_log: HealthLogMode,
+    /// 健康汇总日志的输出间隔（毫秒），0 表示不输出
+    #[serde(default = "default_health_summary_interval")]
+    pub health_summary_interval_ms: u64,
+    /// 创建心跳共享内存段，同机客户端按句柄直接写入心跳时间而不发送管道请求
+    #[serde(default)]
+    pub shared_heartbeat: bool,
+    /// 守护分片数：监控项按句柄分到各分片，每个分片由独立线程检查，监控项很多时可设为 CPU 核数
+    #[serde(default = "default_guardian_shards")]
+    pub guardian_shards: usize,
+}
+
+fn default_restart_concurrency() -> usize {
+    DEFAULT_RESTART_CONCURRENCY
+}
+
+fn default_guardian_shards() -> usize {
+    1
+}
+
+fn default_health_summary_interval() -> u64 {
+    DEFAULT_HEALTH_SUMMARY_INTERVAL_MS
+}
+
+impl Default for ServiceSettings {
+    fn default() -> Self {
+        Self {
+            restart_concurrency: DEFAULT_RESTART_CONCURRENCY,
+            health_log: HealthLogMode::default(),
+            health_summary_interval_ms: DEFAULT_HEALTH_SUMMARY_INTERVAL_MS,
+            shared_heartbeat: false,
+            guardian_shards: default_guardian_shards(),
+        }
     }
 }
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Config {
     pub items: Vec<MonitorItem>,
+    #[serde(default)]
+    pub settings: ServiceSettings,
 }
 
 impl Config {
     pub fn new() -> Self {
-        Self { items: Vec::new() }
+        Self {
+            items: Vec::new(),
+            settings: ServiceSettings::default(),
+        }
     }
 }
 
@@ -96,6 +240,72 @@ pub struct PipeRequest {
     pub item_id: Option<String>,
     #[serde(skip_serializing_if = "Option::is_none")]
     pub timestamp: Option<i64>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub item_ids: Option<Vec<String>>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub timestamps: Option<Vec<i64>>, // 与 item_ids 一一对应的心跳时间（Unix 毫秒），可省略
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub binary: Option<bool>, // 会话握手时请求启用二进制报文
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub handle: Option<u32>, // add/list 返回的数字句柄，可代替 item_id
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub handles: Option<Vec<u32>>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub since_version: Option<u64>, // subscribe: 上次收到的版本号，缺省时返回快照
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub epoch: Option<u64>, // subscribe: 上次响应中的 epoch；按句柄心跳: 取得句柄时的 epoch
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub wait_ms: Option<u64>, // subscribe: 没有新事件时最多等待的毫秒数
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub items: Option<Vec<MonitorItem>>, // batch: 按 ID 添加或更新的监控项
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub remove_ids: Option<Vec<String>>, // batch: 要移除的监控项 ID
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub gauges: Option<HashMap<String, f64>>, // heartbeat: 随心跳上报的指标
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub process_id: Option<u32>, // ready: 发送者的 PID，用于区分当前实例与备用实例
+}
+
+/// status 请求中单个监控项的状态，JSON 与二进制报文共用
+#[derive(Debug, Clone, Serialize)]
+pub struct ItemStatus {
+    pub id: String,
+    pub name: String,
+    pub exe_path: String,
+    pub enabled: bool,
+    pub process_id: Option<u32>,
+    pub last_heartbeat_ms: u64,
+    pub heartbeat_timeout_ms: u64,
+    pub restart_count: u32,
+    pub restart_pending: bool,
+    pub last_restart_reason: Option<String>,
+    pub is_alive: bool,
+    pub is_heartbeat_ok: bool,
+    /// 进程树的资源统计，进程不在作业对象中时省略；二进制状态报文只在扩展格式中包含
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub job: Option<JobAccounting>,
+    /// 随心跳上报的指标统计，从未上报时省略；二进制状态报文只在扩展格式中包含
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub gauges: Option<BTreeMap<String, GaugeStats>>,
+    /// 当前实例已发送 ready（或是复用的已运行进程）
+    pub is_ready: bool,
+    /// 开启 standby 的监控项的备用实例，尚未启动时省略
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub standby: Option<StandbyStatus>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct StandbyStatus {
+    pub process_id: u32,
+    pub is_ready: bool,
+}
+
+/// ready 请求的发送者是当前实例还是备用实例
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize)]
+#[serde(rename_all = "lowercase")]
+pub enum InstanceRole {
+    Active,
+    Standby,
 }
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -133,26 +343,30 @@ impl PipeResponse {
     }
 }
 
+/// 配置变更标志，可以用 `|` 组合（如 Stop | Start 表示先停止再启动）
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
-pub enum ChangeType {
-    None = 0,
-    Start = 1,
-    Stop = 2,
-    Remove = 4,
-    Pause = 8,
+pub struct ChangeType(u8);
+
+#[allow(non_upper_case_globals)]
+impl ChangeType {
+    pub const None: ChangeType = ChangeType(0);
+    pub const Start: ChangeType = ChangeType(1);
+    pub const Stop: ChangeType = ChangeType(2);
+    pub const Remove: ChangeType = ChangeType(4);
+    pub const Pause: ChangeType = ChangeType(8);
 }
 
 impl BitOr for ChangeType {
     type Output = Self;
 
     fn bitor(self, rhs: Self) -> Self::Output {
-        unsafe { std::mem::transmute((self as u8) | (rhs as u8)) }
+        ChangeType(self.0 | rhs.0)
     }
 }
 
 impl ChangeType {
     pub fn has_flag(&self, other: ChangeType) -> bool {
-        (*self as u8) & (other as u8) != 0
+        self.0 & other.0 != 0
     }
 }
 
@@ -166,5 +380,16 @@ pub const SERVICE_NAME: &str = "ProcessGuardService";
 pub const PIPE_NAME: &str = "ProcessGuardService";
 pub const CONFIG_FILE_NAME: &str = "config.json";
 pub const CONFIG_BACKUP_FILE_NAME: &str = "config_bak.json";
+pub const JOURNAL_FILE_NAME: &str = "state.journal";
 pub const CHECK_INTERVAL_MS: u64 = 3000;
+pub const STARTUP_GRACE_PERIOD_MS: u64 = 5000;
+pub const DEFAULT_READY_TIMEOUT_MS: u64 = 60_000;
+pub const DEFAULT_RESTART_CONCURRENCY: usize = 4;
+pub const MAX_RESTART_CONCURRENCY: usize = 16;
+pub const MAX_GUARDIAN_SHARDS: usize = 64;
+pub const RESTART_BACKOFF_INITIAL_MS: u64 = 1000;
+pub const RESTART_BACKOFF_MAX_MS: u64 = 60_000;
+/// 距上次重启超过该时间视为已稳定运行，下一次重启不再退避
+pub const RESTART_BACKOFF_RESET_MS: u64 = 60_000;
 pub const DEFAULT_HEARTBEAT_TIMEOUT_MS: u64 = 10000;
+pub const DEFAULT_HEALTH_SUMMARY_INTERVAL_MS: u64 = 300_000;
@@ -1,23 +1,53 @@
+use crate::framing::{encode_frame, FrameDecoder};
 use crate::guardian::Guardian;
+use crate::heartbeat::age_from_timestamp;
+use crate::metrics::metrics;
 use crate::models::{ChangeType, ConfigChange, PipeRequest, PipeResponse, PIPE_NAME};
-use log::{debug, error, info};
+use crate::wire::{
+    encode_status, is_wire_message, put_str, WireHeader, WireReader, FLAG_EPOCH, FLAG_EXTENDED,
+    FLAG_HANDLES, OP_HEARTBEAT, OP_HEARTBEAT_BATCH, OP_STATUS,
+};
+use log::{debug, error, info, warn};
+use std::collections::HashSet;
 use std::ffi::OsStr;
 use std::os::windows::ffi::OsStrExt;
-use std::sync::Arc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
 use windows::core::PCWSTR;
-use windows::Win32::Foundation::CloseHandle;
-use windows::Win32::Storage::FileSystem::{
-    ReadFile, WriteFile, FILE_FLAGS_AND_ATTRIBUTES,
+use windows::Win32::Foundation::{
+    CloseHandle, ERROR_IO_PENDING, ERROR_PIPE_CONNECTED, HANDLE, INVALID_HANDLE_VALUE,
 };
+use windows::Win32::Storage::FileSystem::{ReadFile, WriteFile, FILE_FLAGS_AND_ATTRIBUTES};
 use windows::Win32::System::Pipes::{
     ConnectNamedPipe, CreateNamedPipeW, DisconnectNamedPipe, PIPE_READMODE_BYTE, PIPE_TYPE_BYTE,
     PIPE_WAIT,
 };
+use windows::Win32::System::IO::{
+    CancelIoEx, CreateIoCompletionPort, GetQueuedCompletionStatus, PostQueuedCompletionStatus,
+    OVERLAPPED,
+};
 
 const BUFFER_SIZE: u32 = 65536;
-const MAX_INSTANCES: u32 = 10;
+// 会话连接会长期占用一个管道实例，因此不再限制为 10 个
+const MAX_INSTANCES: u32 = 255; // PIPE_UNLIMITED_INSTANCES
 const TIMEOUT_MS: u32 = 0;
 const PIPE_ACCESS_DUPLEX: u32 = 0x00000003;
+const FILE_FLAG_OVERLAPPED: u32 = 0x40000000;
+const INFINITE: u32 = 0xFFFFFFFF;
+/// 始终保持挂起在 ConnectNamedPipe 上的空闲实例数
+const PENDING_INSTANCES: usize = 4;
+/// 处理完成包并执行 handle_request 的工作线程数
+const WORKER_THREADS: usize = 4;
+const SHUTDOWN_KEY: usize = usize::MAX;
+const SHUTDOWN_DRAIN_TIMEOUT_MS: u32 = 1000;
+const SESSION_REQUEST_TYPE: &str = "session";
+const SESSION_PROTOCOL_VERSION: u32 = 1;
+const SUBSCRIBE_REQUEST_TYPE: &str = "subscribe";
+/// subscribe 请求没有新事件时最多挂起的时长
+const SUBSCRIBE_MAX_WAIT_MS: u64 = 30_000;
+/// 主线程检查挂起订阅是否到期的间隔
+const SUBSCRIBE_POLL_INTERVAL_MS: u64 = 100;
 
 fn to_wide_string(s: &str) -> Vec<u16> {
     OsStr::new(s)
@@ -26,6 +56,111 @@ fn to_wide_string(s: &str) -> Vec<u16> {
         .collect()
 }
 
+fn is_error(err: &windows::core::Error, code: windows::Win32::Foundation::WIN32_ERROR) -> bool {
+    err.code() == code.into()
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum InstanceState {
+    Connecting,
+    Reading,
+    Writing,
+    /// 挂起的 subscribe 请求，没有未完成的 I/O，由主线程投递完成包唤醒
+    Subscribed,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum ConnectionMode {
+    /// 尚未收到第一条消息，可能是会话握手，也可能是旧客户端的一次性请求
+    AwaitingFirstMessage,
+    Session,
+}
+
+/// 一个管道实例及其进行中的重叠 I/O 状态。
+/// `overlapped` 必须是第一个字段，完成包中的 OVERLAPPED 指针可直接还原为实例指针。
+/// 每个实例同一时刻最多只有一个未完成的 I/O，因此完成包处理期间只有一个工作线程访问它。
+#[repr(C)]
+struct PipeInstance {
+    overlapped: OVERLAPPED,
+    handle: HANDLE,
+    state: InstanceState,
+    mode: ConnectionMode,
+    read_buffer: Vec<u8>,
+    write_buffer: Vec<u8>,
+    write_offset: usize,
+    close_after_write: bool,
+    decoder: FrameDecoder,
+    /// 握手时协商了二进制报文，会话帧可以是 JSON 或以 WIRE_MAGIC 开头的二进制报文
+    binary: bool,
+    /// 等待新事件的 subscribe 请求，写完之前的响应后挂起
+    subscription: Option<SubscriptionWait>,
+    /// 开始等待 ConnectNamedPipe 的时间
+    listen_started: Instant,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct SubscriptionWait {
+    since: u64,
+    deadline: Instant,
+}
+
+/// 挂起中的订阅；实例此时不属于任何工作线程，只通过这里的地址被唤醒
+struct ParkedSubscription {
+    address: usize,
+    wait: SubscriptionWait,
+}
+
+enum SubscribeOutcome {
+    Reply(PipeResponse),
+    Wait(SubscriptionWait),
+}
+
+impl PipeInstance {
+    fn new(handle: HANDLE) -> Self {
+        Self {
+            overlapped: unsafe { std::mem::zeroed() },
+            handle,
+            state: InstanceState::Connecting,
+            mode: ConnectionMode::AwaitingFirstMessage,
+            read_buffer: vec![0u8; BUFFER_SIZE as usize],
+            write_buffer: Vec::new(),
+            write_offset: 0,
+            close_after_write: false,
+            decoder: FrameDecoder::new(),
+            binary: false,
+            subscription: None,
+            listen_started: Instant::now(),
+        }
+    }
+
+    fn reset_connection(&mut self) {
+        self.mode = ConnectionMode::AwaitingFirstMessage;
+        self.write_buffer.clear();
+        self.write_offset = 0;
+        self.close_after_write = false;
+        self.decoder = FrameDecoder::new();
+        self.binary = false;
+        self.subscription = None;
+    }
+
+    fn reset_overlapped(&mut self) {
+        self.overlapped = unsafe { std::mem::zeroed() };
+    }
+}
+
+/// 完成端口与实例池的共享状态
+struct InstancePool {
+    port: HANDLE,
+    pipe_name_wide: Vec<u16>,
+    listening: AtomicUsize,
+    instances: Mutex<HashSet<usize>>,
+    parked: Mutex<Vec<ParkedSubscription>>,
+}
+
+// 完成端口句柄可跨线程使用；实例集合只保存地址，访问受互斥锁保护
+unsafe impl Send for InstancePool {}
+unsafe impl Sync for InstancePool {}
+
 pub struct PipeServer {
     guardian: Arc<Guardian>,
     running: Arc<std::sync::Mutex<bool>>,
@@ -45,150 +180,824 @@ impl PipeServer {
         }
     }
 
-    pub fn run(&self) {
+    pub fn run(self: &Arc<Self>) {
         let pipe_name = format!("\\\\.\\pipe\\{}", PIPE_NAME);
-        let pipe_name_wide = to_wide_string(&pipe_name);
-        let mut ready_notified = false;
 
         info!("正在启动管道服务: {}", pipe_name);
 
+        let port = loop {
+            if !self.is_running() {
+                info!("管道服务正在停止");
+                return;
+            }
+
+            match unsafe { CreateIoCompletionPort(INVALID_HANDLE_VALUE, HANDLE::default(), 0, 0) } {
+                Ok(port) => break port,
+                Err(e) => {
+                    error!("创建完成端口失败: {:?}", e);
+                    std::thread::sleep(Duration::from_secs(1));
+                }
+            }
+        };
+
+        let pool = Arc::new(InstancePool {
+            port,
+            pipe_name_wide: to_wide_string(&pipe_name),
+            listening: AtomicUsize::new(0),
+            instances: Mutex::new(HashSet::new()),
+            parked: Mutex::new(Vec::new()),
+        });
+
         loop {
-            let running = *self.running.lock().unwrap();
-            if !running {
+            if !self.is_running() {
                 info!("管道服务正在停止");
+                unsafe {
+                    let _ = CloseHandle(pool.port);
+                }
+                return;
+            }
+
+            self.ensure_listeners(&pool);
+            if pool.listening.load(Ordering::SeqCst) > 0 {
                 break;
             }
 
-            let pipe_handle = unsafe {
-                CreateNamedPipeW(
-                    PCWSTR(pipe_name_wide.as_ptr()),
-                    FILE_FLAGS_AND_ATTRIBUTES(PIPE_ACCESS_DUPLEX),
-                    PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-                    MAX_INSTANCES,
-                    BUFFER_SIZE,
-                    BUFFER_SIZE,
-                    TIMEOUT_MS,
-                    None,
+            std::thread::sleep(Duration::from_secs(1));
+        }
+
+        if let Some(ready_signal) = &self.ready_signal {
+            ready_signal.mark_ready();
+        }
+
+        info!(
+            "管道服务已就绪: {} 个待连接实例, {} 个工作线程",
+            PENDING_INSTANCES, WORKER_THREADS
+        );
+
+        let mut workers = Vec::with_capacity(WORKER_THREADS);
+        for index in 0..WORKER_THREADS {
+            let server = self.clone();
+            let pool_for_worker = pool.clone();
+            let spawn_result = std::thread::Builder::new()
+                .name(format!("pipe-worker-{}", index))
+                .spawn(move || server.worker_loop(&pool_for_worker));
+            match spawn_result {
+                Ok(handle) => workers.push(handle),
+                Err(e) => error!("创建管道工作线程失败: {}", e),
+            }
+        }
+
+        // 主线程等待状态事件，唤醒有新事件或已到期的挂起订阅
+        let mut version = self.guardian.status_events().version();
+        while self.is_running() {
+            version = self
+                .guardian
+                .status_events()
+                .wait_for_change(version, Duration::from_millis(SUBSCRIBE_POLL_INTERVAL_MS));
+            self.wake_subscribers(&pool, version);
+        }
+
+        info!("管道服务正在停止");
+
+        for _ in 0..workers.len() {
+            unsafe {
+                let _ = PostQueuedCompletionStatus(pool.port, 0, SHUTDOWN_KEY, None);
+            }
+        }
+        for worker in workers {
+            let _ = worker.join();
+        }
+
+        self.shutdown_instances(&pool);
+
+        info!("管道服务已停止");
+    }
+
+    fn is_running(&self) -> bool {
+        *self.running.lock().unwrap()
+    }
+
+    fn worker_loop(&self, pool: &InstancePool) {
+        loop {
+            let mut bytes_transferred: u32 = 0;
+            let mut completion_key: usize = 0;
+            let mut overlapped: *mut OVERLAPPED = std::ptr::null_mut();
+
+            let result = unsafe {
+                GetQueuedCompletionStatus(
+                    pool.port,
+                    &mut bytes_transferred,
+                    &mut completion_key,
+                    &mut overlapped,
+                    INFINITE,
                 )
             };
 
-            if !pipe_handle.is_invalid() && !ready_notified {
-                if let Some(ready_signal) = &self.ready_signal {
-                    ready_signal.mark_ready();
+            if overlapped.is_null() {
+                if completion_key == SHUTDOWN_KEY && result.is_ok() {
+                    break;
+                }
+                if let Err(e) = result {
+                    error!("等待完成端口失败: {:?}", e);
+                    break;
                 }
-                ready_notified = true;
-            }
-
-            if pipe_handle.is_invalid() {
-                error!("创建命名管道失败");
-                std::thread::sleep(std::time::Duration::from_secs(1));
                 continue;
             }
 
-            //  debug!("等待客户端连接...");
+            let instance = unsafe { &mut *(overlapped as *mut PipeInstance) };
+            self.on_completion(pool, instance, result.is_ok(), bytes_transferred as usize);
+        }
+    }
 
-            let connect_result = unsafe { ConnectNamedPipe(pipe_handle, None) };
+    fn on_completion(
+        &self,
+        pool: &InstancePool,
+        instance: &mut PipeInstance,
+        success: bool,
+        bytes_transferred: usize,
+    ) {
+        match instance.state {
+            InstanceState::Connecting => {
+                pool.listening.fetch_sub(1, Ordering::SeqCst);
+                // 先补足待连接实例再处理当前客户端，使接入延迟不受请求处理耗时影响
+                self.ensure_listeners(pool);
+
+                if success {
+                    //   info!("客户端已连接到管道服务");
+                    let metrics = metrics();
+                    metrics.pipe_connections.increment();
+                    metrics
+                        .pipe_accept_wait
+                        .record_duration(instance.listen_started.elapsed());
+                    self.issue_read(pool, instance);
+                } else {
+                    debug!("等待客户端连接失败");
+                    self.recycle_instance(pool, instance);
+                }
+            }
+            InstanceState::Reading => {
+                if !success || bytes_transferred == 0 {
+                    //  info!("客户端已从管道服务断开");
+                    self.recycle_instance(pool, instance);
+                } else {
+                    self.on_read(pool, instance, bytes_transferred);
+                }
+            }
+            InstanceState::Writing => {
+                if !success {
+                    error!("向管道写入响应失败");
+                    self.recycle_instance(pool, instance);
+                    return;
+                }
 
-            if connect_result.is_err() {
-                let err = windows::core::Error::from_win32();
-                if err.code() != windows::Win32::Foundation::ERROR_PIPE_CONNECTED.into() {
-                    error!("连接命名管道失败: {:?}", err);
-                    unsafe {
-                        let _ = CloseHandle(pipe_handle);
-                    }
-                    continue;
+                instance.write_offset += bytes_transferred;
+                if instance.write_offset < instance.write_buffer.len() {
+                    self.issue_write(pool, instance);
+                } else if instance.close_after_write {
+                    self.recycle_instance(pool, instance);
+                } else if let Some(wait) = instance.subscription {
+                    self.park_subscription(pool, instance, wait);
+                } else {
+                    // 解码器中可能还有挂起订阅之后到达的帧
+                    self.process_frames(pool, instance);
                 }
             }
+            InstanceState::Subscribed => {
+                let since = instance.subscription.take().map_or(0, |wait| wait.since);
+                let response = self.subscription_events(since);
+                let response_data = serde_json::to_string(&response).unwrap_or_default();
+                instance.write_buffer.clear();
+                instance.write_offset = 0;
+                encode_frame(response_data.as_bytes(), &mut instance.write_buffer);
+                self.issue_write(pool, instance);
+            }
+        }
+    }
 
-            //   info!("客户端已连接到管道服务");
+    fn on_read(&self, pool: &InstancePool, instance: &mut PipeInstance, bytes_read: usize) {
+        if instance.mode == ConnectionMode::Session {
+            instance.decoder.push(&instance.read_buffer[..bytes_read]);
+            self.process_frames(pool, instance);
+            return;
+        }
 
-            let mut buffer = vec![0u8; BUFFER_SIZE as usize];
-            let mut bytes_read: u32 = 0;
+        instance.write_buffer.clear();
+        instance.write_offset = 0;
+
+        let request_data = String::from_utf8_lossy(&instance.read_buffer[..bytes_read]);
+        //    info!("接收到请求: {}", request_data);
+
+        let response = match parse_request(&request_data) {
+            Ok(request) if request.request_type == SESSION_REQUEST_TYPE => {
+                instance.mode = ConnectionMode::Session;
+                instance.binary = request.binary == Some(true);
+                PipeResponse::success_with_data(
+                    "会话已建立",
+                    serde_json::json!({
+                        "version": SESSION_PROTOCOL_VERSION,
+                        "binary": instance.binary,
+                        "epoch": self.guardian.status_events().epoch(),
+                    }),
+                )
+            }
+            Ok(request) => {
+                // 旧客户端: 一次连接只处理一个请求
+                instance.close_after_write = true;
+                self.dispatch_request(&request)
+            }
+            Err(response) => {
+                instance.close_after_write = true;
+                response
+            }
+        };
 
-            let read_result =
-                unsafe { ReadFile(pipe_handle, Some(&mut buffer), Some(&mut bytes_read), None) };
+        let response_data = serde_json::to_string(&response).unwrap_or_default();
+        instance
+            .write_buffer
+            .extend_from_slice(response_data.as_bytes());
+        self.issue_write(pool, instance);
+    }
 
-            if read_result.is_err() || bytes_read == 0 {
-                debug!("从管道读取失败或请求为空");
-                unsafe {
-                    let _ = DisconnectNamedPipe(pipe_handle);
-                    let _ = CloseHandle(pipe_handle);
+    /// 处理解码器中已完整到达的会话帧。
+    /// 客户端可以连续发送多帧，按顺序处理并合并为一次写入；遇到需要等待的 subscribe 请求时停止，
+    /// 先写出之前的响应再挂起
+    fn process_frames(&self, pool: &InstancePool, instance: &mut PipeInstance) {
+        instance.write_buffer.clear();
+        instance.write_offset = 0;
+
+        loop {
+            match instance.decoder.next_frame() {
+                Ok(Some(payload)) if instance.binary && is_wire_message(&payload) => {
+                    let reply = self.handle_wire_request(&payload);
+                    encode_frame(&reply, &mut instance.write_buffer);
+                }
+                Ok(Some(payload)) => {
+                    let request_data = String::from_utf8_lossy(&payload);
+                    let response = match parse_request(&request_data) {
+                        Ok(request) if request.request_type == SUBSCRIBE_REQUEST_TYPE => {
+                            let started = Instant::now();
+                            match self.poll_subscription(&request) {
+                                SubscribeOutcome::Reply(response) => {
+                                    metrics().record_request(
+                                        SUBSCRIBE_REQUEST_TYPE,
+                                        started.elapsed(),
+                                        response.success,
+                                    );
+                                    response
+                                }
+                                SubscribeOutcome::Wait(wait) => {
+                                    instance.subscription = Some(wait);
+                                    break;
+                                }
+                            }
+                        }
+                        Ok(request) => self.dispatch_request(&request),
+                        Err(response) => response,
+                    };
+                    let response_data = serde_json::to_string(&response).unwrap_or_default();
+                    encode_frame(response_data.as_bytes(), &mut instance.write_buffer);
+                }
+                Ok(None) => break,
+                Err(e) => {
+                    error!("会话帧无效, 关闭连接: {}", e);
+                    instance.close_after_write = true;
+                    break;
                 }
-                continue;
             }
+        }
+
+        if !instance.write_buffer.is_empty() {
+            self.issue_write(pool, instance);
+        } else if instance.close_after_write {
+            self.recycle_instance(pool, instance);
+        } else if let Some(wait) = instance.subscription {
+            self.park_subscription(pool, instance, wait);
+        } else {
+            self.issue_read(pool, instance);
+        }
+    }
 
-            let request_data = String::from_utf8_lossy(&buffer[..bytes_read as usize]);
-            //    info!("接收到请求: {}", request_data);
+    fn park_subscription(
+        &self,
+        pool: &InstancePool,
+        instance: &mut PipeInstance,
+        wait: SubscriptionWait,
+    ) {
+        instance.state = InstanceState::Subscribed;
+        instance.reset_overlapped();
+        pool.parked.lock().unwrap().push(ParkedSubscription {
+            address: instance as *mut PipeInstance as usize,
+            wait,
+        });
+    }
 
-            let response = self.handle_request(&request_data);
-            let response_data = serde_json::to_string(&response).unwrap_or_default();
+    /// 为有新事件或已到期的挂起订阅投递完成包，由工作线程生成响应
+    fn wake_subscribers(&self, pool: &InstancePool, version: u64) {
+        let now = Instant::now();
+        let mut parked = pool.parked.lock().unwrap();
 
-            let mut bytes_written: u32 = 0;
-            let write_result = unsafe {
-                WriteFile(
-                    pipe_handle,
-                    Some(response_data.as_bytes()),
-                    Some(&mut bytes_written),
-                    None,
-                )
-            };
+        parked.retain(|parked| {
+            if parked.wait.since >= version && parked.wait.deadline > now {
+                return true;
+            }
 
-            if write_result.is_err() {
-                error!("向管道写入响应失败");
-            } else {
-                // debug!("响应已发送: {}", response_data);
+            let instance = unsafe { &*(parked.address as *const PipeInstance) };
+            let posted =
+                unsafe { PostQueuedCompletionStatus(pool.port, 0, 0, Some(&instance.overlapped)) };
+            if let Err(e) = &posted {
+                error!("投递订阅完成包失败: {:?}", e);
             }
+            posted.is_err()
+        });
+    }
+
+    fn issue_read(&self, pool: &InstancePool, instance: &mut PipeInstance) {
+        instance.state = InstanceState::Reading;
+        instance.reset_overlapped();
+
+        let result = unsafe {
+            ReadFile(
+                instance.handle,
+                Some(instance.read_buffer.as_mut_slice()),
+                None,
+                Some(&mut instance.overlapped),
+            )
+        };
 
+        if let Err(e) = result {
+            if !is_error(&e, ERROR_IO_PENDING) {
+                debug!("从管道读取失败或请求为空");
+                self.recycle_instance(pool, instance);
+            }
+        }
+    }
+
+    fn issue_write(&self, pool: &InstancePool, instance: &mut PipeInstance) {
+        instance.state = InstanceState::Writing;
+        instance.reset_overlapped();
+
+        let result = unsafe {
+            WriteFile(
+                instance.handle,
+                Some(&instance.write_buffer[instance.write_offset..]),
+                None,
+                Some(&mut instance.overlapped),
+            )
+        };
+
+        if let Err(e) = result {
+            if !is_error(&e, ERROR_IO_PENDING) {
+                error!("向管道写入响应失败: {:?}", e);
+                self.recycle_instance(pool, instance);
+            }
+        }
+    }
+
+    /// 补足挂起在 ConnectNamedPipe 上的实例数
+    fn ensure_listeners(&self, pool: &InstancePool) {
+        while self.is_running() && pool.listening.load(Ordering::SeqCst) < PENDING_INSTANCES {
+            if pool.instances.lock().unwrap().len() >= MAX_INSTANCES as usize {
+                warn!("管道实例数已达上限: {}", MAX_INSTANCES);
+                return;
+            }
+            if !self.create_instance(pool) {
+                return;
+            }
+        }
+    }
+
+    fn create_instance(&self, pool: &InstancePool) -> bool {
+        let pipe_handle = unsafe {
+            CreateNamedPipeW(
+                PCWSTR(pool.pipe_name_wide.as_ptr()),
+                FILE_FLAGS_AND_ATTRIBUTES(PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED),
+                PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+                MAX_INSTANCES,
+                BUFFER_SIZE,
+                BUFFER_SIZE,
+                TIMEOUT_MS,
+                None,
+            )
+        };
+
+        if pipe_handle.is_invalid() {
+            error!("创建命名管道失败");
+            return false;
+        }
+
+        if let Err(e) = unsafe { CreateIoCompletionPort(pipe_handle, pool.port, 0, 0) } {
+            error!("关联管道与完成端口失败: {:?}", e);
             unsafe {
-                let _ = DisconnectNamedPipe(pipe_handle);
                 let _ = CloseHandle(pipe_handle);
             }
+            return false;
+        }
+
+        let instance = Box::into_raw(Box::new(PipeInstance::new(pipe_handle)));
+        pool.instances.lock().unwrap().insert(instance as usize);
+        pool.listening.fetch_add(1, Ordering::SeqCst);
 
-            //  info!("客户端已从管道服务断开");
+        self.arm_connect(pool, unsafe { &mut *instance });
+        true
+    }
+
+    fn arm_connect(&self, pool: &InstancePool, instance: &mut PipeInstance) {
+        instance.state = InstanceState::Connecting;
+        instance.reset_connection();
+        instance.reset_overlapped();
+        instance.listen_started = Instant::now();
+
+        //  debug!("等待客户端连接...");
+
+        let result = unsafe { ConnectNamedPipe(instance.handle, Some(&mut instance.overlapped)) };
+
+        if let Err(e) = result {
+            if is_error(&e, ERROR_PIPE_CONNECTED) {
+                // 客户端在创建与等待之间已连接，不会产生完成包，需要手动投递
+                let posted = unsafe {
+                    PostQueuedCompletionStatus(pool.port, 0, 0, Some(&instance.overlapped))
+                };
+                if posted.is_err() {
+                    error!("投递管道连接完成包失败: {:?}", posted);
+                    pool.listening.fetch_sub(1, Ordering::SeqCst);
+                    self.close_instance(pool, instance);
+                }
+            } else if !is_error(&e, ERROR_IO_PENDING) {
+                error!("连接命名管道失败: {:?}", e);
+                pool.listening.fetch_sub(1, Ordering::SeqCst);
+                self.close_instance(pool, instance);
+            }
         }
+    }
 
-        info!("管道服务已停止");
+    /// 客户端断开后复用实例继续监听；空闲实例已足够时直接关闭
+    fn recycle_instance(&self, pool: &InstancePool, instance: &mut PipeInstance) {
+        unsafe {
+            let _ = DisconnectNamedPipe(instance.handle);
+        }
+
+        if self.is_running() && pool.listening.load(Ordering::SeqCst) < PENDING_INSTANCES {
+            pool.listening.fetch_add(1, Ordering::SeqCst);
+            self.arm_connect(pool, instance);
+        } else {
+            self.close_instance(pool, instance);
+        }
     }
 
-    fn handle_request(&self, request_data: &str) -> PipeResponse {
-        let request: PipeRequest = match serde_json::from_str(request_data) {
-            Ok(r) => r,
-            Err(e) => {
-                error!("解析请求失败: {}", e);
-                return PipeResponse::error(&format!("JSON格式错误: {}", e));
+    fn close_instance(&self, pool: &InstancePool, instance: &mut PipeInstance) {
+        let address = instance as *mut PipeInstance as usize;
+        pool.instances.lock().unwrap().remove(&address);
+
+        unsafe {
+            let instance = Box::from_raw(address as *mut PipeInstance);
+            let _ = CloseHandle(instance.handle);
+        }
+    }
+
+    /// 工作线程退出后，除挂起的订阅外每个实例各有一个未完成的 I/O；关闭句柄并等待取消完成后再释放
+    fn shutdown_instances(&self, pool: &InstancePool) {
+        let addresses: Vec<usize> = pool.instances.lock().unwrap().drain().collect();
+        // 挂起中的订阅没有未完成的 I/O，不会产生完成包
+        let parked = pool.parked.lock().unwrap().drain(..).count();
+        let pending = addresses.len() - parked;
+
+        for &address in &addresses {
+            let instance = unsafe { &*(address as *const PipeInstance) };
+            unsafe {
+                let _ = CancelIoEx(instance.handle, None);
+                let _ = DisconnectNamedPipe(instance.handle);
+                let _ = CloseHandle(instance.handle);
             }
-        };
+        }
 
-        //  info!("正在处理请求类型: {}", request.request_type);
+        let mut drained = 0;
+        while drained < pending {
+            let mut bytes_transferred: u32 = 0;
+            let mut completion_key: usize = 0;
+            let mut overlapped: *mut OVERLAPPED = std::ptr::null_mut();
+            let _ = unsafe {
+                GetQueuedCompletionStatus(
+                    pool.port,
+                    &mut bytes_transferred,
+                    &mut completion_key,
+                    &mut overlapped,
+                    SHUTDOWN_DRAIN_TIMEOUT_MS,
+                )
+            };
+            if overlapped.is_null() {
+                break;
+            }
+            drained += 1;
+        }
+
+        if drained == pending {
+            for address in addresses {
+                unsafe {
+                    drop(Box::from_raw(address as *mut PipeInstance));
+                }
+            }
+        } else {
+            warn!(
+                "仍有 {} 个管道 I/O 未完成, 跳过释放实例内存",
+                pending - drained
+            );
+        }
+
+        unsafe {
+            let _ = CloseHandle(pool.port);
+        }
+    }
 
+    fn dispatch_request(&self, request: &PipeRequest) -> PipeResponse {
+        let started = Instant::now();
+        let response = self.route_request(request);
+        metrics().record_request(&request.request_type, started.elapsed(), response.success);
+        response
+    }
+
+    fn route_request(&self, request: &PipeRequest) -> PipeResponse {
         match request.request_type.as_str() {
-            "heartbeat" => self.handle_heartbeat(&request),
-            "add" => self.handle_add(&request),
-            "update" => self.handle_update(&request),
-            "remove" => self.handle_remove(&request),
-            "pause" => self.handle_pause(&request),
-            "stop" => self.handle_stop(&request),
-            "start" => self.handle_start(&request),
+            "heartbeat" => self.handle_heartbeat(request),
+            "heartbeat_batch" => self.handle_heartbeat_batch(request),
+            "ready" => self.handle_ready(request),
+            "add" => self.handle_add(request),
+            "update" => self.handle_update(request),
+            "remove" => self.handle_remove(request),
+            "batch" => self.handle_batch(request),
+            "pause" => self.handle_pause(request),
+            "stop" => self.handle_stop(request),
+            "start" => self.handle_start(request),
             "list" => self.handle_list(),
             "status" => self.handle_status(),
+            "metrics" => {
+                let mut data = metrics().to_json();
+                data["gauges"] = self.guardian.gauge_stats();
+                PipeResponse::success_with_data("运行指标", data)
+            }
+            // 一次性连接不能挂起，总是立即返回
+            SUBSCRIBE_REQUEST_TYPE => match self.poll_subscription(request) {
+                SubscribeOutcome::Reply(response) => response,
+                SubscribeOutcome::Wait(wait) => self.subscription_events(wait.since),
+            },
             _ => PipeResponse::error(&format!("未知的请求类型: {}", request.request_type)),
         }
     }
 
+    /// 处理二进制报文，返回响应报文；报文无法解析时返回不带 FLAG_OK 的错误响应
+    fn handle_wire_request(&self, payload: &[u8]) -> Vec<u8> {
+        let mut reply = Vec::new();
+
+        let (header, body) = match WireHeader::decode(payload) {
+            Ok(decoded) => decoded,
+            Err(e) => {
+                error!("二进制报文无效: {}", e);
+                WireHeader::reply(&WireHeader::new(0), false).encode(&mut reply);
+                put_str(&mut reply, &e.to_string());
+                return reply;
+            }
+        };
+
+        let started = Instant::now();
+        let mut body_out = Vec::new();
+        // 按 ID 的心跳在响应的 item_index 中返回句柄，客户端之后可改用句柄
+        let mut reply_index = header.item_index;
+        let extended = header.flags & FLAG_EXTENDED != 0;
+        let result = match header.opcode {
+            OP_HEARTBEAT => self
+                .wire_heartbeat(&header, body)
+                .map(|handle| reply_index = handle),
+            OP_HEARTBEAT_BATCH => self.wire_heartbeat_batch(&header, body, &mut body_out),
+            OP_STATUS => {
+                encode_status(&self.guardian.status_snapshot(), extended, &mut body_out);
+                Ok(())
+            }
+            opcode => Err(format!("未知的二进制操作码: 0x{:02X}", opcode)),
+        };
+        let request_type = match header.opcode {
+            OP_HEARTBEAT => "wire_heartbeat",
+            OP_HEARTBEAT_BATCH => "wire_heartbeat_batch",
+            OP_STATUS => "wire_status",
+            _ => "other",
+        };
+        metrics().record_request(request_type, started.elapsed(), result.is_ok());
+
+        match result {
+            Ok(()) => {
+                let mut reply_header = WireHeader::reply(&header, true);
+                reply_header.item_index = reply_index;
+                if header.opcode == OP_STATUS && extended {
+                    reply_header.flags |= FLAG_EXTENDED;
+                }
+                reply_header.encode(&mut reply);
+                reply.extend_from_slice(&body_out);
+            }
+            Err(message) => {
+                WireHeader::reply(&header, false).encode(&mut reply);
+                put_str(&mut reply, &message);
+            }
+        }
+        reply
+    }
+
+    /// item_index 非 0 时按句柄更新（带 FLAG_EPOCH 时负载为 u64 epoch），否则负载为监控项 ID；
+    /// 返回监控项的句柄
+    fn wire_heartbeat(&self, header: &WireHeader, body: &[u8]) -> Result<u32, String> {
+        let age = age_from_timestamp((header.timestamp != 0).then_some(header.timestamp));
+
+        if header.item_index != 0 {
+            self.check_handle_epoch(wire_epoch(header, &mut WireReader::new(body))?)?;
+            if self
+                .guardian
+                .update_heartbeat_by_handle(header.item_index, age)
+            {
+                return Ok(header.item_index);
+            }
+            error!("心跳更新失败, 未找到句柄: {}", header.item_index);
+            return Err("未找到监控项".to_string());
+        }
+
+        let item_id =
+            std::str::from_utf8(body).map_err(|_| "item_id 不是有效的 UTF-8".to_string())?;
+        if self.guardian.update_heartbeat_aged(item_id, age) {
+            Ok(self.guardian.item_handle(item_id))
+        } else {
+            error!("心跳更新失败, 未找到监控项: {}", item_id);
+            Err("未找到监控项".to_string())
+        }
+    }
+
+    /// 负载为 ID 字符串列表，带 FLAG_HANDLES 时为 u32 句柄列表（带 FLAG_EPOCH 时以 u64 epoch 开头）；
+    /// 响应负载为未找到的 ID 或句柄
+    fn wire_heartbeat_batch(
+        &self,
+        header: &WireHeader,
+        body: &[u8],
+        out: &mut Vec<u8>,
+    ) -> Result<(), String> {
+        let age = age_from_timestamp((header.timestamp != 0).then_some(header.timestamp));
+        let mut reader = WireReader::new(body);
+
+        if header.flags & FLAG_HANDLES != 0 {
+            self.check_handle_epoch(wire_epoch(header, &mut reader)?)?;
+            let mut handles = Vec::new();
+            while !reader.is_empty() {
+                handles.push(reader.read_u32().map_err(|e| e.to_string())?);
+            }
+
+            let unknown = self
+                .guardian
+                .update_heartbeat_batch_by_handle(handles.into_iter().map(|h| (h, age)));
+            if !unknown.is_empty() {
+                error!("批量心跳中有 {} 个句柄未找到: {:?}", unknown.len(), unknown);
+            }
+            for handle in unknown {
+                out.extend_from_slice(&handle.to_le_bytes());
+            }
+            return Ok(());
+        }
+
+        let mut item_ids = Vec::new();
+        while !reader.is_empty() {
+            item_ids.push(reader.read_str().map_err(|e| e.to_string())?);
+        }
+
+        let unknown = self
+            .guardian
+            .update_heartbeat_batch(item_ids.into_iter().map(|id| (id, age)));
+        if !unknown.is_empty() {
+            error!(
+                "批量心跳中有 {} 个监控项未找到: {:?}",
+                unknown.len(),
+                unknown
+            );
+        }
+        for item_id in &unknown {
+            put_str(out, item_id);
+        }
+        Ok(())
+    }
+
     fn handle_heartbeat(&self, request: &PipeRequest) -> PipeResponse {
         if let Some(item_id) = &request.item_id {
             if self.guardian.update_heartbeat(item_id) {
                 //    debug!("监控项心跳已更新: {}", item_id);
+                if let Some(gauges) = &request.gauges {
+                    let dropped = self.guardian.record_gauges(item_id, gauges);
+                    log_dropped_gauges(item_id, dropped);
+                }
                 PipeResponse::success("心跳已更新")
             } else {
                 error!("心跳更新失败, 未找到监控项: {}", item_id);
                 PipeResponse::error("未找到监控项")
             }
+        } else if let Some(handle) = request.handle {
+            if let Err(message) = self.check_handle_epoch(request.epoch) {
+                return PipeResponse::error(&message);
+            }
+            let age = age_from_timestamp(request.timestamp);
+            if self.guardian.update_heartbeat_by_handle(handle, age) {
+                if let Some(gauges) = &request.gauges {
+                    let dropped = self.guardian.record_gauges_by_handle(handle, gauges);
+                    log_dropped_gauges(&handle.to_string(), dropped);
+                }
+                PipeResponse::success("心跳已更新")
+            } else {
+                error!("心跳更新失败, 未找到句柄: {}", handle);
+                PipeResponse::error("未找到监控项")
+            }
         } else {
             PipeResponse::error("缺少item_id")
         }
     }
 
+    /// 进程启动完成；备用实例收到 role 为 standby，提升后再次发送才会收到 active
+    fn handle_ready(&self, request: &PipeRequest) -> PipeResponse {
+        let item_id = match &request.item_id {
+            Some(item_id) => item_id,
+            None => return PipeResponse::error("缺少item_id"),
+        };
+
+        match self.guardian.mark_ready(item_id, request.process_id) {
+            Some(role) => PipeResponse::success_with_data(
+                "就绪状态已更新",
+                serde_json::json!({ "role": role }),
+            ),
+            None => {
+                error!(
+                    "就绪通知失败, 未找到监控项或进程不属于该监控项: {} (PID: {:?})",
+                    item_id, request.process_id
+                );
+                PipeResponse::error("未找到监控项或进程不属于该监控项")
+            }
+        }
+    }
+
+    fn handle_heartbeat_batch(&self, request: &PipeRequest) -> PipeResponse {
+        let item_ids = match (&request.item_ids, &request.handles) {
+            (Some(item_ids), _) => item_ids,
+            (None, Some(handles)) => {
+                return self.handle_heartbeat_batch_by_handle(request, handles)
+            }
+            (None, None) => return PipeResponse::error("缺少item_ids"),
+        };
+
+        if let Some(timestamps) = &request.timestamps {
+            if timestamps.len() != item_ids.len() {
+                return PipeResponse::error("timestamps 与 item_ids 数量不一致");
+            }
+        }
+
+        let timestamps = request.timestamps.as_deref();
+        let unknown = self
+            .guardian
+            .update_heartbeat_batch(item_ids.iter().enumerate().map(|(index, item_id)| {
+                let timestamp = timestamps.map(|ts| ts[index]).or(request.timestamp);
+                (item_id.as_str(), age_from_timestamp(timestamp))
+            }));
+
+        if !unknown.is_empty() {
+            error!(
+                "批量心跳中有 {} 个监控项未找到: {:?}",
+                unknown.len(),
+                unknown
+            );
+        }
+
+        PipeResponse::success_with_data(
+            "心跳已批量更新",
+            serde_json::json!({
+                "updated": item_ids.len() - unknown.len(),
+                "unknown": unknown,
+            }),
+        )
+    }
+
+    fn handle_heartbeat_batch_by_handle(
+        &self,
+        request: &PipeRequest,
+        handles: &[u32],
+    ) -> PipeResponse {
+        if let Err(message) = self.check_handle_epoch(request.epoch) {
+            return PipeResponse::error(&message);
+        }
+        let age = age_from_timestamp(request.timestamp);
+        let unknown = self
+            .guardian
+            .update_heartbeat_batch_by_handle(handles.iter().map(|handle| (*handle, age)));
+
+        if !unknown.is_empty() {
+            error!("批量心跳中有 {} 个句柄未找到: {:?}", unknown.len(), unknown);
+        }
+
+        PipeResponse::success_with_data(
+            "心跳已批量更新",
+            serde_json::json!({
+                "updated": handles.len() - unknown.len(),
+                "unknown_handles": unknown,
+            }),
+        )
+    }
+
     fn handle_add(&self, request: &PipeRequest) -> PipeResponse {
         if let Some(config) = &request.config {
             info!("正在添加监控项: {} ({})", config.name, config.exe_path);
@@ -212,10 +1021,7 @@ impl PipeServer {
 
             cfg.items.push(config.clone());
 
-            if let Err(e) = crate::config::save_config(&cfg) {
-                error!("保存配置失败: {}", e);
-                return PipeResponse::error(&format!("保存配置失败: {}", e));
-            }
+            self.guardian.persist_config();
 
             drop(cfg);
 
@@ -225,8 +1031,17 @@ impl PipeServer {
             };
             self.guardian.add_change(change);
 
+            // 句柄在添加时就分配，进程启动前即可返回给客户端
+            let handle = self.guardian.item_handle(&config.id);
+
             info!("监控项添加成功: {} ({})", config.name, config.id);
-            PipeResponse::success("监控项已添加")
+            PipeResponse::success_with_data(
+                "监控项已添加",
+                serde_json::json!({
+                    "handle": handle,
+                    "epoch": self.guardian.status_events().epoch(),
+                }),
+            )
         } else {
             PipeResponse::error("缺少配置")
         }
@@ -242,10 +1057,7 @@ impl PipeServer {
             if let Some(existing) = cfg.items.iter_mut().find(|i| i.id == config.id) {
                 *existing = config.clone();
 
-                if let Err(e) = crate::config::save_config(&cfg) {
-                    error!("保存配置失败: {}", e);
-                    return PipeResponse::error(&format!("保存配置失败: {}", e));
-                }
+                self.guardian.persist_config();
 
                 drop(cfg);
 
@@ -278,10 +1090,7 @@ impl PipeServer {
             if let Some(item) = item {
                 cfg.items.retain(|i| &i.id != id);
 
-                if let Err(e) = crate::config::save_config(&cfg) {
-                    error!("保存配置失败: {}", e);
-                    return PipeResponse::error(&format!("保存配置失败: {}", e));
-                }
+                self.guardian.persist_config();
 
                 drop(cfg);
 
@@ -302,6 +1111,59 @@ impl PipeServer {
         }
     }
 
+    /// 在一次配置加锁内校验并应用整批添加、更新与移除，只触发一次配置保存；
+    /// 任何一项校验失败时整批不生效，错误列表在 data.errors 中返回
+    fn handle_batch(&self, request: &PipeRequest) -> PipeResponse {
+        let items = request.items.as_deref().unwrap_or(&[]);
+        let remove_ids = request.remove_ids.as_deref().unwrap_or(&[]);
+        if items.is_empty() && remove_ids.is_empty() {
+            return PipeResponse::error("缺少 items 或 remove_ids");
+        }
+
+        info!(
+            "正在批量应用监控项: 添加或更新 {} 个, 移除 {} 个",
+            items.len(),
+            remove_ids.len()
+        );
+
+        let config_arc = self.guardian.get_config();
+        let mut cfg = config_arc.lock().unwrap();
+
+        let outcome = match crate::config::apply_batch(&mut cfg, items, remove_ids) {
+            Ok(outcome) => outcome,
+            Err(errors) => {
+                error!("批量操作校验失败: {:?}", errors);
+                return PipeResponse {
+                    data: Some(serde_json::json!({ "errors": errors })),
+                    ..PipeResponse::error(&format!("批量操作校验失败: {}", errors[0]))
+                };
+            }
+        };
+        self.guardian.persist_config();
+        drop(cfg);
+
+        self.guardian.add_changes(outcome.changes);
+        let handles: Vec<u32> = items
+            .iter()
+            .map(|item| self.guardian.item_handle(&item.id))
+            .collect();
+
+        info!(
+            "批量操作完成: 添加 {} 个, 更新 {} 个, 移除 {} 个",
+            outcome.added, outcome.updated, outcome.removed
+        );
+        PipeResponse::success_with_data(
+            "批量操作已完成",
+            serde_json::json!({
+                "added": outcome.added,
+                "updated": outcome.updated,
+                "removed": outcome.removed,
+                "handles": handles,
+                "epoch": self.guardian.status_events().epoch(),
+            }),
+        )
+    }
+
     fn handle_stop(&self, request: &PipeRequest) -> PipeResponse {
         if let Some(id) = &request.id {
             info!("正在停止监控项: {}", id);
@@ -389,10 +1251,74 @@ impl PipeServer {
 
         let config_arc = self.guardian.get_config();
         let cfg = config_arc.lock().unwrap();
-        let items = serde_json::to_value(&cfg.items).unwrap_or(serde_json::json!([]));
+        let epoch = self.guardian.status_events().epoch();
+        let items: Vec<serde_json::Value> = cfg
+            .items
+            .iter()
+            .map(|item| {
+                let mut value = serde_json::to_value(item).unwrap_or(serde_json::json!({}));
+                if let Some(object) = value.as_object_mut() {
+                    object.insert(
+                        "handle".to_string(),
+                        serde_json::json!(self.guardian.item_handle(&item.id)),
+                    );
+                    object.insert("epoch".to_string(), serde_json::json!(epoch));
+                }
+                value
+            })
+            .collect();
 
         debug!("找到 {} 个监控项", cfg.items.len());
-        PipeResponse::success_with_data("监控项列表", items)
+        PipeResponse::success_with_data("监控项列表", serde_json::Value::Array(items))
+    }
+
+    /// 无法给出增量时返回快照；有新事件或 wait_ms 为 0 时立即返回增量，否则挂起等待
+    fn poll_subscription(&self, request: &PipeRequest) -> SubscribeOutcome {
+        let events = self.guardian.status_events();
+        let since = request.since_version.unwrap_or(0);
+
+        // 先取版本号再取快照，快照之后发生的事件会在下一次订阅中返回
+        let version = events.version();
+        let delta = match events.since(request.epoch.unwrap_or(0), since) {
+            Some(delta) => delta,
+            None => {
+                return SubscribeOutcome::Reply(PipeResponse::success_with_data(
+                    "状态快照",
+                    serde_json::json!({
+                        "epoch": events.epoch(),
+                        "version": version,
+                        "snapshot": true,
+                        "items": self.guardian.status_snapshot(),
+                    }),
+                ))
+            }
+        };
+
+        let wait_ms = request.wait_ms.unwrap_or(0).min(SUBSCRIBE_MAX_WAIT_MS);
+        if !delta.is_empty() || wait_ms == 0 {
+            return SubscribeOutcome::Reply(self.subscription_events(since));
+        }
+
+        SubscribeOutcome::Wait(SubscriptionWait {
+            since,
+            deadline: Instant::now() + Duration::from_millis(wait_ms),
+        })
+    }
+
+    fn subscription_events(&self, since: u64) -> PipeResponse {
+        let events = self.guardian.status_events();
+        let version = events.version();
+        let delta = events.since(events.epoch(), since).unwrap_or_default();
+
+        PipeResponse::success_with_data(
+            "状态事件",
+            serde_json::json!({
+                "epoch": events.epoch(),
+                "version": version,
+                "snapshot": false,
+                "events": delta,
+            }),
+        )
     }
 
     fn handle_status(&self) -> PipeResponse {
@@ -401,4 +1327,38 @@ impl PipeServer {
         let status = self.guardian.get_status();
         PipeResponse::success_with_data("服务状态", status)
     }
+
+    /// 句柄只在分配它的那次服务运行中有效，服务重启后同一数字可能属于另一个监控项；
+    /// 请求带的 epoch 与本次运行不一致时拒绝。未带 epoch 的旧客户端不检查
+    fn check_handle_epoch(&self, epoch: Option<u64>) -> Result<(), String> {
+        match epoch {
+            Some(epoch) if epoch != self.guardian.status_events().epoch() => {
+                error!("句柄来自服务的上一次运行 (epoch {}), 已拒绝", epoch);
+                Err("句柄已失效, 请重新获取".to_string())
+            }
+            _ => Ok(()),
+        }
+    }
+}
+
+/// 带 FLAG_EPOCH 时从负载开头读取 epoch
+fn wire_epoch(header: &WireHeader, reader: &mut WireReader) -> Result<Option<u64>, String> {
+    if header.flags & FLAG_EPOCH == 0 {
+        return Ok(None);
+    }
+    reader.read_u64().map(Some).map_err(|e| e.to_string())
+}
+
+fn parse_request(request_data: &str) -> Result<PipeRequest, PipeResponse> {
+    serde_json::from_str(request_data).map_err(|e| {
+        error!("解析请求失败: {}", e);
+        PipeResponse::error(&format!("JSON格式错误: {}", e))
+    })
+}
+
+/// `dropped` 为 None 表示监控项在更新心跳之后已被移除，指标未记录
+fn log_dropped_gauges(target: &str, dropped: Option<usize>) {
+    if let Some(dropped) = dropped.filter(|dropped| *dropped > 0) {
+        warn!("监控项 {} 的心跳中有 {} 个指标被丢弃", target, dropped);
+    }
 }
@@ -0,0 +1,251 @@
+use crate::system_snapshot::{SnapshotBuffer, SystemSnapshot};
+use log::debug;
+use std::collections::HashMap;
+use windows::core::PWSTR;
+use windows::Win32::Foundation::{CloseHandle, MAX_PATH};
+use windows::Win32::System::Threading::{
+    OpenProcess, QueryFullProcessImageNameW, PROCESS_NAME_WIN32, PROCESS_QUERY_LIMITED_INFORMATION,
+};
+
+/// 快照中的一个进程：PID、映像文件名（不含目录）与创建时间
+pub struct SnapshotEntry {
+    pub process_id: u32,
+    pub exe_name: String,
+    pub create_time: u64,
+}
+
+struct IndexEntry {
+    /// 快照中的映像文件名与创建时间，与新快照不一致说明 PID 已被复用
+    exe_name: String,
+    create_time: u64,
+    /// 小写的完整映像路径；无权限打开的进程为 None，同样缓存以免每次刷新都重试
+    path: Option<String>,
+}
+
+/// PID 到映像路径的缓存索引。
+/// 每次刷新只遍历一次进程快照，只有新出现（或 PID 被复用）的进程才会打开句柄查询路径，
+/// 之后多个监控项的路径查找都在同一份快照上完成。
+#[derive(Default)]
+pub struct ProcessPathIndex {
+    entries: HashMap<u32, IndexEntry>,
+    /// 最近一次快照的进程顺序，查找时按快照顺序返回第一个匹配者
+    order: Vec<u32>,
+    buffer: SnapshotBuffer,
+}
+
+impl ProcessPathIndex {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// 用系统当前的进程快照刷新索引；快照失败时保留原有内容并返回 false
+    pub fn refresh(&mut self) -> bool {
+        match SystemSnapshot::capture(&mut self.buffer) {
+            Some(snapshot) => {
+                self.refresh_from(&snapshot);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// 用已有的系统快照刷新索引，不再单独查询进程列表
+    pub fn refresh_from(&mut self, snapshot: &SystemSnapshot) {
+        let entries = snapshot
+            .processes()
+            .iter()
+            .map(|process| SnapshotEntry {
+                process_id: process.process_id,
+                exe_name: process.image_name.clone(),
+                create_time: process.create_time,
+            })
+            .collect();
+        self.apply_snapshot(entries, query_image_path);
+    }
+
+    fn apply_snapshot<F>(&mut self, snapshot: Vec<SnapshotEntry>, mut query_path: F)
+    where
+        F: FnMut(u32) -> Option<String>,
+    {
+        let mut entries = HashMap::with_capacity(snapshot.len());
+        let mut order = Vec::with_capacity(snapshot.len());
+        let mut queried = 0usize;
+
+        for process in snapshot {
+            let entry = match self.entries.remove(&process.process_id) {
+                Some(entry)
+                    if entry.exe_name == process.exe_name
+                        && entry.create_time == process.create_time =>
+                {
+                    entry
+                }
+                _ => {
+                    queried += 1;
+                    IndexEntry {
+                        path: query_path(process.process_id).map(|p| p.to_lowercase()),
+                        exe_name: process.exe_name,
+                        create_time: process.create_time,
+                    }
+                }
+            };
+            order.push(process.process_id);
+            entries.insert(process.process_id, entry);
+        }
+
+        debug!(
+            "进程路径索引已刷新: {} 个进程, 新查询 {} 个",
+            order.len(),
+            queried
+        );
+        self.entries = entries;
+        self.order = order;
+    }
+
+    /// 在最近一次快照中查找映像路径匹配（不区分大小写）的进程
+    pub fn find(&self, exe_path: &str) -> Option<u32> {
+        let target = exe_path.to_lowercase();
+        self.order
+            .iter()
+            .copied()
+            .find(|&pid| self.path_of(pid) == Some(target.as_str()))
+    }
+
+    /// 一次查找多个路径，结果与输入一一对应；每个进程最多匹配一个路径，
+    /// 多个监控项使用同一程序时各自复用不同的进程
+    pub fn find_many(&self, exe_paths: &[&str]) -> Vec<Option<u32>> {
+        let targets: Vec<String> = exe_paths.iter().map(|p| p.to_lowercase()).collect();
+        let mut found = vec![None; targets.len()];
+        let mut remaining = targets.len();
+
+        for pid in &self.order {
+            if remaining == 0 {
+                break;
+            }
+            if let Some(path) = self.path_of(*pid) {
+                if let Some(slot) = found
+                    .iter_mut()
+                    .zip(&targets)
+                    .find(|(slot, target)| slot.is_none() && path == target.as_str())
+                    .map(|(slot, _)| slot)
+                {
+                    *slot = Some(*pid);
+                    remaining -= 1;
+                }
+            }
+        }
+        found
+    }
+
+    /// 最近一次快照中进程的创建时间，用于之后识别 PID 复用
+    pub fn create_time(&self, process_id: u32) -> Option<u64> {
+        self.entries.get(&process_id).map(|entry| entry.create_time)
+    }
+
+    fn path_of(&self, process_id: u32) -> Option<&str> {
+        self.entries
+            .get(&process_id)
+            .and_then(|entry| entry.path.as_deref())
+    }
+}
+
+/// PROCESS_QUERY_LIMITED_INFORMATION 对大多数其他会话与受保护进程也能打开，且不需要读取目标进程内存
+fn query_image_path(process_id: u32) -> Option<String> {
+    if process_id == 0 {
+        return None;
+    }
+
+    unsafe {
+        let handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, process_id).ok()?;
+        if handle.is_invalid() {
+            return None;
+        }
+
+        let mut buffer = [0u16; MAX_PATH as usize];
+        let mut len = buffer.len() as u32;
+        let result = QueryFullProcessImageNameW(
+            handle,
+            PROCESS_NAME_WIN32,
+            PWSTR(buffer.as_mut_ptr()),
+            &mut len,
+        );
+        let _ = CloseHandle(handle);
+
+        if result.is_ok() && len > 0 {
+            Some(String::from_utf16_lossy(&buffer[..len as usize]))
+        } else {
+            None
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{ProcessPathIndex, SnapshotEntry};
+    use std::cell::RefCell;
+
+    fn snapshot(processes: &[(u32, &str)]) -> Vec<SnapshotEntry> {
+        processes
+            .iter()
+            .map(|&(process_id, exe_name)| SnapshotEntry {
+                process_id,
+                exe_name: exe_name.to_string(),
+                create_time: process_id as u64,
+            })
+            .collect()
+    }
+
+    #[test]
+    fn queries_only_new_or_reused_pids() {
+        let queried = RefCell::new(Vec::new());
+        let query = |pid: u32| {
+            queried.borrow_mut().push(pid);
+            match pid {
+                4 => None,
+                _ => Some(format!("C:\\Apps\\App{}.exe", pid)),
+            }
+        };
+
+        let mut index = ProcessPathIndex::new();
+        index.apply_snapshot(snapshot(&[(4, "System"), (100, "App100.exe")]), query);
+        assert_eq!(*queried.borrow(), vec![4, 100]);
+
+        // 100 不变、200 是新进程、4 的映像名变化视为 PID 复用
+        queried.borrow_mut().clear();
+        index.apply_snapshot(
+            snapshot(&[(4, "Other.exe"), (100, "App100.exe"), (200, "App200.exe")]),
+            |pid| {
+                queried.borrow_mut().push(pid);
+                Some(format!("C:\\Apps\\App{}.exe", pid))
+            },
+        );
+        assert_eq!(*queried.borrow(), vec![4, 200]);
+        assert_eq!(index.find("c:\\apps\\APP200.EXE"), Some(200));
+    }
+
+    #[test]
+    fn finds_many_paths_from_one_snapshot_and_drops_exited_processes() {
+        let mut index = ProcessPathIndex::new();
+        index.apply_snapshot(
+            snapshot(&[(10, "a.exe"), (11, "b.exe"), (12, "a.exe")]),
+            |pid| match pid {
+                11 => Some("C:\\B\\b.exe".to_string()),
+                _ => Some("C:\\A\\a.exe".to_string()),
+            },
+        );
+
+        assert_eq!(
+            index.find_many(&["C:\\A\\a.exe", "C:\\missing.exe", "C:\\B\\B.exe"]),
+            vec![Some(10), None, Some(11)]
+        );
+
+        // 两个监控项使用同一程序时分别复用 10 和 12，第三个需要新启动
+        assert_eq!(
+            index.find_many(&["C:\\A\\a.exe", "C:\\A\\a.exe", "C:\\A\\a.exe"]),
+            vec![Some(10), Some(12), None]
+        );
+
+        index.apply_snapshot(snapshot(&[(12, "a.exe")]), |_| None);
+        assert_eq!(index.find("C:\\A\\a.exe"), Some(12));
+        assert_eq!(index.find("C:\\B\\b.exe"), None);
+    }
+}
@@ -0,0 +1,193 @@
+use crate::job_object::JobAccounting;
+use crate::resource_watch::ResourceSample;
+use crate::session0::ProcessHandle;
+use log::{debug, error};
+use std::collections::VecDeque;
+use std::sync::{Arc, Condvar, Mutex};
+use std::time::Duration;
+use windows::Win32::Foundation::{BOOLEAN, HANDLE, INVALID_HANDLE_VALUE};
+use windows::Win32::System::Threading::{
+    RegisterWaitForSingleObject, UnregisterWaitEx, INFINITE, WT_EXECUTEONLYONCE,
+};
+
+/// 线程池回调报告的进程退出事件
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ProcessExit {
+    pub item_id: String,
+    pub process_id: u32,
+}
+
+/// 收集被监控进程的退出通知。
+/// 每个进程通过 RegisterWaitForSingleObject 在系统线程池上等待，退出时回调写入队列并唤醒守护线程，
+/// 不需要守护线程轮询进程状态。
+#[derive(Default)]
+pub struct ProcessWatcher {
+    exits: Mutex<VecDeque<ProcessExit>>,
+    condvar: Condvar,
+}
+
+struct WaitContext {
+    watcher: Arc<ProcessWatcher>,
+    exit: ProcessExit,
+}
+
+/// 一个进程的句柄及其退出等待注册；释放时先注销等待（等待进行中的回调结束），再关闭句柄
+pub struct ProcessWatch {
+    process: ProcessHandle,
+    wait_handle: HANDLE,
+    context: *mut WaitContext,
+}
+
+// 等待句柄与回调上下文只在注册/注销时使用，注销会同步等待回调完成
+unsafe impl Send for ProcessWatch {}
+unsafe impl Sync for ProcessWatch {}
+
+impl std::fmt::Debug for ProcessWatch {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("ProcessWatch")
+            .field("process_id", &self.process.process_id())
+            .finish()
+    }
+}
+
+impl ProcessWatch {
+    pub fn process_id(&self) -> u32 {
+        self.process.process_id()
+    }
+
+    pub fn is_alive(&self) -> bool {
+        self.process.is_alive()
+    }
+
+    pub fn terminate(&self) -> bool {
+        self.process.terminate()
+    }
+
+    pub fn create_time(&self) -> Option<u64> {
+        self.process.create_time()
+    }
+
+    pub fn accounting(&self) -> Option<JobAccounting> {
+        self.process.accounting()
+    }
+
+    pub fn sample(&self) -> Option<ResourceSample> {
+        self.process.sample()
+    }
+}
+
+impl Drop for ProcessWatch {
+    fn drop(&mut self) {
+        unsafe {
+            // INVALID_HANDLE_VALUE: 阻塞直到已开始执行的回调返回，之后才能安全释放上下文
+            let _ = UnregisterWaitEx(self.wait_handle, INVALID_HANDLE_VALUE);
+            drop(Box::from_raw(self.context));
+        }
+    }
+}
+
+unsafe extern "system" fn on_process_exit(context: *mut std::ffi::c_void, _timed_out: BOOLEAN) {
+    let context = &*(context as *const WaitContext);
+    context.watcher.push(context.exit.clone());
+}
+
+impl ProcessWatcher {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// 注册进程退出等待，失败时返回 None，调用方退回到周期性存活检查
+    pub fn watch(self: &Arc<Self>, item_id: &str, process: ProcessHandle) -> Option<ProcessWatch> {
+        let context = Box::into_raw(Box::new(WaitContext {
+            watcher: self.clone(),
+            exit: ProcessExit {
+                item_id: item_id.to_string(),
+                process_id: process.process_id(),
+            },
+        }));
+
+        let mut wait_handle = HANDLE::default();
+        let result = unsafe {
+            RegisterWaitForSingleObject(
+                &mut wait_handle,
+                process.raw(),
+                Some(on_process_exit),
+                Some(context as *const std::ffi::c_void),
+                INFINITE,
+                WT_EXECUTEONLYONCE,
+            )
+        };
+
+        if let Err(e) = result {
+            error!(
+                "注册进程退出等待失败: {} (PID: {}), {:?}",
+                item_id,
+                process.process_id(),
+                e
+            );
+            unsafe {
+                drop(Box::from_raw(context));
+            }
+            return None;
+        }
+
+        debug!("已注册进程退出等待: {} (PID: {})", item_id, process.process_id());
+
+        Some(ProcessWatch {
+            process,
+            wait_handle,
+            context,
+        })
+    }
+
+    fn push(&self, exit: ProcessExit) {
+        let mut exits = self.exits.lock().unwrap();
+        exits.push_back(exit);
+        self.condvar.notify_all();
+    }
+
+    /// 等待退出事件，最多等待 `timeout`；返回期间到达的全部事件
+    pub fn wait_for_exits(&self, timeout: Duration) -> Vec<ProcessExit> {
+        let exits = self.exits.lock().unwrap();
+        let (mut exits, _) = self
+            .condvar
+            .wait_timeout_while(exits, timeout, |exits| exits.is_empty())
+            .unwrap();
+        exits.drain(..).collect()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{ProcessExit, ProcessWatcher};
+    use std::sync::Arc;
+    use std::time::Duration;
+
+    #[test]
+    fn wait_returns_queued_exits_in_order() {
+        let watcher = Arc::new(ProcessWatcher::new());
+        let first = ProcessExit {
+            item_id: "EnergyMonitor".to_string(),
+            process_id: 42,
+        };
+        let second = ProcessExit {
+            item_id: "Collector".to_string(),
+            process_id: 43,
+        };
+
+        let pusher = watcher.clone();
+        let (a, b) = (first.clone(), second.clone());
+        std::thread::spawn(move || {
+            pusher.push(a);
+            pusher.push(b);
+        })
+        .join()
+        .unwrap();
+
+        assert_eq!(
+            watcher.wait_for_exits(Duration::from_millis(10)),
+            vec![first, second]
+        );
+        assert!(watcher.wait_for_exits(Duration::from_millis(1)).is_empty());
+    }
+}
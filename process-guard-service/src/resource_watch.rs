@@ -0,0 +1,191 @@
+use serde::{Deserialize, Serialize};
+use std::sync::OnceLock;
+use std::time::{Duration, Instant};
+
+const BYTES_PER_MB: u64 = 1024 * 1024;
+
+fn default_cpu_sustain_ms() -> u64 {
+    60_000
+}
+
+/// 监控项的资源上限，超过任一上限时主动重启；各项缺省表示不限制
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct ResourceLimits {
+    /// 工作集上限（MB）
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_working_set_mb: Option<u64>,
+    /// 私有提交内存上限（MB）
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_private_mb: Option<u64>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_handles: Option<u32>,
+    /// CPU 占用上限，占全部逻辑处理器的百分比（与任务管理器一致）
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_cpu_percent: Option<u32>,
+    /// CPU 占用持续超过上限多久后重启（毫秒）
+    #[serde(default = "default_cpu_sustain_ms")]
+    pub cpu_sustain_ms: u64,
+}
+
+impl Default for ResourceLimits {
+    fn default() -> Self {
+        Self {
+            max_working_set_mb: None,
+            max_private_mb: None,
+            max_handles: None,
+            max_cpu_percent: None,
+            cpu_sustain_ms: default_cpu_sustain_ms(),
+        }
+    }
+}
+
+/// 逻辑处理器数，CPU 百分比的分母
+pub fn processor_count() -> u32 {
+    static COUNT: OnceLock<u32> = OnceLock::new();
+    *COUNT.get_or_init(|| {
+        std::thread::available_parallelism()
+            .map(|n| n.get() as u32)
+            .unwrap_or(1)
+    })
+}
+
+/// 一次资源采样，来自守护进程已持有的进程句柄
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ResourceSample {
+    pub working_set_bytes: u64,
+    pub private_bytes: u64,
+    pub handle_count: u32,
+    /// 累计 CPU 时间；进程在作业对象中时为整个进程树的时间
+    pub cpu_time_ms: u64,
+}
+
+/// 单个进程的资源检查状态，进程重启时重置
+#[derive(Debug, Clone, Default)]
+pub struct ResourceWatch {
+    last_cpu: Option<(Instant, u64)>,
+    cpu_over_since: Option<Instant>,
+}
+
+impl ResourceWatch {
+    /// 检查一次采样，超过上限时返回重启原因。CPU 占用按相邻两次采样计算，
+    /// 需要连续 `cpu_sustain_ms` 都超过上限才算超限
+    pub fn check(
+        &mut self,
+        limits: &ResourceLimits,
+        sample: &ResourceSample,
+        now: Instant,
+        processors: u32,
+    ) -> Option<String> {
+        if let Some(max_mb) = limits.max_working_set_mb {
+            if sample.working_set_bytes > max_mb * BYTES_PER_MB {
+                return Some(format!(
+                    "working set {} MB exceeds limit {} MB",
+                    sample.working_set_bytes / BYTES_PER_MB,
+                    max_mb
+                ));
+            }
+        }
+        if let Some(max_mb) = limits.max_private_mb {
+            if sample.private_bytes > max_mb * BYTES_PER_MB {
+                return Some(format!(
+                    "private bytes {} MB exceed limit {} MB",
+                    sample.private_bytes / BYTES_PER_MB,
+                    max_mb
+                ));
+            }
+        }
+        if let Some(max_handles) = limits.max_handles {
+            if sample.handle_count > max_handles {
+                return Some(format!(
+                    "handle count {} exceeds limit {}",
+                    sample.handle_count, max_handles
+                ));
+            }
+        }
+
+        let max_percent = limits.max_cpu_percent?;
+        let previous = self.last_cpu.replace((now, sample.cpu_time_ms));
+        let (at, cpu_ms) = previous?;
+        let wall_ms = now.duration_since(at).as_millis() as u64 * processors.max(1) as u64;
+        if wall_ms == 0 {
+            return None;
+        }
+
+        let percent = sample.cpu_time_ms.saturating_sub(cpu_ms) * 100 / wall_ms;
+        if percent <= max_percent as u64 {
+            self.cpu_over_since = None;
+            return None;
+        }
+
+        let since = *self.cpu_over_since.get_or_insert(at);
+        if now.duration_since(since) >= Duration::from_millis(limits.cpu_sustain_ms) {
+            return Some(format!(
+                "CPU {}% above limit {}% for {} s",
+                percent,
+                max_percent,
+                now.duration_since(since).as_secs()
+            ));
+        }
+        None
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{ResourceLimits, ResourceSample, ResourceWatch, BYTES_PER_MB};
+    use std::time::{Duration, Instant};
+
+    #[test]
+    fn memory_and_handle_limits_trip_immediately() {
+        let limits = ResourceLimits {
+            max_private_mb: Some(4096),
+            max_handles: Some(10_000),
+            ..ResourceLimits::default()
+        };
+        let mut watch = ResourceWatch::default();
+        let mut sample = ResourceSample {
+            private_bytes: 4096 * BYTES_PER_MB,
+            handle_count: 10_000,
+            ..ResourceSample::default()
+        };
+        let now = Instant::now();
+        assert_eq!(watch.check(&limits, &sample, now, 4), None);
+
+        sample.private_bytes += BYTES_PER_MB * 2;
+        assert_eq!(
+            watch.check(&limits, &sample, now, 4).as_deref(),
+            Some("private bytes 4098 MB exceed limit 4096 MB")
+        );
+
+        sample.private_bytes = 0;
+        sample.handle_count = 10_001;
+        assert!(watch.check(&limits, &sample, now, 4).is_some());
+    }
+
+    #[test]
+    fn cpu_limit_requires_sustained_overload() {
+        let limits = ResourceLimits {
+            max_cpu_percent: Some(50),
+            cpu_sustain_ms: 6_000,
+            ..ResourceLimits::default()
+        };
+        let mut watch = ResourceWatch::default();
+        let base = Instant::now();
+        let at = |secs: u64| base + Duration::from_secs(secs);
+        let busy = |cpu_ms: u64| ResourceSample {
+            cpu_time_ms: cpu_ms,
+            ..ResourceSample::default()
+        };
+
+        // 2 个处理器，每 3 秒消耗 4.5 秒 CPU 即 75%
+        assert_eq!(watch.check(&limits, &busy(0), at(0), 2), None);
+        assert_eq!(watch.check(&limits, &busy(4_500), at(3), 2), None);
+        // 中途一次低于上限会重新计时
+        assert_eq!(watch.check(&limits, &busy(5_000), at(6), 2), None);
+        assert_eq!(watch.check(&limits, &busy(9_500), at(9), 2), None);
+        assert_eq!(
+            watch.check(&limits, &busy(14_000), at(12), 2).as_deref(),
+            Some("CPU 75% above limit 50% for 6 s")
+        );
+    }
+}
@@ -0,0 +1,142 @@
+use log::{error, info};
+use std::collections::VecDeque;
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+
+type Job = Box<dyn FnOnce() + Send + 'static>;
+
+#[derive(Default)]
+struct JobQueue {
+    jobs: VecDeque<Job>,
+    shutdown: bool,
+}
+
+#[derive(Default)]
+struct Shared {
+    queue: Mutex<JobQueue>,
+    condvar: Condvar,
+}
+
+/// 固定线程数的重启执行器。
+/// 终止旧进程与 CreateProcessAsUserW 可能耗时数百毫秒，放到这里并行执行，
+/// 线程数即同时进行的重启上限，守护线程只负责判断健康状态并提交任务。
+pub struct RestartExecutor {
+    shared: Arc<Shared>,
+    workers: Mutex<Vec<JoinHandle<()>>>,
+}
+
+impl RestartExecutor {
+    pub fn new(concurrency: usize) -> Self {
+        let concurrency = concurrency.max(1);
+        let shared = Arc::new(Shared::default());
+        let mut workers = Vec::with_capacity(concurrency);
+
+        for index in 0..concurrency {
+            let shared_for_worker = shared.clone();
+            let spawn_result = std::thread::Builder::new()
+                .name(format!("restart-worker-{}", index))
+                .spawn(move || worker_loop(&shared_for_worker));
+            match spawn_result {
+                Ok(handle) => workers.push(handle),
+                Err(e) => error!("Failed to spawn restart worker: {}", e),
+            }
+        }
+
+        info!("Restart executor started with {} workers", workers.len());
+
+        Self {
+            shared,
+            workers: Mutex::new(workers),
+        }
+    }
+
+    /// 提交任务；执行器已停止时丢弃任务并返回 false
+    pub fn submit(&self, job: Job) -> bool {
+        let mut queue = self.shared.queue.lock().unwrap();
+        if queue.shutdown {
+            return false;
+        }
+        queue.jobs.push_back(job);
+        self.shared.condvar.notify_one();
+        true
+    }
+
+    /// 等待正在执行的任务完成后停止工作线程，尚未开始的任务被丢弃
+    pub fn shutdown(&self) {
+        let dropped = {
+            let mut queue = self.shared.queue.lock().unwrap();
+            queue.shutdown = true;
+            self.shared.condvar.notify_all();
+            queue.jobs.drain(..).count()
+        };
+
+        if dropped > 0 {
+            info!("Restart executor dropped {} queued jobs on shutdown", dropped);
+        }
+
+        let workers: Vec<JoinHandle<()>> = self.workers.lock().unwrap().drain(..).collect();
+        for worker in workers {
+            let _ = worker.join();
+        }
+    }
+}
+
+impl Drop for RestartExecutor {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
+}
+
+fn worker_loop(shared: &Shared) {
+    loop {
+        let job = {
+            let mut queue = shared.queue.lock().unwrap();
+            loop {
+                if queue.shutdown {
+                    return;
+                }
+                if let Some(job) = queue.jobs.pop_front() {
+                    break job;
+                }
+                queue = shared.condvar.wait(queue).unwrap();
+            }
+        };
+
+        job();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::RestartExecutor;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::{Arc, Barrier};
+
+    #[test]
+    fn runs_jobs_in_parallel_up_to_worker_count() {
+        let executor = RestartExecutor::new(3);
+        let barrier = Arc::new(Barrier::new(4));
+        let completed = Arc::new(AtomicUsize::new(0));
+
+        for _ in 0..3 {
+            let barrier = barrier.clone();
+            let completed = completed.clone();
+            assert!(executor.submit(Box::new(move || {
+                // 三个任务必须同时运行才能通过屏障
+                barrier.wait();
+                completed.fetch_add(1, Ordering::SeqCst);
+            })));
+        }
+
+        barrier.wait();
+        executor.shutdown();
+        assert_eq!(completed.load(Ordering::SeqCst), 3);
+    }
+
+    #[test]
+    fn rejects_jobs_after_shutdown() {
+        let executor = RestartExecutor::new(1);
+        executor.shutdown();
+        assert!(!executor.submit(Box::new(|| {})));
+    }
+}
@@ -1,18 +1,26 @@
-use log::{debug, error, info};
+use crate::job_object::{JobAccounting, ProcessJob};
+use crate::resource_watch::ResourceSample;
+use log::{debug, error, info, warn};
+use std::collections::HashMap;
 use std::ffi::OsStr;
 use std::os::windows::ffi::OsStrExt;
 use std::ptr;
+use std::sync::{Arc, Mutex, OnceLock};
 use windows::core::{PCWSTR, PWSTR};
-use windows::Win32::Foundation::{CloseHandle, HANDLE, HMODULE, MAX_PATH};
+use windows::Win32::Foundation::{CloseHandle, FILETIME, HANDLE, WAIT_TIMEOUT};
 use windows::Win32::Security::{
     GetTokenInformation, TokenElevation, TokenElevationType, TokenLinkedToken,
     TOKEN_ELEVATION, TOKEN_ELEVATION_TYPE, TOKEN_LINKED_TOKEN,
 };
+use windows::Win32::System::ProcessStatus::{
+    GetProcessMemoryInfo, PROCESS_MEMORY_COUNTERS, PROCESS_MEMORY_COUNTERS_EX,
+};
 use windows::Win32::System::Threading::{
-    CreateProcessAsUserW, GetExitCodeProcess, OpenProcess, TerminateProcess,
-    CREATE_NEW_CONSOLE, CREATE_NO_WINDOW, CREATE_UNICODE_ENVIRONMENT, NORMAL_PRIORITY_CLASS,
-    PROCESS_INFORMATION, PROCESS_QUERY_INFORMATION, PROCESS_TERMINATE,
-    STARTUPINFOW, STARTUPINFOW_FLAGS, PROCESS_VM_READ,
+    CreateProcessAsUserW, GetExitCodeProcess, GetProcessHandleCount, GetProcessTimes, OpenProcess, ResumeThread, TerminateProcess,
+    WaitForSingleObject, CREATE_NEW_CONSOLE, CREATE_NO_WINDOW, CREATE_SUSPENDED,
+    CREATE_UNICODE_ENVIRONMENT, NORMAL_PRIORITY_CLASS, PROCESS_INFORMATION,
+    PROCESS_QUERY_INFORMATION, PROCESS_QUERY_LIMITED_INFORMATION, PROCESS_SET_QUOTA,
+    PROCESS_SYNCHRONIZE, PROCESS_TERMINATE, STARTUPINFOW, STARTUPINFOW_FLAGS,
 };
 
 const MAXIMUM_ALLOWED: u32 = 0x02000000;
@@ -82,6 +90,7 @@ pub struct ProcessInfo {
     pub thread_id: u32,
     pub process_handle: HANDLE,
     pub thread_handle: HANDLE,
+    pub job: Option<ProcessJob>,
 }
 
 impl ProcessInfo {
@@ -91,6 +100,7 @@ impl ProcessInfo {
             thread_id: 0,
             process_handle: HANDLE::default(),
             thread_handle: HANDLE::default(),
+            job: None,
         }
     }
 }
@@ -108,6 +118,169 @@ impl Drop for ProcessInfo {
     }
 }
 
+impl ProcessInfo {
+    /// 取出进程句柄交给调用方长期持有，线程句柄仍随 ProcessInfo 一起关闭
+    pub fn take_process_handle(&mut self) -> Option<ProcessHandle> {
+        if self.process_handle.is_invalid() {
+            return None;
+        }
+        let handle = std::mem::take(&mut self.process_handle);
+        Some(ProcessHandle {
+            process_id: self.process_id,
+            handle,
+            job: self.job.take(),
+        })
+    }
+}
+
+/// 被监控进程的长期句柄，用于等待退出、查询存活状态和终止进程，避免每次检查都重新打开进程
+#[derive(Debug)]
+pub struct ProcessHandle {
+    process_id: u32,
+    handle: HANDLE,
+    /// 进程所在的作业对象，为 None 时只能终止顶层进程
+    job: Option<ProcessJob>,
+}
+
+// 进程句柄可以在任意线程上等待或关闭
+unsafe impl Send for ProcessHandle {}
+unsafe impl Sync for ProcessHandle {}
+
+impl ProcessHandle {
+    /// 打开已存在的进程（例如复用已运行的实例）并尽量加入新的作业对象；
+    /// 加入前已启动的子进程不在作业内
+    pub fn open(process_id: u32) -> Option<Self> {
+        if process_id == 0 {
+            return None;
+        }
+
+        let access = PROCESS_SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_TERMINATE;
+        unsafe {
+            // 加入作业需要 PROCESS_SET_QUOTA，拒绝时退回到原来的访问权限
+            let opened = OpenProcess(access | PROCESS_SET_QUOTA, false, process_id)
+                .or_else(|_| OpenProcess(access, false, process_id));
+            match opened {
+                Ok(handle) if !handle.is_invalid() => Some(Self {
+                    process_id,
+                    handle,
+                    job: ProcessJob::assign(process_id, handle),
+                }),
+                _ => {
+                    debug!("无法打开进程句柄, PID: {}", process_id);
+                    None
+                }
+            }
+        }
+    }
+
+    pub fn process_id(&self) -> u32 {
+        self.process_id
+    }
+
+    pub fn raw(&self) -> HANDLE {
+        self.handle
+    }
+
+    /// 进程对象在退出后变为有信号状态，零超时等待即可判断存活
+    pub fn is_alive(&self) -> bool {
+        unsafe { WaitForSingleObject(self.handle, 0) == WAIT_TIMEOUT }
+    }
+
+    /// 进程创建时间（FILETIME 的 100 纳秒计数），与系统快照中的创建时间比较以识别 PID 复用
+    pub fn create_time(&self) -> Option<u64> {
+        let (mut creation, mut exit, mut kernel, mut user) = (
+            FILETIME::default(),
+            FILETIME::default(),
+            FILETIME::default(),
+            FILETIME::default(),
+        );
+        unsafe {
+            GetProcessTimes(self.handle, &mut creation, &mut exit, &mut kernel, &mut user).ok()?;
+        }
+        Some(filetime_ticks(&creation))
+    }
+
+    /// 作业内的资源统计，不在作业中时为 None
+    pub fn accounting(&self) -> Option<JobAccounting> {
+        self.job.as_ref().and_then(ProcessJob::accounting)
+    }
+
+    /// 用已持有的句柄采样内存、句柄数与 CPU 时间，不重新打开进程
+    pub fn sample(&self) -> Option<ResourceSample> {
+        let mut counters = PROCESS_MEMORY_COUNTERS_EX::default();
+        let mut handle_count = 0u32;
+        let (mut creation, mut exit, mut kernel, mut user) = (
+            FILETIME::default(),
+            FILETIME::default(),
+            FILETIME::default(),
+            FILETIME::default(),
+        );
+        unsafe {
+            GetProcessMemoryInfo(
+                self.handle,
+                &mut counters as *mut _ as *mut PROCESS_MEMORY_COUNTERS,
+                std::mem::size_of::<PROCESS_MEMORY_COUNTERS_EX>() as u32,
+            )
+            .ok()?;
+            GetProcessHandleCount(self.handle, &mut handle_count).ok()?;
+        }
+
+        // 作业统计包含子进程，不在作业中时只统计顶层进程
+        let cpu_time_ms = match self.accounting() {
+            Some(accounting) => accounting.cpu_time_ms,
+            None => {
+                unsafe {
+                    GetProcessTimes(self.handle, &mut creation, &mut exit, &mut kernel, &mut user)
+                        .ok()?;
+                }
+                (filetime_ticks(&kernel) + filetime_ticks(&user)) / 10_000
+            }
+        };
+
+        Some(ResourceSample {
+            working_set_bytes: counters.WorkingSetSize as u64,
+            private_bytes: counters.PrivateUsage as u64,
+            handle_count,
+            cpu_time_ms,
+        })
+    }
+
+    /// 在作业中时终止整棵进程树，否则只终止顶层进程
+    pub fn terminate(&self) -> bool {
+        if let Some(job) = &self.job {
+            if job.terminate(self.process_id) {
+                return true;
+            }
+        }
+
+        info!("正在终止进程, PID: {}", self.process_id);
+
+        let result = unsafe { TerminateProcess(self.handle, 0) };
+        if result.is_ok() {
+            info!("进程 {} 终止成功", self.process_id);
+        } else if !self.is_alive() {
+            debug!("进程 {} 已终止", self.process_id);
+            return true;
+        }
+
+        result.is_ok()
+    }
+}
+
+impl Drop for ProcessHandle {
+    fn drop(&mut self) {
+        unsafe {
+            if !self.handle.is_invalid() {
+                let _ = CloseHandle(self.handle);
+            }
+        }
+    }
+}
+
+fn filetime_ticks(time: &FILETIME) -> u64 {
+    ((time.dwHighDateTime as u64) << 32) | time.dwLowDateTime as u64
+}
+
 fn to_wide_string(s: &str) -> Vec<u16> {
     OsStr::new(s)
         .encode_wide()
@@ -237,7 +410,8 @@ fn try_get_linked_token(token: HANDLE) -> Option<HANDLE> {
 
 #[cfg(test)]
 mod tests {
-    use super::{should_prefer_linked_token, TokenLaunchSource, choose_token_launch_source};
+    use super::{should_prefer_linked_token, SessionCache, TokenLaunchSource, choose_token_launch_source};
+    use std::cell::Cell;
 
     #[test]
     fn prefers_linked_token_for_limited_non_elevated_admin_token() {
@@ -269,6 +443,28 @@ mod tests {
             TokenLaunchSource::Original
         );
     }
+
+    #[test]
+    fn session_cache_creates_once_until_invalidated() {
+        let cache = SessionCache::new();
+        let created = Cell::new(0);
+        let create = || {
+            created.set(created.get() + 1);
+            Ok(created.get())
+        };
+
+        assert_eq!(*cache.get_or_try_insert(1, create).unwrap(), 1);
+        assert_eq!(*cache.get_or_try_insert(1, create).unwrap(), 1);
+        assert_eq!(*cache.get_or_try_insert(2, create).unwrap(), 2);
+
+        assert!(cache.invalidate(1));
+        assert!(!cache.invalidate(1));
+        assert_eq!(*cache.get_or_try_insert(1, create).unwrap(), 3);
+
+        // 创建失败不缓存
+        assert!(cache.get_or_try_insert(3, || Err("WTSQueryUserToken 失败".to_string())).is_err());
+        assert_eq!(*cache.get_or_try_insert(3, create).unwrap(), 4);
+    }
 }
 
 fn get_active_session_id() -> u32 {
@@ -302,27 +498,76 @@ fn get_active_session_id() -> u32 {
     }
 }
 
-pub fn start_process_in_session0(
-    exe_path: &str,
-    working_dir: Option<&str>,
-    args: Option<&str>,
-    minimize: bool,
-    no_window: bool,
-) -> Result<ProcessInfo, String> {
+/// 在某个会话中启动进程所需的主令牌与环境块，创建一次后供该会话的所有启动复用
+struct LaunchContext {
+    token: HANDLE,
+    environment: *mut std::ffi::c_void,
+}
+
+// 令牌与环境块创建后只读，CreateProcessAsUserW 可在多个线程上同时使用
+unsafe impl Send for LaunchContext {}
+unsafe impl Sync for LaunchContext {}
+
+impl Drop for LaunchContext {
+    fn drop(&mut self) {
+        unsafe {
+            let _ = DestroyEnvironmentBlock(self.environment);
+            let _ = CloseHandle(self.token);
+        }
+    }
+}
+
+/// 按会话 ID 缓存的值；正在使用的值由 Arc 保持，失效后最后一次启动结束时释放
+struct SessionCache<T> {
+    entries: Mutex<HashMap<u32, Arc<T>>>,
+}
+
+impl<T> SessionCache<T> {
+    fn new() -> Self {
+        Self {
+            entries: Mutex::new(HashMap::new()),
+        }
+    }
+
+    /// 在锁内创建，多个监控项同时重启时令牌操作只执行一次
+    fn get_or_try_insert(
+        &self,
+        session_id: u32,
+        create: impl FnOnce() -> Result<T, String>,
+    ) -> Result<Arc<T>, String> {
+        let mut entries = self.entries.lock().unwrap();
+        if let Some(value) = entries.get(&session_id) {
+            return Ok(value.clone());
+        }
+        let value = Arc::new(create()?);
+        entries.insert(session_id, value.clone());
+        Ok(value)
+    }
+
+    fn invalidate(&self, session_id: u32) -> bool {
+        self.entries.lock().unwrap().remove(&session_id).is_some()
+    }
+}
+
+fn launch_contexts() -> &'static SessionCache<LaunchContext> {
+    static CONTEXTS: OnceLock<SessionCache<LaunchContext>> = OnceLock::new();
+    CONTEXTS.get_or_init(SessionCache::new)
+}
+
+/// 会话登录或注销后令牌不再有效，由服务控制处理器在 SESSIONCHANGE 通知中调用
+pub fn invalidate_launch_context(session_id: u32) {
+    if launch_contexts().invalidate(session_id) {
+        info!("会话 {} 的启动上下文已失效", session_id);
+    }
+}
+
+fn create_launch_context(session_id: u32) -> Result<LaunchContext, String> {
     unsafe {
-        let mut process_info = ProcessInfo::new();
         let mut h_token = HANDLE::default();
         let mut h_linked_token = HANDLE::default();
         let mut h_dup_token = HANDLE::default();
         let mut p_env: *mut std::ffi::c_void = ptr::null_mut();
 
-        let session_id = get_active_session_id();
-        if session_id == 0xFFFFFFFF {
-            return Err("获取活动会话ID失败".to_string());
-        }
-
-        info!("正在会话 {} 中启动进程, 路径: {}", session_id, exe_path);
-
         let query_result = WTSQueryUserToken(session_id, &mut h_token);
         if query_result == 0 {
             let err = windows::core::Error::from_win32();
@@ -394,6 +639,38 @@ pub fn start_process_in_session0(
             return Err("CreateEnvironmentBlock 失败".to_string());
         }
 
+        let _ = CloseHandle(h_token);
+        if !h_linked_token.is_invalid() {
+            let _ = CloseHandle(h_linked_token);
+        }
+        Ok(LaunchContext {
+            token: h_dup_token,
+            environment: p_env,
+        })
+    }
+}
+
+
+pub fn start_process_in_session0(
+    exe_path: &str,
+    working_dir: Option<&str>,
+    args: Option<&str>,
+    minimize: bool,
+    no_window: bool,
+) -> Result<ProcessInfo, String> {
+    unsafe {
+        let mut process_info = ProcessInfo::new();
+
+        let session_id = get_active_session_id();
+        if session_id == 0xFFFFFFFF {
+            return Err("获取活动会话ID失败".to_string());
+        }
+
+        info!("正在会话 {} 中启动进程, 路径: {}", session_id, exe_path);
+
+        let context = launch_contexts()
+            .get_or_try_insert(session_id, || create_launch_context(session_id))?;
+
         let mut startup_info: STARTUPINFOW = std::mem::zeroed();
         startup_info.cb = std::mem::size_of::<STARTUPINFOW>() as u32;
 
@@ -405,7 +682,9 @@ pub fn start_process_in_session0(
             startup_info.wShowWindow = 2;
         }
 
-        let mut creation_flags = CREATE_UNICODE_ENVIRONMENT | NORMAL_PRIORITY_CLASS;
+        // 挂起启动，加入作业对象后再恢复，保证进程启动的所有子进程都在作业内
+        let mut creation_flags =
+            CREATE_UNICODE_ENVIRONMENT | NORMAL_PRIORITY_CLASS | CREATE_SUSPENDED;
         if no_window {
             creation_flags |= CREATE_NO_WINDOW;
         } else {
@@ -429,28 +708,23 @@ pub fn start_process_in_session0(
         let mut proc_info: PROCESS_INFORMATION = std::mem::zeroed();
 
         let create_result = CreateProcessAsUserW(
-            h_dup_token,
+            context.token,
             PCWSTR(exe_wide.as_ptr()),
             PWSTR(cmd_line.as_mut_ptr()),
             None,
             None,
             false,
             creation_flags,
-            Some(p_env),
+            Some(context.environment),
             cwd_ptr,
             &mut startup_info,
             &mut proc_info,
         );
 
-        let _ = DestroyEnvironmentBlock(p_env);
-        let _ = CloseHandle(h_token);
-        if !h_linked_token.is_invalid() {
-            let _ = CloseHandle(h_linked_token);
-        }
-        let _ = CloseHandle(h_dup_token);
-
         if create_result.is_err() {
             let err = windows::core::Error::from_win32();
+            // 令牌可能已随会话变化失效，下次启动重新获取
+            launch_contexts().invalidate(session_id);
             error!("CreateProcessAsUserW 失败: {:?}", err);
             return Err(format!("CreateProcessAsUserW 失败: {:?}", err));
         }
@@ -459,6 +733,19 @@ pub fn start_process_in_session0(
         process_info.thread_id = proc_info.dwThreadId;
         process_info.process_handle = proc_info.hProcess;
         process_info.thread_handle = proc_info.hThread;
+        process_info.job = ProcessJob::assign(proc_info.dwProcessId, proc_info.hProcess);
+        if process_info.job.is_none() {
+            warn!(
+                "进程 {} 未加入作业对象，终止时只结束顶层进程",
+                process_info.process_id
+            );
+        }
+        if ResumeThread(proc_info.hThread) == u32::MAX {
+            let err = windows::core::Error::from_win32();
+            error!("ResumeThread 失败: {:?}", err);
+            let _ = TerminateProcess(proc_info.hProcess, 0);
+            return Err(format!("ResumeThread 失败: {:?}", err));
+        }
 
         info!(
             "已在会话0中启动进程: {} (PID: {})",
@@ -523,110 +810,3 @@ pub fn kill_process(process_id: u32) -> bool {
         result.is_ok()
     }
 }
-
-pub fn find_process_by_name(process_name: &str) -> Option<u32> {
-    use windows::Win32::System::Diagnostics::ToolHelp::{
-        CreateToolhelp32Snapshot, Process32FirstW, Process32NextW, PROCESSENTRY32W,
-        TH32CS_SNAPPROCESS,
-    };
-
-    debug!("正在按名称搜索进程: {}", process_name);
-
-    unsafe {
-        let snapshot = match CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0) {
-            Ok(h) => h,
-            Err(_) => return None,
-        };
-
-        if snapshot.is_invalid() {
-            return None;
-        }
-
-        let mut entry: PROCESSENTRY32W = std::mem::zeroed();
-        entry.dwSize = std::mem::size_of::<PROCESSENTRY32W>() as u32;
-
-        let mut result = Process32FirstW(snapshot, &mut entry);
-        let target_name = process_name.to_lowercase();
-
-        while result.is_ok() {
-            let exe_name = String::from_utf16_lossy(
-                &entry.szExeFile
-                    [..entry.szExeFile.iter().position(|&c| c == 0).unwrap_or(entry.szExeFile.len())],
-            );
-
-            if exe_name.to_lowercase() == target_name
-                || exe_name.to_lowercase().ends_with(&format!("\\{}", target_name))
-            {
-                let pid = entry.th32ProcessID;
-                let _ = CloseHandle(snapshot);
-                debug!("找到进程 {} , PID: {}", process_name, pid);
-                return Some(pid);
-            }
-
-            result = Process32NextW(snapshot, &mut entry);
-        }
-
-        let _ = CloseHandle(snapshot);
-        debug!("未找到进程 {}", process_name);
-        None
-    }
-}
-
-pub fn find_process_by_path(exe_path: &str) -> Option<u32> {
-    use windows::Win32::System::Diagnostics::ToolHelp::{
-        CreateToolhelp32Snapshot, Process32FirstW, Process32NextW, PROCESSENTRY32W,
-        TH32CS_SNAPPROCESS,
-    };
-    use windows::Win32::System::ProcessStatus::GetModuleFileNameExW;
-
-    debug!("正在按路径搜索进程: {}", exe_path);
-
-    unsafe {
-        let snapshot = match CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0) {
-            Ok(h) => h,
-            Err(_) => return None,
-        };
-
-        if snapshot.is_invalid() {
-            return None;
-        }
-
-        let mut entry: PROCESSENTRY32W = std::mem::zeroed();
-        entry.dwSize = std::mem::size_of::<PROCESSENTRY32W>() as u32;
-
-        let mut result = Process32FirstW(snapshot, &mut entry);
-        let target_path = exe_path.to_lowercase();
-
-        while result.is_ok() {
-            let handle = OpenProcess(
-                PROCESS_QUERY_INFORMATION | PROCESS_VM_READ,
-                false,
-                entry.th32ProcessID,
-            );
-
-            if let Ok(handle) = handle {
-                if !handle.is_invalid() {
-                    let mut buffer = [0u16; MAX_PATH as usize];
-                    let len = GetModuleFileNameExW(handle, HMODULE::default(), &mut buffer);
-                    let _ = CloseHandle(handle);
-
-                    if len > 0 {
-                        let path = String::from_utf16_lossy(&buffer[..len as usize]);
-                        if path.to_lowercase() == target_path {
-                            let pid = entry.th32ProcessID;
-                            let _ = CloseHandle(snapshot);
-                            debug!("找到路径为 {} 的进程, PID: {}", exe_path, pid);
-                            return Some(pid);
-                        }
-                    }
-                }
-            }
-
-            result = Process32NextW(snapshot, &mut entry);
-        }
-
-        let _ = CloseHandle(snapshot);
-        debug!("未找到路径为 {} 的进程", exe_path);
-        None
-    }
-}
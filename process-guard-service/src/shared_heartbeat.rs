@@ -0,0 +1,283 @@
+use crate::heartbeat::HeartbeatIndex;
+use crate::metrics::metrics;
+use log::{error, info};
+use std::ffi::OsStr;
+use std::os::windows::ffi::OsStrExt;
+use std::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use std::time::Duration;
+use windows::core::PCWSTR;
+use windows::Win32::Foundation::{
+    CloseHandle, GetLastError, LocalFree, ERROR_ALREADY_EXISTS, HANDLE, HLOCAL,
+    INVALID_HANDLE_VALUE,
+};
+use windows::Win32::Security::Authorization::{
+    ConvertStringSecurityDescriptorToSecurityDescriptorW, SDDL_REVISION_1,
+};
+use windows::Win32::Security::{PSECURITY_DESCRIPTOR, SECURITY_ATTRIBUTES};
+use windows::Win32::System::Memory::{
+    CreateFileMappingW, MapViewOfFile, UnmapViewOfFile, FILE_MAP_ALL_ACCESS,
+    MEMORY_MAPPED_VIEW_ADDRESS, PAGE_READWRITE,
+};
+use windows::Win32::System::SystemInformation::GetTickCount64;
+
+/// 客户端按名称打开的共享内存段，与 ProcessGuardClient.cpp 中的 SHARED_HEARTBEAT_NAME 一致
+pub const SHARED_HEARTBEAT_NAME: &str = "Global\\ProcessGuardHeartbeats";
+/// 段头中的标识 "PGHB"，客户端用于确认布局
+pub const SHARED_HEARTBEAT_MAGIC: u32 = 0x4248_4750;
+pub const SHARED_HEARTBEAT_VERSION: u32 = 2;
+/// 槽位数，即可通过共享内存上报心跳的最大句柄 + 1
+pub const SHARED_HEARTBEAT_SLOTS: usize = 4096;
+/// 段头大小，槽位从这里开始按句柄下标排列，每个槽 8 字节
+const HEADER_SIZE: usize = 64;
+/// 只允许 SYSTEM 与管理员访问，与命名管道的默认访问控制一致（普通用户也无法写入管道）；
+/// 其他用户写入槽位就能替任意监控项伪造心跳
+const SHARED_HEARTBEAT_SDDL: &str = "D:P(A;;GA;;;SY)(A;;GA;;;BA)";
+
+fn to_wide_string(s: &str) -> Vec<u16> {
+    OsStr::new(s)
+        .encode_wide()
+        .chain(std::iter::once(0))
+        .collect()
+}
+
+#[repr(C)]
+struct SharedHeader {
+    magic: AtomicU32,
+    version: AtomicU32,
+    slot_count: AtomicU32,
+    header_size: AtomicU32,
+    /// 创建段的服务运行的 epoch，客户端只在与取得句柄时的 epoch 一致时写入槽位
+    epoch: AtomicU64,
+}
+
+/// 同机客户端的心跳共享内存。
+/// 客户端把 GetTickCount64 的毫秒值写入自己句柄对应的槽位（一次内存写入，不经过管道），
+/// 各分片的守护线程检查心跳前调用 `sync_shard` 把本分片句柄新写入的值合并到心跳槽。
+pub struct SharedHeartbeats {
+    mapping: HANDLE,
+    view: MEMORY_MAPPED_VIEW_ADDRESS,
+    /// 每个槽位上次合并的值，相同的值不重复计入心跳；各分片只更新自己的槽位，不需要加锁
+    seen: Vec<AtomicU64>,
+}
+
+// 视图只通过原子类型访问，句柄只在 Drop 中关闭
+unsafe impl Send for SharedHeartbeats {}
+unsafe impl Sync for SharedHeartbeats {}
+
+impl SharedHeartbeats {
+    /// 创建共享内存段，失败时返回 None，心跳仍可通过管道上报。
+    /// 客户端仍打开着服务上次运行的段时得到的是同一个段，其中的槽位属于上次分配的句柄，先全部清零；
+    /// `epoch` 写入段头，持有上次运行句柄的客户端据此停止写入
+    pub fn create(epoch: u64) -> Option<Self> {
+        let size = HEADER_SIZE + SHARED_HEARTBEAT_SLOTS * std::mem::size_of::<u64>();
+        let sddl = to_wide_string(SHARED_HEARTBEAT_SDDL);
+        let name = to_wide_string(SHARED_HEARTBEAT_NAME);
+
+        unsafe {
+            let mut descriptor = PSECURITY_DESCRIPTOR::default();
+            if let Err(e) = ConvertStringSecurityDescriptorToSecurityDescriptorW(
+                PCWSTR(sddl.as_ptr()),
+                SDDL_REVISION_1,
+                &mut descriptor,
+                None,
+            ) {
+                error!(
+                    "Failed to build shared heartbeat security descriptor: {}",
+                    e
+                );
+                return None;
+            }
+
+            let attributes = SECURITY_ATTRIBUTES {
+                nLength: std::mem::size_of::<SECURITY_ATTRIBUTES>() as u32,
+                lpSecurityDescriptor: descriptor.0,
+                bInheritHandle: false.into(),
+            };
+            let mapping = CreateFileMappingW(
+                INVALID_HANDLE_VALUE,
+                Some(&attributes),
+                PAGE_READWRITE,
+                0,
+                size as u32,
+                PCWSTR(name.as_ptr()),
+            );
+            // 必须在其他 API 调用之前读取
+            let existed = GetLastError() == ERROR_ALREADY_EXISTS;
+            let _ = LocalFree(HLOCAL(descriptor.0));
+
+            let mapping = match mapping {
+                Ok(mapping) => mapping,
+                Err(e) => {
+                    error!("Failed to create shared heartbeat section: {}", e);
+                    return None;
+                }
+            };
+
+            let view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+            if view.Value.is_null() {
+                error!("Failed to map shared heartbeat section");
+                let _ = CloseHandle(mapping);
+                return None;
+            }
+
+            let shared = Self {
+                mapping,
+                view,
+                seen: (0..SHARED_HEARTBEAT_SLOTS)
+                    .map(|_| AtomicU64::new(0))
+                    .collect(),
+            };
+            // 客户端看到 magic 后才使用段，因此先清除 magic、最后写入
+            let header = shared.header();
+            header.magic.store(0, Ordering::Release);
+            // 清零前先让上次运行的客户端停止写入
+            header.epoch.store(0, Ordering::SeqCst);
+            if existed {
+                info!("Reusing shared heartbeat section left by a previous run, clearing slots");
+                for slot in shared.slots() {
+                    slot.store(0, Ordering::Relaxed);
+                }
+            }
+            header
+                .version
+                .store(SHARED_HEARTBEAT_VERSION, Ordering::Relaxed);
+            header
+                .slot_count
+                .store(SHARED_HEARTBEAT_SLOTS as u32, Ordering::Relaxed);
+            header
+                .header_size
+                .store(HEADER_SIZE as u32, Ordering::Relaxed);
+            header.epoch.store(epoch, Ordering::Release);
+            header
+                .magic
+                .store(SHARED_HEARTBEAT_MAGIC, Ordering::Release);
+
+            info!(
+                "Shared heartbeat section {} ready ({} slots)",
+                SHARED_HEARTBEAT_NAME, SHARED_HEARTBEAT_SLOTS
+            );
+            Some(shared)
+        }
+    }
+
+    fn header(&self) -> &SharedHeader {
+        unsafe { &*(self.view.Value as *const SharedHeader) }
+    }
+
+    fn slots(&self) -> &[AtomicU64] {
+        unsafe {
+            let base = (self.view.Value as *const u8).add(HEADER_SIZE) as *const AtomicU64;
+            std::slice::from_raw_parts(base, SHARED_HEARTBEAT_SLOTS)
+        }
+    }
+
+    /// 把客户端新写入的心跳合并到心跳索引，返回合并的心跳数
+    pub fn sync(&self, index: &HeartbeatIndex) -> usize {
+        self.sync_shard(index, 0, 1)
+    }
+
+    /// 只合并 `handle % shard_count == shard` 的槽位（与守护分片的划分一致）
+    pub fn sync_shard(&self, index: &HeartbeatIndex, shard: usize, shard_count: usize) -> usize {
+        let now_tick = unsafe { GetTickCount64() };
+        let merged = merge_slots(
+            self.slots(),
+            &self.seen,
+            now_tick,
+            index,
+            shard,
+            shard_count,
+        );
+        if merged > 0 {
+            metrics().heartbeats_shared.add(merged as u64);
+        }
+        merged
+    }
+}
+
+impl Drop for SharedHeartbeats {
+    fn drop(&mut self) {
+        unsafe {
+            let _ = UnmapViewOfFile(self.view);
+            let _ = CloseHandle(self.mapping);
+        }
+    }
+}
+
+/// 槽位中的值是写入时的系统启动毫秒数（GetTickCount64），0 表示从未写入；
+/// 只合并比上次看到的更新的值，句柄已移除的槽位忽略。只访问属于 `shard` 的槽位
+fn merge_slots(
+    slots: &[AtomicU64],
+    seen: &[AtomicU64],
+    now_tick: u64,
+    index: &HeartbeatIndex,
+    shard: usize,
+    shard_count: usize,
+) -> usize {
+    let shard_count = shard_count.max(1);
+    let mut merged = 0;
+    // 句柄 0 保留表示未指定
+    let first = if shard == 0 { shard_count } else { shard };
+    for handle in (first..slots.len().min(seen.len())).step_by(shard_count) {
+        let tick = slots[handle].load(Ordering::Acquire);
+        // 状态查询与分片线程可能同时合并同一槽位，只有把 seen 推进的一方计入心跳
+        if tick == 0 || seen[handle].fetch_max(tick, Ordering::Relaxed) >= tick {
+            continue;
+        }
+        if let Some(heartbeat) = index.get_by_handle(handle as u32) {
+            heartbeat.record_aged(Duration::from_millis(now_tick.saturating_sub(tick)));
+            merged += 1;
+        }
+    }
+    merged
+}
+
+#[cfg(test)]
+mod tests {
+    use super::merge_slots;
+    use crate::heartbeat::{HeartbeatIndex, HeartbeatSlot};
+    use std::sync::atomic::{AtomicU64, Ordering};
+    use std::sync::Arc;
+    use std::time::Duration;
+
+    #[test]
+    fn merges_only_new_ticks_for_known_handles() {
+        let mut index = HeartbeatIndex::new();
+        let slot = Arc::new(HeartbeatSlot::new());
+        let handle = index.insert("EnergyMonitor", slot.clone()) as usize;
+        let slots: Vec<AtomicU64> = (0..8).map(|_| AtomicU64::new(0)).collect();
+        let seen: Vec<AtomicU64> = (0..8).map(|_| AtomicU64::new(0)).collect();
+
+        std::thread::sleep(Duration::from_millis(20));
+        assert_eq!(merge_slots(&slots, &seen, 10_000, &index, 0, 1), 0);
+        assert!(slot.elapsed() >= Duration::from_millis(20));
+
+        // 未知句柄的槽位只记下值，不计入心跳
+        slots[handle].store(9_990, Ordering::Release);
+        slots[handle + 1].store(9_990, Ordering::Release);
+        assert_eq!(merge_slots(&slots, &seen, 10_000, &index, 0, 1), 1);
+        assert!(slot.elapsed() < Duration::from_millis(20));
+        assert_eq!(seen[handle + 1].load(Ordering::Relaxed), 9_990);
+
+        // 客户端没有再写入时不重复合并
+        assert_eq!(merge_slots(&slots, &seen, 10_500, &index, 0, 1), 0);
+        slots[handle].store(10_400, Ordering::Release);
+        assert_eq!(merge_slots(&slots, &seen, 10_500, &index, 0, 1), 1);
+    }
+
+    #[test]
+    fn each_shard_merges_only_its_own_handles() {
+        let mut index = HeartbeatIndex::new();
+        let first = index.insert("EnergyMonitor", Arc::new(HeartbeatSlot::new())) as usize;
+        let second = index.insert("DataCollector", Arc::new(HeartbeatSlot::new())) as usize;
+        assert_eq!((first % 2, second % 2), (1, 0));
+        let slots: Vec<AtomicU64> = (0..8).map(|_| AtomicU64::new(0)).collect();
+        let seen: Vec<AtomicU64> = (0..8).map(|_| AtomicU64::new(0)).collect();
+        slots[first].store(9_990, Ordering::Release);
+        slots[second].store(9_990, Ordering::Release);
+
+        assert_eq!(merge_slots(&slots, &seen, 10_000, &index, 1, 2), 1);
+        assert_eq!(seen[second].load(Ordering::Relaxed), 0);
+        assert_eq!(merge_slots(&slots, &seen, 10_000, &index, 0, 2), 1);
+        assert_eq!(merge_slots(&slots, &seen, 10_000, &index, 0, 1), 0);
+    }
+}
@@ -0,0 +1,170 @@
+use crate::models::ItemStatus;
+use serde::Serialize;
+use std::collections::VecDeque;
+use std::sync::{Condvar, Mutex};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+/// 保留的最近事件数；订阅方落后更多时需要重新获取快照
+pub const STATUS_EVENT_CAPACITY: usize = 1024;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize)]
+#[serde(rename_all = "snake_case")]
+pub enum StatusEventKind {
+    Started,
+    Died,
+    Restarted,
+    HeartbeatLate,
+    ConfigChanged,
+    Removed,
+}
+
+/// 一次状态变化，`status` 为变化后该监控项的状态（移除时为空）
+#[derive(Debug, Clone, Serialize)]
+pub struct StatusEvent {
+    pub version: u64,
+    pub event: StatusEventKind,
+    pub item_id: String,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub status: Option<ItemStatus>,
+}
+
+struct EventRing {
+    events: VecDeque<StatusEvent>,
+    version: u64,
+}
+
+/// 带版本号的状态事件环形缓冲。
+/// 守护线程在状态变化时写入，订阅方带着上次看到的版本号来取增量；
+/// `epoch` 标识本次服务运行，服务重启后旧的版本号不再有效。
+pub struct StatusEvents {
+    epoch: u64,
+    capacity: usize,
+    ring: Mutex<EventRing>,
+    condvar: Condvar,
+}
+
+impl StatusEvents {
+    pub fn new(capacity: usize) -> Self {
+        let epoch = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map(|d| d.as_millis() as u64)
+            .unwrap_or(0);
+        Self {
+            epoch,
+            capacity: capacity.max(1),
+            ring: Mutex::new(EventRing {
+                events: VecDeque::new(),
+                version: 0,
+            }),
+            condvar: Condvar::new(),
+        }
+    }
+
+    pub fn epoch(&self) -> u64 {
+        self.epoch
+    }
+
+    pub fn version(&self) -> u64 {
+        self.ring.lock().unwrap().version
+    }
+
+    pub fn publish(&self, event: StatusEventKind, item_id: &str, status: Option<ItemStatus>) {
+        let mut ring = self.ring.lock().unwrap();
+        ring.version += 1;
+        let version = ring.version;
+        if ring.events.len() >= self.capacity {
+            ring.events.pop_front();
+        }
+        ring.events.push_back(StatusEvent {
+            version,
+            event,
+            item_id: item_id.to_string(),
+            status,
+        });
+        self.condvar.notify_all();
+    }
+
+    /// `since` 之后的全部事件。
+    /// 返回 None 表示无法给出增量（首次订阅、epoch 不一致或所需事件已被覆盖），调用方应返回快照
+    pub fn since(&self, epoch: u64, since: u64) -> Option<Vec<StatusEvent>> {
+        if epoch != self.epoch || since == 0 {
+            return None;
+        }
+
+        let ring = self.ring.lock().unwrap();
+        if since > ring.version {
+            return None;
+        }
+
+        let oldest = ring
+            .events
+            .front()
+            .map(|e| e.version)
+            .unwrap_or(ring.version + 1);
+        if since + 1 < oldest {
+            return None;
+        }
+
+        Some(
+            ring.events
+                .iter()
+                .filter(|e| e.version > since)
+                .cloned()
+                .collect(),
+        )
+    }
+
+    /// 等待版本号超过 `version`，最多等待 `timeout`；返回当前版本号
+    pub fn wait_for_change(&self, version: u64, timeout: Duration) -> u64 {
+        let ring = self.ring.lock().unwrap();
+        let (ring, _) = self
+            .condvar
+            .wait_timeout_while(ring, timeout, |ring| ring.version <= version)
+            .unwrap();
+        ring.version
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{StatusEventKind, StatusEvents};
+    use std::time::Duration;
+
+    #[test]
+    fn returns_events_after_version_and_requires_snapshot_on_gaps() {
+        let events = StatusEvents::new(2);
+        let epoch = events.epoch();
+        assert!(events.since(epoch, 0).is_none());
+
+        events.publish(StatusEventKind::Started, "EnergyMonitor", None);
+        events.publish(StatusEventKind::Died, "EnergyMonitor", None);
+        assert_eq!(events.version(), 2);
+
+        let delta = events.since(epoch, 1).unwrap();
+        assert_eq!(delta.len(), 1);
+        assert_eq!(delta[0].event, StatusEventKind::Died);
+        assert!(events.since(epoch, 2).unwrap().is_empty());
+
+        // 容量为 2，版本 1 被覆盖后从 1 开始的增量不再完整
+        events.publish(StatusEventKind::Restarted, "EnergyMonitor", None);
+        assert!(events.since(epoch, 1).is_some());
+        events.publish(StatusEventKind::HeartbeatLate, "EnergyMonitor", None);
+        assert!(events.since(epoch, 1).is_none());
+
+        assert!(events.since(epoch + 1, 3).is_none());
+        assert!(events.since(epoch, 99).is_none());
+    }
+
+    #[test]
+    fn wait_returns_once_version_advances() {
+        let events = std::sync::Arc::new(StatusEvents::new(8));
+        assert_eq!(events.wait_for_change(0, Duration::from_millis(1)), 0);
+
+        let publisher = events.clone();
+        let handle = std::thread::spawn(move || {
+            publisher.publish(StatusEventKind::ConfigChanged, "Collector", None);
+        });
+        assert_eq!(events.wait_for_change(0, Duration::from_secs(5)), 1);
+        handle.join().unwrap();
+    }
+}
@@ -0,0 +1,310 @@
+use crate::metrics::metrics;
+use crate::resource_watch::ResourceSample;
+use log::{debug, error};
+use std::collections::HashMap;
+use std::time::Instant;
+
+const SYSTEM_PROCESS_INFORMATION_CLASS: u32 = 5;
+const STATUS_INFO_LENGTH_MISMATCH: i32 = 0xC000_0004_u32 as i32;
+/// 进程数在两次调用之间可能增长，扩容时多留一些余量
+const BUFFER_SLACK: usize = 64 * 1024;
+const MAX_QUERY_ATTEMPTS: usize = 4;
+
+#[link(name = "ntdll")]
+extern "system" {
+    fn NtQuerySystemInformation(
+        system_information_class: u32,
+        system_information: *mut std::ffi::c_void,
+        system_information_length: u32,
+        return_length: *mut u32,
+    ) -> i32;
+}
+
+#[repr(C)]
+struct UnicodeString {
+    length: u16,
+    maximum_length: u16,
+    buffer: *const u16,
+}
+
+/// SYSTEM_PROCESS_INFORMATION 的固定部分，线程信息紧随其后，这里不读取
+#[repr(C)]
+#[allow(dead_code)] // 未读取的字段只用于保持布局
+struct SystemProcessInformation {
+    next_entry_offset: u32,
+    number_of_threads: u32,
+    working_set_private_size: i64,
+    hard_fault_count: u32,
+    number_of_threads_high_watermark: u32,
+    cycle_time: u64,
+    create_time: i64,
+    user_time: i64,
+    kernel_time: i64,
+    image_name: UnicodeString,
+    base_priority: i32,
+    unique_process_id: usize,
+    inherited_from_unique_process_id: usize,
+    handle_count: u32,
+    session_id: u32,
+    unique_process_key: usize,
+    peak_virtual_size: usize,
+    virtual_size: usize,
+    page_fault_count: u32,
+    peak_working_set_size: usize,
+    working_set_size: usize,
+    quota_peak_paged_pool_usage: usize,
+    quota_paged_pool_usage: usize,
+    quota_peak_non_paged_pool_usage: usize,
+    quota_non_paged_pool_usage: usize,
+    pagefile_usage: usize,
+    peak_pagefile_usage: usize,
+    private_page_count: usize,
+}
+
+/// 快照中的一个进程
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct SnapshotProcess {
+    pub process_id: u32,
+    pub parent_id: u32,
+    /// 创建时间（FILETIME 的 100 纳秒计数），PID 相同但创建时间不同说明 PID 已被复用
+    pub create_time: u64,
+    /// 映像文件名（不含目录）
+    pub image_name: String,
+    pub working_set_bytes: u64,
+    pub private_bytes: u64,
+    pub handle_count: u32,
+    /// 用户态与内核态 CPU 时间之和
+    pub cpu_time_ms: u64,
+}
+
+impl SnapshotProcess {
+    /// 只包含这一个进程的资源采样，CPU 时间不含子进程
+    pub fn sample(&self) -> ResourceSample {
+        ResourceSample {
+            working_set_bytes: self.working_set_bytes,
+            private_bytes: self.private_bytes,
+            handle_count: self.handle_count,
+            cpu_time_ms: self.cpu_time_ms,
+        }
+    }
+}
+
+/// 查询缓冲区，在多次快照之间复用；按 u64 分配以满足结构体的对齐要求
+#[derive(Default)]
+pub struct SnapshotBuffer {
+    words: Vec<u64>,
+}
+
+impl SnapshotBuffer {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    fn byte_len(&self) -> usize {
+        self.words.len() * std::mem::size_of::<u64>()
+    }
+
+    fn reserve_bytes(&mut self, bytes: usize) {
+        let word = std::mem::size_of::<u64>();
+        let words = (bytes + word - 1) / word;
+        if words > self.words.len() {
+            self.words.resize(words, 0);
+        }
+    }
+
+    fn bytes(&self, len: usize) -> &[u8] {
+        let len = len.min(self.byte_len());
+        unsafe { std::slice::from_raw_parts(self.words.as_ptr() as *const u8, len) }
+    }
+}
+
+/// 一次 NtQuerySystemInformation(SystemProcessInformation) 得到的全部进程。
+/// 每个检查周期只生成一次，存活判断、资源采样与路径查找都在同一份快照上完成
+pub struct SystemSnapshot {
+    processes: Vec<SnapshotProcess>,
+    by_pid: HashMap<u32, usize>,
+}
+
+impl SystemSnapshot {
+    /// 查询失败时返回 None，调用方退回到逐个打开进程
+    pub fn capture(buffer: &mut SnapshotBuffer) -> Option<Self> {
+        let started = Instant::now();
+        if buffer.byte_len() == 0 {
+            buffer.reserve_bytes(BUFFER_SLACK * 4);
+        }
+
+        for _ in 0..MAX_QUERY_ATTEMPTS {
+            let mut needed = 0u32;
+            let status = unsafe {
+                NtQuerySystemInformation(
+                    SYSTEM_PROCESS_INFORMATION_CLASS,
+                    buffer.words.as_mut_ptr() as *mut std::ffi::c_void,
+                    buffer.byte_len().min(u32::MAX as usize) as u32,
+                    &mut needed,
+                )
+            };
+
+            if status == STATUS_INFO_LENGTH_MISMATCH {
+                buffer.reserve_bytes(needed as usize + BUFFER_SLACK);
+                continue;
+            }
+            if status < 0 {
+                error!("NtQuerySystemInformation 失败: 0x{:08X}", status as u32);
+                return None;
+            }
+
+            let processes = unsafe { parse_process_information(buffer.bytes(needed as usize)) };
+            metrics().system_snapshot.record_duration(started.elapsed());
+            debug!("系统进程快照: {} 个进程", processes.len());
+            return Some(Self::from_processes(processes));
+        }
+
+        error!("NtQuerySystemInformation 缓冲区多次不足");
+        None
+    }
+
+    fn from_processes(processes: Vec<SnapshotProcess>) -> Self {
+        let by_pid = processes
+            .iter()
+            .enumerate()
+            .map(|(index, process)| (process.process_id, index))
+            .collect();
+        Self { processes, by_pid }
+    }
+
+    /// 按快照顺序遍历所有进程
+    pub fn processes(&self) -> &[SnapshotProcess] {
+        &self.processes
+    }
+
+    /// `create_time` 为 None 时只按 PID 查找，否则创建时间不一致视为 PID 已被复用
+    pub fn find(&self, process_id: u32, create_time: Option<u64>) -> Option<&SnapshotProcess> {
+        let process = &self.processes[*self.by_pid.get(&process_id)?];
+        match create_time {
+            Some(create_time) if create_time != process.create_time => None,
+            _ => Some(process),
+        }
+    }
+
+    pub fn is_alive(&self, process_id: u32, create_time: Option<u64>) -> bool {
+        self.find(process_id, create_time).is_some()
+    }
+}
+
+/// 缓冲区中是以 next_entry_offset 串起的变长记录，最后一条的偏移为 0；
+/// 映像名指向同一缓冲区内部，超出缓冲区的记录直接丢弃
+unsafe fn parse_process_information(buffer: &[u8]) -> Vec<SnapshotProcess> {
+    let mut processes = Vec::new();
+    let entry_size = std::mem::size_of::<SystemProcessInformation>();
+    let mut offset = 0usize;
+
+    while offset + entry_size <= buffer.len() {
+        let entry = &*(buffer.as_ptr().add(offset) as *const SystemProcessInformation);
+        let image_name = if entry.image_name.buffer.is_null() {
+            String::new()
+        } else {
+            let chars = std::slice::from_raw_parts(
+                entry.image_name.buffer,
+                entry.image_name.length as usize / 2,
+            );
+            String::from_utf16_lossy(chars)
+        };
+
+        processes.push(SnapshotProcess {
+            process_id: entry.unique_process_id as u32,
+            parent_id: entry.inherited_from_unique_process_id as u32,
+            create_time: entry.create_time.max(0) as u64,
+            image_name,
+            working_set_bytes: entry.working_set_size as u64,
+            private_bytes: entry.private_page_count as u64,
+            handle_count: entry.handle_count,
+            cpu_time_ms: (entry.user_time.max(0) + entry.kernel_time.max(0)) as u64 / 10_000,
+        });
+
+        if entry.next_entry_offset == 0 {
+            break;
+        }
+        offset += entry.next_entry_offset as usize;
+    }
+    processes
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{
+        parse_process_information, SnapshotProcess, SystemProcessInformation, SystemSnapshot,
+        UnicodeString,
+    };
+
+    fn entry(pid: usize, name: &[u16], next: u32) -> SystemProcessInformation {
+        let mut entry: SystemProcessInformation = unsafe { std::mem::zeroed() };
+        entry.next_entry_offset = next;
+        entry.unique_process_id = pid;
+        entry.inherited_from_unique_process_id = 4;
+        entry.create_time = 1_000 + pid as i64;
+        entry.user_time = 30_000;
+        entry.kernel_time = 20_000;
+        entry.working_set_size = 8 << 20;
+        entry.private_page_count = 4 << 20;
+        entry.handle_count = 120;
+        entry.image_name = UnicodeString {
+            length: (name.len() * 2) as u16,
+            maximum_length: (name.len() * 2) as u16,
+            buffer: if name.is_empty() {
+                std::ptr::null()
+            } else {
+                name.as_ptr()
+            },
+        };
+        entry
+    }
+
+    #[test]
+    fn parses_chained_entries_and_detects_pid_reuse() {
+        let name: Vec<u16> = "App.exe".encode_utf16().collect();
+        let stride = std::mem::size_of::<SystemProcessInformation>() + 64;
+        let mut words = vec![0u64; stride * 2 / 8];
+        unsafe {
+            let base = words.as_mut_ptr() as *mut u8;
+            std::ptr::write(
+                base as *mut SystemProcessInformation,
+                entry(0, &[], stride as u32),
+            );
+            std::ptr::write(
+                base.add(stride) as *mut SystemProcessInformation,
+                entry(200, &name, 0),
+            );
+        }
+
+        let bytes =
+            unsafe { std::slice::from_raw_parts(words.as_ptr() as *const u8, words.len() * 8) };
+        let processes = unsafe { parse_process_information(bytes) };
+        assert_eq!(processes.len(), 2);
+        assert_eq!(processes[0].image_name, "");
+        assert_eq!(
+            processes[1],
+            SnapshotProcess {
+                process_id: 200,
+                parent_id: 4,
+                create_time: 1_200,
+                image_name: "App.exe".to_string(),
+                working_set_bytes: 8 << 20,
+                private_bytes: 4 << 20,
+                handle_count: 120,
+                cpu_time_ms: 5,
+            }
+        );
+
+        let snapshot = SystemSnapshot::from_processes(processes);
+        assert!(snapshot.is_alive(200, None));
+        assert!(snapshot.is_alive(200, Some(1_200)));
+        assert!(!snapshot.is_alive(200, Some(1_100)));
+        assert!(!snapshot.is_alive(300, None));
+
+        // 截断的缓冲区不越界读取
+        assert_eq!(
+            unsafe { parse_process_information(&bytes[..stride + 8]) }.len(),
+            1
+        );
+    }
+}
@@ -0,0 +1,418 @@
+use crate::models::ItemStatus;
+
+/// 二进制报文首字节。0xB7 不可能出现在 UTF-8 文本开头，与 JSON 帧共用一个会话时可直接区分
+pub const WIRE_MAGIC: u8 = 0xB7;
+/// `[magic u8][opcode u8][flags u16][item_index u32][timestamp i64]`，小端
+pub const WIRE_HEADER_SIZE: usize = 16;
+
+pub const OP_HEARTBEAT: u8 = 0x01;
+pub const OP_HEARTBEAT_BATCH: u8 = 0x02;
+pub const OP_STATUS: u8 = 0x03;
+/// 响应的 opcode 为请求 opcode | OP_REPLY
+pub const OP_REPLY: u8 = 0x80;
+
+pub const FLAG_OK: u16 = 0x0001;
+/// 批量心跳的负载为 u32 句柄列表而不是 ID 字符串列表
+pub const FLAG_HANDLES: u16 = 0x0002;
+/// 按句柄的心跳负载以 u64 epoch 开头（取得句柄时服务的 epoch），与本次运行不一致时拒绝
+pub const FLAG_EPOCH: u16 = 0x0004;
+/// status 请求带此标志时每个监控项追加扩展字段（作业、就绪、备用实例、指标），响应中回显；
+/// 旧服务端忽略该标志，响应中没有它
+pub const FLAG_EXTENDED: u16 = 0x0008;
+
+const STATUS_ENABLED: u8 = 0x01;
+const STATUS_ALIVE: u8 = 0x02;
+const STATUS_HEARTBEAT_OK: u8 = 0x04;
+const STATUS_RESTART_PENDING: u8 = 0x08;
+
+const STATUS_HAS_JOB: u8 = 0x01;
+const STATUS_READY: u8 = 0x02;
+const STATUS_HAS_STANDBY: u8 = 0x04;
+const STATUS_STANDBY_READY: u8 = 0x08;
+
+#[derive(Debug, PartialEq, Eq)]
+pub enum WireError {
+    Truncated,
+    BadMagic(u8),
+    InvalidUtf8,
+}
+
+impl std::fmt::Display for WireError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            WireError::Truncated => write!(f, "wire message truncated"),
+            WireError::BadMagic(magic) => write!(f, "bad wire magic: 0x{:02X}", magic),
+            WireError::InvalidUtf8 => write!(f, "wire string is not valid utf-8"),
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct WireHeader {
+    pub opcode: u8,
+    pub flags: u16,
+    /// 监控项句柄，0 表示未指定（负载中携带 ID）
+    pub item_index: u32,
+    pub timestamp: i64,
+}
+
+impl WireHeader {
+    pub fn new(opcode: u8) -> Self {
+        Self {
+            opcode,
+            flags: 0,
+            item_index: 0,
+            timestamp: 0,
+        }
+    }
+
+    pub fn reply(request: &WireHeader, ok: bool) -> Self {
+        Self {
+            opcode: request.opcode | OP_REPLY,
+            flags: if ok { FLAG_OK } else { 0 },
+            item_index: request.item_index,
+            timestamp: 0,
+        }
+    }
+
+    pub fn encode(&self, out: &mut Vec<u8>) {
+        out.reserve(WIRE_HEADER_SIZE);
+        out.push(WIRE_MAGIC);
+        out.push(self.opcode);
+        out.extend_from_slice(&self.flags.to_le_bytes());
+        out.extend_from_slice(&self.item_index.to_le_bytes());
+        out.extend_from_slice(&self.timestamp.to_le_bytes());
+    }
+
+    /// 解析报文头，返回报文头与剩余的负载
+    pub fn decode(data: &[u8]) -> Result<(WireHeader, &[u8]), WireError> {
+        if data.len() < WIRE_HEADER_SIZE {
+            return Err(WireError::Truncated);
+        }
+        if data[0] != WIRE_MAGIC {
+            return Err(WireError::BadMagic(data[0]));
+        }
+
+        let header = WireHeader {
+            opcode: data[1],
+            flags: u16::from_le_bytes([data[2], data[3]]),
+            item_index: u32::from_le_bytes([data[4], data[5], data[6], data[7]]),
+            timestamp: i64::from_le_bytes([
+                data[8], data[9], data[10], data[11], data[12], data[13], data[14], data[15],
+            ]),
+        };
+        Ok((header, &data[WIRE_HEADER_SIZE..]))
+    }
+}
+
+pub fn is_wire_message(payload: &[u8]) -> bool {
+    payload.first() == Some(&WIRE_MAGIC)
+}
+
+/// `[u16 长度][UTF-8]`，超过 u16 的部分在字符边界处截断
+pub fn put_str(out: &mut Vec<u8>, value: &str) {
+    let mut len = value.len().min(u16::MAX as usize);
+    while !value.is_char_boundary(len) {
+        len -= 1;
+    }
+    let bytes = &value.as_bytes()[..len];
+    out.extend_from_slice(&(bytes.len() as u16).to_le_bytes());
+    out.extend_from_slice(bytes);
+}
+
+pub struct WireReader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> WireReader<'a> {
+    pub fn new(data: &'a [u8]) -> Self {
+        Self { data, pos: 0 }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.pos >= self.data.len()
+    }
+
+    fn take(&mut self, len: usize) -> Result<&'a [u8], WireError> {
+        if self.data.len() - self.pos < len {
+            return Err(WireError::Truncated);
+        }
+        let slice = &self.data[self.pos..self.pos + len];
+        self.pos += len;
+        Ok(slice)
+    }
+
+    pub fn read_u16(&mut self) -> Result<u16, WireError> {
+        let bytes = self.take(2)?;
+        Ok(u16::from_le_bytes([bytes[0], bytes[1]]))
+    }
+
+    pub fn read_u32(&mut self) -> Result<u32, WireError> {
+        let bytes = self.take(4)?;
+        Ok(u32::from_le_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]))
+    }
+
+    pub fn read_u64(&mut self) -> Result<u64, WireError> {
+        let bytes = self.take(8)?;
+        let mut value = [0u8; 8];
+        value.copy_from_slice(bytes);
+        Ok(u64::from_le_bytes(value))
+    }
+
+    pub fn read_str(&mut self) -> Result<&'a str, WireError> {
+        let len = self.read_u16()? as usize;
+        std::str::from_utf8(self.take(len)?).map_err(|_| WireError::InvalidUtf8)
+    }
+}
+
+/// status 响应负载: `[u32 数量]` 后接每个监控项
+/// `[u32 PID(0 表示无)][u32 重启次数][u64 距上次心跳毫秒][u64 心跳超时毫秒][u8 状态位]`
+/// 以及 id、name、exe_path、last_restart_reason 四个字符串；`extended` 时再追加
+/// `[u8 扩展状态位][u32 备用实例 PID][u32 作业活动进程数][u32 作业累计进程数][u64 作业 CPU 毫秒]`
+/// `[u64 作业峰值内存][u8 指标数]`，每个指标为名称字符串与
+/// `[f64 last][f64 min][f64 max][f64 mean][u32 采样数][u64 距上次上报毫秒]`
+pub fn encode_status(items: &[ItemStatus], extended: bool, out: &mut Vec<u8>) {
+    out.extend_from_slice(&(items.len() as u32).to_le_bytes());
+
+    for item in items {
+        let mut state = 0u8;
+        if item.enabled {
+            state |= STATUS_ENABLED;
+        }
+        if item.is_alive {
+            state |= STATUS_ALIVE;
+        }
+        if item.is_heartbeat_ok {
+            state |= STATUS_HEARTBEAT_OK;
+        }
+        if item.restart_pending {
+            state |= STATUS_RESTART_PENDING;
+        }
+
+        out.extend_from_slice(&item.process_id.unwrap_or(0).to_le_bytes());
+        out.extend_from_slice(&item.restart_count.to_le_bytes());
+        out.extend_from_slice(&item.last_heartbeat_ms.to_le_bytes());
+        out.extend_from_slice(&item.heartbeat_timeout_ms.to_le_bytes());
+        out.push(state);
+        put_str(out, &item.id);
+        put_str(out, &item.name);
+        put_str(out, &item.exe_path);
+        put_str(out, item.last_restart_reason.as_deref().unwrap_or(""));
+        if extended {
+            encode_status_extension(item, out);
+        }
+    }
+}
+
+fn encode_status_extension(item: &ItemStatus, out: &mut Vec<u8>) {
+    let mut state = 0u8;
+    if item.job.is_some() {
+        state |= STATUS_HAS_JOB;
+    }
+    if item.is_ready {
+        state |= STATUS_READY;
+    }
+    if let Some(standby) = &item.standby {
+        state |= STATUS_HAS_STANDBY;
+        if standby.is_ready {
+            state |= STATUS_STANDBY_READY;
+        }
+    }
+    out.push(state);
+    let standby_pid = item
+        .standby
+        .as_ref()
+        .map_or(0, |standby| standby.process_id);
+    out.extend_from_slice(&standby_pid.to_le_bytes());
+
+    let job = item.job.unwrap_or_default();
+    out.extend_from_slice(&job.active_processes.to_le_bytes());
+    out.extend_from_slice(&job.total_processes.to_le_bytes());
+    out.extend_from_slice(&job.cpu_time_ms.to_le_bytes());
+    out.extend_from_slice(&job.peak_memory_bytes.to_le_bytes());
+
+    // 每个监控项最多 MAX_GAUGES 个指标，u8 足够
+    let gauges = item.gauges.as_ref();
+    out.push(gauges.map_or(0, |gauges| gauges.len().min(u8::MAX as usize) as u8));
+    for (name, stats) in gauges.into_iter().flatten().take(u8::MAX as usize) {
+        put_str(out, name);
+        for value in [stats.last, stats.min, stats.max, stats.mean] {
+            out.extend_from_slice(&value.to_le_bytes());
+        }
+        out.extend_from_slice(&(stats.samples as u32).to_le_bytes());
+        out.extend_from_slice(&stats.age_ms.to_le_bytes());
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{
+        encode_status, is_wire_message, put_str, WireError, WireHeader, WireReader, FLAG_OK,
+        OP_HEARTBEAT, OP_REPLY, WIRE_HEADER_SIZE,
+    };
+    use crate::gauges::GaugeStats;
+    use crate::job_object::JobAccounting;
+    use crate::models::{ItemStatus, StandbyStatus};
+    use std::collections::BTreeMap;
+
+    #[test]
+    fn header_round_trips_and_is_distinguishable_from_json() {
+        let header = WireHeader {
+            opcode: OP_HEARTBEAT,
+            flags: 0x0102,
+            item_index: 7,
+            timestamp: -42,
+        };
+        let mut encoded = Vec::new();
+        header.encode(&mut encoded);
+        encoded.extend_from_slice(b"body");
+
+        assert_eq!(encoded.len(), WIRE_HEADER_SIZE + 4);
+        assert!(is_wire_message(&encoded));
+        assert!(!is_wire_message(br#"{"type":"heartbeat"}"#));
+        assert_eq!(WireHeader::decode(&encoded), Ok((header, &b"body"[..])));
+
+        let reply = WireHeader::reply(&header, true);
+        assert_eq!(reply.opcode, OP_HEARTBEAT | OP_REPLY);
+        assert_eq!(reply.flags, FLAG_OK);
+    }
+
+    #[test]
+    fn rejects_truncated_header_and_strings() {
+        assert_eq!(WireHeader::decode(&[0xB7, 1, 0]), Err(WireError::Truncated));
+
+        let mut body = Vec::new();
+        put_str(&mut body, "EnergyMonitor");
+        let mut reader = WireReader::new(&body[..body.len() - 1]);
+        assert_eq!(reader.read_str(), Err(WireError::Truncated));
+
+        let mut reader = WireReader::new(&body);
+        assert_eq!(reader.read_str(), Ok("EnergyMonitor"));
+        assert!(reader.is_empty());
+
+        let mut reader = WireReader::new(&[7, 0, 0]);
+        assert_eq!(reader.read_u32(), Err(WireError::Truncated));
+
+        let mut body = 0x0102_0304_0506_0708u64.to_le_bytes().to_vec();
+        body.extend_from_slice(&9u32.to_le_bytes());
+        let mut reader = WireReader::new(&body);
+        assert_eq!(reader.read_u64(), Ok(0x0102_0304_0506_0708));
+        assert_eq!(reader.read_u32(), Ok(9));
+        assert_eq!(reader.read_u64(), Err(WireError::Truncated));
+    }
+
+    #[test]
+    fn long_strings_are_truncated_on_char_boundary() {
+        // 3 字节的汉字，u16::MAX 恰好落在字符中间
+        let value = "监".repeat(u16::MAX as usize / 3 + 1);
+        let mut body = Vec::new();
+        put_str(&mut body, &value);
+
+        let text = WireReader::new(&body).read_str().unwrap();
+        assert_eq!(text.len(), u16::MAX as usize);
+        assert!(value.starts_with(text));
+
+        let mut body = Vec::new();
+        put_str(&mut body, &format!("a{}", value));
+        let text = WireReader::new(&body).read_str().unwrap();
+        assert_eq!(text.len(), u16::MAX as usize - 2);
+    }
+
+    #[test]
+    fn status_record_has_fixed_prefix_and_strings() {
+        let items = vec![ItemStatus {
+            id: "a".to_string(),
+            name: "bc".to_string(),
+            exe_path: String::new(),
+            enabled: true,
+            process_id: None,
+            last_heartbeat_ms: 5,
+            heartbeat_timeout_ms: 1000,
+            restart_count: 2,
+            restart_pending: false,
+            last_restart_reason: None,
+            is_alive: false,
+            is_heartbeat_ok: true,
+            job: None,
+            gauges: None,
+            is_ready: false,
+            standby: None,
+        }];
+        let mut out = Vec::new();
+        encode_status(&items, false, &mut out);
+
+        // 4 数量 + 4+4+8+8+1 定长字段 + 4 个字符串长度 + 3 字节字符串
+        assert_eq!(out.len(), 4 + 25 + 8 + 3);
+        assert_eq!(&out[..4], &1u32.to_le_bytes());
+        assert_eq!(out[4 + 24], 0x01 | 0x04);
+    }
+
+    #[test]
+    fn extended_status_carries_job_ready_standby_and_gauges() {
+        let mut gauges = BTreeMap::new();
+        gauges.insert(
+            "queue_depth".to_string(),
+            GaugeStats {
+                last: 3.0,
+                min: 1.0,
+                max: 7.5,
+                mean: 4.25,
+                samples: 12,
+                age_ms: 40,
+            },
+        );
+        let items = vec![ItemStatus {
+            id: "a".to_string(),
+            name: String::new(),
+            exe_path: String::new(),
+            enabled: true,
+            process_id: Some(10),
+            last_heartbeat_ms: 5,
+            heartbeat_timeout_ms: 1000,
+            restart_count: 0,
+            restart_pending: false,
+            last_restart_reason: None,
+            is_alive: true,
+            is_heartbeat_ok: true,
+            job: Some(JobAccounting {
+                active_processes: 2,
+                total_processes: 5,
+                cpu_time_ms: 1_234,
+                peak_memory_bytes: 1 << 33,
+            }),
+            gauges: Some(gauges),
+            is_ready: true,
+            standby: Some(StandbyStatus {
+                process_id: 20,
+                is_ready: false,
+            }),
+        }];
+        let mut out = Vec::new();
+        encode_status(&items, true, &mut out);
+
+        let mut reader = WireReader::new(&out);
+        assert_eq!(reader.read_u32(), Ok(1));
+        // 跳过定长字段与四个字符串
+        reader.take(25).unwrap();
+        for _ in 0..4 {
+            reader.read_str().unwrap();
+        }
+
+        assert_eq!(reader.take(1), Ok(&[0x01 | 0x02 | 0x04][..]));
+        assert_eq!(reader.read_u32(), Ok(20));
+        assert_eq!(reader.read_u32(), Ok(2));
+        assert_eq!(reader.read_u32(), Ok(5));
+        assert_eq!(reader.read_u64(), Ok(1_234));
+        assert_eq!(reader.read_u64(), Ok(1 << 33));
+        assert_eq!(reader.take(1), Ok(&[1][..]));
+        assert_eq!(reader.read_str(), Ok("queue_depth"));
+        let values: Vec<f64> = (0..4)
+            .map(|_| f64::from_bits(reader.read_u64().unwrap()))
+            .collect();
+        assert_eq!(values, [3.0, 1.0, 7.5, 4.25]);
+        assert_eq!(reader.read_u32(), Ok(12));
+        assert_eq!(reader.read_u64(), Ok(40));
+        assert!(reader.is_empty());
+    }
+}